@@ -1,8 +1,8 @@
 
 #include "assembler/assemble.hpp"
+#include "instructions.hpp"
 #include "logging/aixlog.hpp"
 #include "types.hpp"
-#include <libskiff/bytecode/instructions.hpp>
 #include <libskiff/generator/binary_generator.hpp>
 #include <libskiff/generator/instruction_generator.hpp>
 
@@ -15,64 +15,152 @@
 #include <regex>
 #include <set>
 #include <sstream>
+#include <tuple>
 #include <unordered_map>
 
 namespace skiff {
 namespace assembler {
 namespace {
 
+//! \brief What a vector mnemonic encodes
+struct vector_mnemonic_t {
+  uint8_t opcode;
+  uint8_t operation;
+  skiff::instructions::vector_lane_e lane;
+};
+
+//! \brief Retrieve every vector mnemonic, each operation suffixed with the
+//!        type of its lanes, e.g. `vadd_u32`
+inline std::unordered_map<std::string, vector_mnemonic_t>
+get_vector_mnemonics()
+{
+  using skiff::instructions::vector_lane_e;
+  using skiff::instructions::vector_op_e;
+  using skiff::instructions::vector_reduction_e;
+
+  struct operation_t {
+    std::string name;
+    uint8_t opcode;
+    uint8_t operation;
+  };
+  const std::vector<operation_t> operations = {
+      {"vadd", skiff::instructions::VECTOR,
+       static_cast<uint8_t>(vector_op_e::ADD)},
+      {"vsub", skiff::instructions::VECTOR,
+       static_cast<uint8_t>(vector_op_e::SUB)},
+      {"vmul", skiff::instructions::VECTOR,
+       static_cast<uint8_t>(vector_op_e::MUL)},
+      {"vmin", skiff::instructions::VECTOR,
+       static_cast<uint8_t>(vector_op_e::MIN)},
+      {"vmax", skiff::instructions::VECTOR,
+       static_cast<uint8_t>(vector_op_e::MAX)},
+      {"vsum", skiff::instructions::VECTOR_REDUCE,
+       static_cast<uint8_t>(vector_reduction_e::SUM)},
+      {"vhmin", skiff::instructions::VECTOR_REDUCE,
+       static_cast<uint8_t>(vector_reduction_e::MIN)},
+      {"vhmax", skiff::instructions::VECTOR_REDUCE,
+       static_cast<uint8_t>(vector_reduction_e::MAX)},
+      {"vdot", skiff::instructions::VECTOR_DOT, 0}};
+
+  const std::vector<std::tuple<std::string, vector_lane_e>> lanes = {
+      {"_u8", vector_lane_e::U8},
+      {"_u32", vector_lane_e::U32},
+      {"_u64", vector_lane_e::U64},
+      {"_f64", vector_lane_e::F64}};
+
+  std::unordered_map<std::string, vector_mnemonic_t> mnemonics;
+  for (auto &operation : operations) {
+    for (auto &[suffix, lane] : lanes) {
+      mnemonics[operation.name + suffix] = {operation.opcode,
+                                            operation.operation, lane};
+    }
+  }
+  return mnemonics;
+}
+
 inline std::unordered_map<std::string, uint8_t> get_string_to_instruction_map()
 {
-  return {{"nop", libskiff::bytecode::instructions::NOP},
-          {"exit", libskiff::bytecode::instructions::EXIT},
-          {"blt", libskiff::bytecode::instructions::BLT},
-          {"bgt", libskiff::bytecode::instructions::BGT},
-          {"beq", libskiff::bytecode::instructions::BEQ},
-          {"jmp", libskiff::bytecode::instructions::JMP},
-          {"call", libskiff::bytecode::instructions::CALL},
-          {"ret", libskiff::bytecode::instructions::RET},
-          {"mov", libskiff::bytecode::instructions::MOV},
-          {"add", libskiff::bytecode::instructions::ADD},
-          {"sub", libskiff::bytecode::instructions::SUB},
-          {"div", libskiff::bytecode::instructions::DIV},
-          {"mul", libskiff::bytecode::instructions::MUL},
-          {"addf", libskiff::bytecode::instructions::ADDF},
-          {"subf", libskiff::bytecode::instructions::SUBF},
-          {"divf", libskiff::bytecode::instructions::DIVF},
-          {"mulf", libskiff::bytecode::instructions::MULF},
-          {"lsh", libskiff::bytecode::instructions::LSH},
-          {"rsh", libskiff::bytecode::instructions::RSH},
-          {"and", libskiff::bytecode::instructions::AND},
-          {"or", libskiff::bytecode::instructions::OR},
-          {"xor", libskiff::bytecode::instructions::XOR},
-          {"not", libskiff::bytecode::instructions::NOT},
-          {"bltf", libskiff::bytecode::instructions::BLTF},
-          {"bgtf", libskiff::bytecode::instructions::BGTF},
-          {"beqf", libskiff::bytecode::instructions::BEQF},
-          {"aseq", libskiff::bytecode::instructions::ASEQ},
-          {"asne", libskiff::bytecode::instructions::ASNE},
-          {"push_w", libskiff::bytecode::instructions::PUSH_W},
-          {"push_dw", libskiff::bytecode::instructions::PUSH_DW},
-          {"push_qw", libskiff::bytecode::instructions::PUSH_QW},
-          {"pop_w", libskiff::bytecode::instructions::POP_W},
-          {"pop_dw", libskiff::bytecode::instructions::POP_DW},
-          {"pop_qw", libskiff::bytecode::instructions::POP_QW},
-          {"alloc", libskiff::bytecode::instructions::ALLOC},
-          {"free", libskiff::bytecode::instructions::FREE},
-          {"sw", libskiff::bytecode::instructions::SW},
-          {"sdw", libskiff::bytecode::instructions::SDW},
-          {"sqw", libskiff::bytecode::instructions::SQW},
-          {"lw", libskiff::bytecode::instructions::LW},
-          {"ldw", libskiff::bytecode::instructions::LDW},
-          {"lqw", libskiff::bytecode::instructions::LQW},
-          {"syscall", libskiff::bytecode::instructions::SYSCALL},
-          {"debug", libskiff::bytecode::instructions::DEBUG},
-          {"eirq", libskiff::bytecode::instructions::EIRQ},
-          {"dirq", libskiff::bytecode::instructions::DIRQ},
-          {"push_hw", libskiff::bytecode::instructions::PUSH_HW},
-          {"pop_hw", libskiff::bytecode::instructions::POP_HW},
-          {"shw", libskiff::bytecode::instructions::SHW},
-          {"lhw", libskiff::bytecode::instructions::LHW}};
+  std::unordered_map<std::string, uint8_t> map = {
+      {"nop", libskiff::bytecode::instructions::NOP},
+      {"exit", libskiff::bytecode::instructions::EXIT},
+      {"blt", libskiff::bytecode::instructions::BLT},
+      {"bgt", libskiff::bytecode::instructions::BGT},
+      {"beq", libskiff::bytecode::instructions::BEQ},
+      {"jmp", libskiff::bytecode::instructions::JMP},
+      {"call", libskiff::bytecode::instructions::CALL},
+      {"ret", libskiff::bytecode::instructions::RET},
+      {"mov", libskiff::bytecode::instructions::MOV},
+      {"add", libskiff::bytecode::instructions::ADD},
+      {"sub", libskiff::bytecode::instructions::SUB},
+      {"div", libskiff::bytecode::instructions::DIV},
+      {"mul", libskiff::bytecode::instructions::MUL},
+      {"addf", libskiff::bytecode::instructions::ADDF},
+      {"subf", libskiff::bytecode::instructions::SUBF},
+      {"divf", libskiff::bytecode::instructions::DIVF},
+      {"mulf", libskiff::bytecode::instructions::MULF},
+      {"lsh", libskiff::bytecode::instructions::LSH},
+      {"rsh", libskiff::bytecode::instructions::RSH},
+      {"and", libskiff::bytecode::instructions::AND},
+      {"or", libskiff::bytecode::instructions::OR},
+      {"xor", libskiff::bytecode::instructions::XOR},
+      {"not", libskiff::bytecode::instructions::NOT},
+      {"bltf", libskiff::bytecode::instructions::BLTF},
+      {"bgtf", libskiff::bytecode::instructions::BGTF},
+      {"beqf", libskiff::bytecode::instructions::BEQF},
+      {"aseq", libskiff::bytecode::instructions::ASEQ},
+      {"asne", libskiff::bytecode::instructions::ASNE},
+      {"push_w", libskiff::bytecode::instructions::PUSH_W},
+      {"push_dw", libskiff::bytecode::instructions::PUSH_DW},
+      {"push_qw", libskiff::bytecode::instructions::PUSH_QW},
+      {"pop_w", libskiff::bytecode::instructions::POP_W},
+      {"pop_dw", libskiff::bytecode::instructions::POP_DW},
+      {"pop_qw", libskiff::bytecode::instructions::POP_QW},
+      {"alloc", libskiff::bytecode::instructions::ALLOC},
+      {"free", libskiff::bytecode::instructions::FREE},
+      {"realloc", skiff::instructions::REALLOC},
+      {"ssw", skiff::instructions::STACK_STORE_W},
+      {"ssdw", skiff::instructions::STACK_STORE_DW},
+      {"ssqw", skiff::instructions::STACK_STORE_QW},
+      {"lsw", skiff::instructions::STACK_LOAD_W},
+      {"lsdw", skiff::instructions::STACK_LOAD_DW},
+      {"lsqw", skiff::instructions::STACK_LOAD_QW},
+      {"pushm", skiff::instructions::PUSH_MULTIPLE},
+      {"popm", skiff::instructions::POP_MULTIPLE},
+      {"addi", skiff::instructions::ADD_IMMEDIATE},
+      {"subi", skiff::instructions::SUB_IMMEDIATE},
+      {"muli", skiff::instructions::MUL_IMMEDIATE},
+      {"lshi", skiff::instructions::LSH_IMMEDIATE},
+      {"rshi", skiff::instructions::RSH_IMMEDIATE},
+      {"andi", skiff::instructions::AND_IMMEDIATE},
+      {"ori", skiff::instructions::OR_IMMEDIATE},
+      {"blti", skiff::instructions::BLT_IMMEDIATE},
+      {"bgti", skiff::instructions::BGT_IMMEDIATE},
+      {"beqi", skiff::instructions::BEQ_IMMEDIATE},
+      {"sw", libskiff::bytecode::instructions::SW},
+      {"sdw", libskiff::bytecode::instructions::SDW},
+      {"sqw", libskiff::bytecode::instructions::SQW},
+      {"lw", libskiff::bytecode::instructions::LW},
+      {"ldw", libskiff::bytecode::instructions::LDW},
+      {"lqw", libskiff::bytecode::instructions::LQW},
+      {"syscall", libskiff::bytecode::instructions::SYSCALL},
+      {"debug", libskiff::bytecode::instructions::DEBUG},
+      {"eirq", libskiff::bytecode::instructions::EIRQ},
+      {"dirq", libskiff::bytecode::instructions::DIRQ},
+      {"push_hw", libskiff::bytecode::instructions::PUSH_HW},
+      {"pop_hw", libskiff::bytecode::instructions::POP_HW},
+      {"shw", libskiff::bytecode::instructions::SHW},
+      {"lhw", libskiff::bytecode::instructions::LHW},
+      {"region_begin", skiff::instructions::REGION_BEGIN},
+      {"region_free", skiff::instructions::REGION_FREE},
+      {"mcpy", skiff::instructions::MEMORY_COPY},
+      {"mset", skiff::instructions::MEMORY_FILL},
+      {"mcmp", skiff::instructions::MEMORY_COMPARE},
+  };
+
+  for (auto &[mnemonic, entry] : get_vector_mnemonics()) {
+    map[mnemonic] = entry.opcode;
+  }
+  return map;
 }
 
 template <class T> std::optional<T> get_number(const std::string value)
@@ -1170,6 +1258,339 @@ bool build_free(const instruction_data_t &ins, assembler_data_t &adt)
   return true;
 }
 
+bool build_region_begin(const instruction_data_t &ins, assembler_data_t &adt)
+{
+  LOG(DEBUG) << TAG("assembler:func") << __func__ << "\n";
+  auto [success, val] = validate_one_reg_instruction("REGION_BEGIN", ins, adt);
+  if (!success) {
+    return false;
+  }
+  adt.bin_generator.add_instruction(
+      skiff::instructions::gen_region_begin(val));
+  return true;
+}
+
+bool build_region_free(const instruction_data_t &ins, assembler_data_t &adt)
+{
+  LOG(DEBUG) << TAG("assembler:func") << __func__ << "\n";
+  auto [success, val] = validate_one_reg_instruction("REGION_FREE", ins, adt);
+  if (!success) {
+    return false;
+  }
+  adt.bin_generator.add_instruction(skiff::instructions::gen_region_free(val));
+  return true;
+}
+
+std::tuple<bool, std::vector<uint8_t>>
+validate_n_reg_instruction(std::string kind, const instruction_data_t &ins,
+                           assembler_data_t &adt, const std::size_t count)
+{
+  std::string location_information =
+      "line " + std::to_string(ins.line_data.line_number);
+
+  if (ins.line_data.pieces.size() != count + 1) {
+    add_issue(location_information, "phase 4",
+              "Malformed " + kind + " instruction", adt, true);
+    return {false, {}};
+  }
+
+  std::vector<uint8_t> registers;
+  for (std::size_t i = 1; i <= count; i++) {
+    auto value = adt.ins_generator.get_register_value(ins.line_data.pieces[i]);
+    if (value == std::nullopt) {
+      add_issue(location_information, "phase 4",
+                "Invalid register " + ins.line_data.pieces[i], adt, true);
+      return {false, {}};
+    }
+    registers.push_back(*value);
+  }
+
+  return {true, registers};
+}
+
+bool build_realloc(const instruction_data_t &ins, assembler_data_t &adt)
+{
+  LOG(DEBUG) << TAG("assembler:func") << __func__ << "\n";
+  auto [success, r] = validate_n_reg_instruction("REALLOC", ins, adt, 2);
+  if (!success) {
+    return false;
+  }
+  adt.bin_generator.add_instruction(
+      skiff::instructions::gen_realloc(r[0], r[1]));
+  return true;
+}
+
+bool build_memory_copy(const instruction_data_t &ins, assembler_data_t &adt)
+{
+  LOG(DEBUG) << TAG("assembler:func") << __func__ << "\n";
+  auto [success, r] = validate_n_reg_instruction("MEMORY_COPY", ins, adt, 5);
+  if (!success) {
+    return false;
+  }
+  adt.bin_generator.add_instruction(
+      skiff::instructions::gen_memory_copy(r[0], r[1], r[2], r[3], r[4]));
+  return true;
+}
+
+bool build_memory_fill(const instruction_data_t &ins, assembler_data_t &adt)
+{
+  LOG(DEBUG) << TAG("assembler:func") << __func__ << "\n";
+  auto [success, r] = validate_n_reg_instruction("MEMORY_FILL", ins, adt, 4);
+  if (!success) {
+    return false;
+  }
+  adt.bin_generator.add_instruction(
+      skiff::instructions::gen_memory_fill(r[0], r[1], r[2], r[3]));
+  return true;
+}
+
+bool build_memory_compare(const instruction_data_t &ins, assembler_data_t &adt)
+{
+  LOG(DEBUG) << TAG("assembler:func") << __func__ << "\n";
+  auto [success, r] =
+      validate_n_reg_instruction("MEMORY_COMPARE", ins, adt, 6);
+  if (!success) {
+    return false;
+  }
+  adt.bin_generator.add_instruction(skiff::instructions::gen_memory_compare(
+      r[0], r[1], r[2], r[3], r[4], r[5]));
+  return true;
+}
+
+bool build_vector(const instruction_data_t &ins, assembler_data_t &adt)
+{
+  LOG(DEBUG) << TAG("assembler:func") << __func__ << "\n";
+  auto mnemonics = get_vector_mnemonics();
+  auto entry = mnemonics.find(ins.line_data.pieces[0]);
+  if (entry == mnemonics.end()) {
+    return false;
+  }
+  auto [opcode, operation, lane] = entry->second;
+
+  switch (opcode) {
+  case skiff::instructions::VECTOR: {
+    auto [success, r] = validate_n_reg_instruction("VECTOR", ins, adt, 7);
+    if (!success) {
+      return false;
+    }
+    adt.bin_generator.add_instruction(skiff::instructions::gen_vector(
+        static_cast<skiff::instructions::vector_op_e>(operation), lane, r[0],
+        r[1], r[2], r[3], r[4], r[5], r[6]));
+    return true;
+  }
+  case skiff::instructions::VECTOR_REDUCE: {
+    auto [success, r] =
+        validate_n_reg_instruction("VECTOR_REDUCE", ins, adt, 4);
+    if (!success) {
+      return false;
+    }
+    adt.bin_generator.add_instruction(skiff::instructions::gen_vector_reduce(
+        static_cast<skiff::instructions::vector_reduction_e>(operation), lane,
+        r[0], r[1], r[2], r[3]));
+    return true;
+  }
+  case skiff::instructions::VECTOR_DOT: {
+    auto [success, r] = validate_n_reg_instruction("VECTOR_DOT", ins, adt, 6);
+    if (!success) {
+      return false;
+    }
+    adt.bin_generator.add_instruction(skiff::instructions::gen_vector_dot(
+        lane, r[0], r[1], r[2], r[3], r[4], r[5]));
+    return true;
+  }
+  }
+  return false;
+}
+
+//  Stack accesses take a base register, a signed offset from it given as a
+//  raw value, and the register stored or loaded
+bool build_stack_access(const instruction_data_t &ins, assembler_data_t &adt)
+{
+  LOG(DEBUG) << TAG("assembler:func") << __func__ << "\n";
+
+  std::string location_information =
+      "line " + std::to_string(ins.line_data.line_number);
+
+  auto opcode = get_string_to_instruction_map().at(ins.line_data.pieces[0]);
+  if (ins.line_data.pieces.size() != 4) {
+    add_issue(location_information, "phase 4",
+              "Malformed stack access instruction", adt, true);
+    return false;
+  }
+
+  auto base = adt.ins_generator.get_register_value(ins.line_data.pieces[1]);
+  auto reg = adt.ins_generator.get_register_value(ins.line_data.pieces[3]);
+  if (base == std::nullopt || reg == std::nullopt) {
+    add_issue(location_information, "phase 4",
+              "Invalid register given to stack access instruction", adt,
+              true);
+    return false;
+  }
+
+  auto &offset_piece = ins.line_data.pieces[2];
+  auto offset = offset_piece.starts_with('@')
+                    ? get_number<int64_t>(offset_piece.substr(1))
+                    : std::nullopt;
+  if (offset == std::nullopt ||
+      *offset < std::numeric_limits<int32_t>::min() ||
+      *offset > std::numeric_limits<int32_t>::max()) {
+    add_issue(location_information, "phase 4",
+              "Stack offset must be a raw value that fits in 32 bits", adt,
+              true);
+    return false;
+  }
+
+  adt.bin_generator.add_instruction(skiff::instructions::gen_stack_access(
+      opcode, *base, static_cast<int32_t>(*offset), *reg));
+  return true;
+}
+
+//  Pushing and popping several registers takes a list of them, each of
+//  which sets a bit of the mask that is encoded
+bool build_register_mask(const instruction_data_t &ins, assembler_data_t &adt)
+{
+  LOG(DEBUG) << TAG("assembler:func") << __func__ << "\n";
+
+  std::string location_information =
+      "line " + std::to_string(ins.line_data.line_number);
+
+  auto opcode = get_string_to_instruction_map().at(ins.line_data.pieces[0]);
+  if (ins.line_data.pieces.size() < 2) {
+    add_issue(location_information, "phase 4",
+              "Malformed " + ins.line_data.pieces[0] + " instruction", adt,
+              true);
+    return false;
+  }
+
+  uint32_t mask{0};
+  for (std::size_t i = 1; i < ins.line_data.pieces.size(); i++) {
+    auto &piece = ins.line_data.pieces[i];
+    auto value = adt.ins_generator.get_register_value(piece);
+    bool okay{false};
+    uint8_t bit{0};
+    if (value) {
+      std::tie(okay, bit) = skiff::instructions::get_register_mask_bit(*value);
+    }
+    if (!okay) {
+      add_issue(location_information, "phase 4",
+                "Only integer and floating point registers can be given to " +
+                    ins.line_data.pieces[0] + ", not " + piece,
+                adt, true);
+      return false;
+    }
+    if (mask & (uint32_t{1} << bit)) {
+      add_issue(location_information, "phase 4",
+                "Register " + piece + " given more than once", adt, true);
+      return false;
+    }
+    mask |= uint32_t{1} << bit;
+  }
+
+  adt.bin_generator.add_instruction(
+      skiff::instructions::gen_register_mask(opcode, mask));
+  return true;
+}
+
+//  Arithmetic with an immediate takes its right hand side as a value, given
+//  the same way as the value of a mov
+bool build_arithmetic_immediate(const instruction_data_t &ins,
+                                assembler_data_t &adt)
+{
+  LOG(DEBUG) << TAG("assembler:func") << __func__ << "\n";
+
+  std::string location_information =
+      "line " + std::to_string(ins.line_data.line_number);
+
+  auto &mnemonic = ins.line_data.pieces[0];
+  auto opcode = get_string_to_instruction_map().at(mnemonic);
+  if (ins.line_data.pieces.size() != 4) {
+    add_issue(location_information, "phase 4",
+              "Malformed " + mnemonic + " instruction", adt, true);
+    return false;
+  }
+
+  auto dest = adt.ins_generator.get_register_value(ins.line_data.pieces[1]);
+  auto lhs = adt.ins_generator.get_register_value(ins.line_data.pieces[2]);
+  if (dest == std::nullopt || lhs == std::nullopt) {
+    add_issue(location_information, "phase 4",
+              "Invalid register given to instruction", adt, true);
+    return false;
+  }
+
+  auto value =
+      get_const_value(ins.line_data.line_number, ins.line_data.pieces[3], adt);
+  if (value == std::nullopt) {
+    add_issue(location_information, "phase 4",
+              "Unable to retrieve value for " + mnemonic + " instruction", adt,
+              true);
+    return false;
+  }
+
+  if ((opcode == skiff::instructions::LSH_IMMEDIATE ||
+       opcode == skiff::instructions::RSH_IMMEDIATE) &&
+      *value >= skiff::instructions::num_shift_bits) {
+    add_issue(location_information, "phase 4",
+              "Shift amount given to " + mnemonic + " must be less than " +
+                  std::to_string(skiff::instructions::num_shift_bits),
+              adt, true);
+    return false;
+  }
+
+  adt.bin_generator.add_instruction(
+      skiff::instructions::gen_arithmetic_immediate(opcode, *dest, *lhs,
+                                                    *value));
+  return true;
+}
+
+//  Branches against an immediate compare a register with a value that fits
+//  in 32 bits once sign extended, then take a label like any other branch
+bool build_branch_immediate(const instruction_data_t &ins,
+                            assembler_data_t &adt)
+{
+  LOG(DEBUG) << TAG("assembler:func") << __func__ << "\n";
+
+  std::string location_information =
+      "line " + std::to_string(ins.line_data.line_number);
+
+  auto &mnemonic = ins.line_data.pieces[0];
+  auto opcode = get_string_to_instruction_map().at(mnemonic);
+  if (ins.line_data.pieces.size() != 4) {
+    add_issue(location_information, "phase 4",
+              "Malformed " + mnemonic + " instruction", adt, true);
+    return false;
+  }
+
+  auto lhs = adt.ins_generator.get_register_value(ins.line_data.pieces[1]);
+  if (lhs == std::nullopt) {
+    add_issue(location_information, "phase 4",
+              "Invalid register given to instruction", adt, true);
+    return false;
+  }
+
+  auto value =
+      get_const_value(ins.line_data.line_number, ins.line_data.pieces[2], adt);
+  auto signed_value = static_cast<int64_t>(value.value_or(0));
+  if (value == std::nullopt ||
+      signed_value < std::numeric_limits<int32_t>::min() ||
+      signed_value > std::numeric_limits<int32_t>::max()) {
+    add_issue(location_information, "phase 4",
+              "Value given to " + mnemonic + " must fit in 32 bits", adt,
+              true);
+    return false;
+  }
+
+  auto address = get_label_address(ins.line_data.pieces[3], adt);
+  if (address == std::nullopt) {
+    add_issue(location_information, "phase 4",
+              "Unknown label " + ins.line_data.pieces[3], adt, true);
+    return false;
+  }
+
+  adt.bin_generator.add_instruction(skiff::instructions::gen_branch_immediate(
+      opcode, *lhs, static_cast<int32_t>(signed_value), *address));
+  return true;
+}
+
 bool build_push_w(const instruction_data_t &ins, assembler_data_t &adt)
 {
   LOG(DEBUG) << TAG("assembler:func") << __func__ << "\n";
@@ -1587,7 +2008,7 @@ bool phase_2(std::vector<std::tuple<uint64_t, std::string>> &raw_file_data,
 {
   auto string_to_instruction_map = get_string_to_instruction_map();
   auto instruction_to_size_map =
-      libskiff::bytecode::instructions::get_instruction_to_size_map();
+      skiff::instructions::get_instruction_to_size_map();
 
   adt.code_found = false;
   uint64_t num_instructions{0};
@@ -1814,7 +2235,34 @@ bool phase_4(assembler_data_t &adt)
       {"ldw", build_load_dw},     {"lqw", build_load_qw},
       {"lhw", build_load_hw},     {"shw", build_store_hw},
       {"pop_hw", build_pop_hw},   {"push_hw", build_push_hw},
+      {"region_begin", build_region_begin},
+      {"region_free", build_region_free},
+      {"mcpy", build_memory_copy},
+      {"mset", build_memory_fill},
+      {"mcmp", build_memory_compare},
+      {"realloc", build_realloc},
+      {"ssw", build_stack_access},
+      {"ssdw", build_stack_access},
+      {"ssqw", build_stack_access},
+      {"lsw", build_stack_access},
+      {"lsdw", build_stack_access},
+      {"lsqw", build_stack_access},
+      {"pushm", build_register_mask},
+      {"popm", build_register_mask},
+      {"addi", build_arithmetic_immediate},
+      {"subi", build_arithmetic_immediate},
+      {"muli", build_arithmetic_immediate},
+      {"lshi", build_arithmetic_immediate},
+      {"rshi", build_arithmetic_immediate},
+      {"andi", build_arithmetic_immediate},
+      {"ori", build_arithmetic_immediate},
+      {"blti", build_branch_immediate},
+      {"bgti", build_branch_immediate},
+      {"beqi", build_branch_immediate},
   };
+  for (auto &[mnemonic, entry] : get_vector_mnemonics()) {
+    ins_build_lit.push_back({mnemonic, build_vector});
+  }
 
   /*
     NOTE:
@@ -1912,6 +2360,7 @@ assembled_t assemble(const std::string &input)
     }
 
     adt.bin_generator.add_section(*section);
+    adt.result.labels[item.second] = item.first;
   }
 
   adt.result.bin = adt.bin_generator.generate_binary();
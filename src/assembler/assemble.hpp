@@ -1,6 +1,8 @@
 #ifndef SKIFF_ASSEMBLE_HPP
 #define SKIFF_ASSEMBLE_HPP
 
+#include <cstdint>
+#include <map>
 #include <optional>
 #include <string>
 #include <vector>
@@ -19,6 +21,7 @@ struct assembled_t {
   std::optional<std::vector<std::string>> errors;   //! Errors produced
   std::optional<std::vector<std::string>> warnings; //! Warnings produced
   std::optional<std::vector<uint8_t>> bin;          //! Resulting binary
+  std::map<uint64_t, std::string> labels;           //! Instruction to label
 };
 
 //! \brief Assemble
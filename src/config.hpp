@@ -8,6 +8,12 @@ namespace config {
 // These constants can be configured without issue
 static constexpr uint64_t stack_size_bytes = 1'048'576;
 
+// Return addresses the call stack can hold before a `call` fails
+static constexpr uint64_t call_stack_depth = 1'048'576;
+
+// Times a back-edge or call target is reached before it is compiled
+static constexpr uint32_t jit_hot_threshold = 1'000;
+
 // These constants should not be changed
 static constexpr uint8_t word_size_bytes = 2;
 static constexpr uint8_t h_word_size_bytes = 1;
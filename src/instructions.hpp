@@ -0,0 +1,358 @@
+#ifndef SKIFF_INSTRUCTIONS_HPP
+#define SKIFF_INSTRUCTIONS_HPP
+
+#include <libskiff/bytecode/instructions.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+/*
+    Instructions understood by skiff beyond those that libskiff defines.
+
+    They are encoded the same way, an opcode followed by its operands, but
+    their opcodes start well above any libskiff uses so that the two sets
+    never collide. Anything that needs the size of an instruction should
+    use the map here, which covers both sets.
+*/
+
+namespace skiff {
+namespace instructions {
+
+constexpr uint8_t REGION_BEGIN = 0x80;
+constexpr uint8_t REGION_FREE = 0x81;
+constexpr uint8_t MEMORY_COPY = 0x82;
+constexpr uint8_t MEMORY_FILL = 0x83;
+constexpr uint8_t MEMORY_COMPARE = 0x84;
+constexpr uint8_t VECTOR = 0x85;
+constexpr uint8_t VECTOR_REDUCE = 0x86;
+constexpr uint8_t VECTOR_DOT = 0x87;
+constexpr uint8_t REALLOC = 0x88;
+constexpr uint8_t STACK_STORE_W = 0x89;
+constexpr uint8_t STACK_STORE_DW = 0x8A;
+constexpr uint8_t STACK_STORE_QW = 0x8B;
+constexpr uint8_t STACK_LOAD_W = 0x8C;
+constexpr uint8_t STACK_LOAD_DW = 0x8D;
+constexpr uint8_t STACK_LOAD_QW = 0x8E;
+constexpr uint8_t PUSH_MULTIPLE = 0x8F;
+constexpr uint8_t POP_MULTIPLE = 0x90;
+constexpr uint8_t ADD_IMMEDIATE = 0x91;
+constexpr uint8_t SUB_IMMEDIATE = 0x92;
+constexpr uint8_t MUL_IMMEDIATE = 0x93;
+constexpr uint8_t LSH_IMMEDIATE = 0x94;
+constexpr uint8_t RSH_IMMEDIATE = 0x95;
+constexpr uint8_t AND_IMMEDIATE = 0x96;
+constexpr uint8_t OR_IMMEDIATE = 0x97;
+constexpr uint8_t BLT_IMMEDIATE = 0x98;
+constexpr uint8_t BGT_IMMEDIATE = 0x99;
+constexpr uint8_t BEQ_IMMEDIATE = 0x9A;
+
+//! \brief Number of registers a `pushm` or `popm` mask can select. Bits 0
+//!        through 9 select i0 through i9, and bits 10 through 19 select f0
+//!        through f9
+constexpr std::size_t num_mask_registers = 20;
+
+//! \brief Number of bits a register can be shifted by, `lshi` and `rshi`
+//!        amounts must be less than this
+constexpr uint64_t num_shift_bits = 64;
+
+//! \brief Type of each lane of a vector instruction
+enum class vector_lane_e : uint8_t { U8, U32, U64, F64 };
+constexpr std::size_t num_vector_lanes = 4;
+
+//! \brief Operation applied lane by lane by a `VECTOR` instruction
+enum class vector_op_e : uint8_t { ADD, SUB, MUL, MIN, MAX };
+constexpr std::size_t num_vector_ops = 5;
+
+//! \brief Operation combining every lane of a `VECTOR_REDUCE` instruction
+enum class vector_reduction_e : uint8_t { SUM, MIN, MAX };
+constexpr std::size_t num_vector_reductions = 3;
+
+//! \brief Retrieve the number of bytes in a lane
+inline uint8_t get_vector_lane_bytes(const vector_lane_e lane)
+{
+  switch (lane) {
+  case vector_lane_e::U8:
+    return 1;
+  case vector_lane_e::U32:
+    return 4;
+  case vector_lane_e::U64:
+  case vector_lane_e::F64:
+    return 8;
+  }
+  return 0;
+}
+
+//! \brief Combine an operation and a lane type into the byte that follows
+//!        the opcode of a vector instruction
+inline uint8_t encode_vector_kind(const uint8_t operation,
+                                  const vector_lane_e lane)
+{
+  return static_cast<uint8_t>(operation << 4 | static_cast<uint8_t>(lane));
+}
+
+//! \brief Split the kind byte of a vector instruction
+//! \returns Tuple with a success flag, the operation and the lane type. The
+//!          flag is false if either is out of range
+inline std::tuple<bool, uint8_t, vector_lane_e>
+decode_vector_kind(const uint8_t kind, const std::size_t num_operations)
+{
+  const uint8_t operation = kind >> 4;
+  const uint8_t lane = kind & 0x0F;
+  if (operation >= num_operations || lane >= num_vector_lanes) {
+    return {false, 0, vector_lane_e::U8};
+  }
+  return {true, operation, static_cast<vector_lane_e>(lane)};
+}
+
+//! \brief Retrieve the size in bytes of every instruction, opcode included
+inline std::unordered_map<uint8_t, uint8_t> get_instruction_to_size_map()
+{
+  auto map = libskiff::bytecode::instructions::get_instruction_to_size_map();
+  map[REGION_BEGIN] = 2;
+  map[REGION_FREE] = 2;
+  map[MEMORY_COPY] = 6;
+  map[MEMORY_FILL] = 5;
+  map[MEMORY_COMPARE] = 7;
+  map[VECTOR] = 9;
+  map[VECTOR_REDUCE] = 6;
+  map[VECTOR_DOT] = 8;
+  map[REALLOC] = 3;
+  for (auto opcode : {STACK_STORE_W, STACK_STORE_DW, STACK_STORE_QW,
+                      STACK_LOAD_W, STACK_LOAD_DW, STACK_LOAD_QW}) {
+    map[opcode] = 7;
+  }
+  map[PUSH_MULTIPLE] = 5;
+  map[POP_MULTIPLE] = 5;
+  for (auto opcode : {ADD_IMMEDIATE, SUB_IMMEDIATE, MUL_IMMEDIATE,
+                      LSH_IMMEDIATE, RSH_IMMEDIATE, AND_IMMEDIATE,
+                      OR_IMMEDIATE}) {
+    map[opcode] = 11;
+  }
+  for (auto opcode : {BLT_IMMEDIATE, BGT_IMMEDIATE, BEQ_IMMEDIATE}) {
+    map[opcode] = 14;
+  }
+  return map;
+}
+
+//! \brief Retrieve the bit of a `pushm` or `popm` mask that selects a
+//!        register
+//! \param id Id of the register as encoded in the bytecode
+//! \returns Tuple with a success flag and the bit. The flag is false if the
+//!          register is not an integer or floating point register
+inline std::tuple<bool, uint8_t> get_register_mask_bit(const uint8_t id)
+{
+  if (id >= 0x10 && id < 0x1A) {
+    return {true, static_cast<uint8_t>(id - 0x10)};
+  }
+  if (id >= 0x20 && id < 0x2A) {
+    return {true, static_cast<uint8_t>(id - 0x20 + 10)};
+  }
+  return {false, 0};
+}
+
+//! \brief Encode a `region_begin` instruction
+//! \param dest Register to receive the id of the region
+inline std::vector<uint8_t> gen_region_begin(const uint8_t dest)
+{
+  return {REGION_BEGIN, dest};
+}
+
+//! \brief Encode a `region_free` instruction
+//! \param region Register holding the id of the region to free
+inline std::vector<uint8_t> gen_region_free(const uint8_t region)
+{
+  return {REGION_FREE, region};
+}
+
+//! \brief Encode a `realloc` instruction
+//! \param slot Register holding the slot to resize
+//! \param size Register holding the number of bytes the slot should hold
+inline std::vector<uint8_t> gen_realloc(const uint8_t slot, const uint8_t size)
+{
+  return {REALLOC, slot, size};
+}
+
+//! \brief Encode a load from or store to the stack, relative to a register
+//! \param opcode One of the `STACK_STORE_*` or `STACK_LOAD_*` opcodes
+//! \param base Register holding the location the offset is taken from
+//! \param offset Signed number of bytes from the base to the value
+//! \param reg Register holding the value to store, or receiving the value
+//!            loaded
+inline std::vector<uint8_t> gen_stack_access(const uint8_t opcode,
+                                             const uint8_t base,
+                                             const int32_t offset,
+                                             const uint8_t reg)
+{
+  const auto bits = static_cast<uint32_t>(offset);
+  return {opcode,
+          base,
+          static_cast<uint8_t>(bits >> 24),
+          static_cast<uint8_t>(bits >> 16),
+          static_cast<uint8_t>(bits >> 8),
+          static_cast<uint8_t>(bits),
+          reg};
+}
+
+//! \brief Encode a `pushm` or `popm` instruction
+//! \param opcode Either `PUSH_MULTIPLE` or `POP_MULTIPLE`
+//! \param mask Registers to push or pop, see `num_mask_registers`
+inline std::vector<uint8_t> gen_register_mask(const uint8_t opcode,
+                                              const uint32_t mask)
+{
+  return {opcode, static_cast<uint8_t>(mask >> 24),
+          static_cast<uint8_t>(mask >> 16), static_cast<uint8_t>(mask >> 8),
+          static_cast<uint8_t>(mask)};
+}
+
+//! \brief Encode an arithmetic instruction that takes its right hand side
+//!        as a value rather than from a register
+//! \param opcode One of the `*_IMMEDIATE` arithmetic opcodes
+//! \param dest Register to receive the result
+//! \param lhs Register holding the left hand side
+//! \param value The right hand side
+inline std::vector<uint8_t> gen_arithmetic_immediate(const uint8_t opcode,
+                                                     const uint8_t dest,
+                                                     const uint8_t lhs,
+                                                     const uint64_t value)
+{
+  std::vector<uint8_t> encoded{opcode, dest, lhs};
+  for (auto i = 7; i >= 0; i--) {
+    encoded.push_back(static_cast<uint8_t>(value >> (i * 8)));
+  }
+  return encoded;
+}
+
+//! \brief Encode a branch that compares a register against a value
+//! \param opcode One of `BLT_IMMEDIATE`, `BGT_IMMEDIATE` or `BEQ_IMMEDIATE`
+//! \param lhs Register holding the left hand side
+//! \param value The right hand side, sign extended to 64 bits before the
+//!              unsigned comparison
+//! \param address Instruction to branch to
+inline std::vector<uint8_t> gen_branch_immediate(const uint8_t opcode,
+                                                 const uint8_t lhs,
+                                                 const int32_t value,
+                                                 const uint64_t address)
+{
+  const auto bits = static_cast<uint32_t>(value);
+  std::vector<uint8_t> encoded{opcode,
+                               lhs,
+                               static_cast<uint8_t>(bits >> 24),
+                               static_cast<uint8_t>(bits >> 16),
+                               static_cast<uint8_t>(bits >> 8),
+                               static_cast<uint8_t>(bits)};
+  for (auto i = 7; i >= 0; i--) {
+    encoded.push_back(static_cast<uint8_t>(address >> (i * 8)));
+  }
+  return encoded;
+}
+
+//! \brief Encode a `mcpy` instruction
+//! \param dest Register holding the slot to copy into
+//! \param dest_offset Register holding the offset to copy into
+//! \param source Register holding the slot to copy from
+//! \param source_offset Register holding the offset to copy from
+//! \param length Register holding the number of bytes to copy
+inline std::vector<uint8_t>
+gen_memory_copy(const uint8_t dest, const uint8_t dest_offset,
+                const uint8_t source, const uint8_t source_offset,
+                const uint8_t length)
+{
+  return {MEMORY_COPY, dest, dest_offset, source, source_offset, length};
+}
+
+//! \brief Encode a `mset` instruction
+//! \param slot Register holding the slot to fill
+//! \param offset Register holding the offset to start filling from
+//! \param length Register holding the number of bytes to fill
+//! \param value Register whose lowest byte is written to every byte
+inline std::vector<uint8_t> gen_memory_fill(const uint8_t slot,
+                                            const uint8_t offset,
+                                            const uint8_t length,
+                                            const uint8_t value)
+{
+  return {MEMORY_FILL, slot, offset, length, value};
+}
+
+//! \brief Encode a `mcmp` instruction
+//! \param dest Register to receive the result of the comparison
+//! \param lhs Register holding the first slot
+//! \param lhs_offset Register holding the offset into the first slot
+//! \param rhs Register holding the second slot
+//! \param rhs_offset Register holding the offset into the second slot
+//! \param length Register holding the number of bytes to compare
+inline std::vector<uint8_t>
+gen_memory_compare(const uint8_t dest, const uint8_t lhs,
+                   const uint8_t lhs_offset, const uint8_t rhs,
+                   const uint8_t rhs_offset, const uint8_t length)
+{
+  return {MEMORY_COMPARE, dest, lhs, lhs_offset, rhs, rhs_offset, length};
+}
+
+//! \brief Encode a `VECTOR` instruction, applying `op` to each lane
+//! \param dest Register holding the slot to write the results to
+//! \param dest_offset Register holding the offset to write the results to
+//! \param lhs Register holding the slot of the left hand lanes
+//! \param lhs_offset Register holding the offset of the left hand lanes
+//! \param rhs Register holding the slot of the right hand lanes
+//! \param rhs_offset Register holding the offset of the right hand lanes
+//! \param count Register holding the number of lanes
+inline std::vector<uint8_t>
+gen_vector(const vector_op_e op, const vector_lane_e lane, const uint8_t dest,
+           const uint8_t dest_offset, const uint8_t lhs,
+           const uint8_t lhs_offset, const uint8_t rhs,
+           const uint8_t rhs_offset, const uint8_t count)
+{
+  return {VECTOR,
+          encode_vector_kind(static_cast<uint8_t>(op), lane),
+          dest,
+          dest_offset,
+          lhs,
+          lhs_offset,
+          rhs,
+          rhs_offset,
+          count};
+}
+
+//! \brief Encode a `VECTOR_REDUCE` instruction, combining every lane
+//! \param dest Register to receive the result
+//! \param slot Register holding the slot of the lanes
+//! \param offset Register holding the offset of the lanes
+//! \param count Register holding the number of lanes
+inline std::vector<uint8_t>
+gen_vector_reduce(const vector_reduction_e reduction, const vector_lane_e lane,
+                  const uint8_t dest, const uint8_t slot,
+                  const uint8_t offset, const uint8_t count)
+{
+  return {VECTOR_REDUCE,
+          encode_vector_kind(static_cast<uint8_t>(reduction), lane),
+          dest,
+          slot,
+          offset,
+          count};
+}
+
+//! \brief Encode a `VECTOR_DOT` instruction, summing the lane products
+//! \param dest Register to receive the result
+//! \param lhs Register holding the slot of the left hand lanes
+//! \param lhs_offset Register holding the offset of the left hand lanes
+//! \param rhs Register holding the slot of the right hand lanes
+//! \param rhs_offset Register holding the offset of the right hand lanes
+//! \param count Register holding the number of lanes
+inline std::vector<uint8_t>
+gen_vector_dot(const vector_lane_e lane, const uint8_t dest, const uint8_t lhs,
+               const uint8_t lhs_offset, const uint8_t rhs,
+               const uint8_t rhs_offset, const uint8_t count)
+{
+  return {VECTOR_DOT, encode_vector_kind(0, lane),
+          dest,       lhs,
+          lhs_offset, rhs,
+          rhs_offset, count};
+}
+
+} // namespace instructions
+} // namespace skiff
+
+#endif
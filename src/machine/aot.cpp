@@ -0,0 +1,599 @@
+#include "machine/aot.hpp"
+#include "logging/aixlog.hpp"
+
+#include <dlfcn.h>
+#include <pwd.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+/*
+    A program is translated to a single C function. Every instruction gets a
+    label and straight line code, branches become gotos and indirect jumps
+    (returns and the initial entry) go through a switch over the address.
+
+    Registers are copied into locals on entry so the C compiler can keep
+    them in host registers. They are written back to the vm's register file
+    before calling back into the vm and whenever the module returns, then
+    read again after any service that may have changed them.
+*/
+
+namespace skiff {
+namespace machine {
+
+namespace {
+
+// Everything the generated code needs, with no headers required
+constexpr const char *prelude = R"(/* Generated by skiffd, do not edit */
+typedef unsigned int u32;
+typedef unsigned long long u64;
+
+typedef struct {
+  u64 *registers;
+  const void *const volatile *interrupts_pending;
+  void *vm;
+  u64 ip;
+  u64 remaining;
+  int (*call)(void *vm, u64 return_address);
+  int (*ret)(void *vm, u64 *destination);
+  int (*stack)(void *vm, u32 opcode, u32 reg);
+  void (*memory)(void *vm, u32 opcode, u32 a, u32 b, u32 c, u64 value);
+  int (*fp_arith)(u32 opcode, u64 lhs, u64 rhs, u64 *out);
+  int (*fp_compare)(u32 opcode, u64 lhs, u64 rhs);
+} skiff_aot_env_t;
+
+/* Charge an instruction to the budget, stopping before it if it is spent */
+#define STEP(n)                                                                \
+  I##n:                                                                        \
+  if (!rem) {                                                                  \
+    ip = n;                                                                    \
+    goto yield;                                                                \
+  }                                                                            \
+  rem--;
+
+/* Hand instruction n to the interpreter, refunding it */
+#define FALLBACK(n)                                                            \
+  do {                                                                         \
+    ip = n;                                                                    \
+    rem++;                                                                     \
+    goto fallback;                                                             \
+  } while (0)
+
+/* Transfer control, stopping if an interrupt is waiting */
+#define JUMP(n)                                                                \
+  do {                                                                         \
+    if (*pending) {                                                            \
+      ip = n;                                                                  \
+      goto interrupt;                                                          \
+    }                                                                          \
+    goto I##n;                                                                 \
+  } while (0)
+
+/* Transfer control out of range, where the interpreter will stop */
+#define JUMP_OUT(n)                                                            \
+  do {                                                                         \
+    ip = n;                                                                    \
+    goto fallback;                                                             \
+  } while (0)
+
+)";
+
+std::string hex(const uint64_t value)
+{
+  std::stringstream ss;
+  ss << "0x" << std::hex << value << "ull";
+  return ss.str();
+}
+
+std::string reg(const uint8_t index) { return "r" + std::to_string(index); }
+
+//  Modules are loaded into the process, so only a cache and modules that
+//  nobody else can have written to are trusted. Links aren't followed
+bool is_private(const std::filesystem::path &path, const mode_t type)
+{
+  struct stat info;
+  if (lstat(path.c_str(), &info) != 0) {
+    return false;
+  }
+  return (info.st_mode & S_IFMT) == type && info.st_uid == geteuid() &&
+         !(info.st_mode & (S_IWGRP | S_IWOTH));
+}
+
+//  Run the compiler directly rather than through a shell so paths reach it
+//  as they are, whatever they hold. $CC is split on whitespace so it can
+//  carry flags, with no quoting. Returns the compiler's exit status, or -1
+//  if it couldn't be run to completion
+int compile(const std::filesystem::path &source,
+            const std::filesystem::path &output)
+{
+  std::vector<std::string> args;
+  const char *compiler = std::getenv("CC");
+  std::istringstream words(compiler ? compiler : "");
+  for (std::string word; words >> word;) {
+    args.push_back(word);
+  }
+  if (args.empty()) {
+    args.push_back("cc");
+  }
+
+  // Absolute paths can't be mistaken for options
+  for (auto arg : {"-O2", "-shared", "-fPIC", "-o"}) {
+    args.push_back(arg);
+  }
+  args.push_back(std::filesystem::absolute(output).string());
+  args.push_back(std::filesystem::absolute(source).string());
+
+  std::string command;
+  std::vector<char *> argv;
+  for (auto &arg : args) {
+    command += (command.empty() ? "" : " ") + arg;
+    argv.push_back(arg.data());
+  }
+  argv.push_back(nullptr);
+  LOG(DEBUG) << TAG("aot") << "Compiling : " << command << "\n";
+
+  pid_t pid;
+  if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) !=
+      0) {
+    return -1;
+  }
+  int status{0};
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      return -1;
+    }
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+//  Create the cache if it doesn't exist yet, readable only by its owner
+bool make_private_directory(const std::filesystem::path &path)
+{
+  if (path.empty()) {
+    return false;
+  }
+  std::error_code ec;
+  if (path.has_parent_path()) {
+    std::filesystem::create_directories(path.parent_path(), ec);
+  }
+  if (mkdir(path.c_str(), 0700) != 0 && errno != EEXIST) {
+    return false;
+  }
+  return is_private(path, S_IFDIR);
+}
+
+} // namespace
+
+std::string aot_translate(const program_c &program)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+
+  auto &instructions = program.get_instructions();
+  const uint64_t num_instructions = program.get_num_instructions();
+
+  std::stringstream out;
+  out << prelude;
+  // Moving registers between the vm and the locals
+  out << "#define SPILL() \\\n  do { \\\n";
+  for (uint8_t i = 0; i < types::reg::count; i++) {
+    out << "    R[" << +i << "] = " << reg(i) << "; \\\n";
+  }
+  out << "  } while (0)\n";
+  out << "#define RELOAD() \\\n  do { \\\n";
+  for (uint8_t i = 0; i < types::reg::count; i++) {
+    out << "    " << reg(i) << " = R[" << +i << "]; \\\n";
+  }
+  out << "  } while (0)\n\n";
+
+  out << "const u32 skiff_aot_abi_version = " << aot_abi_version << ";\n";
+
+  // The whole program is kept in the module so opening it can check that
+  // it was built for exactly this program, not one that hashes the same
+  const auto &identity = program.get_identity();
+  out << "const u64 skiff_aot_identity_size = " << identity.size() << ";\n";
+  out << "const unsigned char skiff_aot_identity[] = {";
+  for (std::size_t i = 0; i < identity.size(); i++) {
+    out << (i % 16 ? " " : "\n  ") << +identity[i] << ",";
+  }
+  out << "\n};\n\n";
+  out << "int skiff_aot_run(skiff_aot_env_t *env)\n{\n";
+  out << "  u64 *const R = env->registers;\n";
+  out << "  const void *const volatile *const pending = "
+         "env->interrupts_pending;\n";
+  for (uint8_t i = 0; i < types::reg::count; i++) {
+    out << "  u64 " << reg(i) << " = R[" << +i << "];\n";
+  }
+  out << "  u64 rem = env->remaining;\n";
+  out << "  u64 ip = env->ip;\n";
+  out << "  u64 t = 0;\n";
+  out << "  int status = 0;\n\n";
+
+  // Indirect jumps may land on any instruction
+  out << "dispatch:\n";
+  out << "  switch (ip) {\n";
+  for (uint64_t i = 0; i < num_instructions; i++) {
+    out << "  case " << i << ":\n    goto I" << i << ";\n";
+  }
+  out << "  default:\n    goto fallback;\n  }\n\n";
+
+  auto jump = [&](const uint64_t target) {
+    return target < num_instructions ? "JUMP(" + std::to_string(target) + ");"
+                                     : "JUMP_OUT(" + hex(target) + ");";
+  };
+
+  for (uint64_t i = 0; i < num_instructions; i++) {
+    auto &ins = instructions[i];
+    const auto n = std::to_string(i);
+    const auto opcode = std::to_string(static_cast<uint32_t>(ins.opcode));
+    const auto a = reg(ins.a);
+    const auto b = reg(ins.b);
+    const auto c = reg(ins.c);
+
+    out << "  STEP(" << n << ")\n  ";
+    switch (ins.opcode) {
+    case threaded_opcode_e::NOP:
+      out << ";";
+      break;
+    case threaded_opcode_e::BLT:
+      out << "if (" << a << " < " << b << ") " << jump(ins.value);
+      break;
+    case threaded_opcode_e::BGT:
+      out << "if (" << a << " > " << b << ") " << jump(ins.value);
+      break;
+    case threaded_opcode_e::BEQ:
+      out << "if (" << a << " == " << b << ") " << jump(ins.value);
+      break;
+    case threaded_opcode_e::JMP:
+      out << jump(ins.value);
+      break;
+    case threaded_opcode_e::CALL:
+      out << "if (!env->call(env->vm, " << i + 1 << ")) FALLBACK(" << n
+          << ");\n  " << jump(ins.value);
+      break;
+    case threaded_opcode_e::RET:
+      out << "if (!env->ret(env->vm, &t)) FALLBACK(" << n << ");\n"
+          << "  ip = t;\n"
+          << "  if (*pending) goto interrupt;\n"
+          << "  goto dispatch;";
+      break;
+    case threaded_opcode_e::MOV:
+      out << a << " = " << hex(ins.value) << ";";
+      break;
+    case threaded_opcode_e::ADD:
+      out << a << " = " << b << " + " << c << ";";
+      break;
+    case threaded_opcode_e::SUB:
+      out << a << " = " << b << " - " << c << ";";
+      break;
+    case threaded_opcode_e::MUL:
+      out << a << " = " << b << " * " << c << ";";
+      break;
+    case threaded_opcode_e::DIV:
+      out << "if (!" << c << ") FALLBACK(" << n << ");\n  " << a << " = "
+          << b << " / " << c << ";";
+      break;
+    case threaded_opcode_e::LSH:
+      out << a << " = " << b << " << (" << c << " & 63);";
+      break;
+    case threaded_opcode_e::RSH:
+      out << a << " = " << b << " >> (" << c << " & 63);";
+      break;
+    case threaded_opcode_e::AND:
+      out << a << " = " << b << " & " << c << ";";
+      break;
+    case threaded_opcode_e::OR:
+      out << a << " = " << b << " | " << c << ";";
+      break;
+    case threaded_opcode_e::XOR:
+      out << a << " = " << b << " ^ " << c << ";";
+      break;
+    case threaded_opcode_e::NOT:
+      out << a << " = !" << b << ";";
+      break;
+    case threaded_opcode_e::ADDI:
+      out << a << " = " << b << " + " << hex(ins.value) << ";";
+      break;
+    case threaded_opcode_e::SUBI:
+      out << a << " = " << b << " - " << hex(ins.value) << ";";
+      break;
+    case threaded_opcode_e::MULI:
+      out << a << " = " << b << " * " << hex(ins.value) << ";";
+      break;
+    case threaded_opcode_e::LSHI:
+      out << a << " = " << b << " << " << ins.value << ";";
+      break;
+    case threaded_opcode_e::RSHI:
+      out << a << " = " << b << " >> " << ins.value << ";";
+      break;
+    case threaded_opcode_e::ANDI:
+      out << a << " = " << b << " & " << hex(ins.value) << ";";
+      break;
+    case threaded_opcode_e::ORI:
+      out << a << " = " << b << " | " << hex(ins.value) << ";";
+      break;
+    case threaded_opcode_e::BLTI:
+      out << "if (" << a << " < " << hex(get_immediate(ins)) << ") "
+          << jump(ins.value);
+      break;
+    case threaded_opcode_e::BGTI:
+      out << "if (" << a << " > " << hex(get_immediate(ins)) << ") "
+          << jump(ins.value);
+      break;
+    case threaded_opcode_e::BEQI:
+      out << "if (" << a << " == " << hex(get_immediate(ins)) << ") "
+          << jump(ins.value);
+      break;
+    case threaded_opcode_e::ADDF:
+    case threaded_opcode_e::SUBF:
+    case threaded_opcode_e::MULF:
+    case threaded_opcode_e::DIVF:
+      out << "if (!env->fp_arith(" << opcode << ", " << b << ", " << c
+          << ", &t)) FALLBACK(" << n << ");\n  " << a << " = t;";
+      break;
+    case threaded_opcode_e::BLTF:
+    case threaded_opcode_e::BGTF:
+    case threaded_opcode_e::BEQF:
+      out << "if (env->fp_compare(" << opcode << ", " << a << ", " << b
+          << ")) " << jump(ins.value);
+      break;
+    case threaded_opcode_e::ASEQ:
+      out << "if (" << a << " != " << b << ") FALLBACK(" << n << ");";
+      break;
+    case threaded_opcode_e::ASNE:
+      out << "if (" << a << " == " << b << ") FALLBACK(" << n << ");";
+      break;
+    case threaded_opcode_e::PUSH_W:
+    case threaded_opcode_e::PUSH_HW:
+    case threaded_opcode_e::PUSH_DW:
+    case threaded_opcode_e::PUSH_QW:
+    case threaded_opcode_e::POP_W:
+    case threaded_opcode_e::POP_HW:
+    case threaded_opcode_e::POP_DW:
+    case threaded_opcode_e::POP_QW:
+      out << "SPILL();\n  t = env->stack(env->vm, " << opcode << ", "
+          << static_cast<uint32_t>(ins.a) << ");\n  RELOAD();\n"
+          << "  if (!t) FALLBACK(" << n << ");";
+      break;
+    case threaded_opcode_e::PUSH_MULTIPLE:
+    case threaded_opcode_e::POP_MULTIPLE:
+      out << "SPILL();\n  t = env->stack(env->vm, " << opcode << ", "
+          << static_cast<uint32_t>(ins.value) << ");\n  RELOAD();\n"
+          << "  if (!t) FALLBACK(" << n << ");";
+      break;
+    case threaded_opcode_e::ALLOC:
+    case threaded_opcode_e::FREE:
+    case threaded_opcode_e::REALLOC:
+    case threaded_opcode_e::STACK_STORE_W:
+    case threaded_opcode_e::STACK_STORE_DW:
+    case threaded_opcode_e::STACK_STORE_QW:
+    case threaded_opcode_e::STACK_LOAD_W:
+    case threaded_opcode_e::STACK_LOAD_DW:
+    case threaded_opcode_e::STACK_LOAD_QW:
+    case threaded_opcode_e::REGION_BEGIN:
+    case threaded_opcode_e::REGION_FREE:
+    case threaded_opcode_e::MEMORY_COPY:
+    case threaded_opcode_e::MEMORY_FILL:
+    case threaded_opcode_e::MEMORY_COMPARE:
+    case threaded_opcode_e::VECTOR:
+    case threaded_opcode_e::VECTOR_REDUCE:
+    case threaded_opcode_e::VECTOR_DOT:
+    case threaded_opcode_e::STORE_W:
+    case threaded_opcode_e::STORE_HW:
+    case threaded_opcode_e::STORE_DW:
+    case threaded_opcode_e::STORE_QW:
+    case threaded_opcode_e::LOAD_W:
+    case threaded_opcode_e::LOAD_HW:
+    case threaded_opcode_e::LOAD_DW:
+    case threaded_opcode_e::LOAD_QW:
+      out << "SPILL();\n  env->memory(env->vm, " << opcode << ", "
+          << static_cast<uint32_t>(ins.a) << ", "
+          << static_cast<uint32_t>(ins.b) << ", "
+          << static_cast<uint32_t>(ins.c) << ", " << hex(ins.value)
+          << ");\n  RELOAD();";
+      break;
+
+    // Rare, or needing more of the vm than the environment gives
+    case threaded_opcode_e::EXIT:
+    case threaded_opcode_e::SYSCALL:
+    case threaded_opcode_e::DEBUG:
+    case threaded_opcode_e::EIRQ:
+    case threaded_opcode_e::DIRQ:
+    case threaded_opcode_e::MOV_ADD:
+    case threaded_opcode_e::ADD_BLT:
+    case threaded_opcode_e::ADD_BGT:
+    case threaded_opcode_e::ADD_BEQ:
+    case threaded_opcode_e::ADD_SW:
+    case threaded_opcode_e::ADD_SQW:
+    case threaded_opcode_e::MOV_ADD_SW:
+    case threaded_opcode_e::MOV_ADD_SQW:
+    case threaded_opcode_e::PUSH_QW_N:
+    case threaded_opcode_e::POP_QW_N:
+    case threaded_opcode_e::END:
+    case threaded_opcode_e::NUM_OPCODES:
+      out << "FALLBACK(" << n << ");";
+      break;
+    }
+    out << "\n";
+  }
+
+  // Running off of the end is left to the interpreter to report
+  out << "  JUMP_OUT(" << num_instructions << ");\n\n";
+
+  out << "yield:\n  status = " << static_cast<int>(aot_status_e::YIELD)
+      << ";\n  goto out;\n";
+  out << "interrupt:\n  status = "
+      << static_cast<int>(aot_status_e::INTERRUPT) << ";\n  goto out;\n";
+  out << "fallback:\n  status = " << static_cast<int>(aot_status_e::FALLBACK)
+      << ";\n";
+  out << "out:\n";
+  out << "  SPILL();\n";
+  out << "  env->remaining = rem;\n";
+  out << "  env->ip = ip;\n";
+  out << "  return status;\n";
+  out << "}\n";
+  return out.str();
+}
+
+std::tuple<bool, std::shared_ptr<const aot_module_c>>
+aot_module_c::open(const std::filesystem::path &path, const program_c &program)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+
+  if (!is_private(path, S_IFREG)) {
+    LOG(WARNING) << TAG("aot") << "Module " << path
+                 << " is not a file only its owner can write to\n";
+    return {false, nullptr};
+  }
+
+  void *handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!handle) {
+    LOG(DEBUG) << TAG("aot") << "Unable to open " << path << " : "
+               << dlerror() << "\n";
+    return {false, nullptr};
+  }
+
+  std::shared_ptr<aot_module_c> module(new aot_module_c());
+  module->_handle = handle;
+
+  auto *version =
+      static_cast<const uint32_t *>(dlsym(handle, "skiff_aot_abi_version"));
+  auto *identity_size =
+      static_cast<const uint64_t *>(dlsym(handle, "skiff_aot_identity_size"));
+  auto *identity =
+      static_cast<const uint8_t *>(dlsym(handle, "skiff_aot_identity"));
+  module->_entry = reinterpret_cast<entry_t>(dlsym(handle, "skiff_aot_run"));
+
+  if (!version || !identity_size || !identity || !module->_entry ||
+      *version != aot_abi_version) {
+    LOG(WARNING) << TAG("aot") << "Module " << path
+                 << " was not built by this version\n";
+    return {false, nullptr};
+  }
+  module->_identity = {identity, *identity_size};
+  if (!module->matches(program)) {
+    LOG(WARNING) << TAG("aot") << "Module " << path
+                 << " does not match the program\n";
+    return {false, nullptr};
+  }
+  module->_hash = program.get_hash();
+  return {true, module};
+}
+
+std::tuple<bool, std::shared_ptr<const aot_module_c>>
+aot_module_c::build(const program_c &program,
+                    const std::filesystem::path &cache_directory)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+
+  std::stringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0') << program.get_hash()
+       << "-v" << std::dec << aot_abi_version;
+  const auto module_path = cache_directory / (name.str() + ".so");
+
+  if (!make_private_directory(cache_directory)) {
+    LOG(FATAL) << TAG("aot") << "Cache directory " << cache_directory
+               << " could not be created or is not private to its owner\n";
+    return {false, nullptr};
+  }
+
+  std::error_code ec;
+  if (std::filesystem::exists(module_path, ec)) {
+    auto [okay, module] = open(module_path, program);
+    if (okay) {
+      std::const_pointer_cast<aot_module_c>(module)->_from_cache = true;
+      LOG(DEBUG) << TAG("aot") << "Using cached " << module_path << "\n";
+      return {true, module};
+    }
+  }
+
+  // Build beside the cache entry and move it into place once complete so
+  // that concurrent builds never see a partial module
+  const auto unique = name.str() + "." + std::to_string(getpid());
+  const auto source_path = cache_directory / (unique + ".c");
+  const auto temporary_path = cache_directory / (unique + ".so");
+  {
+    std::ofstream source(source_path);
+    source << aot_translate(program);
+    if (!source) {
+      LOG(FATAL) << TAG("aot") << "Unable to write " << source_path << "\n";
+      return {false, nullptr};
+    }
+  }
+
+  const int result = compile(source_path, temporary_path);
+  std::filesystem::remove(source_path, ec);
+  if (result != 0) {
+    LOG(FATAL) << TAG("aot") << "Compiler failed with status " << result
+               << "\n";
+    std::filesystem::remove(temporary_path, ec);
+    return {false, nullptr};
+  }
+
+  // Compilers leave the module with whatever the umask allows, and only
+  // modules nobody else can write to are opened
+  if (chmod(temporary_path.c_str(), 0700) != 0) {
+    LOG(FATAL) << TAG("aot") << "Unable to restrict " << temporary_path
+               << "\n";
+    std::filesystem::remove(temporary_path, ec);
+    return {false, nullptr};
+  }
+
+  std::filesystem::rename(temporary_path, module_path, ec);
+  if (ec) {
+    LOG(FATAL) << TAG("aot") << "Unable to move module into the cache : "
+               << ec.message() << "\n";
+    std::filesystem::remove(temporary_path, ec);
+    return {false, nullptr};
+  }
+  return open(module_path, program);
+}
+
+std::filesystem::path aot_module_c::get_default_cache_directory()
+{
+  if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+    return std::filesystem::path(xdg) / "skiff";
+  }
+  if (const char *home = std::getenv("HOME"); home && *home) {
+    return std::filesystem::path(home) / ".cache" / "skiff";
+  }
+
+  // Somewhere shared like the temporary directory would let anyone plant
+  // modules, so without a home there is no cache
+  if (const auto *user = getpwuid(geteuid()); user && user->pw_dir &&
+                                              *user->pw_dir) {
+    return std::filesystem::path(user->pw_dir) / ".cache" / "skiff";
+  }
+  return {};
+}
+
+aot_module_c::~aot_module_c()
+{
+  if (_handle) {
+    dlclose(_handle);
+  }
+}
+
+aot_module_c::entry_t aot_module_c::get_entry() const { return _entry; }
+
+uint64_t aot_module_c::get_hash() const { return _hash; }
+
+bool aot_module_c::matches(const program_c &program) const
+{
+  const auto &identity = program.get_identity();
+  return std::equal(_identity.begin(), _identity.end(), identity.begin(),
+                    identity.end());
+}
+
+bool aot_module_c::is_from_cache() const { return _from_cache; }
+
+} // namespace machine
+} // namespace skiff
@@ -0,0 +1,127 @@
+#ifndef SKIFF_AOT_HPP
+#define SKIFF_AOT_HPP
+
+#include "machine/program.hpp"
+#include "types.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <tuple>
+
+namespace skiff {
+namespace machine {
+
+//! \brief Version of the interface between vm and compiled module
+//! \note  Part of the cache key, bump whenever `aot_env_t` or the generated
+//!        code changes
+static constexpr uint32_t aot_abi_version = 4;
+
+//! \brief Why a compiled module handed control back to the vm
+enum class aot_status_e : int {
+  YIELD = 0,     //! The instruction budget ran out
+  INTERRUPT = 1, //! An interrupt is waiting to be taken
+  FALLBACK = 2   //! The instruction at `ip` must be run by the interpreter
+};
+
+//! \brief State shared between the vm and a compiled module
+//! \note  Mirrored field for field in the C emitted by `aot_translate`
+struct aot_env_t {
+  types::vm_register *registers;  //! Register file of the running vm
+  const void *interrupts_pending; //! Word that is non-zero while pending
+  void *vm;                       //! Passed back to every service
+  uint64_t ip;                    //! Where to start, then where stopped
+  uint64_t remaining;             //! Instruction budget, updated on return
+
+  //! Push a return address onto the call stack. Returns 0 if it is full
+  int (*call)(void *vm, uint64_t return_address);
+  //! Pop a return address. Returns 0 if the call stack is empty
+  int (*ret)(void *vm, uint64_t *destination);
+  //! Run a push or pop on register `reg`. Returns 0 on failure
+  int (*stack)(void *vm, uint32_t opcode, uint32_t reg);
+  //! Run an instruction that uses memory, given its operands
+  void (*memory)(void *vm, uint32_t opcode, uint32_t a, uint32_t b,
+                 uint32_t c, uint64_t value);
+  //! Floating point arithmetic. Returns 0 when dividing by zero
+  int (*fp_arith)(uint32_t opcode, uint64_t lhs, uint64_t rhs, uint64_t *out);
+  //! Floating point comparison for a branch
+  int (*fp_compare)(uint32_t opcode, uint64_t lhs, uint64_t rhs);
+};
+
+//! \brief Translate a program to C
+//! \returns C source exporting `skiff_aot_run`, `skiff_aot_abi_version` and
+//!          the identity of the program it was translated from
+//! \note  Instructions that need the vm call back through `aot_env_t`, and
+//!        anything rare or fatal falls back to the interpreter, so errors
+//!        are reported exactly as the interpreter reports them
+extern std::string aot_translate(const program_c &program);
+
+//! \brief A program compiled to a native shared object
+class aot_module_c {
+public:
+  //! \brief Entry point of a compiled program
+  using entry_t = int (*)(aot_env_t *env);
+
+  //! \brief Load a compiled module from disk
+  //! \param path The shared object to load
+  //! \param program The program the module must have been built for
+  //! \returns Tuple with a success flag and the module
+  //! \note  Only a regular file owned by the effective user that nobody
+  //!        else can write to is loaded
+  [[nodiscard]] static std::tuple<bool, std::shared_ptr<const aot_module_c>>
+  open(const std::filesystem::path &path, const program_c &program);
+
+  //! \brief Retrieve a compiled module for a program, building it if the
+  //!        cache does not have one yet
+  //! \param program The program to compile
+  //! \param cache_directory Where compiled modules are kept
+  //! \returns Tuple with a success flag and the module
+  //! \note  Compiles with `$CC`, split on whitespace and run without a
+  //!        shell, or `cc` when it is not set. Modules are named by the
+  //!        program hash so any number of processes can share a cache. The
+  //!        cache is created readable only by its owner, and is refused if
+  //!        it is owned by anyone else or others can write to it
+  [[nodiscard]] static std::tuple<bool, std::shared_ptr<const aot_module_c>>
+  build(const program_c &program,
+        const std::filesystem::path &cache_directory);
+
+  //! \brief Retrieve the default cache directory
+  //! \returns `$XDG_CACHE_HOME/skiff`, `$HOME/.cache/skiff` or the same
+  //!          under the effective user's home directory, empty if there is
+  //!          none
+  [[nodiscard]] static std::filesystem::path get_default_cache_directory();
+
+  //! \brief Unload the module
+  ~aot_module_c();
+
+  aot_module_c(const aot_module_c &) = delete;
+  aot_module_c &operator=(const aot_module_c &) = delete;
+
+  //! \brief Retrieve the entry point
+  [[nodiscard]] entry_t get_entry() const;
+
+  //! \brief Retrieve the hash of the program the module was built from
+  [[nodiscard]] uint64_t get_hash() const;
+
+  //! \brief Check if the module was built from a program
+  [[nodiscard]] bool matches(const program_c &program) const;
+
+  //! \brief Check if the module was found in the cache rather than built
+  [[nodiscard]] bool is_from_cache() const;
+
+private:
+  aot_module_c() = default;
+
+  void *_handle{nullptr};
+  entry_t _entry{nullptr};
+  uint64_t _hash{0};
+  std::span<const uint8_t> _identity; // Lives in the loaded module
+  bool _from_cache{false};
+};
+
+} // namespace machine
+} // namespace skiff
+
+#endif
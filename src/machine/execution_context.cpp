@@ -44,6 +44,7 @@ void instruction_pop_dw_c::visit(executor_if &e) { e.accept(*this); }
 void instruction_pop_qw_c::visit(executor_if &e) { e.accept(*this); }
 void instruction_alloc_c::visit(executor_if &e) { e.accept(*this); }
 void instruction_free_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_realloc_c::visit(executor_if &e) { e.accept(*this); }
 void instruction_store_word_c::visit(executor_if &e) { e.accept(*this); }
 void instruction_store_hword_c::visit(executor_if &e) { e.accept(*this); }
 void instruction_store_dword_c::visit(executor_if &e) { e.accept(*this); }
@@ -52,10 +53,36 @@ void instruction_load_word_c::visit(executor_if &e) { e.accept(*this); }
 void instruction_load_hword_c::visit(executor_if &e) { e.accept(*this); }
 void instruction_load_dword_c::visit(executor_if &e) { e.accept(*this); }
 void instruction_load_qword_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_stack_store_word_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_stack_store_dword_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_stack_store_qword_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_stack_load_word_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_stack_load_dword_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_stack_load_qword_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_push_multiple_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_pop_multiple_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_addi_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_subi_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_muli_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_lshi_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_rshi_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_andi_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_ori_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_blti_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_bgti_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_beqi_c::visit(executor_if &e) { e.accept(*this); }
 void instruction_syscall_c::visit(executor_if &e) { e.accept(*this); }
 void instruction_debug_c::visit(executor_if &e) { e.accept(*this); }
 void instruction_eirq_c::visit(executor_if &e) { e.accept(*this); }
 void instruction_dirq_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_region_begin_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_region_free_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_memory_copy_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_memory_fill_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_memory_compare_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_vector_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_vector_reduce_c::visit(executor_if &e) { e.accept(*this); }
+void instruction_vector_dot_c::visit(executor_if &e) { e.accept(*this); }
 
 } // namespace machine
 } // namespace skiff
\ No newline at end of file
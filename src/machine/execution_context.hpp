@@ -410,6 +410,17 @@ public:
   types::vm_register &idx;
 };
 
+class instruction_realloc_c : public instruction_c {
+public:
+  instruction_realloc_c(types::vm_register &idx, types::vm_register &size)
+      : idx(idx), size(size)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &idx;
+  types::vm_register &size;
+};
+
 class instruction_store_word_c : public instruction_c {
 public:
   instruction_store_word_c(types::vm_register &idx, types::vm_register &offset,
@@ -514,6 +525,234 @@ public:
   types::vm_register &dest;
 };
 
+class instruction_stack_store_word_c : public instruction_c {
+public:
+  instruction_stack_store_word_c(types::vm_register &base,
+                                 const uint64_t offset,
+                                 types::vm_register &data)
+      : base(base), offset(offset), data(data)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &base;
+  uint64_t offset;
+  types::vm_register &data;
+};
+
+class instruction_stack_store_dword_c : public instruction_c {
+public:
+  instruction_stack_store_dword_c(types::vm_register &base,
+                                  const uint64_t offset,
+                                  types::vm_register &data)
+      : base(base), offset(offset), data(data)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &base;
+  uint64_t offset;
+  types::vm_register &data;
+};
+
+class instruction_stack_store_qword_c : public instruction_c {
+public:
+  instruction_stack_store_qword_c(types::vm_register &base,
+                                  const uint64_t offset,
+                                  types::vm_register &data)
+      : base(base), offset(offset), data(data)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &base;
+  uint64_t offset;
+  types::vm_register &data;
+};
+
+class instruction_stack_load_word_c : public instruction_c {
+public:
+  instruction_stack_load_word_c(types::vm_register &base,
+                                const uint64_t offset,
+                                types::vm_register &dest)
+      : base(base), offset(offset), dest(dest)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &base;
+  uint64_t offset;
+  types::vm_register &dest;
+};
+
+class instruction_stack_load_dword_c : public instruction_c {
+public:
+  instruction_stack_load_dword_c(types::vm_register &base,
+                                 const uint64_t offset,
+                                 types::vm_register &dest)
+      : base(base), offset(offset), dest(dest)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &base;
+  uint64_t offset;
+  types::vm_register &dest;
+};
+
+class instruction_stack_load_qword_c : public instruction_c {
+public:
+  instruction_stack_load_qword_c(types::vm_register &base,
+                                 const uint64_t offset,
+                                 types::vm_register &dest)
+      : base(base), offset(offset), dest(dest)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &base;
+  uint64_t offset;
+  types::vm_register &dest;
+};
+
+class instruction_push_multiple_c : public instruction_c {
+public:
+  instruction_push_multiple_c(const uint64_t mask) : mask(mask) {}
+  virtual void visit(executor_if &e) override;
+  uint64_t mask;
+};
+
+class instruction_pop_multiple_c : public instruction_c {
+public:
+  instruction_pop_multiple_c(const uint64_t mask) : mask(mask) {}
+  virtual void visit(executor_if &e) override;
+  uint64_t mask;
+};
+
+class instruction_addi_c : public instruction_c {
+public:
+  instruction_addi_c(types::vm_register &dest, types::vm_register &lhs,
+                     const uint64_t value)
+      : dest_reg(dest), lhs_reg(lhs), value(value)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &dest_reg;
+  types::vm_register &lhs_reg;
+  uint64_t value;
+};
+
+class instruction_subi_c : public instruction_c {
+public:
+  instruction_subi_c(types::vm_register &dest, types::vm_register &lhs,
+                     const uint64_t value)
+      : dest_reg(dest), lhs_reg(lhs), value(value)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &dest_reg;
+  types::vm_register &lhs_reg;
+  uint64_t value;
+};
+
+class instruction_muli_c : public instruction_c {
+public:
+  instruction_muli_c(types::vm_register &dest, types::vm_register &lhs,
+                     const uint64_t value)
+      : dest_reg(dest), lhs_reg(lhs), value(value)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &dest_reg;
+  types::vm_register &lhs_reg;
+  uint64_t value;
+};
+
+class instruction_lshi_c : public instruction_c {
+public:
+  instruction_lshi_c(types::vm_register &dest, types::vm_register &lhs,
+                     const uint64_t value)
+      : dest_reg(dest), lhs_reg(lhs), value(value)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &dest_reg;
+  types::vm_register &lhs_reg;
+  uint64_t value;
+};
+
+class instruction_rshi_c : public instruction_c {
+public:
+  instruction_rshi_c(types::vm_register &dest, types::vm_register &lhs,
+                     const uint64_t value)
+      : dest_reg(dest), lhs_reg(lhs), value(value)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &dest_reg;
+  types::vm_register &lhs_reg;
+  uint64_t value;
+};
+
+class instruction_andi_c : public instruction_c {
+public:
+  instruction_andi_c(types::vm_register &dest, types::vm_register &lhs,
+                     const uint64_t value)
+      : dest_reg(dest), lhs_reg(lhs), value(value)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &dest_reg;
+  types::vm_register &lhs_reg;
+  uint64_t value;
+};
+
+class instruction_ori_c : public instruction_c {
+public:
+  instruction_ori_c(types::vm_register &dest, types::vm_register &lhs,
+                    const uint64_t value)
+      : dest_reg(dest), lhs_reg(lhs), value(value)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &dest_reg;
+  types::vm_register &lhs_reg;
+  uint64_t value;
+};
+
+class instruction_blti_c : public instruction_c {
+public:
+  instruction_blti_c(uint64_t dest, types::vm_register &lhs,
+                     const uint64_t value)
+      : lhs_reg(lhs), value(value), destination(dest)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &lhs_reg;
+  uint64_t value;
+  uint64_t destination;
+};
+
+class instruction_bgti_c : public instruction_c {
+public:
+  instruction_bgti_c(uint64_t dest, types::vm_register &lhs,
+                     const uint64_t value)
+      : lhs_reg(lhs), value(value), destination(dest)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &lhs_reg;
+  uint64_t value;
+  uint64_t destination;
+};
+
+class instruction_beqi_c : public instruction_c {
+public:
+  instruction_beqi_c(uint64_t dest, types::vm_register &lhs,
+                     const uint64_t value)
+      : lhs_reg(lhs), value(value), destination(dest)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &lhs_reg;
+  uint64_t value;
+  uint64_t destination;
+};
+
 class instruction_syscall_c : public instruction_c {
 public:
   instruction_syscall_c(const uint64_t &address) : address(address) {}
@@ -540,6 +779,138 @@ public:
   virtual void visit(executor_if &e) override;
 };
 
+class instruction_region_begin_c : public instruction_c {
+public:
+  instruction_region_begin_c(types::vm_register &dest) : dest(dest) {}
+  virtual void visit(executor_if &e) override;
+  types::vm_register &dest;
+};
+
+class instruction_region_free_c : public instruction_c {
+public:
+  instruction_region_free_c(types::vm_register &region) : region(region) {}
+  virtual void visit(executor_if &e) override;
+  types::vm_register &region;
+};
+
+class instruction_memory_copy_c : public instruction_c {
+public:
+  instruction_memory_copy_c(types::vm_register &dest,
+                            types::vm_register &dest_offset,
+                            types::vm_register &source,
+                            types::vm_register &source_offset,
+                            types::vm_register &length)
+      : dest(dest), dest_offset(dest_offset), source(source),
+        source_offset(source_offset), length(length)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &dest;
+  types::vm_register &dest_offset;
+  types::vm_register &source;
+  types::vm_register &source_offset;
+  types::vm_register &length;
+};
+
+class instruction_memory_fill_c : public instruction_c {
+public:
+  instruction_memory_fill_c(types::vm_register &idx, types::vm_register &offset,
+                            types::vm_register &length,
+                            types::vm_register &value)
+      : idx(idx), offset(offset), length(length), value(value)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &idx;
+  types::vm_register &offset;
+  types::vm_register &length;
+  types::vm_register &value;
+};
+
+class instruction_memory_compare_c : public instruction_c {
+public:
+  instruction_memory_compare_c(types::vm_register &dest,
+                               types::vm_register &lhs,
+                               types::vm_register &lhs_offset,
+                               types::vm_register &rhs,
+                               types::vm_register &rhs_offset,
+                               types::vm_register &length)
+      : dest(dest), lhs(lhs), lhs_offset(lhs_offset), rhs(rhs),
+        rhs_offset(rhs_offset), length(length)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  types::vm_register &dest;
+  types::vm_register &lhs;
+  types::vm_register &lhs_offset;
+  types::vm_register &rhs;
+  types::vm_register &rhs_offset;
+  types::vm_register &length;
+};
+
+class instruction_vector_c : public instruction_c {
+public:
+  instruction_vector_c(const uint8_t kind, types::vm_register &dest,
+                       types::vm_register &dest_offset,
+                       types::vm_register &lhs,
+                       types::vm_register &lhs_offset,
+                       types::vm_register &rhs,
+                       types::vm_register &rhs_offset,
+                       types::vm_register &count)
+      : kind(kind), dest(dest), dest_offset(dest_offset), lhs(lhs),
+        lhs_offset(lhs_offset), rhs(rhs), rhs_offset(rhs_offset), count(count)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  uint8_t kind;
+  types::vm_register &dest;
+  types::vm_register &dest_offset;
+  types::vm_register &lhs;
+  types::vm_register &lhs_offset;
+  types::vm_register &rhs;
+  types::vm_register &rhs_offset;
+  types::vm_register &count;
+};
+
+class instruction_vector_reduce_c : public instruction_c {
+public:
+  instruction_vector_reduce_c(const uint8_t kind, types::vm_register &dest,
+                              types::vm_register &idx,
+                              types::vm_register &offset,
+                              types::vm_register &count)
+      : kind(kind), dest(dest), idx(idx), offset(offset), count(count)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  uint8_t kind;
+  types::vm_register &dest;
+  types::vm_register &idx;
+  types::vm_register &offset;
+  types::vm_register &count;
+};
+
+class instruction_vector_dot_c : public instruction_c {
+public:
+  instruction_vector_dot_c(const uint8_t kind, types::vm_register &dest,
+                           types::vm_register &lhs,
+                           types::vm_register &lhs_offset,
+                           types::vm_register &rhs,
+                           types::vm_register &rhs_offset,
+                           types::vm_register &count)
+      : kind(kind), dest(dest), lhs(lhs), lhs_offset(lhs_offset), rhs(rhs),
+        rhs_offset(rhs_offset), count(count)
+  {
+  }
+  virtual void visit(executor_if &e) override;
+  uint8_t kind;
+  types::vm_register &dest;
+  types::vm_register &lhs;
+  types::vm_register &lhs_offset;
+  types::vm_register &rhs;
+  types::vm_register &rhs_offset;
+  types::vm_register &count;
+};
+
 //! \brief Executor of instructions interface
 class executor_if {
 public:
@@ -581,6 +952,7 @@ public:
   virtual void accept(instruction_pop_qw_c &ins) = 0;
   virtual void accept(instruction_alloc_c &ins) = 0;
   virtual void accept(instruction_free_c &ins) = 0;
+  virtual void accept(instruction_realloc_c &ins) = 0;
   virtual void accept(instruction_store_word_c &ins) = 0;
   virtual void accept(instruction_store_hword_c &ins) = 0;
   virtual void accept(instruction_store_dword_c &ins) = 0;
@@ -589,10 +961,36 @@ public:
   virtual void accept(instruction_load_hword_c &ins) = 0;
   virtual void accept(instruction_load_dword_c &ins) = 0;
   virtual void accept(instruction_load_qword_c &ins) = 0;
+  virtual void accept(instruction_stack_store_word_c &ins) = 0;
+  virtual void accept(instruction_stack_store_dword_c &ins) = 0;
+  virtual void accept(instruction_stack_store_qword_c &ins) = 0;
+  virtual void accept(instruction_stack_load_word_c &ins) = 0;
+  virtual void accept(instruction_stack_load_dword_c &ins) = 0;
+  virtual void accept(instruction_stack_load_qword_c &ins) = 0;
+  virtual void accept(instruction_push_multiple_c &ins) = 0;
+  virtual void accept(instruction_pop_multiple_c &ins) = 0;
+  virtual void accept(instruction_addi_c &ins) = 0;
+  virtual void accept(instruction_subi_c &ins) = 0;
+  virtual void accept(instruction_muli_c &ins) = 0;
+  virtual void accept(instruction_lshi_c &ins) = 0;
+  virtual void accept(instruction_rshi_c &ins) = 0;
+  virtual void accept(instruction_andi_c &ins) = 0;
+  virtual void accept(instruction_ori_c &ins) = 0;
+  virtual void accept(instruction_blti_c &ins) = 0;
+  virtual void accept(instruction_bgti_c &ins) = 0;
+  virtual void accept(instruction_beqi_c &ins) = 0;
   virtual void accept(instruction_syscall_c &ins) = 0;
   virtual void accept(instruction_debug_c &ins) = 0;
   virtual void accept(instruction_eirq_c &ins) = 0;
   virtual void accept(instruction_dirq_c &ins) = 0;
+  virtual void accept(instruction_region_begin_c &ins) = 0;
+  virtual void accept(instruction_region_free_c &ins) = 0;
+  virtual void accept(instruction_memory_copy_c &ins) = 0;
+  virtual void accept(instruction_memory_fill_c &ins) = 0;
+  virtual void accept(instruction_memory_compare_c &ins) = 0;
+  virtual void accept(instruction_vector_c &ins) = 0;
+  virtual void accept(instruction_vector_reduce_c &ins) = 0;
+  virtual void accept(instruction_vector_dot_c &ins) = 0;
 };
 
 } // namespace machine
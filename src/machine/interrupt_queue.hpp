@@ -0,0 +1,91 @@
+#ifndef SKIFF_INTERRUPT_QUEUE_HPP
+#define SKIFF_INTERRUPT_QUEUE_HPP
+
+#include <atomic>
+#include <cstdint>
+
+namespace skiff {
+namespace machine {
+
+//! \brief Lock-free multiple-producer single-consumer queue of interrupt ids
+//! \note  Any number of threads may `push`. Only the thread executing the vm
+//!        may call `pending` and `drain`. Producers link onto an atomic list
+//!        head and the consumer takes the whole list in a single exchange,
+//!        so nodes are never popped while another thread can reach them.
+class interrupt_queue_c {
+public:
+  //! \brief Construct an empty queue
+  interrupt_queue_c() = default;
+
+  //! \brief Destruct the queue, dropping anything not yet drained
+  ~interrupt_queue_c()
+  {
+    auto *node = _head.exchange(nullptr, std::memory_order_acquire);
+    while (node) {
+      auto *next = node->next;
+      delete node;
+      node = next;
+    }
+  }
+
+  interrupt_queue_c(const interrupt_queue_c &) = delete;
+  interrupt_queue_c &operator=(const interrupt_queue_c &) = delete;
+
+  //! \brief Submit an interrupt id
+  //! \param id The id to submit
+  void push(const uint64_t id)
+  {
+    auto *node = new node_t{id, _head.load(std::memory_order_relaxed)};
+    while (!_head.compare_exchange_weak(node->next, node,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+    }
+  }
+
+  //! \brief Check if anything has been submitted
+  //! \note  Cheap enough to poll from the execution loop
+  [[nodiscard]] bool pending() const
+  {
+    return _head.load(std::memory_order_relaxed) != nullptr;
+  }
+
+  //! \brief Retrieve a word that is non-zero while anything is submitted
+  //! \note  For generated code that can not call `pending`
+  [[nodiscard]] const void *get_pending_word() const { return &_head; }
+
+  //! \brief Remove all submitted ids, handing them to `fn` in the order that
+  //!        they were submitted
+  //! \param fn Callable taking a `uint64_t` interrupt id
+  template <typename Fn> void drain(Fn &&fn)
+  {
+    auto *node = _head.exchange(nullptr, std::memory_order_acquire);
+
+    // The list is newest first, reverse it to get submission order
+    node_t *ordered = nullptr;
+    while (node) {
+      auto *next = node->next;
+      node->next = ordered;
+      ordered = node;
+      node = next;
+    }
+
+    while (ordered) {
+      auto *next = ordered->next;
+      fn(ordered->id);
+      delete ordered;
+      ordered = next;
+    }
+  }
+
+private:
+  struct node_t {
+    uint64_t id;
+    node_t *next;
+  };
+  std::atomic<node_t *> _head{nullptr};
+};
+
+} // namespace machine
+} // namespace skiff
+
+#endif
@@ -0,0 +1,670 @@
+#include "machine/jit.hpp"
+#include "logging/aixlog.hpp"
+#include <libskiff/bytecode/floating_point.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <set>
+
+#ifdef SKIFF_JIT_AVAILABLE
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*
+    Each instruction is translated by a fixed template that works directly
+    on the register file in memory, with the register file pointer in rbx,
+    the remaining instruction budget in r12, the interrupt word pointer in
+    r13 and the address of the caller's budget in r14.
+
+    The region is split into blocks at every branch and branch target. The
+    budget is charged once on entry to a block for every instruction in it,
+    so the only checks on the straight line path are at block boundaries.
+    Any exit that leaves part way through a block refunds the instructions
+    that it did not run.
+*/
+
+namespace skiff {
+namespace machine {
+
+namespace {
+
+// Longest run of instructions compiled into a single region
+constexpr std::size_t max_region_length = 2048;
+
+using floating_point_op_t = bool (*)(types::vm_register *, uint32_t, uint32_t,
+                                     uint32_t);
+
+namespace fp = libskiff::bytecode::floating_point;
+
+// Floating point goes through libskiff so the encoding is never assumed
+bool addf(types::vm_register *r, uint32_t a, uint32_t b, uint32_t c)
+{
+  r[a] = fp::to_uint64_t(fp::from_uint64_t(r[b]) + fp::from_uint64_t(r[c]));
+  return true;
+}
+
+bool subf(types::vm_register *r, uint32_t a, uint32_t b, uint32_t c)
+{
+  r[a] = fp::to_uint64_t(fp::from_uint64_t(r[b]) - fp::from_uint64_t(r[c]));
+  return true;
+}
+
+bool mulf(types::vm_register *r, uint32_t a, uint32_t b, uint32_t c)
+{
+  r[a] = fp::to_uint64_t(fp::from_uint64_t(r[b]) * fp::from_uint64_t(r[c]));
+  return true;
+}
+
+bool divf(types::vm_register *r, uint32_t a, uint32_t b, uint32_t c)
+{
+  if (fp::are_equal(r[c], 0.0)) {
+    return false;
+  }
+  r[a] = fp::to_uint64_t(fp::from_uint64_t(r[b]) / fp::from_uint64_t(r[c]));
+  return true;
+}
+
+bool bltf(types::vm_register *r, uint32_t a, uint32_t b, uint32_t)
+{
+  return fp::from_uint64_t(r[a]) < fp::from_uint64_t(r[b]);
+}
+
+bool bgtf(types::vm_register *r, uint32_t a, uint32_t b, uint32_t)
+{
+  return fp::from_uint64_t(r[a]) > fp::from_uint64_t(r[b]);
+}
+
+bool beqf(types::vm_register *r, uint32_t a, uint32_t b, uint32_t)
+{
+  return fp::from_uint64_t(r[a]) == fp::from_uint64_t(r[b]);
+}
+
+// Host registers used by the templates
+enum class host_e : uint8_t { RAX = 0, RCX = 1 };
+
+// Condition codes for jcc
+enum class cond_e : uint8_t {
+  BELOW = 0x82,
+  EQUAL = 0x84,
+  NOT_EQUAL = 0x85,
+  ABOVE = 0x87
+};
+
+//  Append-only x86-64 encoder covering what the templates need
+class emitter_c {
+public:
+  std::vector<uint8_t> code;
+
+  void bytes(std::initializer_list<uint8_t> values)
+  {
+    code.insert(code.end(), values);
+  }
+
+  void imm32(const uint32_t value)
+  {
+    for (auto i = 0; i < 4; i++) {
+      code.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+  }
+
+  void imm64(const uint64_t value)
+  {
+    for (auto i = 0; i < 8; i++) {
+      code.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+  }
+
+  // op reg, [rbx + index * 8]
+  void reg_mem(std::initializer_list<uint8_t> opcode, const host_e reg,
+               const uint8_t index)
+  {
+    code.push_back(0x48);
+    code.insert(code.end(), opcode);
+    code.push_back(0x83 | (static_cast<uint8_t>(reg) << 3));
+    imm32(index * sizeof(types::vm_register));
+  }
+
+  // mov reg, [rbx + index * 8]
+  void load(const host_e reg, const uint8_t index)
+  {
+    reg_mem({0x8B}, reg, index);
+  }
+
+  // mov [rbx + index * 8], rax
+  void store(const uint8_t index) { reg_mem({0x89}, host_e::RAX, index); }
+
+  // mov qword [rbx + index * 8], value
+  void store_immediate(const uint8_t index, const uint64_t value)
+  {
+    if (value <= 0x7FFFFFFF || value >= 0xFFFFFFFF80000000) {
+      bytes({0x48, 0xC7, 0x83});
+      imm32(index * sizeof(types::vm_register));
+      imm32(static_cast<uint32_t>(value));
+      return;
+    }
+    bytes({0x48, 0xB8});
+    imm64(value);
+    store(index);
+  }
+
+  // jcc / jmp rel32, returning the location of the displacement
+  std::size_t jump(const std::optional<cond_e> cond)
+  {
+    if (cond) {
+      bytes({0x0F, static_cast<uint8_t>(*cond)});
+    }
+    else {
+      bytes({0xE9});
+    }
+    imm32(0);
+    return code.size() - 4;
+  }
+
+  void patch(const std::size_t at, const std::size_t target)
+  {
+    auto rel = static_cast<uint32_t>(static_cast<int64_t>(target) -
+                                     static_cast<int64_t>(at + 4));
+    std::memcpy(&code[at], &rel, sizeof(rel));
+  }
+
+  // Call a floating point helper with the register file and three indices,
+  // leaving its result in al
+  void call_helper(const floating_point_op_t fn, const uint8_t a,
+                   const uint8_t b, const uint8_t c)
+  {
+    bytes({0x48, 0x89, 0xDF}); // mov rdi, rbx
+    bytes({0xBE});             // mov esi, a
+    imm32(a);
+    bytes({0xBA}); // mov edx, b
+    imm32(b);
+    bytes({0xB9}); // mov ecx, c
+    imm32(c);
+    bytes({0x48, 0xB8}); // mov rax, fn
+    imm64(reinterpret_cast<uint64_t>(fn));
+    bytes({0xFF, 0xD0}); // call rax
+    bytes({0x84, 0xC0}); // test al, al
+  }
+};
+
+//  Where an exit leaves to and how many charged instructions it refunds
+using exit_t = std::pair<uint64_t, uint32_t>;
+
+class region_compiler_c {
+public:
+  region_compiler_c(const threaded_program_t &instructions, uint64_t start)
+      : _instructions(instructions), _start(start)
+  {
+  }
+
+  std::optional<std::vector<uint8_t>> compile()
+  {
+    _end = _start;
+    while (_end < _instructions.size() && _end - _start < max_region_length &&
+           jit_c::is_compilable(_instructions[_end].opcode)) {
+      _end++;
+    }
+    if (_end == _start) {
+      return std::nullopt;
+    }
+
+    find_blocks();
+
+    // push rbx, r12, r13, r14 and keep the stack aligned for helper calls
+    _e.bytes({0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56});
+    _e.bytes({0x48, 0x83, 0xEC, 0x08});
+    _e.bytes({0x48, 0x89, 0xFB}); // mov rbx, rdi
+    _e.bytes({0x49, 0x89, 0xF6}); // mov r14, rsi
+    _e.bytes({0x4D, 0x8B, 0x26}); // mov r12, [r14]
+    _e.bytes({0x49, 0x89, 0xD5}); // mov r13, rdx
+
+    for (auto address = _start; address < _end; address++) {
+      if (auto block = _blocks.find(address); block != _blocks.end()) {
+        emit_block_entry(address, block->second);
+      }
+      emit_instruction(address);
+    }
+
+    // Falling out of the region hands the next instruction back
+    exit_to(_e.jump(std::nullopt), {_end, 0});
+
+    emit_exits();
+
+    for (auto &[at, address] : _local_jumps) {
+      _e.patch(at, _labels.at(address));
+    }
+    return {std::move(_e.code)};
+  }
+
+private:
+  const threaded_program_t &_instructions;
+  const uint64_t _start;
+  uint64_t _end{0};
+  emitter_c _e;
+
+  std::map<uint64_t, uint32_t> _blocks; // Block start to length
+  std::set<uint64_t> _loop_heads;
+  std::map<uint64_t, std::size_t> _labels;
+  std::vector<std::pair<std::size_t, uint64_t>> _local_jumps;
+  std::map<exit_t, std::vector<std::size_t>> _exits;
+  uint64_t _block_end{0};
+
+  static bool is_branch(const threaded_opcode_e opcode)
+  {
+    switch (opcode) {
+    case threaded_opcode_e::BLT:
+    case threaded_opcode_e::BGT:
+    case threaded_opcode_e::BEQ:
+    case threaded_opcode_e::BLTF:
+    case threaded_opcode_e::BGTF:
+    case threaded_opcode_e::BEQF:
+    case threaded_opcode_e::BLTI:
+    case threaded_opcode_e::BGTI:
+    case threaded_opcode_e::BEQI:
+    case threaded_opcode_e::JMP:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  bool in_region(const uint64_t address) const
+  {
+    return address >= _start && address < _end;
+  }
+
+  void find_blocks()
+  {
+    std::set<uint64_t> leaders{_start};
+    _loop_heads.insert(_start);
+    for (auto address = _start; address < _end; address++) {
+      auto &ins = _instructions[address];
+      if (!is_branch(ins.opcode)) {
+        continue;
+      }
+      if (address + 1 < _end) {
+        leaders.insert(address + 1);
+      }
+      if (in_region(ins.value)) {
+        leaders.insert(ins.value);
+        if (ins.value <= address) {
+          _loop_heads.insert(ins.value);
+        }
+      }
+    }
+
+    for (auto it = leaders.begin(); it != leaders.end(); it++) {
+      auto next = std::next(it);
+      uint64_t block_end = (next == leaders.end()) ? _end : *next;
+      _blocks[*it] = static_cast<uint32_t>(block_end - *it);
+    }
+  }
+
+  void exit_to(const std::size_t at, const exit_t destination)
+  {
+    _exits[destination].push_back(at);
+  }
+
+  void jump_to(const std::optional<cond_e> cond, const uint64_t address)
+  {
+    auto at = _e.jump(cond);
+    if (in_region(address)) {
+      _local_jumps.push_back({at, address});
+    }
+    else {
+      exit_to(at, {address, 0});
+    }
+  }
+
+  void emit_block_entry(const uint64_t address, const uint32_t length)
+  {
+    _labels[address] = _e.code.size();
+    _block_end = address + length;
+
+    // Loops stop to let the interpreter take interrupts
+    if (_loop_heads.contains(address)) {
+      _e.bytes({0x49, 0x83, 0x7D, 0x00, 0x00}); // cmp qword [r13], 0
+      exit_to(_e.jump(cond_e::NOT_EQUAL), {address, 0});
+    }
+
+    // Only enter the block if the budget covers all of it
+    _e.bytes({0x49, 0x81, 0xFC}); // cmp r12, length
+    _e.imm32(length);
+    exit_to(_e.jump(cond_e::BELOW), {address, 0});
+    _e.bytes({0x49, 0x81, 0xEC}); // sub r12, length
+    _e.imm32(length);
+  }
+
+  // Leave before `address` has executed, refunding it and the rest of its
+  // block
+  void deopt_unless_zero_flag_clear(const uint64_t address)
+  {
+    exit_to(_e.jump(cond_e::EQUAL),
+            {address, static_cast<uint32_t>(_block_end - address)});
+  }
+
+  void emit_arith(const threaded_instruction_t &ins,
+                  std::initializer_list<uint8_t> opcode)
+  {
+    _e.load(host_e::RAX, ins.b);
+    _e.reg_mem(opcode, host_e::RAX, ins.c);
+    _e.store(ins.a);
+  }
+
+  void emit_shift(const threaded_instruction_t &ins, const uint8_t ext)
+  {
+    _e.load(host_e::RAX, ins.b);
+    _e.load(host_e::RCX, ins.c);
+    _e.bytes({0x48, 0xD3, ext}); // shl / shr rax, cl
+    _e.store(ins.a);
+  }
+
+  void emit_branch(const threaded_instruction_t &ins, const cond_e cond)
+  {
+    _e.load(host_e::RAX, ins.a);
+    _e.reg_mem({0x3B}, host_e::RAX, ins.b); // cmp rax, [b]
+    jump_to(cond, ins.value);
+  }
+
+  // The value may not fit in 32 bits, so it goes through rcx
+  void emit_arith_immediate(const threaded_instruction_t &ins,
+                            std::initializer_list<uint8_t> opcode)
+  {
+    _e.load(host_e::RAX, ins.b);
+    _e.bytes({0x48, 0xB9}); // mov rcx, value
+    _e.imm64(ins.value);
+    _e.bytes(opcode);
+    _e.store(ins.a);
+  }
+
+  void emit_shift_immediate(const threaded_instruction_t &ins,
+                            const uint8_t ext)
+  {
+    _e.load(host_e::RAX, ins.b);
+    _e.bytes({0x48, 0xC1, ext, static_cast<uint8_t>(ins.value)}); // shl / shr
+    _e.store(ins.a);
+  }
+
+  // cmp sign extends its 32 bit immediate just as decoding did
+  void emit_branch_immediate(const threaded_instruction_t &ins,
+                             const cond_e cond)
+  {
+    _e.load(host_e::RAX, ins.a);
+    _e.bytes({0x48, 0x3D}); // cmp rax, immediate
+    _e.imm32(static_cast<uint32_t>(ins.immediate));
+    jump_to(cond, ins.value);
+  }
+
+  void emit_instruction(const uint64_t address)
+  {
+    auto &ins = _instructions[address];
+    switch (ins.opcode) {
+    case threaded_opcode_e::NOP:
+      break;
+    case threaded_opcode_e::MOV:
+      _e.store_immediate(ins.a, ins.value);
+      break;
+    case threaded_opcode_e::ADD:
+      emit_arith(ins, {0x03});
+      break;
+    case threaded_opcode_e::SUB:
+      emit_arith(ins, {0x2B});
+      break;
+    case threaded_opcode_e::MUL:
+      emit_arith(ins, {0x0F, 0xAF});
+      break;
+    case threaded_opcode_e::AND:
+      emit_arith(ins, {0x23});
+      break;
+    case threaded_opcode_e::OR:
+      emit_arith(ins, {0x0B});
+      break;
+    case threaded_opcode_e::XOR:
+      emit_arith(ins, {0x33});
+      break;
+    case threaded_opcode_e::LSH:
+      emit_shift(ins, 0xE0);
+      break;
+    case threaded_opcode_e::RSH:
+      emit_shift(ins, 0xE8);
+      break;
+    case threaded_opcode_e::DIV:
+      _e.load(host_e::RCX, ins.c);
+      _e.bytes({0x48, 0x85, 0xC9}); // test rcx, rcx
+      deopt_unless_zero_flag_clear(address);
+      _e.load(host_e::RAX, ins.b);
+      _e.bytes({0x31, 0xD2});       // xor edx, edx
+      _e.bytes({0x48, 0xF7, 0xF1}); // div rcx
+      _e.store(ins.a);
+      break;
+    case threaded_opcode_e::NOT:
+      _e.load(host_e::RAX, ins.b);
+      _e.bytes({0x48, 0x85, 0xC0}); // test rax, rax
+      _e.bytes({0x0F, 0x94, 0xC0}); // sete al
+      _e.bytes({0x0F, 0xB6, 0xC0}); // movzx eax, al
+      _e.store(ins.a);
+      break;
+    case threaded_opcode_e::ADDF:
+      _e.call_helper(addf, ins.a, ins.b, ins.c);
+      break;
+    case threaded_opcode_e::SUBF:
+      _e.call_helper(subf, ins.a, ins.b, ins.c);
+      break;
+    case threaded_opcode_e::MULF:
+      _e.call_helper(mulf, ins.a, ins.b, ins.c);
+      break;
+    case threaded_opcode_e::DIVF:
+      _e.call_helper(divf, ins.a, ins.b, ins.c);
+      deopt_unless_zero_flag_clear(address);
+      break;
+    case threaded_opcode_e::BLT:
+      emit_branch(ins, cond_e::BELOW);
+      break;
+    case threaded_opcode_e::BGT:
+      emit_branch(ins, cond_e::ABOVE);
+      break;
+    case threaded_opcode_e::BEQ:
+      emit_branch(ins, cond_e::EQUAL);
+      break;
+    case threaded_opcode_e::BLTF:
+      _e.call_helper(bltf, ins.a, ins.b, 0);
+      jump_to(cond_e::NOT_EQUAL, ins.value);
+      break;
+    case threaded_opcode_e::BGTF:
+      _e.call_helper(bgtf, ins.a, ins.b, 0);
+      jump_to(cond_e::NOT_EQUAL, ins.value);
+      break;
+    case threaded_opcode_e::BEQF:
+      _e.call_helper(beqf, ins.a, ins.b, 0);
+      jump_to(cond_e::NOT_EQUAL, ins.value);
+      break;
+    case threaded_opcode_e::ADDI:
+      emit_arith_immediate(ins, {0x48, 0x01, 0xC8}); // add rax, rcx
+      break;
+    case threaded_opcode_e::SUBI:
+      emit_arith_immediate(ins, {0x48, 0x29, 0xC8}); // sub rax, rcx
+      break;
+    case threaded_opcode_e::MULI:
+      emit_arith_immediate(ins, {0x48, 0x0F, 0xAF, 0xC1}); // imul rax, rcx
+      break;
+    case threaded_opcode_e::ANDI:
+      emit_arith_immediate(ins, {0x48, 0x21, 0xC8}); // and rax, rcx
+      break;
+    case threaded_opcode_e::ORI:
+      emit_arith_immediate(ins, {0x48, 0x09, 0xC8}); // or rax, rcx
+      break;
+    case threaded_opcode_e::LSHI:
+      emit_shift_immediate(ins, 0xE0);
+      break;
+    case threaded_opcode_e::RSHI:
+      emit_shift_immediate(ins, 0xE8);
+      break;
+    case threaded_opcode_e::BLTI:
+      emit_branch_immediate(ins, cond_e::BELOW);
+      break;
+    case threaded_opcode_e::BGTI:
+      emit_branch_immediate(ins, cond_e::ABOVE);
+      break;
+    case threaded_opcode_e::BEQI:
+      emit_branch_immediate(ins, cond_e::EQUAL);
+      break;
+    case threaded_opcode_e::JMP:
+      jump_to(std::nullopt, ins.value);
+      break;
+    default:
+      break;
+    }
+  }
+
+  void emit_exits()
+  {
+    std::vector<std::size_t> to_epilogue;
+    for (auto &[destination, sites] : _exits) {
+      for (auto at : sites) {
+        _e.patch(at, _e.code.size());
+      }
+      auto [address, refund] = destination;
+      if (refund) {
+        _e.bytes({0x49, 0x81, 0xC4}); // add r12, refund
+        _e.imm32(refund);
+      }
+      _e.bytes({0x48, 0xB8}); // mov rax, address
+      _e.imm64(address);
+      to_epilogue.push_back(_e.jump(std::nullopt));
+    }
+
+    for (auto at : to_epilogue) {
+      _e.patch(at, _e.code.size());
+    }
+    _e.bytes({0x4D, 0x89, 0x26});       // mov [r14], r12
+    _e.bytes({0x48, 0x83, 0xC4, 0x08}); // add rsp, 8
+    _e.bytes({0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B}); // pop r14 - rbx
+    _e.bytes({0xC3});                                     // ret
+  }
+};
+
+} // namespace
+
+jit_c::jit_c(const threaded_program_t &instructions)
+    : _instructions(instructions),
+      _entries(new std::atomic<jit_entry_t>[instructions.size()]),
+      _attempted(instructions.size(), false)
+{
+  for (std::size_t i = 0; i < instructions.size(); i++) {
+    _entries[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+jit_c::~jit_c()
+{
+#ifdef SKIFF_JIT_AVAILABLE
+  for (auto &buffer : _buffers) {
+    munmap(buffer.memory, buffer.mapped);
+  }
+#endif
+}
+
+bool jit_c::is_compilable(const threaded_opcode_e opcode)
+{
+  switch (opcode) {
+  case threaded_opcode_e::NOP:
+  case threaded_opcode_e::MOV:
+  case threaded_opcode_e::ADD:
+  case threaded_opcode_e::SUB:
+  case threaded_opcode_e::MUL:
+  case threaded_opcode_e::DIV:
+  case threaded_opcode_e::AND:
+  case threaded_opcode_e::OR:
+  case threaded_opcode_e::XOR:
+  case threaded_opcode_e::NOT:
+  case threaded_opcode_e::LSH:
+  case threaded_opcode_e::RSH:
+  case threaded_opcode_e::ADDF:
+  case threaded_opcode_e::SUBF:
+  case threaded_opcode_e::MULF:
+  case threaded_opcode_e::DIVF:
+  case threaded_opcode_e::BLT:
+  case threaded_opcode_e::BGT:
+  case threaded_opcode_e::BEQ:
+  case threaded_opcode_e::BLTF:
+  case threaded_opcode_e::BGTF:
+  case threaded_opcode_e::BEQF:
+  case threaded_opcode_e::ADDI:
+  case threaded_opcode_e::SUBI:
+  case threaded_opcode_e::MULI:
+  case threaded_opcode_e::LSHI:
+  case threaded_opcode_e::RSHI:
+  case threaded_opcode_e::ANDI:
+  case threaded_opcode_e::ORI:
+  case threaded_opcode_e::BLTI:
+  case threaded_opcode_e::BGTI:
+  case threaded_opcode_e::BEQI:
+  case threaded_opcode_e::JMP:
+    return true;
+  default:
+    return false;
+  }
+}
+
+jit_entry_t jit_c::compile(const uint64_t address)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+
+  const std::lock_guard<std::mutex> lock(_mutex);
+  if (address >= _instructions.size() || _attempted[address]) {
+    return address < _instructions.size() ? get_entry(address) : nullptr;
+  }
+  _attempted[address] = true;
+
+#ifdef SKIFF_JIT_AVAILABLE
+  auto code = region_compiler_c(_instructions, address).compile();
+  if (!code) {
+    LOG(DEBUG) << TAG("jit") << "Nothing to compile at " << address << "\n";
+    return nullptr;
+  }
+
+  const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  const std::size_t mapped = (code->size() + page - 1) / page * page;
+  void *memory = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    LOG(WARNING) << TAG("jit") << "Unable to map code buffer\n";
+    return nullptr;
+  }
+  std::memcpy(memory, code->data(), code->size());
+
+  // Never writable and executable at the same time
+  if (mprotect(memory, mapped, PROT_READ | PROT_EXEC) != 0) {
+    LOG(WARNING) << TAG("jit") << "Unable to make code buffer executable\n";
+    munmap(memory, mapped);
+    return nullptr;
+  }
+  _buffers.push_back({memory, mapped});
+  _code_size += code->size();
+
+  LOG(DEBUG) << TAG("jit") << "Compiled region at " << address << " into "
+             << code->size() << " bytes\n";
+
+  auto entry = reinterpret_cast<jit_entry_t>(memory);
+  _entries[address].store(entry, std::memory_order_release);
+  return entry;
+#else
+  return nullptr;
+#endif
+}
+
+std::size_t jit_c::get_num_regions() const
+{
+  const std::lock_guard<std::mutex> lock(_mutex);
+  return _buffers.size();
+}
+
+std::size_t jit_c::get_code_size() const
+{
+  const std::lock_guard<std::mutex> lock(_mutex);
+  return _code_size;
+}
+
+} // namespace machine
+} // namespace skiff
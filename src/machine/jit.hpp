@@ -0,0 +1,105 @@
+#ifndef SKIFF_JIT_HPP
+#define SKIFF_JIT_HPP
+
+#include "machine/threaded.hpp"
+#include "types.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define SKIFF_JIT_AVAILABLE 1
+#endif
+
+namespace skiff {
+namespace machine {
+
+//! \brief Entry point of a compiled region
+//! \param registers The register file of the vm running the region
+//! \param remaining Instructions left in the current budget. Updated to
+//!        reflect the instructions executed natively
+//! \param interrupts_pending Word that is non-zero while an interrupt is
+//!        waiting to be taken
+//! \returns The address of the next instruction to execute in the
+//!          interpreter
+using jit_entry_t = uint64_t (*)(types::vm_register *registers,
+                                 uint64_t *remaining,
+                                 const void *interrupts_pending);
+
+//! \brief Template compiler from threaded instructions to x86-64
+//! \note  A region starts at a hot address and runs forward over every
+//!        instruction that can be compiled. Control leaves a region, handing
+//!        back to the interpreter, when it branches outside of the region,
+//!        reaches an instruction that can not be compiled, is about to
+//!        divide by zero, has an interrupt pending at a loop back-edge or
+//!        does not have enough of its instruction budget left to run the
+//!        next block in full.
+//!
+//!        Compiled regions belong to a program and are shared by every vm
+//!        running it. Compilation is guarded by a mutex while lookups are a
+//!        single atomic load.
+class jit_c {
+public:
+  //! \brief Create a compiler for a program
+  //! \param instructions The program instructions, must outlive the jit
+  jit_c(const threaded_program_t &instructions);
+
+  //! \brief Release all compiled code
+  ~jit_c();
+
+  jit_c(const jit_c &) = delete;
+  jit_c &operator=(const jit_c &) = delete;
+
+  //! \brief Check if native code can be generated on this host
+  [[nodiscard]] static constexpr bool is_available()
+  {
+#ifdef SKIFF_JIT_AVAILABLE
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  //! \brief Retrieve the compiled region starting at an address
+  //! \returns The entry point, or nullptr if nothing has been compiled
+  [[nodiscard]] jit_entry_t get_entry(const uint64_t address) const
+  {
+    return _entries[address].load(std::memory_order_acquire);
+  }
+
+  //! \brief Compile the region starting at an address
+  //! \returns The entry point, or nullptr if the region can not be compiled
+  //! \note  Safe to call from any thread. Addresses are only ever compiled
+  //!        once, later calls return the first result
+  jit_entry_t compile(const uint64_t address);
+
+  //! \brief Retrieve the number of regions compiled
+  [[nodiscard]] std::size_t get_num_regions() const;
+
+  //! \brief Retrieve the bytes of native code generated
+  [[nodiscard]] std::size_t get_code_size() const;
+
+  //! \brief Check if an instruction can be compiled
+  [[nodiscard]] static bool is_compilable(const threaded_opcode_e opcode);
+
+private:
+  struct code_buffer_t {
+    void *memory{nullptr};
+    std::size_t mapped{0};
+  };
+
+  const threaded_program_t &_instructions;
+  std::unique_ptr<std::atomic<jit_entry_t>[]> _entries;
+  std::vector<bool> _attempted;        // Guarded by _mutex
+  std::vector<code_buffer_t> _buffers; // Guarded by _mutex
+  std::size_t _code_size{0};           // Guarded by _mutex
+  mutable std::mutex _mutex;
+};
+
+} // namespace machine
+} // namespace skiff
+
+#endif
@@ -0,0 +1,315 @@
+#include "machine/memory/allocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SKIFF_ALLOCATOR_USE_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#define SKIFF_ALLOCATOR_USE_MREMAP
+#endif
+
+namespace skiff {
+namespace machine {
+namespace memory {
+
+static_assert(slab_allocator_c::min_block_bytes
+                  << (slab_allocator_c::num_size_classes - 1) ==
+              slab_allocator_c::max_block_bytes);
+static_assert(slab_allocator_c::slab_bytes %
+                  slab_allocator_c::max_block_bytes ==
+              0);
+
+slab_allocator_c::slab_allocator_c()
+{
+#ifdef SKIFF_ALLOCATOR_USE_MMAP
+  _page_bytes = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+slab_allocator_c::~slab_allocator_c()
+{
+  release_retained();
+  for (auto slab : _slabs) {
+    unmap(slab, slab_bytes);
+  }
+}
+
+bool slab_allocator_c::set_settings(const settings_t &settings)
+{
+  if (_stats.large_in_use || _stats.heap_in_use) {
+    return false;
+  }
+  release_retained();
+  _settings = settings;
+  return true;
+}
+
+std::size_t slab_allocator_c::get_size_class(const std::size_t size)
+{
+  if (size <= min_block_bytes) {
+    return 0;
+  }
+  if (size > max_block_bytes) {
+    return num_size_classes;
+  }
+  return std::bit_width(size - 1) - std::bit_width(min_block_bytes - 1);
+}
+
+void *slab_allocator_c::allocate(const std::size_t size)
+{
+  const auto index = get_size_class(size);
+  void *block{nullptr};
+
+  if (index == num_size_classes) {
+    block = allocate_large(size);
+  }
+  else {
+    const std::size_t bytes = min_block_bytes << index;
+    auto &size_class = _classes[index];
+
+    if (size_class.free_list) {
+      block = size_class.free_list;
+      size_class.free_list = size_class.free_list->next;
+    }
+    else {
+      // Blocks are only carved out of a slab as they are needed, whatever
+      // is left at the end of the old slab goes unused
+      if (size_class.next == size_class.end) {
+        auto slab = static_cast<uint8_t *>(map(slab_bytes));
+        _slabs.push_back(slab);
+        _stats.slabs++;
+        size_class.next = slab;
+        size_class.end = slab + slab_bytes;
+      }
+      block = size_class.next;
+      size_class.next += bytes;
+    }
+    _stats.class_allocations[index]++;
+    _stats.bytes_in_use += bytes;
+  }
+
+  _stats.allocations++;
+  _stats.peak_bytes_in_use =
+      std::max(_stats.peak_bytes_in_use, _stats.bytes_in_use);
+  return block;
+}
+
+void slab_allocator_c::release(void *block, const std::size_t size)
+{
+  if (!block) {
+    return;
+  }
+  _stats.frees++;
+
+  const auto index = get_size_class(size);
+  if (index == num_size_classes) {
+    release_large(block, size);
+    return;
+  }
+
+  auto &size_class = _classes[index];
+  auto free_block = static_cast<free_block_t *>(block);
+  free_block->next = size_class.free_list;
+  size_class.free_list = free_block;
+  _stats.bytes_in_use -= min_block_bytes << index;
+}
+
+void *slab_allocator_c::reallocate(void *block, const std::size_t size,
+                                   const std::size_t new_size)
+{
+  const auto index = get_size_class(size);
+  const auto new_index = get_size_class(new_size);
+
+  // Blocks of the same class are already big enough, and only mappings can
+  // be resized where they are
+  if (index != num_size_classes || new_index != num_size_classes ||
+      !is_mapped(size) || !is_mapped(new_size)) {
+    auto resized = index == new_index && index != num_size_classes
+                       ? block
+                       : allocate(new_size);
+    if (resized != block) {
+      std::memcpy(resized, block, std::min(size, new_size));
+      release(block, size);
+    }
+    _stats.reallocations++;
+    return resized;
+  }
+
+  const auto bytes = get_large_bytes(size);
+  const auto new_bytes = get_large_bytes(new_size);
+  auto resized = bytes == new_bytes ? block : remap(block, bytes, new_bytes);
+  _stats.reallocations++;
+  _stats.large_bytes += new_bytes - bytes;
+  _stats.bytes_in_use += new_bytes - bytes;
+  _stats.peak_bytes_in_use =
+      std::max(_stats.peak_bytes_in_use, _stats.bytes_in_use);
+  return resized;
+}
+
+void *slab_allocator_c::allocate_large(const std::size_t size)
+{
+  if (!is_mapped(size)) {
+    auto block = ::operator new(size, std::align_val_t{min_block_bytes});
+    _stats.heap_in_use++;
+    _stats.bytes_in_use += size;
+    return block;
+  }
+
+  const auto bytes = get_large_bytes(size);
+  void *block{nullptr};
+  auto retained = std::find_if(
+      _retained.begin(), _retained.end(),
+      [bytes](const auto &mapping) { return std::get<1>(mapping) == bytes; });
+  if (retained != _retained.end()) {
+    block = std::get<0>(*retained);
+    _retained.erase(retained);
+    _stats.retained_bytes -= bytes;
+    _stats.reused_mappings++;
+  }
+  else {
+    block = map_large(bytes);
+  }
+  _stats.large_in_use++;
+  _stats.large_bytes += bytes;
+  _stats.bytes_in_use += bytes;
+  return block;
+}
+
+void slab_allocator_c::release_large(void *block, const std::size_t size)
+{
+  if (!is_mapped(size)) {
+    ::operator delete(block, std::align_val_t{min_block_bytes});
+    _stats.heap_in_use--;
+    _stats.bytes_in_use -= size;
+    return;
+  }
+
+  const auto bytes = get_large_bytes(size);
+  unmap_large(block, bytes);
+  _stats.large_in_use--;
+  _stats.large_bytes -= bytes;
+  _stats.bytes_in_use -= bytes;
+}
+
+bool slab_allocator_c::is_mapped(const std::size_t size) const
+{
+  return size >= _settings.map_threshold;
+}
+
+void *slab_allocator_c::map_large(const std::size_t bytes)
+{
+#ifdef SKIFF_ALLOCATOR_USE_MMAP
+  if (_settings.huge_pages && bytes >= huge_page_bytes) {
+    // Map a huge page more than needed and trim it down to an aligned range,
+    // huge pages can only back ranges that start on a huge page boundary
+    auto raw = static_cast<uint8_t *>(map(bytes + huge_page_bytes));
+    const auto address = reinterpret_cast<std::uintptr_t>(raw);
+    const auto head =
+        (huge_page_bytes - address % huge_page_bytes) % huge_page_bytes;
+    if (head) {
+      unmap(raw, head);
+    }
+    if (head != huge_page_bytes) {
+      unmap(raw + head + bytes, huge_page_bytes - head);
+    }
+    advise_huge(raw + head, bytes);
+    return raw + head;
+  }
+#endif
+  return map(bytes);
+}
+
+void slab_allocator_c::unmap_large(void *block, const std::size_t bytes)
+{
+#if defined(SKIFF_ALLOCATOR_USE_MMAP) && defined(MADV_DONTNEED)
+  if (_stats.retained_bytes + bytes <= _settings.retained_bytes) {
+    // The pages go back to the system now and read as zero when touched
+    // again, only the address range is kept
+    madvise(block, bytes, MADV_DONTNEED);
+    _retained.emplace_back(block, bytes);
+    _stats.retained_bytes += bytes;
+    return;
+  }
+#endif
+  unmap(block, bytes);
+}
+
+void slab_allocator_c::advise_huge(void *memory, const std::size_t bytes)
+{
+#if defined(SKIFF_ALLOCATOR_USE_MMAP) && defined(MADV_HUGEPAGE)
+  // Only advice, a kernel without transparent huge pages ignores it
+  madvise(memory, bytes, MADV_HUGEPAGE);
+  _stats.huge_mappings++;
+#endif
+}
+
+void slab_allocator_c::release_retained()
+{
+  for (auto [block, bytes] : _retained) {
+    unmap(block, bytes);
+  }
+  _retained.clear();
+  _stats.retained_bytes = 0;
+}
+
+std::size_t slab_allocator_c::get_large_bytes(const std::size_t size) const
+{
+  return (size + _page_bytes - 1) / _page_bytes * _page_bytes;
+}
+
+void *slab_allocator_c::map(const std::size_t bytes)
+{
+#ifdef SKIFF_ALLOCATOR_USE_MMAP
+  void *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  return memory;
+#else
+  return ::operator new(bytes, std::align_val_t{min_block_bytes});
+#endif
+}
+
+void *slab_allocator_c::remap(void *memory, const std::size_t bytes,
+                              const std::size_t new_bytes)
+{
+#ifdef SKIFF_ALLOCATOR_USE_MREMAP
+  // The kernel moves the pages themselves, so nothing is copied
+  void *resized = mremap(memory, bytes, new_bytes, MREMAP_MAYMOVE);
+  if (resized == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  _stats.remaps++;
+  if (_settings.huge_pages && new_bytes >= huge_page_bytes) {
+    advise_huge(resized, new_bytes);
+  }
+  return resized;
+#else
+  void *resized = map_large(new_bytes);
+  std::memcpy(resized, memory, std::min(bytes, new_bytes));
+  unmap(memory, bytes);
+  return resized;
+#endif
+}
+
+void slab_allocator_c::unmap(void *memory, const std::size_t bytes)
+{
+#ifdef SKIFF_ALLOCATOR_USE_MMAP
+  munmap(memory, bytes);
+#else
+  ::operator delete(memory, std::align_val_t{min_block_bytes});
+#endif
+}
+
+} // namespace memory
+} // namespace machine
+} // namespace skiff
@@ -0,0 +1,169 @@
+#ifndef SKIFF_ALLOCATOR_HPP
+#define SKIFF_ALLOCATOR_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+namespace skiff {
+namespace machine {
+namespace memory {
+
+//! \brief Allocator for the bytes behind memory slots
+//! \note  Small requests are rounded up to a power of two size class and
+//!        carved out of slabs that are kept for the life of the allocator,
+//!        so freeing and allocating a slot of the same size again never
+//!        reaches the system allocator. Requests larger than the biggest
+//!        class are mapped directly, or taken from the heap when they are
+//!        under the mapping threshold. Mapped blocks are populated lazily
+//!        and start zeroed, and are unmapped as soon as they are released
+//!        unless they are retained for reuse. Not thread safe, the owner
+//!        serialises access.
+class slab_allocator_c {
+public:
+  //! \brief Smallest block handed out
+  static constexpr std::size_t min_block_bytes = 16;
+
+  //! \brief Largest block carved out of a slab
+  static constexpr std::size_t max_block_bytes = 4096;
+
+  //! \brief Number of size classes between the smallest and largest block
+  static constexpr std::size_t num_size_classes = 9;
+
+  //! \brief Bytes in each slab
+  static constexpr std::size_t slab_bytes = 65'536;
+
+  //! \brief Size and alignment of a transparent huge page
+  static constexpr std::size_t huge_page_bytes = 2'097'152;
+
+  //! \brief How blocks too large for a slab are served
+  struct settings_t {
+    //! Requests of at least this many bytes are mapped on their own, any
+    //! smaller ones that are too large for a slab come from the heap
+    std::size_t map_threshold{max_block_bytes + 1};
+    //! Align mappings of at least `huge_page_bytes` and ask the system to
+    //! back them with huge pages
+    bool huge_pages{false};
+    //! Most bytes of released mappings kept to serve later requests of the
+    //! same size. Their pages are still handed back to the system at once
+    std::size_t retained_bytes{0};
+  };
+
+  //! \brief Allocation statistics
+  struct stats_t {
+    //! Blocks handed out
+    uint64_t allocations{0};
+    //! Blocks released
+    uint64_t frees{0};
+    //! Bytes handed out and not yet released
+    uint64_t bytes_in_use{0};
+    //! Most bytes in use at once
+    uint64_t peak_bytes_in_use{0};
+    //! Slabs mapped for small blocks
+    uint64_t slabs{0};
+    //! Large blocks mapped and not yet released
+    uint64_t large_in_use{0};
+    //! Bytes mapped for large blocks
+    uint64_t large_bytes{0};
+    //! Blocks too large for a slab taken from the heap and not yet released
+    uint64_t heap_in_use{0};
+    //! Mappings asked to be backed by huge pages
+    uint64_t huge_mappings{0};
+    //! Mappings served from those retained
+    uint64_t reused_mappings{0};
+    //! Bytes of released mappings currently retained
+    uint64_t retained_bytes{0};
+    //! Blocks resized
+    uint64_t reallocations{0};
+    //! Large blocks resized by remapping rather than copying
+    uint64_t remaps{0};
+    //! Blocks handed out from each size class
+    std::array<uint64_t, num_size_classes> class_allocations{};
+  };
+
+  //! \brief Create the allocator
+  slab_allocator_c();
+
+  //! \brief Destroy the allocator, unmapping every slab
+  ~slab_allocator_c();
+
+  slab_allocator_c(const slab_allocator_c &) = delete;
+  slab_allocator_c &operator=(const slab_allocator_c &) = delete;
+
+  //! \brief Allocate a block of at least `size` bytes
+  //! \returns Pointer to the block, aligned to 16 bytes
+  //! \note  Throws std::bad_alloc if the system is out of memory
+  [[nodiscard]] void *allocate(const std::size_t size);
+
+  //! \brief Return a block to the allocator
+  //! \param block The block to release, as returned by `allocate`
+  //! \param size The size the block was allocated with
+  void release(void *block, const std::size_t size);
+
+  //! \brief Grow or shrink a block, keeping the bytes both sizes share
+  //! \param block The block to resize, as returned by `allocate`
+  //! \param size The size the block was allocated with
+  //! \param new_size The size to resize the block to
+  //! \returns Pointer to the resized block, which may have moved
+  //! \note  A block stays where it is if its new size is served the same
+  //!        way, and large blocks are remapped where the system can so
+  //!        their bytes aren't copied. Throws std::bad_alloc if the system
+  //!        is out of memory, leaving the block as it was
+  [[nodiscard]] void *reallocate(void *block, const std::size_t size,
+                                 const std::size_t new_size);
+
+  //! \brief Change how blocks too large for a slab are served
+  //! \returns true iff no such blocks were in use, as they must be released
+  //!          the way they were allocated
+  //! \note  Any mappings retained under the old settings are unmapped
+  [[nodiscard]] bool set_settings(const settings_t &settings);
+
+  //! \brief Retrieve how blocks too large for a slab are served
+  [[nodiscard]] const settings_t &get_settings() const { return _settings; }
+
+  //! \brief Retrieve the allocation statistics
+  [[nodiscard]] const stats_t &get_stats() const { return _stats; }
+
+  //! \brief Retrieve the size class a request is served from
+  //! \returns Index of the class, or num_size_classes for large requests
+  [[nodiscard]] static std::size_t get_size_class(const std::size_t size);
+
+private:
+  struct free_block_t {
+    free_block_t *next;
+  };
+
+  struct size_class_t {
+    free_block_t *free_list{nullptr};
+    uint8_t *next{nullptr};
+    uint8_t *end{nullptr};
+  };
+
+  void *allocate_large(const std::size_t size);
+  void release_large(void *block, const std::size_t size);
+  bool is_mapped(const std::size_t size) const;
+  void *map_large(const std::size_t bytes);
+  void unmap_large(void *block, const std::size_t bytes);
+  void advise_huge(void *memory, const std::size_t bytes);
+  void release_retained();
+  void *map(const std::size_t bytes);
+  void *remap(void *memory, const std::size_t bytes,
+              const std::size_t new_bytes);
+  void unmap(void *memory, const std::size_t bytes);
+  std::size_t get_large_bytes(const std::size_t size) const;
+
+  std::array<size_class_t, num_size_classes> _classes{};
+  std::vector<void *> _slabs;
+  std::vector<std::tuple<void *, std::size_t>> _retained;
+  std::size_t _page_bytes{4096};
+  settings_t _settings;
+  stats_t _stats;
+};
+
+} // namespace memory
+} // namespace machine
+} // namespace skiff
+
+#endif
@@ -0,0 +1,73 @@
+#include "machine/memory/call_stack.hpp"
+
+#include <limits>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SKIFF_CALL_STACK_USE_MMAP
+#include <sys/mman.h>
+#endif
+
+namespace skiff {
+namespace machine {
+namespace memory {
+
+call_stack_c::call_stack_c(const uint64_t max_depth) : _max_depth{max_depth}
+{
+}
+
+call_stack_c::~call_stack_c()
+{
+  if (!_base) {
+    return;
+  }
+#ifdef SKIFF_CALL_STACK_USE_MMAP
+  munmap(_base, _capacity * sizeof(uint64_t));
+#else
+  delete[] _base;
+#endif
+}
+
+bool call_stack_c::set_max_depth(const uint64_t max_depth)
+{
+  if (_base) {
+    return false;
+  }
+  _max_depth = max_depth;
+  return true;
+}
+
+bool call_stack_c::reserve()
+{
+  // Once reserved the stack is only ever out of room when it is full
+  if (_base || _max_depth == 0 ||
+      _max_depth > std::numeric_limits<uint64_t>::max() / sizeof(uint64_t)) {
+    return false;
+  }
+
+#ifdef SKIFF_CALL_STACK_USE_MMAP
+  // Anonymous pages are only backed once they are touched, so nothing is
+  // committed past the deepest call made
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+  flags |= MAP_NORESERVE;
+#endif
+  void *base = mmap(nullptr, _max_depth * sizeof(uint64_t),
+                    PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (base == MAP_FAILED) {
+    return false;
+  }
+  _base = static_cast<uint64_t *>(base);
+#else
+  _base = new (std::nothrow) uint64_t[_max_depth];
+  if (!_base) {
+    return false;
+  }
+#endif
+  _capacity = _max_depth;
+  return true;
+}
+
+} // namespace memory
+} // namespace machine
+} // namespace skiff
@@ -0,0 +1,90 @@
+#ifndef SKIFF_CALL_STACK_HPP
+#define SKIFF_CALL_STACK_HPP
+
+#include "config.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+
+namespace skiff {
+namespace machine {
+namespace memory {
+
+//! \brief A contiguous stack of return addresses that holds up-to the
+//!        number of calls it is created with, 'call_stack_depth' in
+//!        config.hpp by default
+//! \note  Room for the deepest stack is reserved when it is first used,
+//!        and the system only backs the pages that calls reach
+class call_stack_c {
+public:
+  //! \brief Create the call stack
+  //! \param max_depth The most return addresses the stack can hold
+  call_stack_c(const uint64_t max_depth = skiff::config::call_stack_depth);
+
+  //! \brief Destroy the call stack
+  ~call_stack_c();
+
+  call_stack_c(const call_stack_c &) = delete;
+  call_stack_c &operator=(const call_stack_c &) = delete;
+
+  //! \brief Change the most return addresses the stack can hold
+  //! \returns true iff the stack hadn't been used yet
+  [[nodiscard]] bool set_max_depth(const uint64_t max_depth);
+
+  //! \brief Retrieve the most return addresses the stack can hold
+  [[nodiscard]] uint64_t get_max_depth() const { return _max_depth; }
+
+  //! \brief Retrieve the number of return addresses held
+  [[nodiscard]] uint64_t get_depth() const { return _depth; }
+
+  //! \brief Retrieve the most return addresses held at once so far
+  [[nodiscard]] uint64_t get_peak_depth() const
+  {
+    return std::max(_peak, _depth);
+  }
+
+  //! \brief Check if there are no return addresses to pop
+  [[nodiscard]] bool empty() const { return _depth == 0; }
+
+  //! \brief Push a return address
+  //! \returns true iff the stack wasn't already full
+  [[nodiscard]] bool push(const uint64_t address)
+  {
+    if (_depth == _capacity && !reserve()) {
+      return false;
+    }
+    _base[_depth++] = address;
+    return true;
+  }
+
+  //! \brief Pop the most recently pushed return address
+  //! \returns tuple containing boolean indicating if
+  //!          the operation was a success, and the
+  //!          return address
+  [[nodiscard]] std::tuple<bool, uint64_t> pop()
+  {
+    if (_depth == 0) {
+      return {false, 0};
+    }
+    // Only a pop can end the deepest run of calls, so the peak is kept here
+    // rather than on every push
+    _peak = std::max(_peak, _depth);
+    return {true, _base[--_depth]};
+  }
+
+private:
+  bool reserve();
+
+  uint64_t *_base{nullptr};
+  uint64_t _depth{0};
+  uint64_t _capacity{0};
+  uint64_t _peak{0};
+  uint64_t _max_depth{0};
+};
+
+} // namespace memory
+} // namespace machine
+} // namespace skiff
+
+#endif
@@ -1,5 +1,10 @@
 #include "machine/memory/memman.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <new>
+
 namespace skiff {
 namespace machine {
 namespace memory {
@@ -8,53 +13,385 @@ memman_c::memman_c() {}
 
 memman_c::~memman_c()
 {
-  for (auto i = 0; i < _slots.size(); i++) {
-    if (nullptr != _slots.at(i)) {
-      delete _slots.at(i);
+  const uint64_t num_slots = _num_slots.load(std::memory_order_acquire);
+  for (uint64_t i = 0; i < num_slots; i++) {
+    auto &slot = get_descriptor(i);
+    if (slot.memory.load(std::memory_order_relaxed)) {
+      destroy_memory(slot);
     }
   }
+  for (auto &region : _regions) {
+    release_region(region);
+  }
+  for (auto &chunk : _chunks) {
+    delete[] chunk.load(std::memory_order_relaxed);
+  }
 }
 
 std::tuple<bool, uint64_t> memman_c::alloc(const uint64_t size)
 {
   std::lock_guard<std::mutex> lock(_mutex);
-  // Determine if the list needs to grow, or if there is an available index
-  if (_available_ids.empty()) {
-    _slots.push_back(new skiff::machine::memory::memory_c(size));
-    return {true, _slots.size() - 1};
+
+  // A full table can't take the slot whatever its size
+  if (_available_ids.empty() && _num_slots.load(std::memory_order_relaxed) >=
+                                    slots_per_chunk * max_chunks) {
+    return {false, 0};
   }
-  else {
+  // Slots are charged for the storage they hold so freeing them hands back
+  // exactly what was taken
+  const uint64_t bytes = memory_c::get_storage_size(size);
+  const uint64_t peak = _usage.peak_bytes;
+  if (!reserve(bytes)) {
+    return {false, 0};
+  }
+
+  auto *region = _regions.empty() ? nullptr : &_regions.back();
+
+  // The host running out of memory fails the allocation like the limit
+  // does, handing back what was reserved for it
+  const bool grow = _available_ids.empty();
+  const uint64_t index = grow ? _num_slots.load(std::memory_order_relaxed)
+                              : _available_ids.front();
+  skiff::machine::memory::memory_c *memory{nullptr};
+  try {
+    // Chunks are published before the slot count so readers never see a
+    // slot without its chunk
+    auto &chunk = _chunks[index / slots_per_chunk];
+    if (grow && !chunk.load(std::memory_order_relaxed)) {
+      chunk.store(new slot_t[slots_per_chunk], std::memory_order_release);
+    }
+    memory = region ? create_memory(size, *region) : create_memory(size);
+  }
+  catch (const std::bad_alloc &) {
+    _usage.live_bytes -= bytes;
+    _usage.peak_bytes = peak;
+    return {false, 0};
+  }
+  _usage.allocations++;
+  _usage.size_histogram[std::bit_width(size)]++;
 
-    //  If there was a freed spot its index will be in the queue.
-    //  Use it instead of growing the vector
-    auto idx = _available_ids.front();
-    _slots[idx] = new skiff::machine::memory::memory_c(size);
-    _available_ids.pop();
-    return {true, idx};
+  //  If there was a freed spot its index was taken from the queue rather
+  //  than growing the table
+  auto &slot = get_descriptor(index);
+  slot.region = region ? region->id : 0;
+  slot.carved = region ? bytes : 0;
+  if (!grow) {
+    _available_ids.pop_front();
+    slot.memory.store(memory, std::memory_order_release);
+  }
+  else {
+    slot.memory.store(memory, std::memory_order_relaxed);
+    _num_slots.store(index + 1, std::memory_order_release);
+  }
+  const uint64_t generation = slot.generation.load(std::memory_order_relaxed);
+  const uint64_t id = (generation << 32) | index;
+  if (region) {
+    region->bytes += bytes;
+    region->slots.push_back(id);
   }
+  return {true, id};
 }
 
 bool memman_c::free(const uint64_t id)
 {
   std::lock_guard<std::mutex> lock(_mutex);
-  if (id >= _slots.size() || nullptr == _slots[id]) {
+
+  const uint64_t index = id & index_mask;
+  if (index >= _num_slots.load(std::memory_order_relaxed)) {
     return false;
   }
-  delete _slots.at(id);
-  _slots.at(id) = nullptr;
-  _available_ids.push(id);
+  auto &slot = get_descriptor(index);
+  const uint32_t generation = slot.generation.load(std::memory_order_relaxed);
+  if (generation != static_cast<uint32_t>(id >> 32) ||
+      nullptr == slot.memory.load(std::memory_order_relaxed)) {
+    return false;
+  }
+
+  // Retire the id before the memory goes away
+  slot.generation.store(generation + 1, std::memory_order_release);
+  destroy_memory(slot);
+
+  // A slot that has been through every generation is never used again so
+  // its ids can't repeat
+  if (generation + 1 != std::numeric_limits<uint32_t>::max()) {
+    _available_ids.push_back(index);
+  }
   return true;
 }
 
-skiff::machine::memory::memory_c *memman_c::get_slot(const uint64_t id)
+bool memman_c::realloc(const uint64_t id, const uint64_t size)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  const uint64_t index = id & index_mask;
+  if (index >= _num_slots.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  auto &slot = get_descriptor(index);
+  auto memory = slot.memory.load(std::memory_order_relaxed);
+  if (slot.generation.load(std::memory_order_relaxed) !=
+          static_cast<uint32_t>(id >> 32) ||
+      nullptr == memory) {
+    return false;
+  }
+
+  // Bytes carved out of a region can't be resized on their own
+  if (slot.region) {
+    return resize_in_region(slot, size);
+  }
+
+  // Growth is reserved up front and handed back if the resize fails. The
+  // host running out of memory leaves the slot as it was
+  const uint64_t old_size = memory->size();
+  const uint64_t storage = memory_c::get_storage_size(size);
+  const uint64_t growth = storage > old_size ? storage - old_size : 0;
+  const uint64_t peak = _usage.peak_bytes;
+  if (!reserve(growth)) {
+    return false;
+  }
+  bool resized{false};
+  try {
+    resized = memory->resize(size);
+  }
+  catch (const std::bad_alloc &) {
+    resized = false;
+  }
+  if (!resized) {
+    _usage.live_bytes -= growth;
+    _usage.peak_bytes = peak;
+    return false;
+  }
+  _usage.live_bytes -= old_size - std::min(storage, old_size);
+  _usage.reallocations++;
+  return true;
+}
+
+std::tuple<bool, uint64_t> memman_c::begin_region()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  if (_regions.size() >= max_open_regions) {
+    return {false, 0};
+  }
+  _regions.push_back({.id = _next_region_id++});
+  return {true, _regions.back().id};
+}
+
+bool memman_c::free_region(const uint64_t id)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  auto region =
+      std::find_if(_regions.begin(), _regions.end(),
+                   [id](const region_t &region) { return region.id == id; });
+  if (region == _regions.end()) {
+    return false;
+  }
+  const std::size_t outermost = region - _regions.begin();
+
+  // Innermost first, so nested regions go with the one that holds them
+  while (_regions.size() > outermost) {
+    auto &innermost = _regions.back();
+
+    // Each live slot still moves on a generation so its id goes stale.
+    // Their memory was carved from the region's blocks and holds nothing
+    // of its own, so it goes with them rather than slot by slot
+    std::size_t retired{0};
+    for (auto slot_id : innermost.slots) {
+      const uint64_t index = slot_id & index_mask;
+      auto &slot = get_descriptor(index);
+      const uint32_t generation =
+          slot.generation.load(std::memory_order_relaxed);
+      if (generation != static_cast<uint32_t>(slot_id >> 32) ||
+          nullptr == slot.memory.load(std::memory_order_relaxed)) {
+        continue;
+      }
+      slot.generation.store(generation + 1, std::memory_order_release);
+      slot.memory.store(nullptr, std::memory_order_release);
+      if (generation + 1 != std::numeric_limits<uint32_t>::max()) {
+        innermost.slots[retired++] = index;
+      }
+      _usage.frees++;
+    }
+    _available_ids.insert(_available_ids.end(), innermost.slots.begin(),
+                          innermost.slots.begin() + retired);
+    _usage.live_bytes -= innermost.bytes;
+    release_region(innermost);
+    _regions.pop_back();
+  }
+  return true;
+}
+
+void memman_c::set_byte_order(const byte_order_e order)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _byte_order = order;
+}
+
+bool memman_c::set_allocator_settings(
+    const slab_allocator_c::settings_t &settings)
 {
   std::lock_guard<std::mutex> lock(_mutex);
-  if (id >= _slots.size() || nullptr == _slots[id]) {
-    return nullptr;
+  return _allocator.set_settings(settings);
+}
+
+void memman_c::set_limit(const uint64_t bytes)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _limit = bytes;
+}
+
+uint64_t memman_c::get_limit()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _limit;
+}
+
+memman_c::usage_t memman_c::get_usage()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _usage;
+}
+
+slab_allocator_c::stats_t memman_c::get_allocator_stats()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _allocator.get_stats();
+}
+
+skiff::machine::memory::memory_c *memman_c::create_memory(const uint64_t size)
+{
+  auto block = _allocator.allocate(sizeof(skiff::machine::memory::memory_c));
+  try {
+    return new (block)
+        skiff::machine::memory::memory_c(size, _allocator, _byte_order);
+  }
+  catch (...) {
+    _allocator.release(block, sizeof(skiff::machine::memory::memory_c));
+    throw;
+  }
+}
+
+skiff::machine::memory::memory_c *memman_c::create_memory(const uint64_t size,
+                                                          region_t &region)
+{
+  auto block = carve(region, sizeof(skiff::machine::memory::memory_c));
+  auto data = carve(region, memory_c::get_storage_size(size));
+  return new (block) skiff::machine::memory::memory_c(
+      size, static_cast<uint8_t *>(data), _byte_order);
+}
+
+void memman_c::destroy_memory(slot_t &slot)
+{
+  auto memory = slot.memory.load(std::memory_order_relaxed);
+  slot.memory.store(nullptr, std::memory_order_release);
+  _usage.frees++;
+
+  // Memory in a region is given back when the region is freed, and stays
+  // charged until then
+  if (!slot.region) {
+    _usage.live_bytes -= memory->size();
+    memory->~memory_c();
+    _allocator.release(memory, sizeof(skiff::machine::memory::memory_c));
+    return;
+  }
+  memory->~memory_c();
+}
+
+memman_c::region_t *memman_c::find_region(const uint64_t id)
+{
+  auto region =
+      std::find_if(_regions.begin(), _regions.end(),
+                   [id](const region_t &region) { return region.id == id; });
+  return region == _regions.end() ? nullptr : &*region;
+}
+
+bool memman_c::resize_in_region(slot_t &slot, const uint64_t size)
+{
+  auto region = find_region(slot.region);
+  if (!region) {
+    return false;
+  }
+  auto memory = slot.memory.load(std::memory_order_relaxed);
+  const uint64_t storage = memory_c::get_storage_size(size);
+  auto [okay, bytes] = memory->get_span(0, memory->size());
+  auto data = bytes.data();
+
+  // A slot that still fits in what was carved for it is resized in place.
+  // Otherwise it is carved again, and as the bytes it leaves behind stay
+  // with the region until it is freed they stay charged too
+  if (storage > slot.carved) {
+    const uint64_t peak = _usage.peak_bytes;
+    if (!reserve(storage)) {
+      return false;
+    }
+    try {
+      data = static_cast<uint8_t *>(carve(*region, storage));
+    }
+    catch (const std::bad_alloc &) {
+      _usage.live_bytes -= storage;
+      _usage.peak_bytes = peak;
+      return false;
+    }
+    std::copy(bytes.begin(), bytes.end(), data);
+    region->bytes += storage;
+    slot.carved = storage;
+  }
+
+  // The slot keeps the same memory, rebuilt over its new bytes
+  const auto order = memory->get_byte_order();
+  memory->~memory_c();
+  new (memory) skiff::machine::memory::memory_c(size, data, order);
+  _usage.reallocations++;
+  return true;
+}
+
+void *memman_c::carve(region_t &region, const std::size_t size)
+{
+  // Keep everything carved aligned as the allocator would
+  const std::size_t bytes =
+      (size + slab_allocator_c::min_block_bytes - 1) /
+      slab_allocator_c::min_block_bytes * slab_allocator_c::min_block_bytes;
+
+  if (static_cast<std::size_t>(region.end - region.next) < bytes) {
+    const auto block_bytes = std::max(region_block_bytes, bytes);
+    auto block = static_cast<uint8_t *>(_allocator.allocate(block_bytes));
+    region.blocks.push_back({block, block_bytes});
+
+    // Big requests get a block to themselves, leaving the current one to
+    // carry on with
+    if (block_bytes != region_block_bytes) {
+      return block;
+    }
+    region.next = block;
+    region.end = block + block_bytes;
+  }
+  auto result = region.next;
+  region.next += bytes;
+  return result;
+}
+
+bool memman_c::reserve(const uint64_t bytes)
+{
+  if (bytes && _limit &&
+      (bytes > _limit || _usage.live_bytes > _limit - bytes)) {
+    _usage.refused++;
+    return false;
+  }
+  _usage.live_bytes += bytes;
+  _usage.peak_bytes = std::max(_usage.peak_bytes, _usage.live_bytes);
+  return true;
+}
+
+void memman_c::release_region(region_t &region)
+{
+  for (auto [block, bytes] : region.blocks) {
+    _allocator.release(block, bytes);
   }
-  return _slots.at(id);
+  region.blocks.clear();
+  region.next = region.end = nullptr;
 }
 
 } // namespace memory
 } // namespace machine
-} // namespace skiff
\ No newline at end of file
+} // namespace skiff
@@ -1,11 +1,14 @@
 #ifndef SKIFF_MEMMAN_HPP
 #define SKIFF_MEMMAN_HPP
 
+#include "machine/memory/allocator.hpp"
 #include "machine/memory/memory.hpp"
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <deque>
 #include <mutex>
 #include <optional>
-#include <queue>
 #include <tuple>
 #include <vector>
 
@@ -15,33 +18,207 @@ namespace memory {
 
 //! \brief Memory manager class that allows the creation and
 //!        retrieval of memory slots that can be used to hold information
+//! \note  Ids hold the index of a slot in their low 32 bits and the
+//!        generation of that slot in their high 32 bits. Freeing a slot
+//!        moves it on to its next generation, so an id that outlives its
+//!        slot never refers to whatever is allocated there next.
+//!
+//!        Slots are kept in fixed size chunks that never move once created,
+//!        so retrieving a slot takes no lock and can happen on any thread
+//!        while others allocate. Allocating and freeing are serialised.
+//!        A slot retrieved on one thread must not be used after another
+//!        thread frees or resizes it.
+//!
+//!        Both the slots and the bytes they hold come from a slab allocator
+//!        owned by the manager, so short lived slots are recycled without
+//!        going through the system allocator.
+//!
+//!        Slots allocated while a region is open belong to the innermost
+//!        open region. Their bytes are carved out of blocks owned by the
+//!        region, and freeing the region hands the blocks back and uncharges
+//!        its bytes in one go. Only retiring the ids of its slots is done
+//!        slot by slot.
+//!
+//!        The bytes held by slots are accounted as they are allocated,
+//!        resized and freed. Bytes carved by a region stay accounted until
+//!        the region is freed, even once the slot they were carved for is
+//!        freed or moved. A limit on them makes allocations that would
+//!        go past it fail, rather than letting one program take the host.
 class memman_c {
 public:
+  //! \brief Slots held in each chunk of the table
+  static constexpr uint64_t slots_per_chunk = 1024;
+
+  //! \brief Most chunks the table can grow to
+  static constexpr uint64_t max_chunks = 4096;
+
+  //! \brief Most regions that can be open at once
+  static constexpr std::size_t max_open_regions = 4096;
+
+  //! \brief Bytes in each block a region carves its slots out of
+  static constexpr std::size_t region_block_bytes = 4096;
+
+  //! \brief Buckets in the histogram of slot sizes, one per bit width
+  static constexpr std::size_t num_size_buckets = 65;
+
+  //! \brief Accounting of the bytes held by slots
+  struct usage_t {
+    //! Bytes held by slots that are allocated, padding included, and by
+    //! regions that are still open
+    uint64_t live_bytes{0};
+    //! Most bytes held by slots at once
+    uint64_t peak_bytes{0};
+    //! Slots allocated
+    uint64_t allocations{0};
+    //! Slots freed, on their own or with their region
+    uint64_t frees{0};
+    //! Slots resized
+    uint64_t reallocations{0};
+    //! Allocations and resizes refused for going past the limit
+    uint64_t refused{0};
+    //! Slots allocated by size. Bucket n counts sizes of n bits, so those
+    //! from 2^(n-1) up to but not including 2^n bytes
+    std::array<uint64_t, num_size_buckets> size_histogram{};
+  };
+
   //! \brief Construct the memory manager
   memman_c();
 
   //! \brief Destruct the memory manager
   ~memman_c();
 
+  memman_c(const memman_c &) = delete;
+  memman_c &operator=(const memman_c &) = delete;
+
   //! \brief Allocate a memory slot of `size` bytes
   //! \param size The number of bytes to allocate
   //! \returns Tuple with a bool indicating if the allocation happened,
-  //!          and a uint64_t that can be used to retrieve the slot later
+  //!          and a uint64_t that can be used to retrieve the slot later.
+  //!          The allocation doesn't happen if it would go past the limit
   std::tuple<bool, uint64_t> alloc(const uint64_t size);
 
   //! \brief Free a slot
   //! \param id The id of the slot to free
   //! \returns true iff the slot existed and could be freed
+  //! \note  The bytes of a slot in a region are given back, and stop
+  //!        counting against the limit, when the region is freed
   bool free(const uint64_t id);
 
+  //! \brief Grow or shrink a slot, keeping its id and contents
+  //! \param id The id of the slot to resize
+  //! \param size The number of bytes the slot should hold
+  //! \returns true iff the slot existed and could be resized, growing it
+  //!          must not go past the limit
+  //! \note  Bytes past the old size are left as allocated. A slot in a
+  //!        region stays in it, and is resized in place while it fits in
+  //!        what was carved for it. Growing past that carves it again, the
+  //!        old bytes staying charged until they are given back with the
+  //!        region
+  bool realloc(const uint64_t id, const uint64_t size);
+
+  //! \brief Open a region, nested inside any region already open
+  //! \returns Tuple with a bool indicating if the region was opened, and
+  //!          the id of the region. Region ids are never reused
+  std::tuple<bool, uint64_t> begin_region();
+
+  //! \brief Free every slot allocated in a region and close it
+  //! \param id The id of the region to free
+  //! \returns true iff the region was open
+  //! \note  Regions opened inside the region are freed along with it.
+  //!        Slots of the region that were already freed are skipped
+  bool free_region(const uint64_t id);
+
+  //! \brief Set the byte order of slots allocated from now on
+  //! \note  Slots already allocated keep the order they were created with
+  void set_byte_order(const byte_order_e order);
+
+  //! \brief Change how the allocator serves slots too large for a slab
+  //! \returns true iff no such slots were allocated
+  [[nodiscard]] bool
+  set_allocator_settings(const slab_allocator_c::settings_t &settings);
+
+  //! \brief Limit the bytes held by slots
+  //! \param bytes The most bytes slots may hold at once, 0 for no limit
+  //! \note  Slots already holding more than the limit are kept
+  void set_limit(const uint64_t bytes);
+
+  //! \brief Retrieve the limit on bytes held by slots, 0 if there is none
+  [[nodiscard]] uint64_t get_limit();
+
+  //! \brief Retrieve a copy of the accounting of bytes held by slots
+  [[nodiscard]] usage_t get_usage();
+
+  //! \brief Retrieve a copy of the allocation statistics
+  [[nodiscard]] slab_allocator_c::stats_t get_allocator_stats();
+
   //! \brief Retrieve a slot
   //! \param id The id of the slot to retrive
   //! \returns Memory slot iff the id was valid, nullptr otherwise
-  skiff::machine::memory::memory_c *get_slot(const uint64_t id);
+  skiff::machine::memory::memory_c *get_slot(const uint64_t id)
+  {
+    const uint64_t index = id & index_mask;
+    if (index >= _num_slots.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    auto &slot = get_descriptor(index);
+
+    // The generation is checked again after reading the memory so a slot
+    // freed and reallocated in between is never mistaken for this one
+    const uint32_t generation = static_cast<uint32_t>(id >> 32);
+    if (slot.generation.load(std::memory_order_acquire) != generation) {
+      return nullptr;
+    }
+    auto *memory = slot.memory.load(std::memory_order_acquire);
+    if (slot.generation.load(std::memory_order_acquire) != generation) {
+      return nullptr;
+    }
+    return memory;
+  }
 
 private:
-  std::vector<skiff::machine::memory::memory_c *> _slots;
-  std::queue<std::size_t> _available_ids;
+  static constexpr uint64_t index_mask = 0xFFFF'FFFF;
+
+  struct slot_t {
+    std::atomic<skiff::machine::memory::memory_c *> memory{nullptr};
+    std::atomic<uint32_t> generation{0};
+    uint64_t region{0}; // Id of the region holding it, or 0. Guarded by _mutex
+    uint64_t carved{0}; // Bytes carved for it by its region. Guarded by _mutex
+  };
+
+  struct region_t {
+    uint64_t id{0};
+    uint64_t bytes{0}; // Charged for everything carved for its slots
+    std::vector<uint64_t> slots;
+    std::vector<std::tuple<void *, std::size_t>> blocks;
+    uint8_t *next{nullptr};
+    uint8_t *end{nullptr};
+  };
+
+  slot_t &get_descriptor(const uint64_t index)
+  {
+    return _chunks[index / slots_per_chunk].load(
+        std::memory_order_relaxed)[index % slots_per_chunk];
+  }
+
+  skiff::machine::memory::memory_c *create_memory(const uint64_t size);
+  skiff::machine::memory::memory_c *create_memory(const uint64_t size,
+                                                  region_t &region);
+  region_t *find_region(const uint64_t id);
+  bool resize_in_region(slot_t &slot, const uint64_t size);
+  void destroy_memory(slot_t &slot);
+  void *carve(region_t &region, const std::size_t size);
+  void release_region(region_t &region);
+  bool reserve(const uint64_t bytes);
+
+  slab_allocator_c _allocator; // Guarded by _mutex
+  std::array<std::atomic<slot_t *>, max_chunks> _chunks{};
+  std::atomic<uint64_t> _num_slots{0};
+  std::deque<uint64_t> _available_ids;         // Guarded by _mutex
+  std::vector<region_t> _regions;              // Guarded by _mutex
+  uint64_t _next_region_id{1};                 // Guarded by _mutex
+  byte_order_e _byte_order{byte_order_e::BIG}; // Guarded by _mutex
+  uint64_t _limit{0};                          // Guarded by _mutex
+  usage_t _usage;                              // Guarded by _mutex
   std::mutex _mutex;
 };
 
@@ -49,4 +226,4 @@ private:
 } // namespace machine
 } // namespace skiff
 
-#endif
\ No newline at end of file
+#endif
@@ -1,144 +1,125 @@
 #include "machine/memory/memory.hpp"
-#include "config.hpp"
+#include <algorithm>
 #include <cstring>
 
 namespace skiff {
 namespace machine {
 namespace memory {
 
-memory_c::memory_c(const uint64_t size) : _size(size), _data{nullptr}
+memory_c::memory_c(const uint64_t size, const byte_order_e order)
+    : _size(get_storage_size(size)), _data{nullptr}, _byte_order(order)
 {
-  // Ensure that the memory is divisible by words (2 bytes)
-  if (_size % 2 != 0) {
-    _size++;
-  }
   _data = new uint8_t[_size];
 }
 
-memory_c::~memory_c()
+memory_c::memory_c(const uint64_t size, slab_allocator_c &allocator,
+                   const byte_order_e order)
+    : _size(get_storage_size(size)), _data{nullptr}, _allocator(&allocator),
+      _byte_order(order)
 {
-  if (_data) {
-    delete[] _data;
-  }
+  _data = static_cast<uint8_t *>(_allocator->allocate(_size));
 }
 
-bool memory_c::put_hword(const uint64_t index, const uint8_t data)
+memory_c::memory_c(const uint64_t size, uint8_t *data,
+                   const byte_order_e order)
+    : _size(get_storage_size(size)), _data{data}, _owns_data{false},
+      _byte_order(order)
 {
-  if (index >= _size) {
-    return false;
-  }
-  _data[index] = data;
-  return true;
 }
 
-bool memory_c::put_word(const uint64_t index, const uint16_t data)
+memory_c::~memory_c()
 {
-  if (index + skiff::config::word_size_bytes >= _size) {
-    return false;
+  if (!_owns_data) {
+    return;
+  }
+  if (_allocator) {
+    _allocator->release(_data, _size);
+  }
+  else if (_data) {
+    delete[] _data;
   }
-  _data[index] = data >> 8;
-  _data[index + 1] = data;
-  return true;
 }
 
-bool memory_c::put_dword(const uint64_t index, const uint32_t data)
+bool memory_c::resize(const uint64_t size)
 {
-  if (index + skiff::config::d_word_size_bytes >= _size) {
+  if (!_owns_data) {
     return false;
   }
-  _data[index] = data >> 24;
-  _data[index + 1] = data >> 16;
-  _data[index + 2] = data >> 8;
-  _data[index + 3] = data;
-  return true;
-}
 
-bool memory_c::put_qword(const uint64_t index, const uint64_t data)
-{
-  if (index + skiff::config::q_word_size_bytes >= _size) {
-    return false;
+  const auto storage = get_storage_size(size);
+  if (_allocator) {
+    _data = static_cast<uint8_t *>(
+        _allocator->reallocate(_data, _size, storage));
+  }
+  else {
+    auto data = new uint8_t[storage];
+    std::memcpy(data, _data, std::min(_size, storage));
+    delete[] _data;
+    _data = data;
   }
-  _data[index] = data >> 56;
-  _data[index + 1] = data >> 48;
-  _data[index + 2] = data >> 40;
-  _data[index + 3] = data >> 32;
-  _data[index + 4] = data >> 24;
-  _data[index + 5] = data >> 16;
-  _data[index + 6] = data >> 8;
-  _data[index + 7] = data;
+  _size = storage;
   return true;
 }
 
-std::tuple<bool, uint8_t> memory_c::get_hword(const uint64_t index)
+std::vector<uint8_t> memory_c::get_n_bytes(const uint64_t start,
+                                           const uint64_t n) const
 {
-  if (index > _size) {
-    return {false, 0};
+  auto [okay, bytes] = get_span(start, n);
+  if (!okay) {
+    return {};
   }
-  return {true, _data[index]};
+  return {bytes.begin(), bytes.end()};
 }
 
-std::tuple<bool, uint16_t> memory_c::get_word(const uint64_t index)
+bool memory_c::put_n_bytes(const std::span<const uint8_t> data,
+                           const uint64_t start)
 {
-  if (index + skiff::config::word_size_bytes > _size) {
-    return {false, 0};
+  auto [okay, bytes] = get_span(start, data.size());
+  if (!okay) {
+    return false;
   }
-  uint16_t d = static_cast<uint16_t>(_data[index]) << 8;
-  d |= static_cast<uint16_t>(_data[index + 1]);
-  return {true, d};
-}
-
-std::tuple<bool, uint32_t> memory_c::get_dword(const uint64_t index)
-{
-  if (index + skiff::config::d_word_size_bytes > _size) {
-    return {false, 0};
+  if (!data.empty()) {
+    std::memcpy(bytes.data(), data.data(), data.size());
   }
-
-  uint32_t d = static_cast<uint32_t>(_data[index]) << 24;
-  d |= static_cast<uint32_t>(_data[index + 1]) << 16;
-  d |= static_cast<uint32_t>(_data[index + 2]) << 8;
-  d |= static_cast<uint32_t>(_data[index + 3]);
-  return {true, d};
+  return true;
 }
 
-std::tuple<bool, uint64_t> memory_c::get_qword(const uint64_t index)
+bool memory_c::copy(const uint64_t index, const memory_c &source,
+                    const uint64_t source_index, const uint64_t length)
 {
-  if (index + skiff::config::q_word_size_bytes > _size) {
-    return {false, 0};
+  if (!contains(index, length) || !source.contains(source_index, length)) {
+    return false;
   }
-
-  uint64_t d = static_cast<uint64_t>(_data[index]) << 56;
-  d |= static_cast<uint64_t>(_data[index + 1]) << 48;
-  d |= static_cast<uint64_t>(_data[index + 2]) << 40;
-  d |= static_cast<uint64_t>(_data[index + 3]) << 32;
-  d |= static_cast<uint64_t>(_data[index + 4]) << 24;
-  d |= static_cast<uint64_t>(_data[index + 5]) << 16;
-  d |= static_cast<uint64_t>(_data[index + 6]) << 8;
-  d |= static_cast<uint64_t>(_data[index + 7]);
-  return {true, d};
+  if (length) {
+    std::memmove(_data + index, source._data + source_index, length);
+  }
+  return true;
 }
 
-std::vector<uint8_t> memory_c::get_n_bytes(const uint64_t start,
-                                           const uint64_t n)
+bool memory_c::fill(const uint64_t index, const uint64_t length,
+                    const uint8_t value)
 {
-  if (start + n > _size) {
-    return {};
+  if (!contains(index, length)) {
+    return false;
   }
-  std::vector<uint8_t> result;
-  result.resize(n);
-
-  std::memcpy(&result[0], (_data + start), n);
-  return result;
+  if (length) {
+    std::memset(_data + index, value, length);
+  }
+  return true;
 }
 
-bool memory_c::put_n_bytes(const std::vector<uint8_t> data,
-                           const uint64_t start)
+std::tuple<bool, int> memory_c::compare(const uint64_t index,
+                                        const memory_c &other,
+                                        const uint64_t other_index,
+                                        const uint64_t length) const
 {
-  if (start + data.size() > _size) {
-    return false;
+  if (!contains(index, length) || !other.contains(other_index, length)) {
+    return {false, 0};
   }
-
-  std::memcpy(_data + start, &data[0], data.size());
-  return true;
+  if (!length) {
+    return {true, 0};
+  }
+  return {true, std::memcmp(_data + index, other._data + other_index, length)};
 }
 
 } // namespace memory
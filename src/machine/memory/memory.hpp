@@ -1,72 +1,309 @@
 #ifndef SKIFF_MEMORY_HPP
 #define SKIFF_MEMORY_HPP
 
+#include "machine/memory/allocator.hpp"
+#include <bit>
 #include <cstdint>
+#include <cstring>
+#include <span>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 
 namespace skiff {
 namespace machine {
 namespace memory {
 
+//! \brief Order multi-byte values are laid out in memory
+enum class byte_order_e {
+  BIG,   //! Most significant byte first, the same on every host
+  NATIVE //! Whatever the host uses, so values are never swapped
+};
+
 //! \brief A memory structure that contains up-to
 //!        the number of bytes passed in at
 //!        construction time
 class memory_c {
 public:
   //! \brief Create the memory
-  memory_c(const uint64_t size);
+  memory_c(const uint64_t size, const byte_order_e order = byte_order_e::BIG);
+
+  //! \brief Create the memory with bytes from an allocator
+  //! \note  The allocator must outlive the memory
+  memory_c(const uint64_t size, slab_allocator_c &allocator,
+           const byte_order_e order = byte_order_e::BIG);
+
+  //! \brief Create the memory over bytes owned by someone else
+  //! \param data At least `get_storage_size(size)` bytes that must outlive
+  //!             the memory
+  memory_c(const uint64_t size, uint8_t *data,
+           const byte_order_e order = byte_order_e::BIG);
+
+  memory_c(const memory_c &) = delete;
+  memory_c &operator=(const memory_c &) = delete;
 
   //! \brief Destroy the memory
   ~memory_c();
 
+  //! \brief Grow or shrink the memory, keeping the bytes both sizes share
+  //! \param size The number of bytes the memory should hold
+  //! \returns true iff the memory owns its bytes and could be resized
+  //! \note  Bytes past the old size hold whatever they held before, as
+  //!        newly allocated memory does. Pointers and spans into the
+  //!        memory are invalidated
+  [[nodiscard]] bool resize(const uint64_t size);
+
+  //! \brief Retrieve the number of bytes backing memory of a given size
+  [[nodiscard]] static uint64_t get_storage_size(const uint64_t size)
+  {
+    // Ensure that the memory is divisible by words (2 bytes)
+    return size + (size % 2);
+  }
+
+  //! \brief Store a value
+  //! \param index The location in memory to store the value
+  //! \param value The value to store in memory at the location
+  //! \returns true iff the value fits in the memory
+  //! \note  A single unaligned copy, without building a tuple, for the
+  //!        interpreter's loads and stores
+  template <typename T>
+  [[nodiscard]] bool store(const uint64_t index, const T value)
+  {
+    static_assert(std::is_unsigned_v<T>);
+
+    // Anything wider than a byte has always needed room left after it
+    constexpr uint64_t margin = sizeof(T) == 1 ? 0 : sizeof(T);
+    if (index >= _size || _size - index <= margin) {
+      return false;
+    }
+    const T ordered = order(value);
+    std::memcpy(_data + index, &ordered, sizeof(T));
+    return true;
+  }
+
+  //! \brief Load a value
+  //! \param index The location in memory to load the value from
+  //! \param value Receives the value iff it could be loaded
+  //! \returns true iff the value lies within the memory
+  template <typename T>
+  [[nodiscard]] bool load(const uint64_t index, T &value) const
+  {
+    static_assert(std::is_unsigned_v<T>);
+
+    if (index >= _size || _size - index < sizeof(T)) {
+      return false;
+    }
+    T ordered;
+    std::memcpy(&ordered, _data + index, sizeof(T));
+    value = order(ordered);
+    return true;
+  }
+
+  //! \brief Store consecutive values, the first at the lowest location
+  //! \param index The location in memory to store the first value
+  //! \param values The values to store
+  //! \returns true iff every value fits in the memory, nothing is stored
+  //!          otherwise
+  //! \note  Checks the range once, and copies it whole when the memory is
+  //!        in the order of the host
+  template <typename T>
+  [[nodiscard]] bool store_n(const uint64_t index,
+                             const std::span<const T> values)
+  {
+    static_assert(std::is_unsigned_v<T>);
+
+    // The last value needs the same room after it that `store` asks for
+    const uint64_t length = values.size() * sizeof(T);
+    constexpr uint64_t margin = sizeof(T) == 1 ? 0 : 1;
+    if (!contains(index, length) || _size - index - length < margin) {
+      return false;
+    }
+    if (sizeof(T) == 1 || is_host_order()) {
+      std::memcpy(_data + index, values.data(), length);
+      return true;
+    }
+    for (std::size_t i = 0; i < values.size(); i++) {
+      const T ordered = order(values[i]);
+      std::memcpy(_data + index + i * sizeof(T), &ordered, sizeof(T));
+    }
+    return true;
+  }
+
+  //! \brief Load consecutive values, the first from the lowest location
+  //! \param index The location in memory to load the first value from
+  //! \param values Receives the values iff they could all be loaded
+  //! \returns true iff every value lies within the memory
+  template <typename T>
+  [[nodiscard]] bool load_n(const uint64_t index,
+                            const std::span<T> values) const
+  {
+    static_assert(std::is_unsigned_v<T>);
+
+    const uint64_t length = values.size() * sizeof(T);
+    if (!contains(index, length)) {
+      return false;
+    }
+    if (sizeof(T) == 1 || is_host_order()) {
+      std::memcpy(values.data(), _data + index, length);
+      return true;
+    }
+    for (std::size_t i = 0; i < values.size(); i++) {
+      T ordered;
+      std::memcpy(&ordered, _data + index + i * sizeof(T), sizeof(T));
+      values[i] = order(ordered);
+    }
+    return true;
+  }
+
   //! \brief Store half word
   //! \param destination The location in memory to store the word
   //! \param value The value to store in memory at the location
-  [[nodiscard]] bool put_hword(const uint64_t index, const uint8_t data);
+  [[nodiscard]] bool put_hword(const uint64_t index, const uint8_t data)
+  {
+    return store(index, data);
+  }
 
   //! \brief Store word
   //! \param destination The location in memory to store the word
   //! \param value The value to store in memory at the location
-  [[nodiscard]] bool put_word(const uint64_t index, const uint16_t data);
+  [[nodiscard]] bool put_word(const uint64_t index, const uint16_t data)
+  {
+    return store(index, data);
+  }
 
   //! \brief Store double word
   //! \param destination The location in memory to store the dword
   //! \param value The value to store in memory at the location
-  [[nodiscard]] bool put_dword(const uint64_t index, const uint32_t data);
+  [[nodiscard]] bool put_dword(const uint64_t index, const uint32_t data)
+  {
+    return store(index, data);
+  }
 
   //! \brief Store quad word
   //! \param destination The location in memory to store the qword
   //! \param value The value to store in memory at the location
-  [[nodiscard]] bool put_qword(const uint64_t index, const uint64_t data);
+  [[nodiscard]] bool put_qword(const uint64_t index, const uint64_t data)
+  {
+    return store(index, data);
+  }
 
   //! \brief Get half word
   //! \param index The location to read the half word from
   //! \returns tuple containing boolean indicating if
   //!          the operation was a success, and a value
   //!          from the stack.
-  [[nodiscard]] std::tuple<bool, uint8_t> get_hword(const uint64_t index);
+  [[nodiscard]] std::tuple<bool, uint8_t> get_hword(const uint64_t index)
+  {
+    return get<uint8_t>(index);
+  }
 
   //! \brief Get word
   //! \param index The location to read the word from
   //! \returns tuple containing boolean indicating if
   //!          the operation was a success, and a value
   //!          from the stack.
-  [[nodiscard]] std::tuple<bool, uint16_t> get_word(const uint64_t index);
+  [[nodiscard]] std::tuple<bool, uint16_t> get_word(const uint64_t index)
+  {
+    return get<uint16_t>(index);
+  }
 
   //! \brief Get double word
   //! \param index The location to read the word from
   //! \returns tuple containing boolean indicating if
   //!          the operation was a success, and a value
   //!          from the stack.
-  [[nodiscard]] std::tuple<bool, uint32_t> get_dword(const uint64_t index);
+  [[nodiscard]] std::tuple<bool, uint32_t> get_dword(const uint64_t index)
+  {
+    return get<uint32_t>(index);
+  }
 
   //! \brief Get quad word
   //! \param index The location to read the word from
   //! \returns tuple containing boolean indicating if
   //!          the operation was a success, and a value
   //!          from the stack.
-  [[nodiscard]] std::tuple<bool, uint64_t> get_qword(const uint64_t index);
+  [[nodiscard]] std::tuple<bool, uint64_t> get_qword(const uint64_t index)
+  {
+    return get<uint64_t>(index);
+  }
+
+  //! \brief Copy bytes into this memory
+  //! \param index The location in memory to copy the bytes to
+  //! \param source The memory to copy the bytes from, which may be this one
+  //! \param source_index The location in the source to copy from
+  //! \param length The number of bytes to copy
+  //! \returns true iff both ranges lie within their memory
+  //! \note  The ranges may overlap
+  [[nodiscard]] bool copy(const uint64_t index, const memory_c &source,
+                          const uint64_t source_index, const uint64_t length);
+
+  //! \brief Set a range of bytes to a single value
+  //! \param index The location in memory to start filling from
+  //! \param length The number of bytes to fill
+  //! \param value The value to write to every byte
+  //! \returns true iff the range lies within the memory
+  [[nodiscard]] bool fill(const uint64_t index, const uint64_t length,
+                          const uint8_t value);
+
+  //! \brief Compare a range of bytes with a range of another memory
+  //! \param index The location in memory of the first range
+  //! \param other The memory holding the second range, which may be this one
+  //! \param other_index The location in the other memory of the second range
+  //! \param length The number of bytes to compare
+  //! \returns tuple containing boolean indicating if both ranges lie within
+  //!          their memory, and a value less than, equal to or greater than
+  //!          zero as the first range orders before, the same as or after
+  //!          the second
+  [[nodiscard]] std::tuple<bool, int> compare(const uint64_t index,
+                                              const memory_c &other,
+                                              const uint64_t other_index,
+                                              const uint64_t length) const;
+
+  //! \brief Retrieve the bytes of a range
+  //! \param index The location in memory of the first byte
+  //! \param length The number of bytes in the range
+  //! \returns Pointer to the first byte, or nullptr if the range doesn't lie
+  //!          within the memory
+  [[nodiscard]] uint8_t *get_range(const uint64_t index, const uint64_t length)
+  {
+    return contains(index, length) ? _data + index : nullptr;
+  }
+
+  //! \brief Retrieve the bytes of a range
+  [[nodiscard]] const uint8_t *get_range(const uint64_t index,
+                                         const uint64_t length) const
+  {
+    return contains(index, length) ? _data + index : nullptr;
+  }
+
+  //! \brief View a range of bytes in place
+  //! \param index The location in memory of the first byte
+  //! \param length The number of bytes in the range
+  //! \returns tuple containing boolean indicating if the range lies within
+  //!          the memory, and a view of its bytes
+  //! \note  The view is only valid while the memory is, and bytes are seen
+  //!        as stored, without regard to the byte order
+  [[nodiscard]] std::tuple<bool, std::span<uint8_t>>
+  get_span(const uint64_t index, const uint64_t length)
+  {
+    if (!contains(index, length)) {
+      return {false, {}};
+    }
+    return {true, {_data + index, length}};
+  }
+
+  //! \brief View a range of bytes in place
+  [[nodiscard]] std::tuple<bool, std::span<const uint8_t>>
+  get_span(const uint64_t index, const uint64_t length) const
+  {
+    if (!contains(index, length)) {
+      return {false, {}};
+    }
+    return {true, {_data + index, length}};
+  }
+
+  //! \brief Retrieve the order multi-byte values are stored in
+  [[nodiscard]] byte_order_e get_byte_order() const { return _byte_order; }
 
   //! \brief Retrieve the size of the data
   //! \returns Allocated size
@@ -74,17 +311,73 @@ public:
 
   //! \brief Retrieve 'n' bytes from memory
   //! \returns 'n' bytes from index of start iff range of [start, n] is valid
+  //! \note  Copies the bytes, use get_span to read them in place
   [[nodiscard]] std::vector<uint8_t> get_n_bytes(const uint64_t start,
-                                                 const uint64_t n);
+                                                 const uint64_t n) const;
 
   //! \brief Put bytes at position
   //! \returns true iff bytes will fit
-  [[nodiscard]] bool put_n_bytes(const std::vector<uint8_t> data,
+  [[nodiscard]] bool put_n_bytes(const std::span<const uint8_t> data,
                                  const uint64_t start);
 
 private:
+  bool contains(const uint64_t index, const uint64_t length) const
+  {
+    return index <= _size && length <= _size - index;
+  }
+
+  template <typename T> std::tuple<bool, T> get(const uint64_t index) const
+  {
+    T value{0};
+    if (!load(index, value)) {
+      return {false, 0};
+    }
+    return {true, value};
+  }
+
+  bool is_host_order() const
+  {
+    return _byte_order == byte_order_e::NATIVE ||
+           std::endian::native == std::endian::big;
+  }
+
+  // Swapping is its own inverse, so this converts both to and from memory
+  template <typename T> T order(const T value) const
+  {
+    if constexpr (sizeof(T) == 1 || std::endian::native == std::endian::big) {
+      return value;
+    }
+    else {
+      return _byte_order == byte_order_e::BIG ? swap_bytes(value) : value;
+    }
+  }
+
+  template <typename T> static T swap_bytes(const T value)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    if constexpr (sizeof(T) == 2) {
+      return __builtin_bswap16(value);
+    }
+    else if constexpr (sizeof(T) == 4) {
+      return __builtin_bswap32(value);
+    }
+    else {
+      return __builtin_bswap64(value);
+    }
+#else
+    T result{0};
+    for (std::size_t i = 0; i < sizeof(T); i++) {
+      result = (result << 8) | ((value >> (i * 8)) & 0xFF);
+    }
+    return result;
+#endif
+  }
+
   uint64_t _size;
   uint8_t *_data;
+  slab_allocator_c *_allocator{nullptr};
+  bool _owns_data{true};
+  byte_order_e _byte_order{byte_order_e::BIG};
 };
 
 } // namespace memory
@@ -3,161 +3,239 @@
 #include "config.hpp"
 #include "types.hpp"
 
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SKIFF_STACK_USE_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace skiff {
 namespace machine {
 namespace memory {
 
-stack_c::stack_c()
-    : _end{0}, _mem(skiff::config::stack_size_bytes), _sp{nullptr}
+namespace {
+
+// Bytes committed when the stack is first used, every later commit at least
+// doubles what is committed so a deep stack commits a handful of times
+constexpr uint64_t initial_commit_bytes = 16'384;
+
+} // namespace
+
+stack_c::stack_c(const uint64_t max_bytes) : _max_bytes{max_bytes} {}
+
+stack_c::~stack_c()
 {
+  _mem.reset();
+  if (!_base) {
+    return;
+  }
+#ifdef SKIFF_STACK_USE_MMAP
+  munmap(_base, _reserved + _page_bytes);
+#else
+  delete[] _base;
+#endif
 }
 
-stack_c::~stack_c() {}
+bool stack_c::set_max_bytes(const uint64_t max_bytes)
+{
+  if (_base) {
+    return false;
+  }
+  _max_bytes = max_bytes;
+  return true;
+}
 
 void stack_c::set_sp(skiff::types::vm_register &reg) { _sp = &reg; }
 
-std::tuple<bool, uint16_t> stack_c::pop_word()
+bool stack_c::reserve()
 {
-  if (_end < skiff::config::word_size_bytes) {
-    return {false, 0};
-  }
-  _end -= skiff::config::word_size_bytes;
-  if (_sp) {
-    (*_sp) = _end;
+  const uint64_t storage = memory_c::get_storage_size(_max_bytes);
+#ifdef SKIFF_STACK_USE_MMAP
+  _page_bytes = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  const uint64_t reserved =
+      (storage + _page_bytes - 1) / _page_bytes * _page_bytes;
+
+  // Nothing is accessible until it is committed, which leaves the page
+  // after the reservation as a guard whatever gets committed
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+  flags |= MAP_NORESERVE;
+#endif
+  void *base = mmap(nullptr, reserved + _page_bytes, PROT_NONE, flags, -1, 0);
+  if (base == MAP_FAILED) {
+    return false;
   }
-  return _mem.get_word(_end);
+  _base = static_cast<uint8_t *>(base);
+  _reserved = reserved;
+#else
+  _base = new uint8_t[storage];
+  _reserved = storage;
+#endif
+  _mem = std::make_unique<memory_c>(_max_bytes, _base);
+  return true;
 }
 
-std::tuple<bool, uint8_t> stack_c::pop_hword()
+bool stack_c::commit(const uint64_t index, const uint64_t width)
 {
-  if (_end < skiff::config::h_word_size_bytes) {
-    return {false, 0};
+  if (index > _max_bytes || width > _max_bytes - index) {
+    return false;
   }
-  _end -= skiff::config::h_word_size_bytes;
-  if (_sp) {
-    (*_sp) = _end;
+  const uint64_t needed = index + width;
+  if (needed <= _committed) {
+    return true;
   }
-  return _mem.get_hword(_end);
-}
-
-std::tuple<bool, uint32_t> stack_c::pop_dword()
-{
-  if (_end < skiff::config::d_word_size_bytes) {
-    return {false, 0};
+  if (!_base && !reserve()) {
+    return false;
   }
-  _end -= skiff::config::d_word_size_bytes;
-  if (_sp) {
-    (*_sp) = _end;
+
+  uint64_t target = std::max({needed, _committed * 2, initial_commit_bytes});
+  target = (target + _page_bytes - 1) / _page_bytes * _page_bytes;
+  target = std::min(target, _reserved);
+#ifdef SKIFF_STACK_USE_MMAP
+  if (mprotect(_base + _committed, target - _committed,
+               PROT_READ | PROT_WRITE) != 0) {
+    return false;
   }
-  return _mem.get_dword(_end);
+#endif
+  _committed = target;
+  return true;
 }
 
-std::tuple<bool, uint64_t> stack_c::pop_qword()
+template <typename T> std::tuple<bool, T> stack_c::pop()
 {
-  if (_end < skiff::config::q_word_size_bytes) {
+  if (_end < sizeof(T)) {
     return {false, 0};
   }
-  _end -= skiff::config::q_word_size_bytes;
+  _end -= sizeof(T);
   if (_sp) {
     (*_sp) = _end;
   }
-  return _mem.get_qword(_end);
+  T value{0};
+  const bool okay = _mem->load(_end, value);
+  return {okay, value};
 }
 
-bool stack_c::push_word(const uint16_t word)
+template <typename T> bool stack_c::push(const T value)
 {
-  if (_end + skiff::config::word_size_bytes >=
-      skiff::config::stack_size_bytes) {
+  if (_end + sizeof(T) >= _max_bytes) {
     return false;
   }
-  if (!_mem.put_word(_end, word)) {
+  if (!commit(_end, sizeof(T)) || !_mem->store(_end, value)) {
     return false;
   }
-  _end += skiff::config::word_size_bytes;
+  _end += sizeof(T);
   if (_sp) {
     (*_sp) = _end;
   }
   return true;
 }
 
-bool stack_c::push_hword(const uint8_t hword)
+std::tuple<bool, uint16_t> stack_c::pop_word() { return pop<uint16_t>(); }
+
+std::tuple<bool, uint8_t> stack_c::pop_hword() { return pop<uint8_t>(); }
+
+std::tuple<bool, uint32_t> stack_c::pop_dword() { return pop<uint32_t>(); }
+
+std::tuple<bool, uint64_t> stack_c::pop_qword() { return pop<uint64_t>(); }
+
+bool stack_c::push_word(const uint16_t word) { return push(word); }
+
+bool stack_c::push_hword(const uint8_t hword) { return push(hword); }
+
+bool stack_c::push_dword(const uint32_t dword) { return push(dword); }
+
+bool stack_c::push_qword(const uint64_t qword) { return push(qword); }
+
+bool stack_c::push_qwords(const std::span<const uint64_t> values)
 {
-  if (_end + skiff::config::h_word_size_bytes >=
-      skiff::config::stack_size_bytes) {
+  if (values.empty()) {
+    return true;
+  }
+  const uint64_t bytes = values.size() * sizeof(uint64_t);
+  if (_end + bytes >= _max_bytes) {
     return false;
   }
-  if (!_mem.put_hword(_end, hword)) {
+  if (!commit(_end, bytes) || !_mem->store_n(_end, values)) {
     return false;
   }
-  _end += skiff::config::h_word_size_bytes;
+  _end += bytes;
   if (_sp) {
     (*_sp) = _end;
   }
   return true;
 }
 
-bool stack_c::push_dword(const uint32_t dword)
+bool stack_c::pop_qwords(const std::span<uint64_t> values)
 {
-  if (_end + skiff::config::d_word_size_bytes >=
-      skiff::config::stack_size_bytes) {
-    return false;
+  if (values.empty()) {
+    return true;
   }
-  if (!_mem.put_dword(_end, dword)) {
+  const uint64_t bytes = values.size() * sizeof(uint64_t);
+  if (_end < bytes || !_mem->load_n(_end - bytes, values)) {
     return false;
   }
-  _end += skiff::config::d_word_size_bytes;
+  _end -= bytes;
   if (_sp) {
     (*_sp) = _end;
   }
   return true;
 }
 
-bool stack_c::push_qword(const uint64_t qword)
+template <typename T> std::tuple<bool, T> stack_c::load(const uint64_t index)
 {
-  if (_end + skiff::config::q_word_size_bytes >=
-      skiff::config::stack_size_bytes) {
-    return false;
+  if (index > _max_bytes || sizeof(T) > _max_bytes - index) {
+    return {false, 0};
   }
-  if (!_mem.put_qword(_end, qword)) {
-    return false;
+
+  // Nothing past what is committed was ever written, so it reads as zero
+  // without committing it. A value straddling the end still commits the
+  // rest of itself
+  if (index >= _committed) {
+    return {true, 0};
   }
-  _end += skiff::config::q_word_size_bytes;
-  if (_sp) {
-    (*_sp) = _end;
+  if (!commit(index, sizeof(T))) {
+    return {false, 0};
   }
-  return true;
+  T value{0};
+  const bool okay = _mem->load(index, value);
+  return {okay, value};
 }
 
 bool stack_c::store_word(const uint64_t destination, const uint16_t value)
 {
-  return _mem.put_word(destination, value);
+  return commit(destination, sizeof(value)) &&
+         _mem->put_word(destination, value);
 }
 
 bool stack_c::store_dword(const uint64_t destination, const uint32_t value)
 {
-  return _mem.put_dword(destination, value);
+  return commit(destination, sizeof(value)) &&
+         _mem->put_dword(destination, value);
 }
 
 bool stack_c::store_qword(const uint64_t destination, const uint64_t value)
 {
-  return _mem.put_qword(destination, value);
+  return commit(destination, sizeof(value)) &&
+         _mem->put_qword(destination, value);
 }
 
 std::tuple<bool, uint16_t> stack_c::load_word(const uint64_t index)
 {
-  return _mem.get_word(index);
+  return load<uint16_t>(index);
 }
 
 std::tuple<bool, uint32_t> stack_c::load_dword(const uint64_t index)
 {
-  return _mem.get_dword(index);
+  return load<uint32_t>(index);
 }
 
 std::tuple<bool, uint64_t> stack_c::load_qword(const uint64_t index)
 {
-  return _mem.get_qword(index);
+  return load<uint64_t>(index);
 }
 
 } // namespace memory
 } // namespace machine
-} // namespace skiff
\ No newline at end of file
+} // namespace skiff
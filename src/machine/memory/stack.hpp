@@ -1,11 +1,13 @@
 #ifndef SKIFF_STACK_HPP
 #define SKIFF_STACK_HPP
 
+#include "config.hpp"
 #include "machine/memory/memory.hpp"
 #include "types.hpp"
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <span>
 #include <tuple>
 
 namespace skiff {
@@ -13,16 +15,35 @@ namespace machine {
 namespace memory {
 
 //! \brief A stack structure that contains up-to
-//!        the number of bytes described by
-//!        'stack_size_bytes' in libskiff/config.hpp
+//!        the number of bytes it is created with,
+//!        'stack_size_bytes' in config.hpp by default
+//! \note  Nothing is allocated until the stack is first used. Its bytes are
+//!        then reserved from the system without being committed, and pages
+//!        are committed as pushes and stores reach them. Loads past them
+//!        read as zero without committing anything. A page that is never
+//!        committed sits past the end as a guard
 class stack_c {
 public:
   //! \brief Create the stack
-  stack_c();
+  //! \param max_bytes The most bytes the stack can hold
+  stack_c(const uint64_t max_bytes = skiff::config::stack_size_bytes);
 
   //! \brief Destroy the stack
   ~stack_c();
 
+  stack_c(const stack_c &) = delete;
+  stack_c &operator=(const stack_c &) = delete;
+
+  //! \brief Change the most bytes the stack can hold
+  //! \returns true iff the stack hadn't been used yet
+  [[nodiscard]] bool set_max_bytes(const uint64_t max_bytes);
+
+  //! \brief Retrieve the most bytes the stack can hold
+  [[nodiscard]] uint64_t get_max_bytes() const { return _max_bytes; }
+
+  //! \brief Retrieve the bytes committed so far
+  [[nodiscard]] uint64_t get_committed_bytes() const { return _committed; }
+
   //! \brief Set the stack pointer
   //! \post  If this is set, then the stack pointer register will
   //!        be auto updated whenever the stack size changes
@@ -72,6 +93,18 @@ public:
   //! \returns true iff the operation was a success
   bool push_qword(const uint64_t qword);
 
+  //! \brief Push quad words, the first ending up deepest in the stack
+  //! \param values The quad words to push
+  //! \returns true iff all of them fit, nothing is pushed otherwise
+  //! \note  Lays the stack out exactly as pushing each in turn would
+  bool push_qwords(const std::span<const uint64_t> values);
+
+  //! \brief Pop quad words, the reverse of push_qwords
+  //! \param values Receives the quad words in the order they were pushed
+  //! \returns true iff the stack held enough of them, nothing is popped
+  //!          otherwise
+  bool pop_qwords(const std::span<uint64_t> values);
+
   //! \brief Store word
   //! \param destination The location in the stack to store the word
   //! \param value The value to store in memory at the location
@@ -109,9 +142,20 @@ public:
   std::tuple<bool, uint64_t> load_qword(const uint64_t index);
 
 private:
-  uint64_t _end;
-  memory_c _mem;
-  skiff::types::vm_register *_sp;
+  bool commit(const uint64_t index, const uint64_t width);
+  bool reserve();
+  template <typename T> bool push(const T value);
+  template <typename T> std::tuple<bool, T> pop();
+  template <typename T> std::tuple<bool, T> load(const uint64_t index);
+
+  uint64_t _end{0};
+  uint64_t _max_bytes{0};
+  uint64_t _committed{0};
+  uint64_t _reserved{0};
+  std::size_t _page_bytes{4096};
+  uint8_t *_base{nullptr};
+  std::unique_ptr<memory_c> _mem;
+  skiff::types::vm_register *_sp{nullptr};
 };
 
 } // namespace memory
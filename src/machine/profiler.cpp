@@ -0,0 +1,217 @@
+#include "machine/profiler.hpp"
+#include "logging/aixlog.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace skiff {
+namespace machine {
+
+namespace {
+
+inline uint64_t read_cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+} // namespace
+
+std::string annotate_address(const uint64_t address,
+                             const profiler_c::symbols_t &symbols)
+{
+  auto it = symbols.upper_bound(address);
+  if (it == symbols.begin()) {
+    std::stringstream ss;
+    ss << "0x" << std::hex << address;
+    return ss.str();
+  }
+  it--;
+  if (it->first == address) {
+    return it->second;
+  }
+  return it->second + "+" + std::to_string(address - it->first);
+}
+
+void profiler_c::start(const uint64_t num_instructions, const uint64_t entry)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+
+  _opcodes = {};
+  _address_hits.assign(num_instructions, 0);
+  _frames.clear();
+  _frames.push_back({.target = entry, .parent = 0});
+  _current_frame = 0;
+  _timing = false;
+}
+
+void profiler_c::instruction(const uint64_t address,
+                             const threaded_opcode_e opcode)
+{
+  const uint64_t now = read_cycles();
+  if (_timing) {
+    _opcodes[static_cast<std::size_t>(_last_opcode)].cycles +=
+        now - _last_cycles;
+  }
+  _timing = true;
+  _last_opcode = opcode;
+  _last_cycles = now;
+
+  _opcodes[static_cast<std::size_t>(opcode)].count++;
+  if (address < _address_hits.size()) {
+    _address_hits[address]++;
+  }
+  _frames[_current_frame].samples++;
+}
+
+void profiler_c::call(const uint64_t target)
+{
+  auto &children = _frames[_current_frame].children;
+  if (auto it = children.find(target); it != children.end()) {
+    _current_frame = it->second;
+    return;
+  }
+
+  const std::size_t child = _frames.size();
+  children[target] = child;
+  _frames.push_back({.target = target, .parent = _current_frame});
+  _current_frame = child;
+}
+
+void profiler_c::ret()
+{
+  // A return from the root frame is an error the vm will report
+  _current_frame = _frames[_current_frame].parent;
+}
+
+void profiler_c::pause()
+{
+  if (_timing) {
+    _opcodes[static_cast<std::size_t>(_last_opcode)].cycles +=
+        read_cycles() - _last_cycles;
+  }
+  _timing = false;
+}
+
+const std::array<profiler_c::opcode_profile_t,
+                 static_cast<std::size_t>(threaded_opcode_e::NUM_OPCODES)> &
+profiler_c::get_opcode_profile() const
+{
+  return _opcodes;
+}
+
+const std::vector<uint64_t> &profiler_c::get_address_hits() const
+{
+  return _address_hits;
+}
+
+std::string profiler_c::frame_name(const uint64_t address,
+                                   const symbols_t &symbols) const
+{
+  // Frames are entered by address, so only exact labels name them
+  if (auto it = symbols.find(address); it != symbols.end()) {
+    return it->second;
+  }
+  return annotate_address(address, symbols);
+}
+
+void profiler_c::write_folded_stacks(std::ostream &out,
+                                     const symbols_t &symbols) const
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+
+  // Parents are always created before their children so the stack of each
+  // frame can be built from the one before it
+  std::vector<std::string> stacks(_frames.size());
+  for (std::size_t i = 0; i < _frames.size(); i++) {
+    auto name = frame_name(_frames[i].target, symbols);
+    stacks[i] = (i == 0) ? name : stacks[_frames[i].parent] + ";" + name;
+    if (_frames[i].samples) {
+      out << stacks[i] << " " << _frames[i].samples << "\n";
+    }
+  }
+}
+
+void profiler_c::write_report(std::ostream &out, const symbols_t &symbols,
+                              const std::size_t max_addresses) const
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+
+  uint64_t total_count{0};
+  uint64_t total_cycles{0};
+  for (auto &op : _opcodes) {
+    total_count += op.count;
+    total_cycles += op.cycles;
+  }
+
+  auto percent = [](const uint64_t part, const uint64_t whole) {
+    return whole ? 100.0 * static_cast<double>(part) / whole : 0.0;
+  };
+
+  // Opcodes by cycles spent
+  std::vector<std::size_t> opcodes;
+  for (std::size_t i = 0; i < _opcodes.size(); i++) {
+    if (_opcodes[i].count) {
+      opcodes.push_back(i);
+    }
+  }
+  std::stable_sort(opcodes.begin(), opcodes.end(),
+                   [this](const std::size_t lhs, const std::size_t rhs) {
+                     return _opcodes[lhs].cycles > _opcodes[rhs].cycles;
+                   });
+
+  out << std::fixed << std::setprecision(2);
+  out << "---- Opcode profile ----\n";
+  out << std::left << std::setw(10) << "opcode" << std::right
+      << std::setw(16) << "count" << std::setw(9) << "%" << std::setw(16)
+      << "cycles" << std::setw(9) << "%" << std::setw(12) << "cyc/ins"
+      << "\n";
+  for (auto i : opcodes) {
+    auto &op = _opcodes[i];
+    out << std::left << std::setw(10)
+        << get_opcode_name(static_cast<threaded_opcode_e>(i)) << std::right
+        << std::setw(16) << op.count << std::setw(9)
+        << percent(op.count, total_count) << std::setw(16) << op.cycles
+        << std::setw(9) << percent(op.cycles, total_cycles) << std::setw(12)
+        << static_cast<double>(op.cycles) / op.count << "\n";
+  }
+
+  // Addresses by number of hits
+  std::vector<uint64_t> addresses(_address_hits.size());
+  std::iota(addresses.begin(), addresses.end(), 0);
+  std::stable_sort(addresses.begin(), addresses.end(),
+                   [this](const uint64_t lhs, const uint64_t rhs) {
+                     return _address_hits[lhs] > _address_hits[rhs];
+                   });
+
+  out << "---- Hot spots ----\n";
+  out << std::left << std::setw(10) << "address" << std::right
+      << std::setw(16) << "hits" << std::setw(9) << "%"
+      << "  location\n";
+  for (std::size_t i = 0; i < addresses.size() && i < max_addresses; i++) {
+    auto address = addresses[i];
+    if (!_address_hits[address]) {
+      break;
+    }
+    out << std::left << std::setw(10) << address << std::right
+        << std::setw(16) << _address_hits[address] << std::setw(9)
+        << percent(_address_hits[address], total_count) << "  "
+        << annotate_address(address, symbols) << "\n";
+  }
+  out << std::defaultfloat;
+}
+
+} // namespace machine
+} // namespace skiff
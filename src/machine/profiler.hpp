@@ -0,0 +1,110 @@
+#ifndef SKIFF_PROFILER_HPP
+#define SKIFF_PROFILER_HPP
+
+#include "machine/threaded.hpp"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace skiff {
+namespace machine {
+
+//! \brief Execution profiler
+//! \note  Attach to a vm with `vm_c::set_profiler`. Every executed
+//!        instruction is recorded against its opcode, its address and the
+//!        chain of `call` targets (and interrupt handlers) that led to it.
+//!        Cycles are read from the time stamp counter where available and a
+//!        monotonic clock in nanoseconds elsewhere, and are charged to an
+//!        instruction as the time until the next instruction starts
+class profiler_c {
+public:
+  //! \brief Instruction address to label name
+  using symbols_t = std::map<uint64_t, std::string>;
+
+  //! \brief Totals gathered for a single opcode
+  struct opcode_profile_t {
+    uint64_t count{0};  //! Number of times executed
+    uint64_t cycles{0}; //! Cycles spent executing
+  };
+
+  //! \brief Reset the profile for a program
+  //! \param num_instructions Number of instructions in the program
+  //! \param entry Address execution starts at, used as the root frame
+  void start(const uint64_t num_instructions, const uint64_t entry);
+
+  //! \brief Record that an instruction is about to execute
+  void instruction(const uint64_t address, const threaded_opcode_e opcode);
+
+  //! \brief Record that control entered a routine at `target`
+  void call(const uint64_t target);
+
+  //! \brief Record that control returned from the current routine
+  void ret();
+
+  //! \brief Stop the clock on the most recent instruction
+  //! \note  Called when the vm stops or yields so the time spent outside of
+  //!        the vm is not charged to the program
+  void pause();
+
+  //! \brief Retrieve the totals for every opcode
+  [[nodiscard]] const std::array<opcode_profile_t,
+                                 static_cast<std::size_t>(
+                                     threaded_opcode_e::NUM_OPCODES)> &
+  get_opcode_profile() const;
+
+  //! \brief Retrieve the number of times each address was executed
+  [[nodiscard]] const std::vector<uint64_t> &get_address_hits() const;
+
+  //! \brief Write the call graph samples in folded stack format
+  //! \param out Stream to write to
+  //! \param symbols Labels used to name frames
+  //! \note  One line per distinct stack, frames separated by `;` and
+  //!        followed by the number of instructions executed in that stack.
+  //!        Readable by flamegraph.pl, inferno and speedscope
+  void write_folded_stacks(std::ostream &out, const symbols_t &symbols) const;
+
+  //! \brief Write the per-opcode totals and the most executed addresses
+  //! \param out Stream to write to
+  //! \param symbols Labels used to annotate addresses
+  //! \param max_addresses Number of addresses to list
+  void write_report(std::ostream &out, const symbols_t &symbols,
+                    const std::size_t max_addresses) const;
+
+private:
+  //  A node in the tree of call stacks seen. Frames are shared by every
+  //  stack that passes through them so a call only has to find its child
+  struct frame_t {
+    uint64_t target{0};
+    std::size_t parent{0};
+    uint64_t samples{0};
+    std::map<uint64_t, std::size_t> children;
+  };
+
+  std::array<opcode_profile_t,
+             static_cast<std::size_t>(threaded_opcode_e::NUM_OPCODES)>
+      _opcodes{};
+  std::vector<uint64_t> _address_hits;
+  std::vector<frame_t> _frames;
+  std::size_t _current_frame{0};
+
+  bool _timing{false};
+  threaded_opcode_e _last_opcode{threaded_opcode_e::NOP};
+  uint64_t _last_cycles{0};
+
+  std::string frame_name(const uint64_t address,
+                         const symbols_t &symbols) const;
+};
+
+//! \brief Describe an address relative to the closest label at or before it
+//! \returns `label+offset`, `label` or the address in hex without labels
+extern std::string annotate_address(const uint64_t address,
+                                    const profiler_c::symbols_t &symbols);
+
+} // namespace machine
+} // namespace skiff
+
+#endif
@@ -0,0 +1,766 @@
+#include "machine/program.hpp"
+#include "defines.hpp"
+#include "instructions.hpp"
+#include "logging/aixlog.hpp"
+#include "types.hpp"
+#include <libskiff/version.hpp>
+
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+
+namespace skiff {
+namespace machine {
+
+namespace {
+
+//! \brief Layout of the bytes following an opcode
+enum class operand_format_e {
+  NONE,        //! No operands
+  QWORD,       //! value
+  SOURCE,      //! a (read)
+  DEST,        //! a (written)
+  TWO_SOURCE,  //! a, b (read)
+  DEST_SOURCE, //! a (written), b (read)
+  THREE_REG,   //! a (written), b, c (read)
+  STORE,       //! a, b, c (read)
+  LOAD,        //! a, b (read), c (written)
+  BRANCH,      //! a, b (read), value
+  MOV,         //! a (written), value
+  FILL,        //! a, b, c, value register 0 (read)
+  COPY,        //! a, b, c, value registers 0, 1 (read)
+  COMPARE,     //! a (written), b, c, value registers 0, 1, 2 (read)
+  VECTOR,      //! kind, a, b, c, value registers 0 - 3 (read)
+  VECTOR_REDUCE, //! kind, a (written), b, c, value register 0 (read)
+  VECTOR_DOT,  //! kind, a (written), b, c, value registers 0, 1, 2 (read)
+  STACK_STORE, //! b (read), signed 32 bit value, a (read)
+  STACK_LOAD,  //! b (read), signed 32 bit value, a (written)
+  REGISTER_MASK, //! 32 bit mask of registers as value
+  ARITHMETIC_IMMEDIATE, //! a (written), b (read), value
+  BRANCH_IMMEDIATE //! a (read), signed 32 bit immediate, value
+};
+
+struct decode_entry_t {
+  threaded_opcode_e opcode;
+  operand_format_e format;
+  const char *name;
+};
+
+static const std::unordered_map<uint8_t, decode_entry_t> &get_decode_map()
+{
+  namespace ins = libskiff::bytecode::instructions;
+  using op = threaded_opcode_e;
+  using fmt = operand_format_e;
+  static const std::unordered_map<uint8_t, decode_entry_t> map = {
+      {ins::NOP, {op::NOP, fmt::NONE, "NOP"}},
+      {ins::EXIT, {op::EXIT, fmt::NONE, "EXIT"}},
+      {ins::BLT, {op::BLT, fmt::BRANCH, "BLT"}},
+      {ins::BGT, {op::BGT, fmt::BRANCH, "BGT"}},
+      {ins::BEQ, {op::BEQ, fmt::BRANCH, "BEQ"}},
+      {ins::JMP, {op::JMP, fmt::QWORD, "JMP"}},
+      {ins::CALL, {op::CALL, fmt::QWORD, "CALL"}},
+      {ins::RET, {op::RET, fmt::NONE, "RET"}},
+      {ins::MOV, {op::MOV, fmt::MOV, "MOV"}},
+      {ins::ADD, {op::ADD, fmt::THREE_REG, "ADD"}},
+      {ins::SUB, {op::SUB, fmt::THREE_REG, "SUB"}},
+      {ins::DIV, {op::DIV, fmt::THREE_REG, "DIV"}},
+      {ins::MUL, {op::MUL, fmt::THREE_REG, "MUL"}},
+      {ins::ADDF, {op::ADDF, fmt::THREE_REG, "ADDF"}},
+      {ins::SUBF, {op::SUBF, fmt::THREE_REG, "SUBF"}},
+      {ins::DIVF, {op::DIVF, fmt::THREE_REG, "DIVF"}},
+      {ins::MULF, {op::MULF, fmt::THREE_REG, "MULF"}},
+      {ins::LSH, {op::LSH, fmt::THREE_REG, "LSH"}},
+      {ins::RSH, {op::RSH, fmt::THREE_REG, "RSH"}},
+      {ins::AND, {op::AND, fmt::THREE_REG, "AND"}},
+      {ins::OR, {op::OR, fmt::THREE_REG, "OR"}},
+      {ins::XOR, {op::XOR, fmt::THREE_REG, "XOR"}},
+      {ins::NOT, {op::NOT, fmt::DEST_SOURCE, "NOT"}},
+      {ins::BLTF, {op::BLTF, fmt::BRANCH, "BLTF"}},
+      {ins::BGTF, {op::BGTF, fmt::BRANCH, "BGTF"}},
+      {ins::BEQF, {op::BEQF, fmt::BRANCH, "BEQF"}},
+      {ins::ASEQ, {op::ASEQ, fmt::TWO_SOURCE, "ASEQ"}},
+      {ins::ASNE, {op::ASNE, fmt::TWO_SOURCE, "ASNE"}},
+      {ins::PUSH_W, {op::PUSH_W, fmt::SOURCE, "PUSH_W"}},
+      {ins::PUSH_HW, {op::PUSH_HW, fmt::SOURCE, "PUSH_HW"}},
+      {ins::PUSH_DW, {op::PUSH_DW, fmt::SOURCE, "PUSH_DW"}},
+      {ins::PUSH_QW, {op::PUSH_QW, fmt::SOURCE, "PUSH_QW"}},
+      {ins::POP_W, {op::POP_W, fmt::DEST, "POP_W"}},
+      {ins::POP_HW, {op::POP_HW, fmt::DEST, "POP_HW"}},
+      {ins::POP_DW, {op::POP_DW, fmt::DEST, "POP_DW"}},
+      {ins::POP_QW, {op::POP_QW, fmt::DEST, "POP_QW"}},
+      {ins::ALLOC, {op::ALLOC, fmt::DEST_SOURCE, "ALLOC"}},
+      {ins::FREE, {op::FREE, fmt::SOURCE, "FREE"}},
+      {ins::SW, {op::STORE_W, fmt::STORE, "SW"}},
+      {ins::SHW, {op::STORE_HW, fmt::STORE, "SHW"}},
+      {ins::SDW, {op::STORE_DW, fmt::STORE, "SDW"}},
+      {ins::SQW, {op::STORE_QW, fmt::STORE, "SQW"}},
+      {ins::LW, {op::LOAD_W, fmt::LOAD, "LW"}},
+      {ins::LHW, {op::LOAD_HW, fmt::LOAD, "LHW"}},
+      {ins::LDW, {op::LOAD_DW, fmt::LOAD, "LDW"}},
+      {ins::LQW, {op::LOAD_QW, fmt::LOAD, "LQW"}},
+      {ins::SYSCALL, {op::SYSCALL, fmt::QWORD, "SYSCALL"}},
+      {ins::DEBUG, {op::DEBUG, fmt::QWORD, "DEBUG"}},
+      {ins::EIRQ, {op::EIRQ, fmt::NONE, "EIRQ"}},
+      {ins::DIRQ, {op::DIRQ, fmt::NONE, "DIRQ"}},
+      {skiff::instructions::REGION_BEGIN,
+       {op::REGION_BEGIN, fmt::DEST, "REGION_BEGIN"}},
+      {skiff::instructions::REGION_FREE,
+       {op::REGION_FREE, fmt::SOURCE, "REGION_FREE"}},
+      {skiff::instructions::MEMORY_COPY,
+       {op::MEMORY_COPY, fmt::COPY, "MEMORY_COPY"}},
+      {skiff::instructions::MEMORY_FILL,
+       {op::MEMORY_FILL, fmt::FILL, "MEMORY_FILL"}},
+      {skiff::instructions::MEMORY_COMPARE,
+       {op::MEMORY_COMPARE, fmt::COMPARE, "MEMORY_COMPARE"}},
+      {skiff::instructions::VECTOR, {op::VECTOR, fmt::VECTOR, "VECTOR"}},
+      {skiff::instructions::VECTOR_REDUCE,
+       {op::VECTOR_REDUCE, fmt::VECTOR_REDUCE, "VECTOR_REDUCE"}},
+      {skiff::instructions::VECTOR_DOT,
+       {op::VECTOR_DOT, fmt::VECTOR_DOT, "VECTOR_DOT"}},
+      {skiff::instructions::REALLOC,
+       {op::REALLOC, fmt::TWO_SOURCE, "REALLOC"}},
+      {skiff::instructions::STACK_STORE_W,
+       {op::STACK_STORE_W, fmt::STACK_STORE, "STACK_STORE_W"}},
+      {skiff::instructions::STACK_STORE_DW,
+       {op::STACK_STORE_DW, fmt::STACK_STORE, "STACK_STORE_DW"}},
+      {skiff::instructions::STACK_STORE_QW,
+       {op::STACK_STORE_QW, fmt::STACK_STORE, "STACK_STORE_QW"}},
+      {skiff::instructions::STACK_LOAD_W,
+       {op::STACK_LOAD_W, fmt::STACK_LOAD, "STACK_LOAD_W"}},
+      {skiff::instructions::STACK_LOAD_DW,
+       {op::STACK_LOAD_DW, fmt::STACK_LOAD, "STACK_LOAD_DW"}},
+      {skiff::instructions::STACK_LOAD_QW,
+       {op::STACK_LOAD_QW, fmt::STACK_LOAD, "STACK_LOAD_QW"}},
+      {skiff::instructions::PUSH_MULTIPLE,
+       {op::PUSH_MULTIPLE, fmt::REGISTER_MASK, "PUSH_MULTIPLE"}},
+      {skiff::instructions::POP_MULTIPLE,
+       {op::POP_MULTIPLE, fmt::REGISTER_MASK, "POP_MULTIPLE"}},
+      {skiff::instructions::ADD_IMMEDIATE,
+       {op::ADDI, fmt::ARITHMETIC_IMMEDIATE, "ADD_IMMEDIATE"}},
+      {skiff::instructions::SUB_IMMEDIATE,
+       {op::SUBI, fmt::ARITHMETIC_IMMEDIATE, "SUB_IMMEDIATE"}},
+      {skiff::instructions::MUL_IMMEDIATE,
+       {op::MULI, fmt::ARITHMETIC_IMMEDIATE, "MUL_IMMEDIATE"}},
+      {skiff::instructions::LSH_IMMEDIATE,
+       {op::LSHI, fmt::ARITHMETIC_IMMEDIATE, "LSH_IMMEDIATE"}},
+      {skiff::instructions::RSH_IMMEDIATE,
+       {op::RSHI, fmt::ARITHMETIC_IMMEDIATE, "RSH_IMMEDIATE"}},
+      {skiff::instructions::AND_IMMEDIATE,
+       {op::ANDI, fmt::ARITHMETIC_IMMEDIATE, "AND_IMMEDIATE"}},
+      {skiff::instructions::OR_IMMEDIATE,
+       {op::ORI, fmt::ARITHMETIC_IMMEDIATE, "OR_IMMEDIATE"}},
+      {skiff::instructions::BLT_IMMEDIATE,
+       {op::BLTI, fmt::BRANCH_IMMEDIATE, "BLT_IMMEDIATE"}},
+      {skiff::instructions::BGT_IMMEDIATE,
+       {op::BGTI, fmt::BRANCH_IMMEDIATE, "BGT_IMMEDIATE"}},
+      {skiff::instructions::BEQ_IMMEDIATE,
+       {op::BEQI, fmt::BRANCH_IMMEDIATE, "BEQ_IMMEDIATE"}}};
+  return map;
+}
+
+//! \brief Number of operand bytes expected for a format
+static std::size_t get_operand_length(const operand_format_e format)
+{
+  switch (format) {
+  case operand_format_e::NONE:
+    return 0;
+  case operand_format_e::QWORD:
+    return 8;
+  case operand_format_e::SOURCE:
+  case operand_format_e::DEST:
+    return 1;
+  case operand_format_e::TWO_SOURCE:
+  case operand_format_e::DEST_SOURCE:
+    return 2;
+  case operand_format_e::THREE_REG:
+  case operand_format_e::STORE:
+  case operand_format_e::LOAD:
+    return 3;
+  case operand_format_e::BRANCH:
+    return 10;
+  case operand_format_e::MOV:
+    return 9;
+  case operand_format_e::FILL:
+    return 4;
+  case operand_format_e::COPY:
+    return 5;
+  case operand_format_e::COMPARE:
+    return 6;
+  case operand_format_e::VECTOR:
+    return 8;
+  case operand_format_e::VECTOR_REDUCE:
+    return 5;
+  case operand_format_e::VECTOR_DOT:
+    return 7;
+  case operand_format_e::STACK_STORE:
+  case operand_format_e::STACK_LOAD:
+    return 6;
+  case operand_format_e::REGISTER_MASK:
+    return 4;
+  case operand_format_e::ARITHMETIC_IMMEDIATE:
+    return 10;
+  case operand_format_e::BRANCH_IMMEDIATE:
+    return 13;
+  }
+  return 0;
+}
+
+//! \brief Map a register id from the bytecode to a register file index
+static std::optional<uint8_t> get_register_index(const uint8_t id)
+{
+  if (id == 0x00) {
+    return {types::reg::x0};
+  }
+  if (id == 0x01) {
+    return {types::reg::x1};
+  }
+  if (id == 0x02) {
+    return {types::reg::ip};
+  }
+  if (id == 0x03) {
+    return {types::reg::sp};
+  }
+  if (id >= 0x10 && id < 0x10 + config::num_integer_registers) {
+    return {static_cast<uint8_t>(types::reg::i0 + (id - 0x10))};
+  }
+  if (id >= 0x20 && id < 0x20 + config::num_floating_point_registers) {
+    return {static_cast<uint8_t>(types::reg::f0 + (id - 0x20))};
+  }
+  if (id == 0xFF) {
+    return {types::reg::op};
+  }
+  return std::nullopt;
+}
+
+// Force warning to screen and logger
+static void force_warning(const std::string &warn)
+{
+  std::cout << TERM_COLOR_YELLOW << "[WARNING] : " << TERM_COLOR_END << warn
+            << std::endl;
+  LOG(WARNING) << TAG("program") << warn << "\n";
+}
+
+// Force error to screen and logger
+static void force_error(const std::string &err)
+{
+  std::cout << TERM_COLOR_RED << "[ERROR] : " << TERM_COLOR_END << err
+            << std::endl;
+  LOG(WARNING) << TAG("program") << err << "\n";
+}
+
+static uint64_t decode_qword(const uint8_t *data)
+{
+  uint64_t value{0x00};
+  for (auto i = 0; i < 8; i++) {
+    value = (value << 8) | static_cast<uint64_t>(data[i]);
+  }
+  return value;
+}
+
+//! \brief Decode a signed 32 bit value, extended so that adding it to a
+//!        register wraps to the same result as subtracting its magnitude
+static uint64_t decode_signed_dword(const uint8_t *data)
+{
+  uint32_t value{0x00};
+  for (auto i = 0; i < 4; i++) {
+    value = (value << 8) | static_cast<uint32_t>(data[i]);
+  }
+  return static_cast<uint64_t>(
+      static_cast<int64_t>(static_cast<int32_t>(value)));
+}
+
+//! \brief Fold bytes into a 64 bit FNV-1a hash
+static uint64_t hash_bytes(uint64_t hash, const uint8_t *data,
+                           const std::size_t length)
+{
+  for (std::size_t i = 0; i < length; i++) {
+    hash = (hash ^ data[i]) * 0x100000001b3;
+  }
+  return hash;
+}
+
+//! \brief Append a value to bytes, least significant byte first
+static void append_qword(std::vector<uint8_t> &bytes, const uint64_t value)
+{
+  for (auto i = 0; i < 8; i++) {
+    bytes.push_back(static_cast<uint8_t>(value >> (i * 8)));
+  }
+}
+
+} // namespace
+
+/*
+    Decode the binary into a flat list of instructions. Pre-decoding the
+    instructions this way saves us the time of splitting them up at execution
+    time and lets us pre-check the binary for any illegal instructions before
+    execution.
+*/
+std::tuple<bool, std::shared_ptr<const program_c>>
+program_c::decode(libskiff::bytecode::executable_c &executable)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+
+  // Check if its experimental
+  if (executable.is_experimental()) {
+    force_warning("Code marked experimental");
+  }
+
+  // Check compatibilty
+  auto version = executable.get_compatiblity_semver();
+
+  LOG(DEBUG) << TAG("program") << "semver.major:"
+             << (int)libskiff::version::semantic_version.major
+             << "thisversion.major:  " << (int)version.major << "\n";
+
+  if (libskiff::version::semantic_version.major < version.major) {
+    force_error("Incompatibility detected : "
+                "Bytecode version.major newer than VM version.major. ");
+    return {false, nullptr};
+  }
+  if (libskiff::version::semantic_version.minor < version.minor) {
+
+    LOG(DEBUG) << TAG("program") << "semver.minor:"
+               << (int)libskiff::version::semantic_version.minor
+               << "thisversion.minor:  " << (int)version.minor << "\n";
+
+    force_warning("Potential incompatibility detected : "
+                  "Bytecode version.minor newer than VM version.minor. ");
+  }
+  if (libskiff::version::semantic_version.patch < version.patch) {
+    force_warning("Potential incompatibility detected : "
+                  "Bytecode version.patch newer than VM version.patch. ");
+  }
+
+  std::shared_ptr<program_c> program(new program_c());
+  program->_entry_address = executable.get_entry_address();
+  program->_interrupt_table = executable.get_interrupt_table();
+  program->_constants = executable.get_constants();
+  program->_debug_level = executable.get_debug_level();
+
+  bool uses_ip{false};
+  bool writes_ip{false};
+
+  // Register that is read from
+  auto source = [&](const uint8_t id) -> std::optional<uint8_t> {
+    auto index = get_register_index(id);
+    if (!index) {
+      LOG(FATAL) << TAG("program") << "Unable to locate register by value\n";
+      return std::nullopt;
+    }
+    uses_ip |= (*index == types::reg::ip);
+    return index;
+  };
+
+  // Register that is written to. Constant registers can never change, so
+  // writes to them are sent to the sink
+  auto dest = [&](const uint8_t id) -> std::optional<uint8_t> {
+    auto index = source(id);
+    writes_ip |= (index && *index == types::reg::ip);
+    if (index && (*index == types::reg::x0 || *index == types::reg::x1)) {
+      return {types::reg::sink};
+    }
+    return index;
+  };
+
+  // Registers that don't fit in a, b and c are packed into the value
+  auto pack = [&](const uint8_t *ids,
+                  const std::size_t count) -> std::optional<uint64_t> {
+    uint64_t packed{0};
+    for (std::size_t n = 0; n < count; n++) {
+      auto index = source(ids[n]);
+      if (!index) {
+        return std::nullopt;
+      }
+      packed |= static_cast<uint64_t>(*index) << (n * 8);
+    }
+    return {packed};
+  };
+
+  // The operation and lane type of a vector instruction go in the top byte
+  // of the value, after any packed registers
+  auto kind = [&](const uint8_t kind, const std::size_t num_operations,
+                  const std::optional<uint64_t> packed)
+      -> std::optional<uint64_t> {
+    if (!std::get<0>(
+            skiff::instructions::decode_vector_kind(kind, num_operations))) {
+      LOG(FATAL) << TAG("program") << "Invalid vector operation or lane type: "
+                 << static_cast<int>(kind) << "\n";
+      return std::nullopt;
+    }
+    if (!packed) {
+      return std::nullopt;
+    }
+    return {*packed | static_cast<uint64_t>(kind) << 56};
+  };
+
+  // Bit n of a register mask selects register file index i0 + n, as the
+  // integer and floating point registers sit next to each other there
+  static_assert(types::reg::count - types::reg::i0 ==
+                skiff::instructions::num_mask_registers);
+  auto mask = [&](const uint8_t *data) -> std::optional<uint64_t> {
+    uint32_t bits{0};
+    for (auto i = 0; i < 4; i++) {
+      bits = (bits << 8) | static_cast<uint32_t>(data[i]);
+    }
+    if (bits >> skiff::instructions::num_mask_registers) {
+      LOG(FATAL) << TAG("program") << "Invalid register mask: " << bits
+                 << "\n";
+      return std::nullopt;
+    }
+    return {bits};
+  };
+
+  // Shifting by the width of a register or more isn't defined on every
+  // host, so amounts that large never make it into a program
+  auto shift = [&](const uint64_t amount) -> std::optional<uint64_t> {
+    if (amount >= skiff::instructions::num_shift_bits) {
+      LOG(FATAL) << TAG("program") << "Invalid shift amount: " << amount
+                 << "\n";
+      return std::nullopt;
+    }
+    return {amount};
+  };
+
+  // Create instructions - return false if illegal instruction found
+  auto instructions = executable.get_instructions();
+  auto &decode_map = get_decode_map();
+  auto instruction_size_map =
+      skiff::instructions::get_instruction_to_size_map();
+  for (std::size_t i = 0; i < instructions.size(); /* no op */) {
+
+    auto opcode = instructions[i++];
+    auto entry = decode_map.find(opcode);
+    if (entry == decode_map.end() ||
+        instruction_size_map.find(opcode) == instruction_size_map.end()) {
+      LOG(FATAL) << TAG("program")
+                 << "Unknown instruction id: " << static_cast<int>(opcode)
+                 << "\n";
+      return {false, nullptr};
+    }
+
+    // We subtract one because we've already consumed the opcode
+    std::size_t instruction_length = instruction_size_map[opcode] - 1;
+
+    // Check to ensure we have that number bytes left
+    if (i + instruction_length > instructions.size()) {
+      LOG(FATAL) << TAG("program") << "Incomplete instruction at " << i << "/"
+                 << instructions.size() << " trying to read "
+                 << instruction_length << " bytes"
+                 << "\n";
+      return {false, nullptr};
+    }
+
+    auto [threaded_opcode, format, name] = entry->second;
+    if (instruction_length != get_operand_length(format)) {
+      LOG(FATAL) << TAG("program")
+                 << "Insufficent data to construct instruction `" << name
+                 << "`\n";
+      return {false, nullptr};
+    }
+
+    const uint8_t *data = instructions.data() + i;
+
+    // inc i the length of the instruction
+    i += instruction_length;
+
+    std::optional<uint8_t> a{0};
+    std::optional<uint8_t> b{0};
+    std::optional<uint8_t> c{0};
+    std::optional<uint64_t> value{0};
+    int32_t immediate{0};
+    switch (format) {
+    case operand_format_e::NONE:
+      break;
+    case operand_format_e::QWORD:
+      value = decode_qword(data);
+      break;
+    case operand_format_e::SOURCE:
+      a = source(data[0]);
+      break;
+    case operand_format_e::DEST:
+      a = dest(data[0]);
+      break;
+    case operand_format_e::TWO_SOURCE:
+      a = source(data[0]);
+      b = source(data[1]);
+      break;
+    case operand_format_e::DEST_SOURCE:
+      a = dest(data[0]);
+      b = source(data[1]);
+      break;
+    case operand_format_e::THREE_REG:
+      a = dest(data[0]);
+      b = source(data[1]);
+      c = source(data[2]);
+      break;
+    case operand_format_e::STORE:
+      a = source(data[0]);
+      b = source(data[1]);
+      c = source(data[2]);
+      break;
+    case operand_format_e::LOAD:
+      a = source(data[0]);
+      b = source(data[1]);
+      c = dest(data[2]);
+      break;
+    case operand_format_e::BRANCH:
+      a = source(data[0]);
+      b = source(data[1]);
+      value = decode_qword(data + 2);
+      break;
+    case operand_format_e::MOV:
+      a = dest(data[0]);
+      value = decode_qword(data + 1);
+      break;
+    case operand_format_e::FILL:
+      a = source(data[0]);
+      b = source(data[1]);
+      c = source(data[2]);
+      value = pack(data + 3, 1);
+      break;
+    case operand_format_e::COPY:
+      a = source(data[0]);
+      b = source(data[1]);
+      c = source(data[2]);
+      value = pack(data + 3, 2);
+      break;
+    case operand_format_e::COMPARE:
+      a = dest(data[0]);
+      b = source(data[1]);
+      c = source(data[2]);
+      value = pack(data + 3, 3);
+      break;
+    case operand_format_e::VECTOR:
+      a = source(data[1]);
+      b = source(data[2]);
+      c = source(data[3]);
+      value = kind(data[0], skiff::instructions::num_vector_ops,
+                   pack(data + 4, 4));
+      break;
+    case operand_format_e::VECTOR_REDUCE:
+      a = dest(data[1]);
+      b = source(data[2]);
+      c = source(data[3]);
+      value = kind(data[0], skiff::instructions::num_vector_reductions,
+                   pack(data + 4, 1));
+      break;
+    case operand_format_e::VECTOR_DOT:
+      a = dest(data[1]);
+      b = source(data[2]);
+      c = source(data[3]);
+      value = kind(data[0], 1, pack(data + 4, 3));
+      break;
+    case operand_format_e::STACK_STORE:
+      b = source(data[0]);
+      value = decode_signed_dword(data + 1);
+      a = source(data[5]);
+      break;
+    case operand_format_e::STACK_LOAD:
+      b = source(data[0]);
+      value = decode_signed_dword(data + 1);
+      a = dest(data[5]);
+      break;
+    case operand_format_e::REGISTER_MASK:
+      value = mask(data);
+      break;
+    case operand_format_e::ARITHMETIC_IMMEDIATE:
+      a = dest(data[0]);
+      b = source(data[1]);
+      value = decode_qword(data + 2);
+      if (threaded_opcode == threaded_opcode_e::LSHI ||
+          threaded_opcode == threaded_opcode_e::RSHI) {
+        value = shift(*value);
+      }
+      break;
+    case operand_format_e::BRANCH_IMMEDIATE:
+      a = source(data[0]);
+      immediate = static_cast<int32_t>(decode_signed_dword(data + 1));
+      value = decode_qword(data + 5);
+      break;
+    }
+
+    if (!a || !b || !c || !value) {
+      return {false, nullptr};
+    }
+
+    LOG(DEBUG) << TAG("program") << "Decoded `" << name << "`\n";
+    program->_instructions.push_back({.handler = nullptr,
+                                      .value = *value,
+                                      .opcode = threaded_opcode,
+                                      .a = *a,
+                                      .b = *b,
+                                      .c = *c,
+                                      .immediate = immediate});
+  }
+
+  // Falling off the end of the program lands on the sentinel
+  program->_instructions.push_back({.opcode = threaded_opcode_e::END});
+
+  // The threaded engine only syncs the instruction pointer at the edges of
+  // its loop so it can't run instructions that observe it
+  program->_threadable = !uses_ip;
+  program->_verified = program->verify(writes_ip);
+
+  // Fewer, larger instructions for the threaded engine
+  program->_fused = fuse_superinstructions(program->_instructions);
+  for (auto &ins : program->_fused) {
+    if (is_superinstruction(ins.opcode)) {
+      program->_superinstruction_counts[ins.opcode]++;
+    }
+  }
+
+  // Identify the binary by everything that affects how it runs
+  {
+    auto &identity = program->_identity;
+    identity.assign(instructions.begin(), instructions.end());
+    append_qword(identity, instructions.size());
+    identity.insert(identity.end(), program->_constants.begin(),
+                    program->_constants.end());
+    append_qword(identity, program->_constants.size());
+    append_qword(identity, program->_entry_address);
+    append_qword(identity, static_cast<uint64_t>(program->_debug_level));
+    std::map<uint64_t, uint64_t> interrupts(program->_interrupt_table.begin(),
+                                            program->_interrupt_table.end());
+    for (auto &[id, address] : interrupts) {
+      append_qword(identity, id);
+      append_qword(identity, address);
+    }
+    program->_hash =
+        hash_bytes(0xcbf29ce484222325, identity.data(), identity.size());
+  }
+  return {true, program};
+}
+
+const threaded_program_t &program_c::get_instructions() const
+{
+  return _instructions;
+}
+
+uint64_t program_c::get_num_instructions() const
+{
+  return _instructions.size() - 1;
+}
+
+uint64_t program_c::get_entry_address() const { return _entry_address; }
+
+const std::unordered_map<uint64_t, uint64_t> &
+program_c::get_interrupt_table() const
+{
+  return _interrupt_table;
+}
+
+const std::vector<uint8_t> &program_c::get_constants() const
+{
+  return _constants;
+}
+
+libskiff::types::exec_debug_level_e program_c::get_debug_level() const
+{
+  return _debug_level;
+}
+
+bool program_c::is_threadable() const { return _threadable; }
+
+bool program_c::verify(const bool writes_ip) const
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+
+  auto reject = [](const std::string &reason) {
+    LOG(DEBUG) << TAG("program") << "Unverified : " << reason << "\n";
+    return false;
+  };
+
+  // Writes to constant registers were sent to the sink while decoding, but
+  // a write to the instruction pointer could go anywhere
+  if (writes_ip) {
+    return reject("instruction pointer is written");
+  }
+
+  const uint64_t num_instructions = get_num_instructions();
+  if (_entry_address >= num_instructions) {
+    return reject("entry address out of range");
+  }
+  for (auto &[id, address] : _interrupt_table) {
+    if (address >= num_instructions) {
+      return reject("interrupt " + std::to_string(id) + " out of range");
+    }
+  }
+
+  for (uint64_t i = 0; i < num_instructions; i++) {
+    auto &ins = _instructions[i];
+    switch (ins.opcode) {
+    case threaded_opcode_e::BLT:
+    case threaded_opcode_e::BGT:
+    case threaded_opcode_e::BEQ:
+    case threaded_opcode_e::BLTF:
+    case threaded_opcode_e::BGTF:
+    case threaded_opcode_e::BEQF:
+    case threaded_opcode_e::BLTI:
+    case threaded_opcode_e::BGTI:
+    case threaded_opcode_e::BEQI:
+    case threaded_opcode_e::JMP:
+    case threaded_opcode_e::CALL:
+      if (ins.value >= num_instructions) {
+        return reject("destination of instruction " + std::to_string(i) +
+                      " out of range");
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  // Every other instruction can continue on to the next, and a call returns
+  // to the one after it, so the last must leave unconditionally
+  switch (_instructions[num_instructions - 1].opcode) {
+  case threaded_opcode_e::EXIT:
+  case threaded_opcode_e::JMP:
+  case threaded_opcode_e::RET:
+    break;
+  default:
+    return reject("execution can run off of the end");
+  }
+  return true;
+}
+
+bool program_c::is_verified() const { return _verified; }
+
+uint64_t program_c::get_hash() const { return _hash; }
+
+const std::vector<uint8_t> &program_c::get_identity() const
+{
+  return _identity;
+}
+
+const threaded_program_t &program_c::get_fused_instructions() const
+{
+  return _fused;
+}
+
+const std::map<threaded_opcode_e, uint64_t> &
+program_c::get_superinstruction_counts() const
+{
+  return _superinstruction_counts;
+}
+
+const threaded_instruction_t *
+program_c::link(const void *const *handlers) const
+{
+  std::call_once(_linked, [&]() {
+    for (auto &ins : _fused) {
+      ins.handler = handlers[static_cast<std::size_t>(ins.opcode)];
+    }
+  });
+  return _fused.data();
+}
+
+jit_c &program_c::get_jit() const
+{
+  std::call_once(_jit_created,
+                 [&]() { _jit = std::make_unique<jit_c>(_instructions); });
+  return *_jit;
+}
+
+} // namespace machine
+} // namespace skiff
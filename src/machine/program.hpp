@@ -0,0 +1,123 @@
+#ifndef SKIFF_PROGRAM_HPP
+#define SKIFF_PROGRAM_HPP
+
+#include "machine/jit.hpp"
+#include "machine/threaded.hpp"
+#include <libskiff/bytecode/executable.hpp>
+#include <libskiff/types.hpp>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace skiff {
+namespace machine {
+
+//! \brief A decoded binary
+//! \note  Decoded once and never modified afterwards, so a single program
+//!        can be shared by any number of vm_c instances on any number of
+//!        threads. Register operands are stored as register file indices
+//!        and are bound to a vm only when it executes them.
+class program_c {
+public:
+  //! \brief Decode an executable into a program
+  //! \param executable The executable to decode
+  //! \returns Tuple with a success flag and the decoded program
+  [[nodiscard]] static std::tuple<bool, std::shared_ptr<const program_c>>
+  decode(libskiff::bytecode::executable_c &executable);
+
+  //! \brief Retrieve the decoded instructions
+  //! \note  The final instruction is always an END sentinel
+  [[nodiscard]] const threaded_program_t &get_instructions() const;
+
+  //! \brief Retrieve the number of instructions, excluding the sentinel
+  [[nodiscard]] uint64_t get_num_instructions() const;
+
+  //! \brief Retrieve the address that execution starts at
+  [[nodiscard]] uint64_t get_entry_address() const;
+
+  //! \brief Retrieve the map of interrupt id to instruction address
+  [[nodiscard]] const std::unordered_map<uint64_t, uint64_t> &
+  get_interrupt_table() const;
+
+  //! \brief Retrieve the constant bytes to place in memory before execution
+  [[nodiscard]] const std::vector<uint8_t> &get_constants() const;
+
+  //! \brief Retrieve the debug level the binary was built with
+  [[nodiscard]] libskiff::types::exec_debug_level_e get_debug_level() const;
+
+  //! \brief Check if the program can be run by the threaded engine
+  //! \returns false iff an instruction uses the instruction pointer as
+  //!          an operand
+  [[nodiscard]] bool is_threadable() const;
+
+  //! \brief Check if the program passed verification when decoded
+  //! \returns true iff every branch, call and jump destination, the entry
+  //!          address and every interrupt handler are in range, control can
+  //!          never run off of the end of the program and no instruction
+  //!          writes to the instruction pointer or a constant register
+  //! \note  Engines run verified programs without checking the instruction
+  //!        pointer or resetting constant registers as they go
+  [[nodiscard]] bool is_verified() const;
+
+  //! \brief Retrieve a hash of the binary the program was decoded from
+  //! \note  Equal binaries always hash the same, on any host. The hash is
+  //!        not collision resistant, compare identities to be certain two
+  //!        programs are the same
+  [[nodiscard]] uint64_t get_hash() const;
+
+  //! \brief Retrieve everything about the binary that affects how it runs
+  //! \note  Programs with equal identities run alike, the hash is taken
+  //!        over these bytes
+  [[nodiscard]] const std::vector<uint8_t> &get_identity() const;
+
+  //! \brief Retrieve the instructions with superinstructions fused in
+  //! \note  Same length and addresses as `get_instructions`
+  [[nodiscard]] const threaded_program_t &get_fused_instructions() const;
+
+  //! \brief Retrieve the number of each superinstruction fused in
+  [[nodiscard]] const std::map<threaded_opcode_e, uint64_t> &
+  get_superinstruction_counts() const;
+
+  //! \brief Fill in the handler of every fused instruction
+  //! \param handlers Handler addresses indexed by threaded_opcode_e
+  //! \returns Pointer to the first fused instruction
+  //! \note  Only the first call has an effect. Every vm running a program
+  //!        passes the same table so the result is the same regardless of
+  //!        which vm links it
+  const threaded_instruction_t *link(const void *const *handlers) const;
+
+  //! \brief Retrieve the native code compiler for this program
+  //! \note  Created on first use and shared by every vm running the program
+  [[nodiscard]] jit_c &get_jit() const;
+
+private:
+  program_c() = default;
+
+  [[nodiscard]] bool verify(const bool writes_ip) const;
+
+  threaded_program_t _instructions;
+  mutable threaded_program_t _fused;
+  std::map<threaded_opcode_e, uint64_t> _superinstruction_counts;
+  mutable std::once_flag _linked;
+  mutable std::unique_ptr<jit_c> _jit;
+  mutable std::once_flag _jit_created;
+  uint64_t _entry_address{0};
+  std::unordered_map<uint64_t, uint64_t> _interrupt_table;
+  std::vector<uint8_t> _constants;
+  libskiff::types::exec_debug_level_e _debug_level{
+      libskiff::types::exec_debug_level_e::NONE};
+  bool _threadable{true};
+  bool _verified{false};
+  uint64_t _hash{0};
+  std::vector<uint8_t> _identity;
+};
+
+} // namespace machine
+} // namespace skiff
+
+#endif
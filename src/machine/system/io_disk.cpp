@@ -1,10 +1,12 @@
 #include "io_disk.hpp"
 #include "config.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <span>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -27,8 +29,8 @@ public:
   bool open(std::ios_base::openmode flags);
   const bool is_open() { return _fs.is_open(); }
   void close() { _fs.close(); }
-  void write(const char *data, std::size_t len);
-  std::vector<uint8_t> read(const std::size_t len);
+  void write(const std::span<const uint8_t> data);
+  std::size_t read(const std::span<uint8_t> data);
 
 private:
   std::fstream _fs;
@@ -44,13 +46,15 @@ bool file_c::open(std::ios_base::openmode flags)
   return _fs.is_open();
 }
 
-void file_c::write(const char *data, std::size_t len) { _fs.write(data, len); }
+void file_c::write(const std::span<const uint8_t> data)
+{
+  _fs.write(reinterpret_cast<const char *>(data.data()), data.size());
+}
 
-std::vector<uint8_t> file_c::read(const std::size_t len)
+std::size_t file_c::read(const std::span<uint8_t> data)
 {
-  std::vector<uint8_t> in(len);
-  _fs.read(reinterpret_cast<char *>(in.data()), len);
-  return in;
+  _fs.read(reinterpret_cast<char *>(data.data()), data.size());
+  return static_cast<std::size_t>(_fs.gcount());
 }
 
 } // namespace
@@ -198,21 +202,12 @@ void io_disk_c::create(skiff::machine::memory::memory_c *slot,
     return;
   }
 
-  if (path_slot->size() < file_path_source_slot_offset + file_path_len) {
+  auto [path_bytes_okay, path_bytes] =
+      path_slot->get_span(file_path_source_slot_offset, file_path_len);
+  if (!path_bytes_okay) {
     return;
   }
-
-  // Pull the path out of memory - this would be a lot faster if we had a
-  // 'slice' function on the memory object
-  std::string path;
-  for (int i = 0; i < file_path_len; i++) {
-    auto [byte_okay, value] =
-        path_slot->get_hword(file_path_source_slot_offset++);
-    if (!byte_okay) {
-      return;
-    }
-    path += static_cast<char>(value);
-  }
+  std::string path(path_bytes.begin(), path_bytes.end());
 
   // std::cout << "Path: " << path << std::endl;
 
@@ -320,7 +315,8 @@ void io_disk_c::write(skiff::machine::memory::memory_c *slot,
 
   // std::cout << "Got source slot\n";
 
-  if (ss->size() < source_offset + len) {
+  auto [data_okay, data] = ss->get_span(source_offset, len);
+  if (!data_okay || data.empty()) {
     return;
   }
 
@@ -331,17 +327,8 @@ void io_disk_c::write(skiff::machine::memory::memory_c *slot,
     return;
   }
 
-  std::vector<uint8_t> data = ss->get_n_bytes(source_offset, len);
-
-  if (data.empty()) {
-    return;
-  }
-
-  // std::cout << "Writing : " << reinterpret_cast<const char *>(&data[0]) <<
-  // std::endl;
-
-  // Write the data to disk
-  file->write(reinterpret_cast<const char *>(&data[0]), data.size());
+  // Write the data to disk straight from the slot
+  file->write(data);
 
   view.op_register = 1;
 }
@@ -389,7 +376,8 @@ void io_disk_c::read(skiff::machine::memory::memory_c *slot,
 
   // std::cout << "Got source slot\n";
 
-  if (ds->size() < dest_offset + len) {
+  auto [data_okay, data] = ds->get_span(dest_offset, len);
+  if (!data_okay) {
     return;
   }
 
@@ -400,10 +388,9 @@ void io_disk_c::read(skiff::machine::memory::memory_c *slot,
     return;
   }
 
-  std::vector<uint8_t> data = file->read(len);
-  if (!ds->put_n_bytes(data, dest_offset)) {
-    return;
-  }
+  // Read straight into the slot, zeroing anything past the end of the file
+  auto count = file->read(data);
+  std::fill(data.begin() + count, data.end(), 0);
 
   view.op_register = data.size();
 }
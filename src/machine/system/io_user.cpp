@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <bitset>
 #include <iostream>
+#include <string_view>
 #include <libskiff/bytecode/floating_point.hpp>
 
 namespace skiff {
@@ -190,12 +191,13 @@ void io_user_c::perform_output(skiff::types::view_t &view,
     break;
   }
   case data_t::ASCII: {
-    std::vector<uint8_t> data = slot->get_n_bytes(offset, length);
-    if (data.empty()) {
+    auto [okay, data] = slot->get_span(offset, length);
+    if (!okay || data.empty()) {
       return;
     }
-    std::string out(reinterpret_cast<const char *>(&data[0]), data.size());
-    output_data<std::string>(out, destination, newline);
+    std::string_view out(reinterpret_cast<const char *>(data.data()),
+                         data.size());
+    output_data<std::string_view>(out, destination, newline);
     break;
   }
   default:
@@ -269,11 +271,12 @@ void io_user_c::perform_input(skiff::types::view_t &view,
       value = value.substr(0, length);
     }
 
-    std::vector<uint8_t> value_vec(value.begin(), value.end());
-    if (!slot->put_n_bytes(value_vec, offset)) {
+    auto [okay, data] = slot->get_span(offset, value.size());
+    if (!okay) {
       return;
     }
-    view.op_register = value_vec.size();
+    std::copy(value.begin(), value.end(), data.begin());
+    view.op_register = value.size();
     return;
   }
   default:
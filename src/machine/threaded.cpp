@@ -0,0 +1,578 @@
+#include "machine/threaded.hpp"
+#include "logging/aixlog.hpp"
+
+namespace skiff {
+namespace machine {
+
+/*
+    The visitor engine executes instructions that hold references straight
+    into a single vm's registers. Build those from the register file indices
+    held in the shared program.
+*/
+std::vector<std::unique_ptr<instruction_c>>
+raise_to_visitable(const threaded_program_t &instructions,
+                   types::register_file_t &registers)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+
+  std::vector<std::unique_ptr<instruction_c>> result;
+  result.reserve(instructions.size());
+
+  for (auto &ins : instructions) {
+    auto &a = registers[ins.a];
+    auto &b = registers[ins.b];
+    auto &c = registers[ins.c];
+
+    switch (ins.opcode) {
+    case threaded_opcode_e::NOP:
+      result.emplace_back(std::make_unique<instruction_nop_c>());
+      break;
+    case threaded_opcode_e::EXIT:
+      result.emplace_back(std::make_unique<instruction_exit_c>());
+      break;
+    case threaded_opcode_e::BLT:
+      result.emplace_back(std::make_unique<instruction_blt_c>(ins.value, a, b));
+      break;
+    case threaded_opcode_e::BGT:
+      result.emplace_back(std::make_unique<instruction_bgt_c>(ins.value, a, b));
+      break;
+    case threaded_opcode_e::BEQ:
+      result.emplace_back(std::make_unique<instruction_beq_c>(ins.value, a, b));
+      break;
+    case threaded_opcode_e::JMP:
+      result.emplace_back(std::make_unique<instruction_jmp_c>(ins.value));
+      break;
+    case threaded_opcode_e::CALL:
+      result.emplace_back(std::make_unique<instruction_call_c>(ins.value));
+      break;
+    case threaded_opcode_e::RET:
+      result.emplace_back(std::make_unique<instruction_ret_c>());
+      break;
+    case threaded_opcode_e::MOV:
+      result.emplace_back(std::make_unique<instruction_mov_c>(a, ins.value));
+      break;
+    case threaded_opcode_e::ADD:
+      result.emplace_back(std::make_unique<instruction_add_c>(a, b, c));
+      break;
+    case threaded_opcode_e::SUB:
+      result.emplace_back(std::make_unique<instruction_sub_c>(a, b, c));
+      break;
+    case threaded_opcode_e::DIV:
+      result.emplace_back(std::make_unique<instruction_div_c>(a, b, c));
+      break;
+    case threaded_opcode_e::MUL:
+      result.emplace_back(std::make_unique<instruction_mul_c>(a, b, c));
+      break;
+    case threaded_opcode_e::ADDF:
+      result.emplace_back(std::make_unique<instruction_addf_c>(a, b, c));
+      break;
+    case threaded_opcode_e::SUBF:
+      result.emplace_back(std::make_unique<instruction_subf_c>(a, b, c));
+      break;
+    case threaded_opcode_e::DIVF:
+      result.emplace_back(std::make_unique<instruction_divf_c>(a, b, c));
+      break;
+    case threaded_opcode_e::MULF:
+      result.emplace_back(std::make_unique<instruction_mulf_c>(a, b, c));
+      break;
+    case threaded_opcode_e::LSH:
+      result.emplace_back(std::make_unique<instruction_lsh_c>(a, b, c));
+      break;
+    case threaded_opcode_e::RSH:
+      result.emplace_back(std::make_unique<instruction_rsh_c>(a, b, c));
+      break;
+    case threaded_opcode_e::AND:
+      result.emplace_back(std::make_unique<instruction_and_c>(a, b, c));
+      break;
+    case threaded_opcode_e::OR:
+      result.emplace_back(std::make_unique<instruction_or_c>(a, b, c));
+      break;
+    case threaded_opcode_e::XOR:
+      result.emplace_back(std::make_unique<instruction_xor_c>(a, b, c));
+      break;
+    case threaded_opcode_e::NOT:
+      result.emplace_back(std::make_unique<instruction_not_c>(a, b));
+      break;
+    case threaded_opcode_e::BLTF:
+      result.emplace_back(
+          std::make_unique<instruction_bltf_c>(ins.value, a, b));
+      break;
+    case threaded_opcode_e::BGTF:
+      result.emplace_back(
+          std::make_unique<instruction_bgtf_c>(ins.value, a, b));
+      break;
+    case threaded_opcode_e::BEQF:
+      result.emplace_back(
+          std::make_unique<instruction_beqf_c>(ins.value, a, b));
+      break;
+    case threaded_opcode_e::ASEQ:
+      result.emplace_back(std::make_unique<instruction_aseq_c>(a, b));
+      break;
+    case threaded_opcode_e::ASNE:
+      result.emplace_back(std::make_unique<instruction_asne_c>(a, b));
+      break;
+    case threaded_opcode_e::PUSH_W:
+      result.emplace_back(std::make_unique<instruction_push_w_c>(a));
+      break;
+    case threaded_opcode_e::PUSH_HW:
+      result.emplace_back(std::make_unique<instruction_push_hw_c>(a));
+      break;
+    case threaded_opcode_e::PUSH_DW:
+      result.emplace_back(std::make_unique<instruction_push_dw_c>(a));
+      break;
+    case threaded_opcode_e::PUSH_QW:
+      result.emplace_back(std::make_unique<instruction_push_qw_c>(a));
+      break;
+    case threaded_opcode_e::POP_W:
+      result.emplace_back(std::make_unique<instruction_pop_w_c>(a));
+      break;
+    case threaded_opcode_e::POP_HW:
+      result.emplace_back(std::make_unique<instruction_pop_hw_c>(a));
+      break;
+    case threaded_opcode_e::POP_DW:
+      result.emplace_back(std::make_unique<instruction_pop_dw_c>(a));
+      break;
+    case threaded_opcode_e::POP_QW:
+      result.emplace_back(std::make_unique<instruction_pop_qw_c>(a));
+      break;
+    case threaded_opcode_e::ALLOC:
+      result.emplace_back(std::make_unique<instruction_alloc_c>(a, b));
+      break;
+    case threaded_opcode_e::FREE:
+      result.emplace_back(std::make_unique<instruction_free_c>(a));
+      break;
+    case threaded_opcode_e::REALLOC:
+      result.emplace_back(std::make_unique<instruction_realloc_c>(a, b));
+      break;
+    case threaded_opcode_e::STACK_STORE_W:
+      result.emplace_back(
+          std::make_unique<instruction_stack_store_word_c>(b, ins.value, a));
+      break;
+    case threaded_opcode_e::STACK_STORE_DW:
+      result.emplace_back(
+          std::make_unique<instruction_stack_store_dword_c>(b, ins.value, a));
+      break;
+    case threaded_opcode_e::STACK_STORE_QW:
+      result.emplace_back(
+          std::make_unique<instruction_stack_store_qword_c>(b, ins.value, a));
+      break;
+    case threaded_opcode_e::STACK_LOAD_W:
+      result.emplace_back(
+          std::make_unique<instruction_stack_load_word_c>(b, ins.value, a));
+      break;
+    case threaded_opcode_e::STACK_LOAD_DW:
+      result.emplace_back(
+          std::make_unique<instruction_stack_load_dword_c>(b, ins.value, a));
+      break;
+    case threaded_opcode_e::STACK_LOAD_QW:
+      result.emplace_back(
+          std::make_unique<instruction_stack_load_qword_c>(b, ins.value, a));
+      break;
+    case threaded_opcode_e::PUSH_MULTIPLE:
+      result.emplace_back(
+          std::make_unique<instruction_push_multiple_c>(ins.value));
+      break;
+    case threaded_opcode_e::POP_MULTIPLE:
+      result.emplace_back(
+          std::make_unique<instruction_pop_multiple_c>(ins.value));
+      break;
+    case threaded_opcode_e::ADDI:
+      result.emplace_back(
+          std::make_unique<instruction_addi_c>(a, b, ins.value));
+      break;
+    case threaded_opcode_e::SUBI:
+      result.emplace_back(
+          std::make_unique<instruction_subi_c>(a, b, ins.value));
+      break;
+    case threaded_opcode_e::MULI:
+      result.emplace_back(
+          std::make_unique<instruction_muli_c>(a, b, ins.value));
+      break;
+    case threaded_opcode_e::LSHI:
+      result.emplace_back(
+          std::make_unique<instruction_lshi_c>(a, b, ins.value));
+      break;
+    case threaded_opcode_e::RSHI:
+      result.emplace_back(
+          std::make_unique<instruction_rshi_c>(a, b, ins.value));
+      break;
+    case threaded_opcode_e::ANDI:
+      result.emplace_back(
+          std::make_unique<instruction_andi_c>(a, b, ins.value));
+      break;
+    case threaded_opcode_e::ORI:
+      result.emplace_back(std::make_unique<instruction_ori_c>(a, b, ins.value));
+      break;
+    case threaded_opcode_e::BLTI:
+      result.emplace_back(std::make_unique<instruction_blti_c>(
+          ins.value, a, get_immediate(ins)));
+      break;
+    case threaded_opcode_e::BGTI:
+      result.emplace_back(std::make_unique<instruction_bgti_c>(
+          ins.value, a, get_immediate(ins)));
+      break;
+    case threaded_opcode_e::BEQI:
+      result.emplace_back(std::make_unique<instruction_beqi_c>(
+          ins.value, a, get_immediate(ins)));
+      break;
+    case threaded_opcode_e::STORE_W:
+      result.emplace_back(std::make_unique<instruction_store_word_c>(a, b, c));
+      break;
+    case threaded_opcode_e::STORE_HW:
+      result.emplace_back(
+          std::make_unique<instruction_store_hword_c>(a, b, c));
+      break;
+    case threaded_opcode_e::STORE_DW:
+      result.emplace_back(
+          std::make_unique<instruction_store_dword_c>(a, b, c));
+      break;
+    case threaded_opcode_e::STORE_QW:
+      result.emplace_back(
+          std::make_unique<instruction_store_qword_c>(a, b, c));
+      break;
+    case threaded_opcode_e::LOAD_W:
+      result.emplace_back(std::make_unique<instruction_load_word_c>(a, b, c));
+      break;
+    case threaded_opcode_e::LOAD_HW:
+      result.emplace_back(std::make_unique<instruction_load_hword_c>(a, b, c));
+      break;
+    case threaded_opcode_e::LOAD_DW:
+      result.emplace_back(std::make_unique<instruction_load_dword_c>(a, b, c));
+      break;
+    case threaded_opcode_e::LOAD_QW:
+      result.emplace_back(std::make_unique<instruction_load_qword_c>(a, b, c));
+      break;
+    case threaded_opcode_e::SYSCALL:
+      result.emplace_back(std::make_unique<instruction_syscall_c>(ins.value));
+      break;
+    case threaded_opcode_e::DEBUG:
+      result.emplace_back(std::make_unique<instruction_debug_c>(ins.value));
+      break;
+    case threaded_opcode_e::EIRQ:
+      result.emplace_back(std::make_unique<instruction_eirq_c>());
+      break;
+    case threaded_opcode_e::DIRQ:
+      result.emplace_back(std::make_unique<instruction_dirq_c>());
+      break;
+    case threaded_opcode_e::REGION_BEGIN:
+      result.emplace_back(std::make_unique<instruction_region_begin_c>(a));
+      break;
+    case threaded_opcode_e::REGION_FREE:
+      result.emplace_back(std::make_unique<instruction_region_free_c>(a));
+      break;
+    case threaded_opcode_e::MEMORY_COPY:
+      result.emplace_back(std::make_unique<instruction_memory_copy_c>(
+          a, b, c, registers[get_packed_register(ins, 0)],
+          registers[get_packed_register(ins, 1)]));
+      break;
+    case threaded_opcode_e::MEMORY_FILL:
+      result.emplace_back(std::make_unique<instruction_memory_fill_c>(
+          a, b, c, registers[get_packed_register(ins, 0)]));
+      break;
+    case threaded_opcode_e::MEMORY_COMPARE:
+      result.emplace_back(std::make_unique<instruction_memory_compare_c>(
+          a, b, c, registers[get_packed_register(ins, 0)],
+          registers[get_packed_register(ins, 1)],
+          registers[get_packed_register(ins, 2)]));
+      break;
+    case threaded_opcode_e::VECTOR:
+      result.emplace_back(std::make_unique<instruction_vector_c>(
+          get_vector_kind(ins), a, b, c, registers[get_packed_register(ins, 0)],
+          registers[get_packed_register(ins, 1)],
+          registers[get_packed_register(ins, 2)],
+          registers[get_packed_register(ins, 3)]));
+      break;
+    case threaded_opcode_e::VECTOR_REDUCE:
+      result.emplace_back(std::make_unique<instruction_vector_reduce_c>(
+          get_vector_kind(ins), a, b, c,
+          registers[get_packed_register(ins, 0)]));
+      break;
+    case threaded_opcode_e::VECTOR_DOT:
+      result.emplace_back(std::make_unique<instruction_vector_dot_c>(
+          get_vector_kind(ins), a, b, c, registers[get_packed_register(ins, 0)],
+          registers[get_packed_register(ins, 1)],
+          registers[get_packed_register(ins, 2)]));
+      break;
+    case threaded_opcode_e::MOV_ADD:
+    case threaded_opcode_e::ADD_BLT:
+    case threaded_opcode_e::ADD_BGT:
+    case threaded_opcode_e::ADD_BEQ:
+    case threaded_opcode_e::ADD_SW:
+    case threaded_opcode_e::ADD_SQW:
+    case threaded_opcode_e::MOV_ADD_SW:
+    case threaded_opcode_e::MOV_ADD_SQW:
+    case threaded_opcode_e::PUSH_QW_N:
+    case threaded_opcode_e::POP_QW_N:
+    case threaded_opcode_e::END:
+    case threaded_opcode_e::NUM_OPCODES:
+      break;
+    }
+  }
+  return result;
+}
+
+/*
+    Superinstructions replace the first instruction of a sequence and leave
+    the rest where they are. Running one executes the whole sequence with a
+    single dispatch, while a branch into the middle of the sequence, or a
+    budget that runs out part way through it, simply continues with the
+    original instructions.
+
+    Every address is considered as the start of a sequence, so the tail of
+    one superinstruction may start another. The longest match wins.
+*/
+threaded_program_t
+fuse_superinstructions(const threaded_program_t &instructions)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+
+  using op = threaded_opcode_e;
+
+  threaded_program_t fused = instructions;
+  auto opcode_at = [&](const std::size_t index) {
+    return index < instructions.size() ? instructions[index].opcode : op::END;
+  };
+
+  for (std::size_t i = 0; i < instructions.size(); i++) {
+    const auto first = opcode_at(i);
+    const auto second = opcode_at(i + 1);
+    const auto third = opcode_at(i + 2);
+    auto &ins = fused[i];
+
+    if (first == op::PUSH_QW || first == op::POP_QW) {
+      uint64_t length{1};
+      while (opcode_at(i + length) == first) {
+        length++;
+      }
+      if (length > 1) {
+        ins.opcode = (first == op::PUSH_QW) ? op::PUSH_QW_N : op::POP_QW_N;
+        ins.value = length;
+      }
+      continue;
+    }
+
+    if (first == op::MOV && second == op::ADD) {
+      ins.opcode = (third == op::STORE_W)    ? op::MOV_ADD_SW
+                   : (third == op::STORE_QW) ? op::MOV_ADD_SQW
+                                             : op::MOV_ADD;
+      continue;
+    }
+
+    if (first == op::ADD) {
+      switch (second) {
+      case op::BLT:
+        ins.opcode = op::ADD_BLT;
+        break;
+      case op::BGT:
+        ins.opcode = op::ADD_BGT;
+        break;
+      case op::BEQ:
+        ins.opcode = op::ADD_BEQ;
+        break;
+      case op::STORE_W:
+        ins.opcode = op::ADD_SW;
+        break;
+      case op::STORE_QW:
+        ins.opcode = op::ADD_SQW;
+        break;
+      default:
+        break;
+      }
+    }
+  }
+  return fused;
+}
+
+bool is_superinstruction(const threaded_opcode_e opcode)
+{
+  return opcode >= threaded_opcode_e::MOV_ADD &&
+         opcode <= threaded_opcode_e::POP_QW_N;
+}
+
+const char *get_opcode_name(const threaded_opcode_e opcode)
+{
+  switch (opcode) {
+  case threaded_opcode_e::NOP:
+    return "nop";
+  case threaded_opcode_e::EXIT:
+    return "exit";
+  case threaded_opcode_e::BLT:
+    return "blt";
+  case threaded_opcode_e::BGT:
+    return "bgt";
+  case threaded_opcode_e::BEQ:
+    return "beq";
+  case threaded_opcode_e::JMP:
+    return "jmp";
+  case threaded_opcode_e::CALL:
+    return "call";
+  case threaded_opcode_e::RET:
+    return "ret";
+  case threaded_opcode_e::MOV:
+    return "mov";
+  case threaded_opcode_e::ADD:
+    return "add";
+  case threaded_opcode_e::SUB:
+    return "sub";
+  case threaded_opcode_e::DIV:
+    return "div";
+  case threaded_opcode_e::MUL:
+    return "mul";
+  case threaded_opcode_e::ADDF:
+    return "addf";
+  case threaded_opcode_e::SUBF:
+    return "subf";
+  case threaded_opcode_e::DIVF:
+    return "divf";
+  case threaded_opcode_e::MULF:
+    return "mulf";
+  case threaded_opcode_e::LSH:
+    return "lsh";
+  case threaded_opcode_e::RSH:
+    return "rsh";
+  case threaded_opcode_e::AND:
+    return "and";
+  case threaded_opcode_e::OR:
+    return "or";
+  case threaded_opcode_e::XOR:
+    return "xor";
+  case threaded_opcode_e::NOT:
+    return "not";
+  case threaded_opcode_e::BLTF:
+    return "bltf";
+  case threaded_opcode_e::BGTF:
+    return "bgtf";
+  case threaded_opcode_e::BEQF:
+    return "beqf";
+  case threaded_opcode_e::ASEQ:
+    return "aseq";
+  case threaded_opcode_e::ASNE:
+    return "asne";
+  case threaded_opcode_e::PUSH_W:
+    return "push_w";
+  case threaded_opcode_e::PUSH_HW:
+    return "push_hw";
+  case threaded_opcode_e::PUSH_DW:
+    return "push_dw";
+  case threaded_opcode_e::PUSH_QW:
+    return "push_qw";
+  case threaded_opcode_e::POP_W:
+    return "pop_w";
+  case threaded_opcode_e::POP_HW:
+    return "pop_hw";
+  case threaded_opcode_e::POP_DW:
+    return "pop_dw";
+  case threaded_opcode_e::POP_QW:
+    return "pop_qw";
+  case threaded_opcode_e::ALLOC:
+    return "alloc";
+  case threaded_opcode_e::FREE:
+    return "free";
+  case threaded_opcode_e::REALLOC:
+    return "realloc";
+  case threaded_opcode_e::STACK_STORE_W:
+    return "ssw";
+  case threaded_opcode_e::STACK_STORE_DW:
+    return "ssdw";
+  case threaded_opcode_e::STACK_STORE_QW:
+    return "ssqw";
+  case threaded_opcode_e::STACK_LOAD_W:
+    return "lsw";
+  case threaded_opcode_e::STACK_LOAD_DW:
+    return "lsdw";
+  case threaded_opcode_e::STACK_LOAD_QW:
+    return "lsqw";
+  case threaded_opcode_e::PUSH_MULTIPLE:
+    return "pushm";
+  case threaded_opcode_e::POP_MULTIPLE:
+    return "popm";
+  case threaded_opcode_e::ADDI:
+    return "addi";
+  case threaded_opcode_e::SUBI:
+    return "subi";
+  case threaded_opcode_e::MULI:
+    return "muli";
+  case threaded_opcode_e::LSHI:
+    return "lshi";
+  case threaded_opcode_e::RSHI:
+    return "rshi";
+  case threaded_opcode_e::ANDI:
+    return "andi";
+  case threaded_opcode_e::ORI:
+    return "ori";
+  case threaded_opcode_e::BLTI:
+    return "blti";
+  case threaded_opcode_e::BGTI:
+    return "bgti";
+  case threaded_opcode_e::BEQI:
+    return "beqi";
+  case threaded_opcode_e::STORE_W:
+    return "sw";
+  case threaded_opcode_e::STORE_HW:
+    return "shw";
+  case threaded_opcode_e::STORE_DW:
+    return "sdw";
+  case threaded_opcode_e::STORE_QW:
+    return "sqw";
+  case threaded_opcode_e::LOAD_W:
+    return "lw";
+  case threaded_opcode_e::LOAD_HW:
+    return "lhw";
+  case threaded_opcode_e::LOAD_DW:
+    return "ldw";
+  case threaded_opcode_e::LOAD_QW:
+    return "lqw";
+  case threaded_opcode_e::SYSCALL:
+    return "syscall";
+  case threaded_opcode_e::DEBUG:
+    return "debug";
+  case threaded_opcode_e::EIRQ:
+    return "eirq";
+  case threaded_opcode_e::DIRQ:
+    return "dirq";
+  case threaded_opcode_e::REGION_BEGIN:
+    return "region_begin";
+  case threaded_opcode_e::REGION_FREE:
+    return "region_free";
+  case threaded_opcode_e::MEMORY_COPY:
+    return "mcpy";
+  case threaded_opcode_e::MEMORY_FILL:
+    return "mset";
+  case threaded_opcode_e::MEMORY_COMPARE:
+    return "mcmp";
+  case threaded_opcode_e::VECTOR:
+    return "vector";
+  case threaded_opcode_e::VECTOR_REDUCE:
+    return "vector_reduce";
+  case threaded_opcode_e::VECTOR_DOT:
+    return "vector_dot";
+  case threaded_opcode_e::MOV_ADD:
+    return "mov+add";
+  case threaded_opcode_e::ADD_BLT:
+    return "add+blt";
+  case threaded_opcode_e::ADD_BGT:
+    return "add+bgt";
+  case threaded_opcode_e::ADD_BEQ:
+    return "add+beq";
+  case threaded_opcode_e::ADD_SW:
+    return "add+sw";
+  case threaded_opcode_e::ADD_SQW:
+    return "add+sqw";
+  case threaded_opcode_e::MOV_ADD_SW:
+    return "mov+add+sw";
+  case threaded_opcode_e::MOV_ADD_SQW:
+    return "mov+add+sqw";
+  case threaded_opcode_e::PUSH_QW_N:
+    return "push_qw*n";
+  case threaded_opcode_e::POP_QW_N:
+    return "pop_qw*n";
+  case threaded_opcode_e::END:
+    return "<end>";
+  case threaded_opcode_e::NUM_OPCODES:
+    break;
+  }
+  return "<unknown>";
+}
+
+} // namespace machine
+} // namespace skiff
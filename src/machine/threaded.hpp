@@ -0,0 +1,207 @@
+#ifndef SKIFF_THREADED_HPP
+#define SKIFF_THREADED_HPP
+
+#include "machine/execution_context.hpp"
+#include "types.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace skiff {
+namespace machine {
+
+//! \brief Operations understood by the direct-threaded engine
+enum class threaded_opcode_e : uint8_t {
+  NOP,
+  EXIT,
+  BLT,
+  BGT,
+  BEQ,
+  JMP,
+  CALL,
+  RET,
+  MOV,
+  ADD,
+  SUB,
+  DIV,
+  MUL,
+  ADDF,
+  SUBF,
+  DIVF,
+  MULF,
+  LSH,
+  RSH,
+  AND,
+  OR,
+  XOR,
+  NOT,
+  BLTF,
+  BGTF,
+  BEQF,
+  ASEQ,
+  ASNE,
+  PUSH_W,
+  PUSH_HW,
+  PUSH_DW,
+  PUSH_QW,
+  POP_W,
+  POP_HW,
+  POP_DW,
+  POP_QW,
+  ALLOC,
+  FREE,
+  STORE_W,
+  STORE_HW,
+  STORE_DW,
+  STORE_QW,
+  LOAD_W,
+  LOAD_HW,
+  LOAD_DW,
+  LOAD_QW,
+  SYSCALL,
+  DEBUG,
+  EIRQ,
+  DIRQ,
+  REGION_BEGIN,
+  REGION_FREE,
+  MEMORY_COPY,
+  MEMORY_FILL,
+  MEMORY_COMPARE,
+  VECTOR,
+  VECTOR_REDUCE,
+  VECTOR_DOT,
+  REALLOC,
+  STACK_STORE_W,
+  STACK_STORE_DW,
+  STACK_STORE_QW,
+  STACK_LOAD_W,
+  STACK_LOAD_DW,
+  STACK_LOAD_QW,
+  PUSH_MULTIPLE,
+  POP_MULTIPLE,
+  ADDI,
+  SUBI,
+  MULI,
+  LSHI,
+  RSHI,
+  ANDI,
+  ORI,
+  BLTI,
+  BGTI,
+  BEQI,
+
+  // Superinstructions, only ever found in a fused program. Each stands in
+  // for the instruction it replaces and the ones that follow it, which are
+  // left in place so that control can still enter part way through
+  MOV_ADD,     //! mov, add
+  ADD_BLT,     //! add, blt
+  ADD_BGT,     //! add, bgt
+  ADD_BEQ,     //! add, beq
+  ADD_SW,      //! add, sw
+  ADD_SQW,     //! add, sqw
+  MOV_ADD_SW,  //! mov, add, sw
+  MOV_ADD_SQW, //! mov, add, sqw
+  PUSH_QW_N,   //! `value` consecutive push_qw
+  POP_QW_N,    //! `value` consecutive pop_qw
+
+  END, //! Sentinel placed after the last instruction
+  NUM_OPCODES
+};
+
+//! \brief Flat, pointer-free encoding of a decoded instruction
+//! \note  Register operands are indices into a types::register_file_t.
+//!        Their meaning depends on the opcode:
+//!          dest, lhs, rhs                : a, b, c
+//!          dest, lhs, immediate rhs      : a, b, value
+//!          branch lhs, rhs, destination  : a, b, value
+//!          branch lhs, immediate rhs     : a, immediate
+//!            destination                 : value
+//!          store idx, offset, data       : a, b, c
+//!          load idx, offset, dest        : a, b, c
+//!          alloc dest, size              : a, b
+//!          mov dest, constant            : a, value
+//!          push source / pop dest / free : a
+//!          realloc slot, size            : a, b
+//!          stack store data, base, offset: a, b, value
+//!          stack load dest, base, offset : a, b, value
+//!          pushm / popm registers        : value, bit n selects index
+//!                                          i0 + n
+//!          region_begin / region_free    : a
+//!          mcpy dest, offset, source     : a, b, c
+//!            source offset, length       : registers 0, 1 of value
+//!          mset slot, offset, length     : a, b, c
+//!            value                       : register 0 of value
+//!          mcmp dest, lhs, lhs offset    : a, b, c
+//!            rhs, rhs offset, length     : registers 0, 1, 2 of value
+//!          vector dest, offset, lhs      : a, b, c
+//!            lhs offset, rhs, rhs offset : registers 0, 1, 2 of value
+//!            count                       : register 3 of value
+//!          vector reduce dest, slot      : a, b
+//!            offset, count               : c, register 0 of value
+//!          vector dot dest, lhs          : a, b
+//!            lhs offset, rhs             : c, register 0 of value
+//!            rhs offset, count           : registers 1, 2 of value
+//!          vector operation, lane type   : top byte of value
+//!          not dest, source              : a, b
+//!          aseq / asne expected, actual  : a, b
+//!          jmp / call / syscall / debug  : value
+struct threaded_instruction_t {
+  const void *handler{nullptr}; //! Filled in by the engine before dispatch
+  uint64_t value{0};
+  threaded_opcode_e opcode{threaded_opcode_e::NOP};
+  uint8_t a{0};
+  uint8_t b{0};
+  uint8_t c{0};
+  int32_t immediate{0}; //! Fits in what would otherwise be padding
+};
+
+//! \brief Retrieve the immediate of an instruction, sign extended so that
+//!        it compares as the register it stands in for would
+inline uint64_t get_immediate(const threaded_instruction_t &ins)
+{
+  return static_cast<uint64_t>(static_cast<int64_t>(ins.immediate));
+}
+
+//! \brief Retrieve a register index packed into the value of an instruction
+//! \param n Which of the packed registers to retrieve, from 0
+inline uint8_t get_packed_register(const threaded_instruction_t &ins,
+                                   const unsigned n)
+{
+  return static_cast<uint8_t>(ins.value >> (n * 8));
+}
+
+//! \brief Retrieve the operation and lane type of a vector instruction
+inline uint8_t get_vector_kind(const threaded_instruction_t &ins)
+{
+  return static_cast<uint8_t>(ins.value >> 56);
+}
+
+//! \brief A lowered program
+using threaded_program_t = std::vector<threaded_instruction_t>;
+
+//! \brief Build visitable instructions bound to a register file
+//! \param instructions The threaded instructions to convert
+//! \param registers The register file the instructions will reference
+//! \returns The instructions, not including the END sentinel
+extern std::vector<std::unique_ptr<instruction_c>>
+raise_to_visitable(const threaded_program_t &instructions,
+                   types::register_file_t &registers);
+
+//! \brief Replace common sequences of instructions with superinstructions
+//! \param instructions The instructions to fuse, ending with END
+//! \returns The fused program. Instructions keep their addresses, so it can
+//!          be run in place of the original
+extern threaded_program_t
+fuse_superinstructions(const threaded_program_t &instructions);
+
+//! \brief Check if an opcode is a superinstruction
+extern bool is_superinstruction(const threaded_opcode_e opcode);
+
+//! \brief Retrieve the assembler mnemonic of an opcode
+extern const char *get_opcode_name(const threaded_opcode_e opcode);
+
+} // namespace machine
+} // namespace skiff
+
+#endif
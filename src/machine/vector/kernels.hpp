@@ -0,0 +1,36 @@
+#ifndef SKIFF_VECTOR_KERNELS_HPP
+#define SKIFF_VECTOR_KERNELS_HPP
+
+#include "machine/vector/vector.hpp"
+
+// Vector extensions let one set of kernels be built for any width
+#if defined(__GNUC__) || defined(__clang__)
+#define SKIFF_VECTOR_HAS_SIMD128
+#if defined(__x86_64__) || defined(__i386__)
+#define SKIFF_VECTOR_HAS_AVX2
+#endif
+#endif
+
+namespace skiff {
+namespace machine {
+namespace vector {
+
+//! \brief Retrieve the kernels that work one lane at a time
+extern const kernels_t &get_scalar_kernels();
+
+#ifdef SKIFF_VECTOR_HAS_SIMD128
+//! \brief Retrieve the kernels built for 128 bit vectors
+extern const kernels_t &get_simd128_kernels();
+#endif
+
+#ifdef SKIFF_VECTOR_HAS_AVX2
+//! \brief Retrieve the kernels built for AVX2
+//! \note  Must only be run on a host that supports AVX2
+extern const kernels_t &get_avx2_kernels();
+#endif
+
+} // namespace vector
+} // namespace machine
+} // namespace skiff
+
+#endif
@@ -0,0 +1,425 @@
+#include "machine/vector/kernels.hpp"
+
+#include <cstring>
+#include <type_traits>
+
+/*
+    The kernels of every instruction set. A translation unit that includes
+    this defines SKIFF_VECTOR_BYTES as the width of the vectors it builds
+    for, 0 for one lane at a time, and SKIFF_VECTOR_TARGET as the attribute
+    that lets the compiler use them. Everything here has internal linkage so
+    the copies built for each instruction set never mix.
+
+    Floating point sums are split into four partial sums whatever the width,
+    so every instruction set rounds the same way and gives the same result.
+*/
+
+#if !defined(SKIFF_VECTOR_BYTES) || !defined(SKIFF_VECTOR_TARGET)
+#error "SKIFF_VECTOR_BYTES and SKIFF_VECTOR_TARGET must be defined"
+#endif
+
+namespace skiff {
+namespace machine {
+namespace vector {
+namespace {
+
+// Unsigned type holding the bits of a lane
+template <typename T> struct bits {
+  using type = T;
+};
+template <> struct bits<double> {
+  using type = uint64_t;
+};
+template <typename T> using bits_t = typename bits<T>::type;
+
+// Lanes of type T, either one or a vector of them
+template <typename T, bool Vector> struct lanes {
+  using type = T;
+  using bits = bits_t<T>;
+};
+
+#if SKIFF_VECTOR_BYTES
+template <typename T> struct simd;
+
+#define SKIFF_VECTOR_TYPE(T)                                                   \
+  template <> struct simd<T> {                                                 \
+    typedef T type __attribute__((vector_size(SKIFF_VECTOR_BYTES)));           \
+  };
+SKIFF_VECTOR_TYPE(uint8_t)
+SKIFF_VECTOR_TYPE(uint16_t)
+SKIFF_VECTOR_TYPE(uint32_t)
+SKIFF_VECTOR_TYPE(uint64_t)
+SKIFF_VECTOR_TYPE(double)
+#undef SKIFF_VECTOR_TYPE
+
+template <typename T> using simd_t = typename simd<T>::type;
+
+template <typename T> struct lanes<T, true> {
+  using type = simd_t<T>;
+  using bits = simd_t<bits_t<T>>;
+};
+
+template <typename T>
+constexpr uint64_t lanes_per_vector = SKIFF_VECTOR_BYTES / sizeof(T);
+#endif
+
+template <typename T, bool Vector>
+using lanes_t = typename lanes<T, Vector>::type;
+
+template <typename To, typename From>
+SKIFF_VECTOR_TARGET To cast_bits(const From from)
+{
+  static_assert(sizeof(To) == sizeof(From));
+  To to;
+  std::memcpy(&to, &from, sizeof(To));
+  return to;
+}
+
+// Reverse the bytes of every lane of X, whose lanes are U
+template <typename U, typename X> SKIFF_VECTOR_TARGET X swap_lanes(X x)
+{
+  if constexpr (sizeof(U) == 1) {
+    return x;
+  }
+  else if constexpr (sizeof(U) == 4) {
+    constexpr uint32_t byte_1 = 0x0000FF00;
+    constexpr uint32_t byte_2 = 0x00FF0000;
+    return (x >> 24) | ((x >> 8) & byte_1) | ((x << 8) & byte_2) | (x << 24);
+  }
+  else {
+    constexpr uint64_t odd_words = 0x0000FFFF0000FFFF;
+    constexpr uint64_t odd_bytes = 0x00FF00FF00FF00FF;
+    x = (x >> 32) | (x << 32);
+    x = ((x >> 16) & odd_words) | ((x & odd_words) << 16);
+    return ((x >> 8) & odd_bytes) | ((x & odd_bytes) << 8);
+  }
+}
+
+template <typename T, bool Swap, bool Vector = false>
+SKIFF_VECTOR_TARGET lanes_t<T, Vector> load(const uint8_t *data)
+{
+  typename lanes<T, Vector>::bits raw;
+  std::memcpy(&raw, data, sizeof(raw));
+  if constexpr (Swap) {
+    raw = swap_lanes<bits_t<T>>(raw);
+  }
+  return cast_bits<lanes_t<T, Vector>>(raw);
+}
+
+template <typename T, bool Swap, bool Vector = false>
+SKIFF_VECTOR_TARGET void store(uint8_t *data, const lanes_t<T, Vector> value)
+{
+  auto raw = cast_bits<typename lanes<T, Vector>::bits>(value);
+  if constexpr (Swap) {
+    raw = swap_lanes<bits_t<T>>(raw);
+  }
+  std::memcpy(data, &raw, sizeof(raw));
+}
+
+template <op_e Op, typename X>
+SKIFF_VECTOR_TARGET X compute(const X lhs, const X rhs)
+{
+  if constexpr (Op == op_e::ADD) {
+    return static_cast<X>(lhs + rhs);
+  }
+  else if constexpr (Op == op_e::SUB) {
+    return static_cast<X>(lhs - rhs);
+  }
+  else if constexpr (Op == op_e::MUL) {
+    return static_cast<X>(lhs * rhs);
+  }
+  else if constexpr (Op == op_e::MIN) {
+    return rhs < lhs ? rhs : lhs;
+  }
+  else {
+    return lhs < rhs ? rhs : lhs;
+  }
+}
+
+#if SKIFF_VECTOR_BYTES
+template <typename V> SKIFF_VECTOR_TARGET uint64_t sum_lanes(const V value)
+{
+  uint64_t total{0};
+  for (std::size_t i = 0; i < sizeof(V) / sizeof(value[0]); i++) {
+    total += value[i];
+  }
+  return total;
+}
+#endif
+
+template <typename T, op_e Op, bool Swap>
+SKIFF_VECTOR_TARGET void run_elementwise(uint8_t *dest, const uint8_t *lhs,
+                                         const uint8_t *rhs,
+                                         const uint64_t count)
+{
+  uint64_t i{0};
+#if SKIFF_VECTOR_BYTES
+  for (; i + lanes_per_vector<T> <= count; i += lanes_per_vector<T>) {
+    const auto offset = i * sizeof(T);
+    store<T, Swap, true>(dest + offset,
+                         compute<Op>(load<T, Swap, true>(lhs + offset),
+                                     load<T, Swap, true>(rhs + offset)));
+  }
+#endif
+  for (; i < count; i++) {
+    const auto offset = i * sizeof(T);
+    store<T, Swap>(dest + offset, compute<Op>(load<T, Swap>(lhs + offset),
+                                              load<T, Swap>(rhs + offset)));
+  }
+}
+
+// Accumulates lanes i, i + 4, i + 8 ... into the i'th partial sum
+template <bool Swap, bool Dot>
+SKIFF_VECTOR_TARGET uint64_t run_f64_sum(const uint8_t *lhs, const uint8_t *rhs,
+                                         const uint64_t count)
+{
+  double partial[4] = {};
+  uint64_t i{0};
+#if SKIFF_VECTOR_BYTES
+  constexpr uint64_t width = lanes_per_vector<double>;
+  constexpr uint64_t vectors = 4 / width;
+  simd_t<double> sums[vectors] = {};
+  for (; i + 4 <= count; i += 4) {
+    for (uint64_t v = 0; v < vectors; v++) {
+      const auto offset = (i + v * width) * sizeof(double);
+      if constexpr (Dot) {
+        sums[v] += load<double, Swap, true>(lhs + offset) *
+                   load<double, Swap, true>(rhs + offset);
+      }
+      else {
+        sums[v] += load<double, Swap, true>(lhs + offset);
+      }
+    }
+  }
+  for (uint64_t v = 0; v < vectors; v++) {
+    for (uint64_t lane = 0; lane < width; lane++) {
+      partial[v * width + lane] = sums[v][lane];
+    }
+  }
+#else
+  for (; i + 4 <= count; i += 4) {
+    for (uint64_t p = 0; p < 4; p++) {
+      const auto offset = (i + p) * sizeof(double);
+      if constexpr (Dot) {
+        partial[p] +=
+            load<double, Swap>(lhs + offset) * load<double, Swap>(rhs + offset);
+      }
+      else {
+        partial[p] += load<double, Swap>(lhs + offset);
+      }
+    }
+  }
+#endif
+  double total = (partial[0] + partial[1]) + (partial[2] + partial[3]);
+  for (; i < count; i++) {
+    const auto offset = i * sizeof(double);
+    if constexpr (Dot) {
+      total +=
+          load<double, Swap>(lhs + offset) * load<double, Swap>(rhs + offset);
+    }
+    else {
+      total += load<double, Swap>(lhs + offset);
+    }
+  }
+  return cast_bits<uint64_t>(total);
+}
+
+template <typename T, bool Swap>
+SKIFF_VECTOR_TARGET uint64_t run_sum(const uint8_t *data, const uint64_t count)
+{
+  if constexpr (std::is_same_v<T, double>) {
+    return run_f64_sum<Swap, false>(data, nullptr, count);
+  }
+  else {
+    uint64_t total{0};
+    uint64_t i{0};
+#if SKIFF_VECTOR_BYTES
+    constexpr uint64_t width = lanes_per_vector<T>;
+    if constexpr (sizeof(T) == 1) {
+      // Pairs of bytes are added into 16 bit lanes, which are emptied
+      // before they can overflow
+      using pairs_t = simd_t<uint16_t>;
+      while (i + width <= count) {
+        pairs_t sums{};
+        for (unsigned n = 0; n < 128 && i + width <= count; n++, i += width) {
+          const auto pairs = cast_bits<pairs_t>(load<T, Swap, true>(data + i));
+          sums += (pairs & 0xFF) + (pairs >> 8);
+        }
+        total += sum_lanes(sums);
+      }
+    }
+    else if constexpr (sizeof(T) == 4) {
+      using pairs_t = simd_t<uint64_t>;
+      pairs_t sums{};
+      for (; i + width <= count; i += width) {
+        const auto pairs =
+            cast_bits<pairs_t>(load<T, Swap, true>(data + i * sizeof(T)));
+        sums += (pairs & 0xFFFFFFFF) + (pairs >> 32);
+      }
+      total = sum_lanes(sums);
+    }
+    else {
+      simd_t<T> sums{};
+      for (; i + width <= count; i += width) {
+        sums += load<T, Swap, true>(data + i * sizeof(T));
+      }
+      total = sum_lanes(sums);
+    }
+#endif
+    for (; i < count; i++) {
+      total += load<T, Swap>(data + i * sizeof(T));
+    }
+    return total;
+  }
+}
+
+template <typename T, op_e Op, bool Swap>
+SKIFF_VECTOR_TARGET uint64_t run_extreme(const uint8_t *data,
+                                         const uint64_t count)
+{
+  T best = load<T, Swap>(data);
+  uint64_t i{1};
+#if SKIFF_VECTOR_BYTES
+  constexpr uint64_t width = lanes_per_vector<T>;
+  if (count >= width) {
+    auto bests = load<T, Swap, true>(data);
+    for (i = width; i + width <= count; i += width) {
+      bests = compute<Op>(bests, load<T, Swap, true>(data + i * sizeof(T)));
+    }
+    best = bests[0];
+    for (uint64_t lane = 1; lane < width; lane++) {
+      best = compute<Op>(best, static_cast<T>(bests[lane]));
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    best = compute<Op>(best, load<T, Swap>(data + i * sizeof(T)));
+  }
+  if constexpr (std::is_same_v<T, double>) {
+    return cast_bits<uint64_t>(best);
+  }
+  else {
+    return best;
+  }
+}
+
+template <typename T, reduction_e Reduction, bool Swap>
+SKIFF_VECTOR_TARGET uint64_t run_reduction(const uint8_t *data,
+                                           const uint64_t count)
+{
+  if constexpr (Reduction == reduction_e::SUM) {
+    return run_sum<T, Swap>(data, count);
+  }
+  else if constexpr (Reduction == reduction_e::MIN) {
+    return run_extreme<T, op_e::MIN, Swap>(data, count);
+  }
+  else {
+    return run_extreme<T, op_e::MAX, Swap>(data, count);
+  }
+}
+
+template <typename T, bool Swap>
+SKIFF_VECTOR_TARGET uint64_t run_dot(const uint8_t *lhs, const uint8_t *rhs,
+                                     const uint64_t count)
+{
+  if constexpr (std::is_same_v<T, double>) {
+    return run_f64_sum<Swap, true>(lhs, rhs, count);
+  }
+  else {
+    uint64_t total{0};
+    uint64_t i{0};
+#if SKIFF_VECTOR_BYTES
+    constexpr uint64_t width = lanes_per_vector<T>;
+    if constexpr (sizeof(T) == 1) {
+      // Each 32 bit lane adds the products of four bytes, and is emptied
+      // before it can overflow
+      using quads_t = simd_t<uint32_t>;
+      while (i + width <= count) {
+        quads_t sums{};
+        for (unsigned n = 0; n < 16384 && i + width <= count;
+             n++, i += width) {
+          const auto a = cast_bits<quads_t>(load<T, Swap, true>(lhs + i));
+          const auto b = cast_bits<quads_t>(load<T, Swap, true>(rhs + i));
+          sums += (a & 0xFF) * (b & 0xFF) +
+                  ((a >> 8) & 0xFF) * ((b >> 8) & 0xFF) +
+                  ((a >> 16) & 0xFF) * ((b >> 16) & 0xFF) +
+                  (a >> 24) * (b >> 24);
+        }
+        total += sum_lanes(sums);
+      }
+    }
+    else if constexpr (sizeof(T) == 4) {
+      using pairs_t = simd_t<uint64_t>;
+      pairs_t sums{};
+      for (; i + width <= count; i += width) {
+        const auto offset = i * sizeof(T);
+        const auto a = cast_bits<pairs_t>(load<T, Swap, true>(lhs + offset));
+        const auto b = cast_bits<pairs_t>(load<T, Swap, true>(rhs + offset));
+        sums += (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF) + (a >> 32) * (b >> 32);
+      }
+      total = sum_lanes(sums);
+    }
+    else {
+      simd_t<T> sums{};
+      for (; i + width <= count; i += width) {
+        const auto offset = i * sizeof(T);
+        sums += load<T, Swap, true>(lhs + offset) *
+                load<T, Swap, true>(rhs + offset);
+      }
+      total = sum_lanes(sums);
+    }
+#endif
+    for (; i < count; i++) {
+      const auto offset = i * sizeof(T);
+      total += static_cast<uint64_t>(load<T, Swap>(lhs + offset)) *
+               static_cast<uint64_t>(load<T, Swap>(rhs + offset));
+    }
+    return total;
+  }
+}
+
+template <typename T, bool Swap>
+void add_lane_kernels(kernels_t &kernels, const lane_e lane)
+{
+  const auto l = static_cast<std::size_t>(lane);
+  auto &elementwise = kernels.elementwise;
+  elementwise[static_cast<std::size_t>(op_e::ADD)][l][Swap] =
+      &run_elementwise<T, op_e::ADD, Swap>;
+  elementwise[static_cast<std::size_t>(op_e::SUB)][l][Swap] =
+      &run_elementwise<T, op_e::SUB, Swap>;
+  elementwise[static_cast<std::size_t>(op_e::MUL)][l][Swap] =
+      &run_elementwise<T, op_e::MUL, Swap>;
+  elementwise[static_cast<std::size_t>(op_e::MIN)][l][Swap] =
+      &run_elementwise<T, op_e::MIN, Swap>;
+  elementwise[static_cast<std::size_t>(op_e::MAX)][l][Swap] =
+      &run_elementwise<T, op_e::MAX, Swap>;
+
+  auto &reduction = kernels.reduction;
+  reduction[static_cast<std::size_t>(reduction_e::SUM)][l][Swap] =
+      &run_reduction<T, reduction_e::SUM, Swap>;
+  reduction[static_cast<std::size_t>(reduction_e::MIN)][l][Swap] =
+      &run_reduction<T, reduction_e::MIN, Swap>;
+  reduction[static_cast<std::size_t>(reduction_e::MAX)][l][Swap] =
+      &run_reduction<T, reduction_e::MAX, Swap>;
+
+  kernels.dot[l][Swap] = &run_dot<T, Swap>;
+}
+
+kernels_t make_kernels(const isa_e isa, const char *name)
+{
+  kernels_t kernels{isa, name};
+  add_lane_kernels<uint8_t, false>(kernels, lane_e::U8);
+  add_lane_kernels<uint8_t, true>(kernels, lane_e::U8);
+  add_lane_kernels<uint32_t, false>(kernels, lane_e::U32);
+  add_lane_kernels<uint32_t, true>(kernels, lane_e::U32);
+  add_lane_kernels<uint64_t, false>(kernels, lane_e::U64);
+  add_lane_kernels<uint64_t, true>(kernels, lane_e::U64);
+  add_lane_kernels<double, false>(kernels, lane_e::F64);
+  add_lane_kernels<double, true>(kernels, lane_e::F64);
+  return kernels;
+}
+
+} // namespace
+} // namespace vector
+} // namespace machine
+} // namespace skiff
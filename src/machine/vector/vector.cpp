@@ -0,0 +1,210 @@
+#include "machine/vector/vector.hpp"
+#include "machine/vector/kernels.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#define SKIFF_VECTOR_BYTES 0
+#define SKIFF_VECTOR_TARGET
+#include "machine/vector/kernels_impl.hpp"
+
+namespace skiff {
+namespace machine {
+namespace vector {
+
+namespace {
+
+// Lanes stored in this order have to be swapped before the host can use them
+bool is_swapped(const memory::byte_order_e order)
+{
+  return order == memory::byte_order_e::BIG &&
+         std::endian::native == std::endian::little;
+}
+
+// Number of bytes in `count` lanes, if it can be represented
+std::tuple<bool, uint64_t> get_length(const lane_e lane, const uint64_t count)
+{
+  const uint64_t lane_bytes = instructions::get_vector_lane_bytes(lane);
+  if (count > std::numeric_limits<uint64_t>::max() / lane_bytes) {
+    return {false, 0};
+  }
+  return {true, count * lane_bytes};
+}
+
+// Check if two ranges share some, but not all, of their bytes
+bool partially_overlap(const uint8_t *lhs, const uint8_t *rhs,
+                       const uint64_t length)
+{
+  const auto a = reinterpret_cast<std::uintptr_t>(lhs);
+  const auto b = reinterpret_cast<std::uintptr_t>(rhs);
+  return a != b && a < b + length && b < a + length;
+}
+
+// Copy lanes out of the way, swapping their bytes if asked to
+const uint8_t *copy_lanes(std::vector<uint8_t> &copy, const uint8_t *data,
+                          const uint64_t length, const lane_e lane,
+                          const bool swap)
+{
+  copy.assign(data, data + length);
+  if (swap) {
+    const auto lane_bytes = instructions::get_vector_lane_bytes(lane);
+    for (auto i = copy.begin(); i != copy.end(); i += lane_bytes) {
+      std::reverse(i, i + lane_bytes);
+    }
+  }
+  return copy.data();
+}
+
+} // namespace
+
+const kernels_t &get_scalar_kernels()
+{
+  static const kernels_t kernels = make_kernels(isa_e::SCALAR, "scalar");
+  return kernels;
+}
+
+const kernels_t *get_kernels(const isa_e isa)
+{
+  switch (isa) {
+  case isa_e::SCALAR:
+    return &get_scalar_kernels();
+  case isa_e::SIMD128:
+#ifdef SKIFF_VECTOR_HAS_SIMD128
+    return &get_simd128_kernels();
+#else
+    return nullptr;
+#endif
+  case isa_e::AVX2:
+#ifdef SKIFF_VECTOR_HAS_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      return &get_avx2_kernels();
+    }
+#endif
+    return nullptr;
+  }
+  return nullptr;
+}
+
+const kernels_t &get_kernels()
+{
+  static const kernels_t &kernels = []() -> const kernels_t & {
+    for (auto isa : {isa_e::AVX2, isa_e::SIMD128}) {
+      if (auto kernels = get_kernels(isa)) {
+        return *kernels;
+      }
+    }
+    return get_scalar_kernels();
+  }();
+  return kernels;
+}
+
+/*
+    The kernels work on lanes stored in the order of the destination. A
+    source stored in the other order is copied and swapped first, as is one
+    that the results would overwrite before all of it had been read.
+*/
+bool apply(const op_e op, const lane_e lane, memory::memory_c &dest,
+           const uint64_t dest_index, const memory::memory_c &lhs,
+           const uint64_t lhs_index, const memory::memory_c &rhs,
+           const uint64_t rhs_index, const uint64_t count,
+           const kernels_t &kernels)
+{
+  auto [okay, length] = get_length(lane, count);
+  if (!okay) {
+    return false;
+  }
+
+  auto to = dest.get_range(dest_index, length);
+  auto first = lhs.get_range(lhs_index, length);
+  auto second = rhs.get_range(rhs_index, length);
+  if (!to || !first || !second) {
+    return false;
+  }
+  if (!count) {
+    return true;
+  }
+
+  const bool swap = is_swapped(dest.get_byte_order());
+
+  std::vector<uint8_t> first_copy;
+  const bool first_swap = is_swapped(lhs.get_byte_order()) != swap;
+  if (first_swap || partially_overlap(to, first, length)) {
+    first = copy_lanes(first_copy, first, length, lane, first_swap);
+  }
+
+  std::vector<uint8_t> second_copy;
+  const bool second_swap = is_swapped(rhs.get_byte_order()) != swap;
+  if (second_swap || partially_overlap(to, second, length)) {
+    second = copy_lanes(second_copy, second, length, lane, second_swap);
+  }
+
+  kernels.elementwise[static_cast<std::size_t>(op)]
+                     [static_cast<std::size_t>(lane)][swap](to, first, second,
+                                                            count);
+  return true;
+}
+
+std::tuple<bool, uint64_t> reduce(const reduction_e reduction,
+                                  const lane_e lane,
+                                  const memory::memory_c &memory,
+                                  const uint64_t index, const uint64_t count,
+                                  const kernels_t &kernels)
+{
+  auto [okay, length] = get_length(lane, count);
+  if (!okay) {
+    return {false, 0};
+  }
+
+  auto data = memory.get_range(index, length);
+  if (!data) {
+    return {false, 0};
+  }
+  if (!count) {
+    // There is no smallest or largest of nothing
+    return {reduction == reduction_e::SUM, 0};
+  }
+
+  const bool swap = is_swapped(memory.get_byte_order());
+  return {true, kernels.reduction[static_cast<std::size_t>(reduction)]
+                                 [static_cast<std::size_t>(lane)][swap](
+                                     data, count)};
+}
+
+std::tuple<bool, uint64_t> dot(const lane_e lane, const memory::memory_c &lhs,
+                               const uint64_t lhs_index,
+                               const memory::memory_c &rhs,
+                               const uint64_t rhs_index, const uint64_t count,
+                               const kernels_t &kernels)
+{
+  auto [okay, length] = get_length(lane, count);
+  if (!okay) {
+    return {false, 0};
+  }
+
+  auto first = lhs.get_range(lhs_index, length);
+  auto second = rhs.get_range(rhs_index, length);
+  if (!first || !second) {
+    return {false, 0};
+  }
+  if (!count) {
+    return {true, 0};
+  }
+
+  const bool swap = is_swapped(lhs.get_byte_order());
+
+  std::vector<uint8_t> second_copy;
+  if (is_swapped(rhs.get_byte_order()) != swap) {
+    second = copy_lanes(second_copy, second, length, lane, true);
+  }
+
+  return {true, kernels.dot[static_cast<std::size_t>(lane)][swap](
+                    first, second, count)};
+}
+
+} // namespace vector
+} // namespace machine
+} // namespace skiff
@@ -0,0 +1,106 @@
+#ifndef SKIFF_VECTOR_HPP
+#define SKIFF_VECTOR_HPP
+
+#include "instructions.hpp"
+#include "machine/memory/memory.hpp"
+
+#include <array>
+#include <cstdint>
+#include <tuple>
+
+namespace skiff {
+namespace machine {
+namespace vector {
+
+using lane_e = skiff::instructions::vector_lane_e;
+using op_e = skiff::instructions::vector_op_e;
+using reduction_e = skiff::instructions::vector_reduction_e;
+
+//! \brief Instruction sets that kernels are built for
+enum class isa_e {
+  SCALAR,  //! One lane at a time, available everywhere
+  SIMD128, //! 128 bit vectors, SSE2 on x86-64
+  AVX2     //! 256 bit vectors
+};
+
+//! \brief Apply an operation to `count` lanes of `lhs` and `rhs`
+using elementwise_kernel_t = void (*)(uint8_t *dest, const uint8_t *lhs,
+                                      const uint8_t *rhs, uint64_t count);
+
+//! \brief Combine `count` lanes, count must not be 0
+using reduction_kernel_t = uint64_t (*)(const uint8_t *data, uint64_t count);
+
+//! \brief Sum the products of `count` lanes of `lhs` and `rhs`
+using dot_kernel_t = uint64_t (*)(const uint8_t *lhs, const uint8_t *rhs,
+                                  uint64_t count);
+
+//! \brief Every kernel built for an instruction set
+//! \note  Each is indexed by operation, then lane type, then whether the
+//!        lanes are stored byte swapped relative to the host
+struct kernels_t {
+  isa_e isa{isa_e::SCALAR};
+  const char *name{nullptr};
+  std::array<std::array<std::array<elementwise_kernel_t, 2>,
+                        instructions::num_vector_lanes>,
+             instructions::num_vector_ops>
+      elementwise{};
+  std::array<std::array<std::array<reduction_kernel_t, 2>,
+                        instructions::num_vector_lanes>,
+             instructions::num_vector_reductions>
+      reduction{};
+  std::array<std::array<dot_kernel_t, 2>, instructions::num_vector_lanes>
+      dot{};
+};
+
+//! \brief Retrieve the kernels built for an instruction set
+//! \returns nullptr if the build or the host doesn't support it
+[[nodiscard]] extern const kernels_t *get_kernels(const isa_e isa);
+
+//! \brief Retrieve the fastest kernels the host supports
+//! \note  Chosen once, on first use
+[[nodiscard]] extern const kernels_t &get_kernels();
+
+//! \brief Apply an operation to each lane of two ranges
+//! \param dest Memory to write the results to
+//! \param dest_index Location in `dest` of the first result
+//! \param lhs Memory holding the left hand lanes
+//! \param lhs_index Location in `lhs` of the first lane
+//! \param rhs Memory holding the right hand lanes
+//! \param rhs_index Location in `rhs` of the first lane
+//! \param count Number of lanes
+//! \returns true iff every range lies within its memory
+//! \note  Integer lanes wrap. Every lane is read before any result is
+//!        written, so the ranges may overlap
+[[nodiscard]] extern bool
+apply(const op_e op, const lane_e lane, memory::memory_c &dest,
+      const uint64_t dest_index, const memory::memory_c &lhs,
+      const uint64_t lhs_index, const memory::memory_c &rhs,
+      const uint64_t rhs_index, const uint64_t count,
+      const kernels_t &kernels = get_kernels());
+
+//! \brief Combine every lane of a range
+//! \returns Tuple with a success flag and the result. The flag is false if
+//!          the range doesn't lie within the memory, or is empty when
+//!          looking for the minimum or maximum
+//! \note  Integer sums are taken modulo 2^64. Floating point results are
+//!        returned as the bits of the double
+[[nodiscard]] extern std::tuple<bool, uint64_t>
+reduce(const reduction_e reduction, const lane_e lane,
+       const memory::memory_c &memory, const uint64_t index,
+       const uint64_t count, const kernels_t &kernels = get_kernels());
+
+//! \brief Sum the products of each lane of two ranges
+//! \returns Tuple with a success flag and the result. The flag is false if
+//!          either range doesn't lie within its memory
+//! \note  Integer products and sums are taken modulo 2^64. Floating point
+//!        results are returned as the bits of the double
+[[nodiscard]] extern std::tuple<bool, uint64_t>
+dot(const lane_e lane, const memory::memory_c &lhs, const uint64_t lhs_index,
+    const memory::memory_c &rhs, const uint64_t rhs_index,
+    const uint64_t count, const kernels_t &kernels = get_kernels());
+
+} // namespace vector
+} // namespace machine
+} // namespace skiff
+
+#endif
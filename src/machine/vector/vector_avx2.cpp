@@ -0,0 +1,24 @@
+#include "machine/vector/kernels.hpp"
+
+#ifdef SKIFF_VECTOR_HAS_AVX2
+
+// Only the kernels are built for AVX2, so the table can be built anywhere
+#define SKIFF_VECTOR_BYTES 32
+#define SKIFF_VECTOR_TARGET __attribute__((target("avx2")))
+#include "machine/vector/kernels_impl.hpp"
+
+namespace skiff {
+namespace machine {
+namespace vector {
+
+const kernels_t &get_avx2_kernels()
+{
+  static const kernels_t kernels = make_kernels(isa_e::AVX2, "avx2");
+  return kernels;
+}
+
+} // namespace vector
+} // namespace machine
+} // namespace skiff
+
+#endif
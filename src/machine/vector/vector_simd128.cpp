@@ -0,0 +1,23 @@
+#include "machine/vector/kernels.hpp"
+
+#ifdef SKIFF_VECTOR_HAS_SIMD128
+
+#define SKIFF_VECTOR_BYTES 16
+#define SKIFF_VECTOR_TARGET
+#include "machine/vector/kernels_impl.hpp"
+
+namespace skiff {
+namespace machine {
+namespace vector {
+
+const kernels_t &get_simd128_kernels()
+{
+  static const kernels_t kernels = make_kernels(isa_e::SIMD128, "simd128");
+  return kernels;
+}
+
+} // namespace vector
+} // namespace machine
+} // namespace skiff
+
+#endif
@@ -4,31 +4,28 @@
 #include <libskiff/version.hpp>
 
 #include "defines.hpp"
+#include "instructions.hpp"
 #include "logging/aixlog.hpp"
 #include "machine/system/callable.hpp"
 #include "machine/system/io_disk.hpp"
 #include "machine/system/io_user.hpp"
 #include "machine/system/timer.hpp"
+#include "machine/vector/vector.hpp"
 #include "machine/vm.hpp"
 #include "types.hpp"
 
+#include <array>
+#include <bit>
 #include <chrono>
 #include <iostream>
 
 namespace skiff {
 namespace machine {
 
-namespace {
-static inline void force_debug(const std::string &msg)
-{
-  std::cout << TERM_COLOR_CYAN << "[DEBUG] : " << TERM_COLOR_END << msg
-            << std::endl;
-}
-} // namespace
-
 vm_c::vm_c()
 {
   LOG(TRACE) << TAG("func") << __func__ << "\n";
+  _x1 = 1;
   _stack.set_sp(_sp);
 
   //  Setup system calls
@@ -45,6 +42,12 @@ vm_c::vm_c()
 
 vm_c::~vm_c() {}
 
+// Force debug message to screen
+void vm_c::issue_forced_debug(const std::string &msg)
+{
+  std::cout << TERM_COLOR_CYAN << "[DEBUG] : " << TERM_COLOR_END << msg
+            << std::endl;
+}
 // Force warning to screen and logger
 void vm_c::issue_forced_warning(const std::string &warn)
 {
@@ -66,17 +69,52 @@ void vm_c::set_runtime_callback(skiff::types::runtime_error_cb cb)
   _runtime_error_cb = {cb};
 }
 
+void vm_c::set_engine(const engine_e engine)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+  _engine = engine;
+}
+
+vm_c::engine_e vm_c::get_engine() const { return _engine; }
+
+void vm_c::set_byte_order(const memory::byte_order_e order)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+  _byte_order = order;
+}
+
+bool vm_c::set_allocator_settings(
+    const memory::slab_allocator_c::settings_t &settings)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+  return _memman.set_allocator_settings(settings);
+}
+
+void vm_c::set_memory_limit(const uint64_t bytes)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+  _memman.set_limit(bytes);
+}
+
+bool vm_c::set_stack_size(const uint64_t bytes)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+  return _stack.set_max_bytes(bytes);
+}
+
+bool vm_c::set_call_depth(const uint64_t depth)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+  return _call_stack.set_max_depth(depth);
+}
+
 bool vm_c::interrupt(const uint64_t id)
 {
-  // Lock the interrupt mutex and check to see if interrupts are enabled or not
-  {
-    const std::lock_guard<std::mutex> lock(_interrupt_mutex);
-    if (!_interrupts_enabled) {
-      return false;
-    }
+  if (!_interrupts_enabled.load(std::memory_order_acquire)) {
+    return false;
   }
 
-  if (_interrupt_id_to_address.find(id) == _interrupt_id_to_address.end()) {
+  if (!_program || !_program->get_interrupt_table().contains(id)) {
     LOG(FATAL) << TAG("vm") << "Interrupt requested for id " << id
                << ", but that interrupt does not exist"
                << "\n";
@@ -85,25 +123,40 @@ bool vm_c::interrupt(const uint64_t id)
     return true;
   }
 
-  //  Using the execution mutex we inject a call instruction
-  //  that will change the instruction pointer
-  //  to the location of the location of the given interrupt
-  {
-    const std::lock_guard<std::mutex> lock(_execution_mutex);
+  //  Hand the id to the executing thread which will inject the call
+  //  between instructions
+  _pending_interrupts.push(id);
+  return true;
+}
+
+void vm_c::accept_interrupts()
+{
+  _pending_interrupts.drain([this](const uint64_t id) {
+    // Once one interrupt has killed the machine the rest are dropped
+    if (!_is_alive) {
+      return;
+    }
 
-    // similar to a call instruction we add the curernt ip to call stack
-    // we do this instead of next ip as the lock ensures we fall in here between
-    // instructions, which means the current ip has not yet been executed
-    _call_stack.push(_ip);
+    // similar to a call instruction we add the current ip to call stack
+    // we do this instead of next ip as we are called between instructions,
+    // which means the current ip has not yet been executed
+    if (!_call_stack.push(_ip)) {
+      kill_with_error(skiff::types::runtime_error_e::CALL_STACK_OVERFLOW,
+                      "Interrupt taken with full callstack");
+      return;
+    }
 
     // and then update the instruction pointer
-    _ip = _interrupt_id_to_address[id];
+    _ip = _program->get_interrupt_table().at(id);
+
+    if (_profiler) {
+      _profiler->call(_ip);
+    }
 
 #ifdef SKIFF_GENERATE_STATS
     _runtime_data.interrupts_accepted++;
 #endif
-  }
-  return true;
+  });
 }
 
 void vm_c::display_runtime_statistics()
@@ -117,6 +170,78 @@ void vm_c::display_runtime_statistics()
             << "ms" << std::endl;
   std::cout << TERM_COLOR_YELLOW << "Instructions loaded   : " << TERM_COLOR_END
             << _runtime_data.instructions_loaded << std::endl;
+  std::cout << TERM_COLOR_YELLOW << "Engine                : " << TERM_COLOR_END
+            << (_profiler                     ? "visitor (profiling)"
+                : _engine == engine_e::THREADED ? "threaded"
+                : _engine == engine_e::TIERED   ? "tiered"
+                : _engine == engine_e::NATIVE   ? "native"
+                                                : "visitor")
+            << std::endl;
+  std::cout << TERM_COLOR_YELLOW << "Memory byte order     : " << TERM_COLOR_END
+            << (_byte_order == memory::byte_order_e::NATIVE ? "native" : "big")
+            << std::endl;
+  std::cout << TERM_COLOR_YELLOW << "Vector kernels        : " << TERM_COLOR_END
+            << vector::get_kernels().name << std::endl;
+  std::cout << TERM_COLOR_YELLOW << "Program verified      : " << TERM_COLOR_END
+            << ((_program && _program->is_verified()) ? "yes" : "no")
+            << std::endl;
+  if (_program && !_profiler && _engine != engine_e::VISITOR) {
+    uint64_t fused{0};
+    std::string kinds;
+    for (auto &[opcode, count] : _program->get_superinstruction_counts()) {
+      fused += count;
+      kinds += std::string(kinds.empty() ? "" : ", ") +
+               get_opcode_name(opcode) + " " + std::to_string(count);
+    }
+    std::cout << TERM_COLOR_YELLOW << "Superinstructions     : "
+              << TERM_COLOR_END << fused;
+    if (fused) {
+      std::cout << " (" << kinds << ")";
+    }
+    std::cout << std::endl;
+  }
+  {
+    auto memory = _memman.get_allocator_stats();
+    std::cout << TERM_COLOR_YELLOW << "Allocator blocks      : "
+              << TERM_COLOR_END << memory.allocations << " (peak "
+              << memory.peak_bytes_in_use << " bytes, " << memory.slabs
+              << " slabs)" << std::endl;
+
+    auto usage = _memman.get_usage();
+    const auto limit = _memman.get_limit();
+    std::cout << TERM_COLOR_YELLOW << "Slot bytes            : "
+              << TERM_COLOR_END << usage.live_bytes << " live (peak "
+              << usage.peak_bytes << ", limit "
+              << (limit ? std::to_string(limit) : "none") << ")" << std::endl;
+    std::cout << TERM_COLOR_YELLOW << "Slot allocations      : "
+              << TERM_COLOR_END << usage.allocations << " (" << usage.frees
+              << " freed, " << usage.reallocations << " resized, "
+              << usage.refused << " refused)" << std::endl;
+
+    // Only sizes that were allocated, by the power of two they fall under
+    std::string sizes;
+    for (std::size_t i = 0; i < usage.size_histogram.size(); i++) {
+      if (usage.size_histogram[i]) {
+        sizes += std::string(sizes.empty() ? "" : ", ") + "<2^" +
+                 std::to_string(i) + " " +
+                 std::to_string(usage.size_histogram[i]);
+      }
+    }
+    std::cout << TERM_COLOR_YELLOW << "Slot sizes            : "
+              << TERM_COLOR_END << (sizes.empty() ? "none" : sizes)
+              << std::endl;
+  }
+  std::cout << TERM_COLOR_YELLOW << "Stack committed       : " << TERM_COLOR_END
+            << _stack.get_committed_bytes() << " of "
+            << _stack.get_max_bytes() << " bytes" << std::endl;
+  std::cout << TERM_COLOR_YELLOW << "Deepest call          : " << TERM_COLOR_END
+            << _call_stack.get_peak_depth() << " of "
+            << _call_stack.get_max_depth() << std::endl;
+  if (_jit) {
+    std::cout << TERM_COLOR_YELLOW << "Regions compiled      : "
+              << TERM_COLOR_END << _jit->get_num_regions() << " ("
+              << _jit->get_code_size() << " bytes)" << std::endl;
+  }
 
 #ifdef SKIFF_GENERATE_STATS
   std::cout << TERM_COLOR_YELLOW << "Instructions executed : " << TERM_COLOR_END
@@ -124,6 +249,8 @@ void vm_c::display_runtime_statistics()
             << " (may overflow uint64_t) " << std::endl;
   std::cout << TERM_COLOR_YELLOW << "Interrupts accepted   : " << TERM_COLOR_END
             << _runtime_data.interrupts_accepted << std::endl;
+  std::cout << TERM_COLOR_YELLOW << "Superinstructions run : " << TERM_COLOR_END
+            << _runtime_data.superinstructions_executed << std::endl;
 #else
   std::cout << TERM_COLOR_BRIGHT_RED << "Note: " << TERM_COLOR_END
             << "Some information gathering was disabled at compile time"
@@ -133,38 +260,158 @@ void vm_c::display_runtime_statistics()
             << TERM_COLOR_END << std::endl;
 }
 
+const vm_c::runtime_data_t &vm_c::get_runtime_data() const
+{
+  return _runtime_data;
+}
+
+memory::slab_allocator_c::stats_t vm_c::get_memory_stats()
+{
+  return _memman.get_allocator_stats();
+}
+
+void vm_c::set_native_module(std::shared_ptr<const aot_module_c> module)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+  _native_module = module;
+}
+
+void vm_c::set_profiler(std::shared_ptr<profiler_c> profiler)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+  _profiler = profiler;
+}
+
 std::pair<vm_c::execution_result_e, int> vm_c::execute()
+{
+  return execute(execution_limit_t{});
+}
+
+std::pair<vm_c::execution_result_e, int>
+vm_c::execute(const execution_limit_t &limit)
 {
   LOG(TRACE) << TAG("func") << __func__ << "\n";
-  _runtime_data.start = std::chrono::system_clock::now();
+
+  // Resumed runs keep their original start time
+  if (!_started) {
+    _runtime_data.start = std::chrono::system_clock::now();
+    _started = true;
+    if (_profiler && _program) {
+      _profiler->start(_program->get_num_instructions(), _ip);
+    }
+  }
+
+  bool yielded{false};
+  if (_profiler) {
+    // Only the visitor engine reports each instruction
+    if (_instructions.empty() && _program) {
+      _instructions =
+          raise_to_visitable(_program->get_instructions(), _registers);
+    }
+    yielded = execute_visitor(limit);
+    _profiler->pause();
+  }
+  else {
+    switch (_engine) {
+    case engine_e::THREADED:
+    case engine_e::TIERED:
+      yielded = execute_threaded(limit);
+      break;
+    case engine_e::NATIVE:
+      yielded = execute_native(limit);
+      break;
+    case engine_e::VISITOR:
+      yielded = execute_visitor(limit);
+      break;
+    }
+  }
+
+  if (yielded) {
+    return {execution_result_e::YIELDED, 0};
+  }
+
+  _runtime_data.end = std::chrono::system_clock::now();
+  // Return back with the return status and exit code
+  return {_return_value, _integer_registers[0]};
+}
+
+bool vm_c::execute_visitor(const execution_limit_t &limit)
+{
+  if (_program && _program->is_verified()) {
+    return run_visitor<true>(limit);
+  }
+  return run_visitor<false>(limit);
+}
+
+template <bool Verified>
+bool vm_c::run_visitor(const execution_limit_t &limit)
+{
+  uint64_t executed{0};
   while (_is_alive) {
 
-    // Ensure that the instruction pointer isn't wack
-    if (_ip > _instructions.size() || _ip < 0) {
-      std::string msg =
-          "Instruction pointer out of range : " + std::to_string(_ip);
-      kill_with_error(
-          skiff::types::runtime_error_e::INSTRUCTION_PTR_OUT_OF_RANGE, msg);
-      continue;
+    // Stop between instructions if this call has used up its limits
+    if (executed == limit.max_instructions) {
+      return true;
+    }
+    if (limit.deadline && executed && executed % deadline_check_interval == 0 &&
+        std::chrono::steady_clock::now() >= *limit.deadline) {
+      return true;
+    }
+    executed++;
+
+    // Take any interrupts submitted since the last instruction
+    if (_pending_interrupts.pending()) {
+      accept_interrupts();
+      if (!_is_alive) {
+        continue;
+      }
     }
 
-    // Update registers
-    _x0 = 0; // Constant 0
-    _x1 = 1; // Constant 1
+    // A verified program can neither leave its instructions nor write to
+    // the constant registers
+    if constexpr (!Verified) {
+      // Ensure that the instruction pointer isn't wack
+      if (_ip >= _instructions.size() || _ip < 0) {
+        std::string msg =
+            "Instruction pointer out of range : " + std::to_string(_ip);
+        kill_with_error(
+            skiff::types::runtime_error_e::INSTRUCTION_PTR_OUT_OF_RANGE, msg);
+        continue;
+      }
+
+      // Update registers
+      _x0 = 0; // Constant 0
+      _x1 = 1; // Constant 1
+    }
 
     // Execute the instruction
-    {
-      const std::lock_guard<std::mutex> lock(_execution_mutex);
+    if (_profiler) {
+      execute_profiled();
+    }
+    else {
       _instructions[_ip]->visit(*this);
     }
 #ifdef SKIFF_GENERATE_STATS
     _runtime_data.instructions_executed++;
 #endif
   }
+  return false;
+}
 
-  _runtime_data.end = std::chrono::system_clock::now();
-  // Return back with the return status and exit code
-  return {_return_value, _integer_registers[0]};
+void vm_c::execute_profiled()
+{
+  auto opcode = _program->get_instructions()[_ip].opcode;
+  _profiler->instruction(_ip, opcode);
+
+  _instructions[_ip]->visit(*this);
+
+  // Follow control into and out of routines for the call graph
+  if (opcode == threaded_opcode_e::CALL && _is_alive) {
+    _profiler->call(_ip);
+  }
+  else if (opcode == threaded_opcode_e::RET && _is_alive) {
+    _profiler->ret();
+  }
 }
 
 void vm_c::kill_with_error(const types::runtime_error_e err,
@@ -180,13 +427,48 @@ void vm_c::kill_with_error(const types::runtime_error_e err,
              << "\n";
 }
 
+void vm_c::display_debug(const uint64_t id)
+{
+  std::cout << TERM_COLOR_BRIGHT_YELLOW << "DEBUG INS:" << id << TERM_COLOR_END
+            << std::endl;
+
+  switch (_debug_level) {
+  case libskiff::types::exec_debug_level_e::NONE:
+    break;
+  case libskiff::types::exec_debug_level_e::MINIMAL:
+    std::cout << "ip | " << _ip << std::endl;
+    break;
+  case libskiff::types::exec_debug_level_e::EXTREME:
+    std::cout << "Integer Registers" << std::endl;
+    for (auto i = 0; i < config::num_integer_registers; i++) {
+      std::cout << "i" << i << " | " << _integer_registers[i] << std::endl;
+    }
+    std::cout << std::endl;
+    std::cout << "Float Registers" << std::endl;
+    for (auto i = 0; i < config::num_floating_point_registers; i++) {
+      std::cout << "f" << i << " | " << _floating_point_registers[i]
+                << std::endl;
+    }
+    std::cout << std::endl;
+  case libskiff::types::exec_debug_level_e::MODERATE:
+    std::cout << "System Registers" << std::endl;
+    std::cout << "x0 | " << _x0 << std::endl
+              << "x1 | " << _x1 << std::endl
+              << "sp | " << _sp << std::endl
+              << "ip | " << _ip << std::endl
+              << "op | " << _op_register << std::endl;
+    std::cout << std::endl;
+    break;
+  }
+}
+
 void vm_c::accept(instruction_nop_c &ins)
 {
   switch (_debug_level) {
   case libskiff::types::exec_debug_level_e::NONE:
     break;
   default:
-    force_debug("NOP Instruction @ IP = " + std::to_string(_ip));
+    issue_forced_debug("NOP Instruction @ IP = " + std::to_string(_ip));
     break;
   }
   _ip++;
@@ -198,7 +480,7 @@ void vm_c::accept(instruction_exit_c &ins)
   case libskiff::types::exec_debug_level_e::NONE:
     break;
   default:
-    force_debug("EXIT Instruction @ IP = " + std::to_string(_ip));
+    issue_forced_debug("EXIT Instruction @ IP = " + std::to_string(_ip));
     break;
   }
   _is_alive = false;
@@ -239,7 +521,11 @@ void vm_c::accept(instruction_jmp_c &ins) { _ip = ins.destination; }
 
 void vm_c::accept(instruction_call_c &ins)
 {
-  _call_stack.push(_ip + 1);
+  if (!_call_stack.push(_ip + 1)) {
+    kill_with_error(skiff::types::runtime_error_e::CALL_STACK_OVERFLOW,
+                    "`call` instruction hit with full callstack");
+    return;
+  }
   _ip = ins.destination;
 }
 
@@ -252,8 +538,7 @@ void vm_c::accept(instruction_ret_c &ins)
     return;
   }
 
-  _ip = _call_stack.top();
-  _call_stack.pop();
+  _ip = std::get<1>(_call_stack.pop());
 }
 
 void vm_c::accept(instruction_mov_c &ins)
@@ -528,6 +813,12 @@ void vm_c::accept(instruction_free_c &ins)
   _ip++;
 }
 
+void vm_c::accept(instruction_realloc_c &ins)
+{
+  _op_register = _memman.realloc(ins.idx, ins.size) ? 1 : 0;
+  _ip++;
+}
+
 void vm_c::accept(instruction_store_word_c &ins)
 {
   auto slot = _memman.get_slot(ins.idx);
@@ -676,6 +967,150 @@ void vm_c::accept(instruction_load_qword_c &ins)
   ins.dest = value;
 }
 
+void vm_c::accept(instruction_stack_store_word_c &ins)
+{
+  _op_register = _stack.store_word(ins.base + ins.offset, ins.data) ? 1 : 0;
+  _ip++;
+}
+
+void vm_c::accept(instruction_stack_store_dword_c &ins)
+{
+  _op_register = _stack.store_dword(ins.base + ins.offset, ins.data) ? 1 : 0;
+  _ip++;
+}
+
+void vm_c::accept(instruction_stack_store_qword_c &ins)
+{
+  _op_register = _stack.store_qword(ins.base + ins.offset, ins.data) ? 1 : 0;
+  _ip++;
+}
+
+void vm_c::accept(instruction_stack_load_word_c &ins)
+{
+  _ip++;
+  auto [okay, value] = _stack.load_word(ins.base + ins.offset);
+  if (!okay) {
+    _op_register = 0;
+    return;
+  }
+  _op_register = 1;
+  ins.dest = value;
+}
+
+void vm_c::accept(instruction_stack_load_dword_c &ins)
+{
+  _ip++;
+  auto [okay, value] = _stack.load_dword(ins.base + ins.offset);
+  if (!okay) {
+    _op_register = 0;
+    return;
+  }
+  _op_register = 1;
+  ins.dest = value;
+}
+
+void vm_c::accept(instruction_stack_load_qword_c &ins)
+{
+  _ip++;
+  auto [okay, value] = _stack.load_qword(ins.base + ins.offset);
+  if (!okay) {
+    _op_register = 0;
+    return;
+  }
+  _op_register = 1;
+  ins.dest = value;
+}
+
+void vm_c::accept(instruction_push_multiple_c &ins)
+{
+  if (!push_registers(ins.mask)) {
+    kill_with_error(skiff::types::runtime_error_e::STACK_PUSH_ERROR,
+                    "Unable to push data to stack. Out of memory?");
+  }
+  _ip++;
+}
+
+void vm_c::accept(instruction_pop_multiple_c &ins)
+{
+  if (!pop_registers(ins.mask)) {
+    kill_with_error(skiff::types::runtime_error_e::STACK_POP_ERROR,
+                    "Unable to pop data from stack. Stack empty?");
+  }
+  _ip++;
+}
+
+void vm_c::accept(instruction_addi_c &ins)
+{
+  ins.dest_reg = ins.lhs_reg + ins.value;
+  _ip++;
+}
+
+void vm_c::accept(instruction_subi_c &ins)
+{
+  ins.dest_reg = ins.lhs_reg - ins.value;
+  _ip++;
+}
+
+void vm_c::accept(instruction_muli_c &ins)
+{
+  ins.dest_reg = ins.lhs_reg * ins.value;
+  _ip++;
+}
+
+void vm_c::accept(instruction_lshi_c &ins)
+{
+  ins.dest_reg = ins.lhs_reg << ins.value;
+  _ip++;
+}
+
+void vm_c::accept(instruction_rshi_c &ins)
+{
+  ins.dest_reg = ins.lhs_reg >> ins.value;
+  _ip++;
+}
+
+void vm_c::accept(instruction_andi_c &ins)
+{
+  ins.dest_reg = ins.lhs_reg & ins.value;
+  _ip++;
+}
+
+void vm_c::accept(instruction_ori_c &ins)
+{
+  ins.dest_reg = ins.lhs_reg | ins.value;
+  _ip++;
+}
+
+void vm_c::accept(instruction_blti_c &ins)
+{
+  if (ins.lhs_reg < ins.value) {
+    _ip = ins.destination;
+  }
+  else {
+    _ip++;
+  }
+}
+
+void vm_c::accept(instruction_bgti_c &ins)
+{
+  if (ins.lhs_reg > ins.value) {
+    _ip = ins.destination;
+  }
+  else {
+    _ip++;
+  }
+}
+
+void vm_c::accept(instruction_beqi_c &ins)
+{
+  if (ins.lhs_reg == ins.value) {
+    _ip = ins.destination;
+  }
+  else {
+    _ip++;
+  }
+}
+
 void vm_c::accept(instruction_syscall_c &ins)
 {
   _ip++;
@@ -700,52 +1135,251 @@ void vm_c::accept(instruction_debug_c &ins)
 {
   _ip++;
 
-  std::cout << TERM_COLOR_BRIGHT_YELLOW << "DEBUG INS:" << ins.id
-            << TERM_COLOR_END << std::endl;
-
-  switch (_debug_level) {
-  case libskiff::types::exec_debug_level_e::NONE:
-    break;
-  case libskiff::types::exec_debug_level_e::MINIMAL:
-    std::cout << "ip | " << _ip << std::endl;
-    break;
-  case libskiff::types::exec_debug_level_e::EXTREME:
-    std::cout << "Integer Registers" << std::endl;
-    for (auto i = 0; i < config::num_integer_registers; i++) {
-      std::cout << "i" << i << " | " << _integer_registers[i] << std::endl;
-    }
-    std::cout << std::endl;
-    std::cout << "Float Registers" << std::endl;
-    for (auto i = 0; i < config::num_floating_point_registers; i++) {
-      std::cout << "f" << i << " | " << _floating_point_registers[i]
-                << std::endl;
-    }
-    std::cout << std::endl;
-  case libskiff::types::exec_debug_level_e::MODERATE:
-    std::cout << "System Registers" << std::endl;
-    std::cout << "x0 | " << _x0 << std::endl
-              << "x1 | " << _x1 << std::endl
-              << "sp | " << _sp << std::endl
-              << "ip | " << _ip << std::endl
-              << "op | " << _op_register << std::endl;
-    std::cout << std::endl;
-    break;
-  }
+  display_debug(ins.id);
 }
 
 void vm_c::accept(instruction_eirq_c &ins)
 {
-  const std::lock_guard<std::mutex> lock(_interrupt_mutex);
-  _interrupts_enabled = true;
+  _interrupts_enabled.store(true, std::memory_order_release);
   _ip++;
 }
 
 void vm_c::accept(instruction_dirq_c &ins)
 {
-  const std::lock_guard<std::mutex> lock(_interrupt_mutex);
-  _interrupts_enabled = false;
+  _interrupts_enabled.store(false, std::memory_order_release);
+  _ip++;
+}
+
+void vm_c::accept(instruction_region_begin_c &ins)
+{
+  auto [okay, value] = _memman.begin_region();
+  if (!okay) {
+    _op_register = 0;
+  }
+  else {
+    ins.dest = value;
+    _op_register = 1;
+  }
+  _ip++;
+}
+
+void vm_c::accept(instruction_region_free_c &ins)
+{
+  if (!_memman.free_region(ins.region)) {
+    _op_register = 0;
+  }
+  else {
+    _op_register = 1;
+  }
+  _ip++;
+}
+
+/*
+    Registers selected by a mask are pushed in order of their index, so
+    popping them with the same mask undoes the push. A run of registers is
+    already laid out in that order in the register file and goes to or from
+    the stack as it is, anything else is gathered first. Either way the
+    stack is checked once, and nothing changes if it can't take them all.
+*/
+bool vm_c::push_registers(const uint64_t mask)
+{
+  if (!mask) {
+    return true;
+  }
+  const auto first = static_cast<std::size_t>(std::countr_zero(mask));
+  const auto count = static_cast<std::size_t>(std::popcount(mask));
+  if ((mask >> first) == (uint64_t{1} << count) - 1) {
+    return _stack.push_qwords(
+        {_registers.data() + types::reg::i0 + first, count});
+  }
+
+  std::array<types::vm_register, skiff::instructions::num_mask_registers>
+      values;
+  std::size_t n{0};
+  for (auto bits = mask; bits; bits &= bits - 1) {
+    values[n++] = _registers[types::reg::i0 + std::countr_zero(bits)];
+  }
+  return _stack.push_qwords({values.data(), n});
+}
+
+bool vm_c::pop_registers(const uint64_t mask)
+{
+  if (!mask) {
+    return true;
+  }
+  const auto first = static_cast<std::size_t>(std::countr_zero(mask));
+  const auto count = static_cast<std::size_t>(std::popcount(mask));
+  if ((mask >> first) == (uint64_t{1} << count) - 1) {
+    return _stack.pop_qwords(
+        {_registers.data() + types::reg::i0 + first, count});
+  }
+
+  std::array<types::vm_register, skiff::instructions::num_mask_registers>
+      values;
+  if (!_stack.pop_qwords({values.data(), count})) {
+    return false;
+  }
+  std::size_t n{0};
+  for (auto bits = mask; bits; bits &= bits - 1) {
+    _registers[types::reg::i0 + std::countr_zero(bits)] = values[n++];
+  }
+  return true;
+}
+
+bool vm_c::memory_copy(const uint64_t dest, const uint64_t dest_offset,
+                       const uint64_t source, const uint64_t source_offset,
+                       const uint64_t length)
+{
+  auto to = _memman.get_slot(dest);
+  auto from = _memman.get_slot(source);
+  return to && from && to->copy(dest_offset, *from, source_offset, length);
+}
+
+bool vm_c::memory_fill(const uint64_t slot, const uint64_t offset,
+                       const uint64_t length, const uint8_t value)
+{
+  auto memory = _memman.get_slot(slot);
+  return memory && memory->fill(offset, length, value);
+}
+
+/*
+    Registers are unsigned, so rather than the sign memcmp gives the
+    comparison is reported as 0 when the ranges are equal, 1 when the first
+    orders before the second and 2 when it orders after
+*/
+std::tuple<bool, uint64_t>
+vm_c::memory_compare(const uint64_t lhs, const uint64_t lhs_offset,
+                     const uint64_t rhs, const uint64_t rhs_offset,
+                     const uint64_t length)
+{
+  auto first = _memman.get_slot(lhs);
+  auto second = _memman.get_slot(rhs);
+  if (!first || !second) {
+    return {false, 0};
+  }
+  auto [okay, order] = first->compare(lhs_offset, *second, rhs_offset, length);
+  if (!okay) {
+    return {false, 0};
+  }
+  return {true, order < 0 ? 1 : order > 0 ? 2 : 0};
+}
+
+void vm_c::accept(instruction_memory_copy_c &ins)
+{
+  _op_register = memory_copy(ins.dest, ins.dest_offset, ins.source,
+                             ins.source_offset, ins.length)
+                     ? 1
+                     : 0;
+  _ip++;
+}
+
+void vm_c::accept(instruction_memory_fill_c &ins)
+{
+  _op_register = memory_fill(ins.idx, ins.offset, ins.length,
+                             static_cast<uint8_t>(ins.value))
+                     ? 1
+                     : 0;
+  _ip++;
+}
+
+void vm_c::accept(instruction_memory_compare_c &ins)
+{
+  auto [okay, value] = memory_compare(ins.lhs, ins.lhs_offset, ins.rhs,
+                                      ins.rhs_offset, ins.length);
+  if (!okay) {
+    _op_register = 0;
+  }
+  else {
+    ins.dest = value;
+    _op_register = 1;
+  }
+  _ip++;
+}
+
+/*
+    The kind of a vector instruction was checked when the program was
+    decoded, so only the slots and ranges can be at fault here
+*/
+bool vm_c::vector_apply(const uint8_t kind, const uint64_t dest,
+                        const uint64_t dest_offset, const uint64_t lhs,
+                        const uint64_t lhs_offset, const uint64_t rhs,
+                        const uint64_t rhs_offset, const uint64_t count)
+{
+  auto [valid, op, lane] =
+      instructions::decode_vector_kind(kind, instructions::num_vector_ops);
+  auto to = _memman.get_slot(dest);
+  auto first = _memman.get_slot(lhs);
+  auto second = _memman.get_slot(rhs);
+  return valid && to && first && second &&
+         vector::apply(static_cast<vector::op_e>(op), lane, *to, dest_offset,
+                       *first, lhs_offset, *second, rhs_offset, count);
+}
+
+std::tuple<bool, uint64_t> vm_c::vector_reduce(const uint8_t kind,
+                                               const uint64_t slot,
+                                               const uint64_t offset,
+                                               const uint64_t count)
+{
+  auto [valid, reduction, lane] = instructions::decode_vector_kind(
+      kind, instructions::num_vector_reductions);
+  auto memory = _memman.get_slot(slot);
+  if (!valid || !memory) {
+    return {false, 0};
+  }
+  return vector::reduce(static_cast<vector::reduction_e>(reduction), lane,
+                        *memory, offset, count);
+}
+
+std::tuple<bool, uint64_t>
+vm_c::vector_dot(const uint8_t kind, const uint64_t lhs,
+                 const uint64_t lhs_offset, const uint64_t rhs,
+                 const uint64_t rhs_offset, const uint64_t count)
+{
+  auto [valid, unused, lane] = instructions::decode_vector_kind(kind, 1);
+  auto first = _memman.get_slot(lhs);
+  auto second = _memman.get_slot(rhs);
+  if (!valid || !first || !second) {
+    return {false, 0};
+  }
+  return vector::dot(lane, *first, lhs_offset, *second, rhs_offset, count);
+}
+
+void vm_c::accept(instruction_vector_c &ins)
+{
+  _op_register = vector_apply(ins.kind, ins.dest, ins.dest_offset, ins.lhs,
+                              ins.lhs_offset, ins.rhs, ins.rhs_offset,
+                              ins.count)
+                     ? 1
+                     : 0;
+  _ip++;
+}
+
+void vm_c::accept(instruction_vector_reduce_c &ins)
+{
+  auto [okay, value] = vector_reduce(ins.kind, ins.idx, ins.offset, ins.count);
+  if (!okay) {
+    _op_register = 0;
+  }
+  else {
+    ins.dest = value;
+    _op_register = 1;
+  }
+  _ip++;
+}
+
+void vm_c::accept(instruction_vector_dot_c &ins)
+{
+  auto [okay, value] = vector_dot(ins.kind, ins.lhs, ins.lhs_offset, ins.rhs,
+                                  ins.rhs_offset, ins.count);
+  if (!okay) {
+    _op_register = 0;
+  }
+  else {
+    ins.dest = value;
+    _op_register = 1;
+  }
   _ip++;
 }
 
 } // namespace machine
-} // namespace skiff
\ No newline at end of file
+} // namespace skiff
@@ -1,10 +1,17 @@
 #ifndef SKIFF_VM_HPP
 #define SKIFF_VM_HPP
 
+#include "machine/aot.hpp"
 #include "machine/execution_context.hpp"
+#include "machine/interrupt_queue.hpp"
+#include "machine/jit.hpp"
+#include "machine/memory/call_stack.hpp"
 #include "machine/memory/memman.hpp"
 #include "machine/memory/stack.hpp"
+#include "machine/profiler.hpp"
+#include "machine/program.hpp"
 #include "machine/system/callable.hpp"
+#include "machine/threaded.hpp"
 #include <libskiff/bytecode/executable.hpp>
 #include <libskiff/types.hpp>
 
@@ -12,11 +19,13 @@
 #include "types.hpp"
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <limits>
 #include <memory>
-#include <mutex>
 #include <optional>
 #include <queue>
-#include <stack>
+#include <span>
 #include <utility>
 #include <vector>
 
@@ -31,14 +40,32 @@ public:
     uint64_t instructions_executed{0};
     uint64_t instructions_loaded{0};
     uint64_t interrupts_accepted{0};
+    uint64_t superinstructions_executed{0};
     std::chrono::system_clock::time_point start;
     std::chrono::system_clock::time_point end;
   };
 
   //! \brief Result status of execution
   enum class execution_result_e {
-    OKAY, //! Execution finished with no errors
-    ERROR //! Execution finished due to an error
+    OKAY,   //! Execution finished with no errors
+    ERROR,  //! Execution finished due to an error
+    YIELDED //! Execution stopped at a limit and can be resumed
+  };
+
+  //! \brief Bounds on a single call to `execute`
+  struct execution_limit_t {
+    //! Maximum number of instructions to execute
+    uint64_t max_instructions{std::numeric_limits<uint64_t>::max()};
+    //! Point in time after which execution should yield
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+  };
+
+  //! \brief Method used to execute the loaded instructions
+  enum class engine_e {
+    THREADED, //! Lowered, direct-threaded dispatch (default)
+    VISITOR,  //! Reference engine visiting each decoded instruction
+    TIERED,   //! Threaded dispatch that compiles hot regions to native code
+    NATIVE    //! Ahead of time compiled module, see `set_native_module`
   };
 
   //! \brief Construct the VM
@@ -52,17 +79,84 @@ public:
   [[nodiscard]] bool
   load(std::unique_ptr<libskiff::bytecode::executable_c> executable);
 
+  //! \brief Load the VM with an already decoded program
+  //! \param program The program to run. It may be shared with other VMs
+  //! \returns True iff the VM can run the program
+  [[nodiscard]] bool load(std::shared_ptr<const program_c> program);
+
   //! \brief Set a callback to receive runtime errors
   //! \param cb The runtime callback
   //! \note There is only one callback stored. Calling this twice will
   //!       unset the first cb
   void set_runtime_callback(skiff::types::runtime_error_cb cb);
 
+  //! \brief Select the engine used to execute the binary
+  //! \param engine The engine to use
+  //! \note  Must be called prior to `load`. Binaries that the threaded engine
+  //!        can not run are executed by the visitor engine. The tiered engine
+  //!        falls back to the threaded engine when native code can not be
+  //!        generated for the host or the binary has debugging enabled.
+  //!        The native engine falls back to the threaded engine when no
+  //!        module built from the program has been given or the binary has
+  //!        debugging enabled
+  void set_engine(const engine_e engine);
+
+  //! \brief Retrieve the engine that will execute the loaded binary
+  [[nodiscard]] engine_e get_engine() const;
+
+  //! \brief Select the byte order of memory the binary allocates
+  //! \param order The order multi-byte values are stored in
+  //! \note  Must be called prior to `load`. Native order lets loads and
+  //!        stores skip swapping bytes, but changes what byte level access
+  //!        sees of wider values. Constants are always held big-endian as
+  //!        that is how the assembler encodes them
+  void set_byte_order(const memory::byte_order_e order);
+
+  //! \brief Select how slots too large for a slab are allocated
+  //! \param settings Mapping threshold, huge page and retention settings
+  //! \returns true iff the settings were applied
+  //! \note  Must be called prior to `load`
+  [[nodiscard]] bool set_allocator_settings(
+      const memory::slab_allocator_c::settings_t &settings);
+
+  //! \brief Limit the bytes the binary's slots may hold at once
+  //! \param bytes The limit, 0 for none
+  //! \note  Must be called prior to `load`, as the constants are held in a
+  //!        slot. Allocations past the limit fail, setting `op` to 0
+  void set_memory_limit(const uint64_t bytes);
+
+  //! \brief Set the most bytes the stack can grow to
+  //! \param bytes The size of the stack, its pages are only committed as
+  //!        the binary reaches them
+  //! \returns true iff the stack hadn't been used yet
+  //! \note  Must be called prior to `execute`
+  [[nodiscard]] bool set_stack_size(const uint64_t bytes);
+
+  //! \brief Set the deepest the binary's calls can nest
+  //! \param depth The most return addresses the call stack holds, a call
+  //!        past it stops the binary with a runtime error
+  //! \returns true iff the call stack hadn't been used yet
+  //! \note  Must be called prior to `execute`
+  [[nodiscard]] bool set_call_depth(const uint64_t depth);
+
   //! \brief Execute the loaded binary
   //! \returns Pair with execution status and
   //!          exit code generated by binary
   [[nodiscard]] std::pair<execution_result_e, int> execute();
 
+  //! \brief Execute the loaded binary until it finishes or a limit is hit
+  //! \param limit The instruction budget and / or deadline for this call
+  //! \returns Pair with execution status and exit code generated by binary.
+  //!          If a limit was hit the status is YIELDED and all state is kept
+  //!          so that calling `execute` again resumes where it stopped.
+  //! \note    Deadlines are checked every `deadline_check_interval`
+  //!          instructions, so a deadline may be overrun by that many
+  [[nodiscard]] std::pair<execution_result_e, int>
+  execute(const execution_limit_t &limit);
+
+  //! \brief Instructions executed between checks of an execution deadline
+  static constexpr uint64_t deadline_check_interval = 4096;
+
   //! \brief Retrieve a reference to the vm memory manager
   //! \returns Reference into the active memory manager
   [[nodiscard]] memory::memman_c &get_memory_ref();
@@ -70,45 +164,108 @@ public:
   //! \brief Submit an interrupt
   //! \returns true iff the interrupt could be submitted as
   //!          interrupts might be disabled
+  //! \note    Safe to call from any thread. The interrupt is queued and taken
+  //!          by the executing thread at its next instruction (visitor) or
+  //!          control transfer (threaded)
   [[nodiscard]] bool interrupt(const uint64_t id);
 
   //! \brief Dump runtime statistics to standard out (iff enabled)
   void display_runtime_statistics();
 
+  //! \brief Retrieve the data gathered about the runtime of the vm
+  [[nodiscard]] const runtime_data_t &get_runtime_data() const;
+
+  //! \brief Retrieve statistics about the memory allocated by the program
+  [[nodiscard]] memory::slab_allocator_c::stats_t get_memory_stats();
+
+  //! \brief Profile execution
+  //! \param profiler The profiler to record into, or nullptr to stop
+  //! \note  Profiling is done by the visitor engine, which is used in place
+  //!        of the threaded engine while a profiler is attached. Attach
+  //!        before the first call to `execute`
+  void set_profiler(std::shared_ptr<profiler_c> profiler);
+
+  //! \brief Provide the compiled module run by the native engine
+  //! \param module A module built from the program that will be loaded
+  //! \note  Must be called prior to `load`
+  void set_native_module(std::shared_ptr<const aot_module_c> module);
+
 private:
+  friend struct native_services_t;
+
   runtime_data_t _runtime_data;
 
   bool _is_alive{true};
+  bool _started{false};
   libskiff::types::exec_debug_level_e _debug_level{
       libskiff::types::exec_debug_level_e::NONE};
-  std::array<types::vm_register, config::num_integer_registers>
-      _integer_registers{};
-  std::array<types::vm_register, config::num_floating_point_registers>
-      _floating_point_registers{};
-  types::vm_register _x0{0};
-  types::vm_register _x1{1};
-  types::vm_register _ip{0};
-  types::vm_register _sp{0};
-  types::vm_register _op_register{0};
-  std::unordered_map<uint64_t, uint64_t> _interrupt_id_to_address;
-  bool _interrupts_enabled{true};
+  types::register_file_t _registers{};
+  std::span<types::vm_register, config::num_integer_registers>
+      _integer_registers{_registers.data() + types::reg::i0,
+                         config::num_integer_registers};
+  std::span<types::vm_register, config::num_floating_point_registers>
+      _floating_point_registers{_registers.data() + types::reg::f0,
+                                config::num_floating_point_registers};
+  types::vm_register &_x0{_registers[types::reg::x0]};
+  types::vm_register &_x1{_registers[types::reg::x1]};
+  types::vm_register &_ip{_registers[types::reg::ip]};
+  types::vm_register &_sp{_registers[types::reg::sp]};
+  types::vm_register &_op_register{_registers[types::reg::op]};
+  std::atomic<bool> _interrupts_enabled{true};
+  interrupt_queue_c _pending_interrupts;
   execution_result_e _return_value{execution_result_e::OKAY};
 
+  engine_e _engine{engine_e::THREADED};
+  memory::byte_order_e _byte_order{memory::byte_order_e::BIG};
+  std::shared_ptr<const program_c> _program;
   std::vector<std::unique_ptr<instruction_c>> _instructions;
-  std::stack<uint64_t> _call_stack;
+  std::shared_ptr<profiler_c> _profiler;
+  jit_c *_jit{nullptr};
+  std::vector<uint32_t> _hot_counts;
+  std::shared_ptr<const aot_module_c> _native_module;
+  memory::call_stack_c _call_stack;
   memory::stack_c _stack;
   memory::memman_c _memman;
 
   std::optional<skiff::types::runtime_error_cb> _runtime_error_cb;
   std::vector<std::unique_ptr<system::callable_if>> _system_callables;
-  std::mutex _interrupt_mutex;
-  std::mutex _execution_mutex;
 
-  types::vm_register *get_register(uint8_t id);
+  void accept_interrupts();
+  bool execute_visitor(const execution_limit_t &limit);
+  template <bool Verified> bool run_visitor(const execution_limit_t &limit);
+  void execute_profiled();
+  bool execute_threaded(const execution_limit_t &limit);
+  template <bool Verified> bool run_threaded(const execution_limit_t &limit);
+  bool execute_native(const execution_limit_t &limit);
+  void display_debug(const uint64_t id);
+  void issue_forced_debug(const std::string &msg);
   void issue_forced_error(const std::string &err);
   void issue_forced_warning(const std::string &err);
   void kill_with_error(const types::runtime_error_e err,
                        const std::string &err_str);
+  bool push_registers(const uint64_t mask);
+  bool pop_registers(const uint64_t mask);
+  bool memory_copy(const uint64_t dest, const uint64_t dest_offset,
+                   const uint64_t source, const uint64_t source_offset,
+                   const uint64_t length);
+  bool memory_fill(const uint64_t slot, const uint64_t offset,
+                   const uint64_t length, const uint8_t value);
+  std::tuple<bool, uint64_t>
+  memory_compare(const uint64_t lhs, const uint64_t lhs_offset,
+                 const uint64_t rhs, const uint64_t rhs_offset,
+                 const uint64_t length);
+  bool vector_apply(const uint8_t kind, const uint64_t dest,
+                    const uint64_t dest_offset, const uint64_t lhs,
+                    const uint64_t lhs_offset, const uint64_t rhs,
+                    const uint64_t rhs_offset, const uint64_t count);
+  std::tuple<bool, uint64_t> vector_reduce(const uint8_t kind,
+                                           const uint64_t slot,
+                                           const uint64_t offset,
+                                           const uint64_t count);
+  std::tuple<bool, uint64_t>
+  vector_dot(const uint8_t kind, const uint64_t lhs, const uint64_t lhs_offset,
+             const uint64_t rhs, const uint64_t rhs_offset,
+             const uint64_t count);
   virtual void accept(instruction_nop_c &ins) override;
   virtual void accept(instruction_exit_c &ins) override;
   virtual void accept(instruction_blt_c &ins) override;
@@ -147,6 +304,7 @@ private:
   virtual void accept(instruction_pop_qw_c &ins) override;
   virtual void accept(instruction_alloc_c &ins) override;
   virtual void accept(instruction_free_c &ins) override;
+  virtual void accept(instruction_realloc_c &ins) override;
   virtual void accept(instruction_store_word_c &ins) override;
   virtual void accept(instruction_store_hword_c &ins) override;
   virtual void accept(instruction_store_dword_c &ins) override;
@@ -155,10 +313,36 @@ private:
   virtual void accept(instruction_load_hword_c &ins) override;
   virtual void accept(instruction_load_dword_c &ins) override;
   virtual void accept(instruction_load_qword_c &ins) override;
+  virtual void accept(instruction_stack_store_word_c &ins) override;
+  virtual void accept(instruction_stack_store_dword_c &ins) override;
+  virtual void accept(instruction_stack_store_qword_c &ins) override;
+  virtual void accept(instruction_stack_load_word_c &ins) override;
+  virtual void accept(instruction_stack_load_dword_c &ins) override;
+  virtual void accept(instruction_stack_load_qword_c &ins) override;
+  virtual void accept(instruction_push_multiple_c &ins) override;
+  virtual void accept(instruction_pop_multiple_c &ins) override;
+  virtual void accept(instruction_addi_c &ins) override;
+  virtual void accept(instruction_subi_c &ins) override;
+  virtual void accept(instruction_muli_c &ins) override;
+  virtual void accept(instruction_lshi_c &ins) override;
+  virtual void accept(instruction_rshi_c &ins) override;
+  virtual void accept(instruction_andi_c &ins) override;
+  virtual void accept(instruction_ori_c &ins) override;
+  virtual void accept(instruction_blti_c &ins) override;
+  virtual void accept(instruction_bgti_c &ins) override;
+  virtual void accept(instruction_beqi_c &ins) override;
   virtual void accept(instruction_syscall_c &ins) override;
   virtual void accept(instruction_debug_c &ins) override;
   virtual void accept(instruction_eirq_c &ins) override;
   virtual void accept(instruction_dirq_c &ins) override;
+  virtual void accept(instruction_region_begin_c &ins) override;
+  virtual void accept(instruction_region_free_c &ins) override;
+  virtual void accept(instruction_memory_copy_c &ins) override;
+  virtual void accept(instruction_memory_fill_c &ins) override;
+  virtual void accept(instruction_memory_compare_c &ins) override;
+  virtual void accept(instruction_vector_c &ins) override;
+  virtual void accept(instruction_vector_reduce_c &ins) override;
+  virtual void accept(instruction_vector_dot_c &ins) override;
 };
 
 } // namespace machine
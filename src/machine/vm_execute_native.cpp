@@ -0,0 +1,350 @@
+#include <libskiff/bytecode/floating_point.hpp>
+
+#include "logging/aixlog.hpp"
+#include "machine/aot.hpp"
+#include "machine/vm.hpp"
+#include "types.hpp"
+
+#include <algorithm>
+
+/*
+    Execution of an ahead of time compiled module.
+
+    The module runs straight through the program, calling back into the vm
+    for anything that touches the call stack, the data stack or memory.
+    Whenever it stops it says why : the slice of the budget ran out, an
+    interrupt is waiting, or the next instruction is one it leaves to the
+    interpreter. That instruction is run by the threaded engine with a
+    budget of one so that errors, system calls and debug output behave
+    exactly as they do everywhere else.
+*/
+
+namespace skiff {
+namespace machine {
+
+namespace fp = libskiff::bytecode::floating_point;
+
+//  Services the generated code calls back into
+struct native_services_t {
+  static int call(void *vm, uint64_t return_address)
+  {
+    return static_cast<vm_c *>(vm)->_call_stack.push(return_address) ? 1 : 0;
+  }
+
+  static int ret(void *vm, uint64_t *destination)
+  {
+    auto [okay, address] = static_cast<vm_c *>(vm)->_call_stack.pop();
+    *destination = address;
+    return okay ? 1 : 0;
+  }
+
+  // Failures change nothing, so the interpreter can repeat the instruction
+  // to report them. Pushing and popping several registers passes their mask
+  // in place of a register
+  static int stack(void *vm, uint32_t opcode, uint32_t reg)
+  {
+    auto &self = *static_cast<vm_c *>(vm);
+    switch (static_cast<threaded_opcode_e>(opcode)) {
+    case threaded_opcode_e::PUSH_MULTIPLE:
+      return self.push_registers(reg) ? 1 : 0;
+    case threaded_opcode_e::POP_MULTIPLE:
+      return self.pop_registers(reg) ? 1 : 0;
+    default:
+      break;
+    }
+
+    auto &value = self._registers[reg];
+    auto pop = [&](auto method) {
+      auto [okay, popped] = (self._stack.*method)();
+      if (okay) {
+        value = popped;
+      }
+      return okay;
+    };
+
+    bool okay{false};
+    switch (static_cast<threaded_opcode_e>(opcode)) {
+    case threaded_opcode_e::PUSH_W:
+      okay = self._stack.push_word(value);
+      break;
+    case threaded_opcode_e::PUSH_HW:
+      okay = self._stack.push_hword(value);
+      break;
+    case threaded_opcode_e::PUSH_DW:
+      okay = self._stack.push_dword(value);
+      break;
+    case threaded_opcode_e::PUSH_QW:
+      okay = self._stack.push_qword(value);
+      break;
+    case threaded_opcode_e::POP_W:
+      okay = pop(&memory::stack_c::pop_word);
+      break;
+    case threaded_opcode_e::POP_HW:
+      okay = pop(&memory::stack_c::pop_hword);
+      break;
+    case threaded_opcode_e::POP_DW:
+      okay = pop(&memory::stack_c::pop_dword);
+      break;
+    case threaded_opcode_e::POP_QW:
+      okay = pop(&memory::stack_c::pop_qword);
+      break;
+    default:
+      break;
+    }
+    return okay ? 1 : 0;
+  }
+
+  static void memory(void *vm, uint32_t opcode, uint32_t a, uint32_t b,
+                     uint32_t c, uint64_t value)
+  {
+    auto &self = *static_cast<vm_c *>(vm);
+    auto *r = self._registers.data();
+    auto &op = self._op_register;
+
+    auto store = [&](auto method) {
+      auto slot = self._memman.get_slot(r[a]);
+      op = (slot && ((*slot).*method)(r[b], r[c])) ? 1 : 0;
+    };
+    auto load = [&](auto method) {
+      auto slot = self._memman.get_slot(r[a]);
+      op = 0;
+      if (slot) {
+        auto [okay, value] = ((*slot).*method)(r[b]);
+        if (okay) {
+          op = 1;
+          r[c] = value;
+        }
+      }
+    };
+
+    auto stack_load = [&](auto method) {
+      auto [okay, loaded] = (self._stack.*method)(r[b] + value);
+      op = okay ? 1 : 0;
+      if (okay) {
+        r[a] = loaded;
+      }
+    };
+
+    // Registers that don't fit in a, b and c are packed into the value
+    auto packed = [&](const unsigned n) {
+      return r[static_cast<uint8_t>(value >> (n * 8))];
+    };
+    const auto kind = static_cast<uint8_t>(value >> 56);
+
+    using slot_t = memory::memory_c;
+
+    switch (static_cast<threaded_opcode_e>(opcode)) {
+    case threaded_opcode_e::ALLOC: {
+      auto [okay, value] = self._memman.alloc(r[b]);
+      if (okay) {
+        r[a] = value;
+      }
+      op = okay ? 1 : 0;
+      break;
+    }
+    case threaded_opcode_e::FREE:
+      op = self._memman.free(r[a]) ? 1 : 0;
+      break;
+    case threaded_opcode_e::REALLOC:
+      op = self._memman.realloc(r[a], r[b]) ? 1 : 0;
+      break;
+    case threaded_opcode_e::STACK_STORE_W:
+      op = self._stack.store_word(r[b] + value, r[a]) ? 1 : 0;
+      break;
+    case threaded_opcode_e::STACK_STORE_DW:
+      op = self._stack.store_dword(r[b] + value, r[a]) ? 1 : 0;
+      break;
+    case threaded_opcode_e::STACK_STORE_QW:
+      op = self._stack.store_qword(r[b] + value, r[a]) ? 1 : 0;
+      break;
+    case threaded_opcode_e::STACK_LOAD_W:
+      stack_load(&memory::stack_c::load_word);
+      break;
+    case threaded_opcode_e::STACK_LOAD_DW:
+      stack_load(&memory::stack_c::load_dword);
+      break;
+    case threaded_opcode_e::STACK_LOAD_QW:
+      stack_load(&memory::stack_c::load_qword);
+      break;
+    case threaded_opcode_e::REGION_BEGIN: {
+      auto [okay, value] = self._memman.begin_region();
+      if (okay) {
+        r[a] = value;
+      }
+      op = okay ? 1 : 0;
+      break;
+    }
+    case threaded_opcode_e::REGION_FREE:
+      op = self._memman.free_region(r[a]) ? 1 : 0;
+      break;
+    case threaded_opcode_e::MEMORY_COPY:
+      op = self.memory_copy(r[a], r[b], r[c], packed(0), packed(1)) ? 1 : 0;
+      break;
+    case threaded_opcode_e::MEMORY_FILL:
+      op = self.memory_fill(r[a], r[b], r[c], static_cast<uint8_t>(packed(0)))
+               ? 1
+               : 0;
+      break;
+    case threaded_opcode_e::MEMORY_COMPARE: {
+      auto [okay, result] =
+          self.memory_compare(r[b], r[c], packed(0), packed(1), packed(2));
+      if (okay) {
+        r[a] = result;
+      }
+      op = okay ? 1 : 0;
+      break;
+    }
+    case threaded_opcode_e::VECTOR:
+      op = self.vector_apply(kind, r[a], r[b], r[c], packed(0), packed(1),
+                             packed(2), packed(3))
+               ? 1
+               : 0;
+      break;
+    case threaded_opcode_e::VECTOR_REDUCE: {
+      auto [okay, result] = self.vector_reduce(kind, r[b], r[c], packed(0));
+      if (okay) {
+        r[a] = result;
+      }
+      op = okay ? 1 : 0;
+      break;
+    }
+    case threaded_opcode_e::VECTOR_DOT: {
+      auto [okay, result] =
+          self.vector_dot(kind, r[b], r[c], packed(0), packed(1), packed(2));
+      if (okay) {
+        r[a] = result;
+      }
+      op = okay ? 1 : 0;
+      break;
+    }
+    case threaded_opcode_e::STORE_W:
+      store(&slot_t::put_word);
+      break;
+    case threaded_opcode_e::STORE_HW:
+      store(&slot_t::put_hword);
+      break;
+    case threaded_opcode_e::STORE_DW:
+      store(&slot_t::put_dword);
+      break;
+    case threaded_opcode_e::STORE_QW:
+      store(&slot_t::put_qword);
+      break;
+    case threaded_opcode_e::LOAD_W:
+      load(&slot_t::get_word);
+      break;
+    case threaded_opcode_e::LOAD_HW:
+      load(&slot_t::get_hword);
+      break;
+    case threaded_opcode_e::LOAD_DW:
+      load(&slot_t::get_dword);
+      break;
+    case threaded_opcode_e::LOAD_QW:
+      load(&slot_t::get_qword);
+      break;
+    default:
+      break;
+    }
+  }
+
+  static int fp_arith(uint32_t opcode, uint64_t lhs, uint64_t rhs,
+                      uint64_t *out)
+  {
+    const auto l = fp::from_uint64_t(lhs);
+    const auto r = fp::from_uint64_t(rhs);
+    switch (static_cast<threaded_opcode_e>(opcode)) {
+    case threaded_opcode_e::ADDF:
+      *out = fp::to_uint64_t(l + r);
+      return 1;
+    case threaded_opcode_e::SUBF:
+      *out = fp::to_uint64_t(l - r);
+      return 1;
+    case threaded_opcode_e::MULF:
+      *out = fp::to_uint64_t(l * r);
+      return 1;
+    case threaded_opcode_e::DIVF:
+      if (fp::are_equal(rhs, 0.0)) {
+        return 0;
+      }
+      *out = fp::to_uint64_t(l / r);
+      return 1;
+    default:
+      return 0;
+    }
+  }
+
+  static int fp_compare(uint32_t opcode, uint64_t lhs, uint64_t rhs)
+  {
+    const auto l = fp::from_uint64_t(lhs);
+    const auto r = fp::from_uint64_t(rhs);
+    switch (static_cast<threaded_opcode_e>(opcode)) {
+    case threaded_opcode_e::BLTF:
+      return l < r;
+    case threaded_opcode_e::BGTF:
+      return l > r;
+    case threaded_opcode_e::BEQF:
+      return l == r;
+    default:
+      return 0;
+    }
+  }
+};
+
+bool vm_c::execute_native(const execution_limit_t &limit)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+
+  const auto entry = _native_module->get_entry();
+  aot_env_t env{
+      .registers = _registers.data(),
+      .interrupts_pending = _pending_interrupts.get_pending_word(),
+      .vm = this,
+      .ip = 0,
+      .remaining = 0,
+      .call = native_services_t::call,
+      .ret = native_services_t::ret,
+      .stack = native_services_t::stack,
+      .memory = native_services_t::memory,
+      .fp_arith = native_services_t::fp_arith,
+      .fp_compare = native_services_t::fp_compare,
+  };
+
+  uint64_t budget = limit.max_instructions;
+  while (_is_alive) {
+    if (budget == 0) {
+      return true;
+    }
+    if (_pending_interrupts.pending()) {
+      accept_interrupts();
+      if (!_is_alive) {
+        continue;
+      }
+    }
+
+    // Without a deadline the whole budget is a single slice
+    const uint64_t slice =
+        limit.deadline ? std::min(budget, deadline_check_interval) : budget;
+    env.ip = _ip;
+    env.remaining = slice;
+    const auto status = static_cast<aot_status_e>(entry(&env));
+    _ip = env.ip;
+    budget -= slice - env.remaining;
+#ifdef SKIFF_GENERATE_STATS
+    _runtime_data.instructions_executed += slice - env.remaining;
+#endif
+
+    if (status == aot_status_e::FALLBACK && budget) {
+      budget--;
+      if (!execute_threaded({.max_instructions = 1})) {
+        return false;
+      }
+    }
+
+    if (limit.deadline && std::chrono::steady_clock::now() >= *limit.deadline) {
+      return _is_alive;
+    }
+  }
+  return false;
+}
+
+} // namespace machine
+} // namespace skiff
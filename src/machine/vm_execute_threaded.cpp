@@ -0,0 +1,815 @@
+#include <libskiff/bytecode/floating_point.hpp>
+
+#include "defines.hpp"
+#include "logging/aixlog.hpp"
+#include "machine/jit.hpp"
+#include "machine/threaded.hpp"
+#include "machine/vm.hpp"
+#include "types.hpp"
+
+#include <algorithm>
+#include <array>
+
+/*
+    Direct-threaded execution of a lowered program.
+
+    Each threaded instruction carries the address of the code that executes
+    it so moving to the next instruction is a single indirect jump from the
+    end of each handler rather than a trip through a virtual `visit` and
+    `accept` pair. Compilers without the labels-as-values extension fall
+    back to a switch over the opcode.
+
+    The instruction pointer is held as a pointer into the program while
+    running and is only written back to `_ip` when something outside of
+    the loop may observe it.
+
+    When tiered, taken back-edges and calls count how often their target is
+    reached. Once a target is hot the region starting there is compiled and
+    from then on is entered natively, coming back to the interpreter at the
+    address the native code stopped at.
+
+    Every dispatch draws from a slice of the instruction budget. When the
+    slice runs out the loop checks the overall budget and deadline, and
+    either refills the slice or yields with `_ip` pointing at the next
+    instruction so that the following call picks up where this one left.
+*/
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SKIFF_COMPUTED_GOTO 1
+#endif
+
+#ifdef SKIFF_GENERATE_STATS
+#define SKIFF_COUNT_INSTRUCTION() _runtime_data.instructions_executed++
+#define SKIFF_COUNT_SUPERINSTRUCTION()                                         \
+  _runtime_data.superinstructions_executed++
+#define SKIFF_COUNT_NATIVE(remaining) const uint64_t skiff_before = remaining
+#define SKIFF_COUNT_NATIVE_END(remaining)                                      \
+  _runtime_data.instructions_executed += skiff_before - remaining
+#else
+#define SKIFF_COUNT_INSTRUCTION()
+#define SKIFF_COUNT_SUPERINSTRUCTION()
+#define SKIFF_COUNT_NATIVE(remaining)
+#define SKIFF_COUNT_NATIVE_END(remaining)
+#endif
+
+#ifdef SKIFF_COMPUTED_GOTO
+#define SKIFF_HANDLER(name) handler_##name:
+#define SKIFF_DISPATCH()                                                       \
+  do {                                                                         \
+    if (remaining == 0) {                                                      \
+      goto slice_expired;                                                      \
+    }                                                                          \
+    remaining--;                                                               \
+    SKIFF_COUNT_INSTRUCTION();                                                 \
+    goto *pc->handler;                                                         \
+  } while (0)
+#else
+#define SKIFF_HANDLER(name) case threaded_opcode_e::name:
+#define SKIFF_DISPATCH()                                                       \
+  do {                                                                         \
+    if (remaining == 0) {                                                      \
+      goto slice_expired;                                                      \
+    }                                                                          \
+    remaining--;                                                               \
+    SKIFF_COUNT_INSTRUCTION();                                                 \
+    goto dispatch;                                                             \
+  } while (0)
+#endif
+
+#define SKIFF_NEXT()                                                           \
+  do {                                                                         \
+    pc++;                                                                      \
+    SKIFF_DISPATCH();                                                          \
+  } while (0)
+
+// Transfer control to an instruction index, leaving the loop if it is out of
+// range of the program. Verified programs can only ever transfer control in
+// range so skip the check. Pending interrupts are taken here, so every loop
+// polls for them at least once per iteration, and leaves if taking one kills
+// the machine
+#define SKIFF_JUMP(target)                                                     \
+  do {                                                                         \
+    uint64_t skiff_target = (target);                                          \
+    if (_pending_interrupts.pending()) {                                       \
+      _ip = skiff_target;                                                      \
+      accept_interrupts();                                                     \
+      if (!_is_alive) {                                                        \
+        goto interrupt_failed;                                                 \
+      }                                                                        \
+      skiff_target = _ip;                                                      \
+    }                                                                          \
+    if (!Verified && skiff_target >= num_instructions) {                       \
+      _ip = skiff_target;                                                      \
+      goto out_of_range;                                                       \
+    }                                                                          \
+    pc = program + skiff_target;                                               \
+    SKIFF_DISPATCH();                                                          \
+  } while (0)
+
+#define SKIFF_SYNC_IP() _ip = static_cast<uint64_t>(pc - program)
+
+// Move on to the next part of a superinstruction, charging it to the budget.
+// Parts are left in place so if the slice runs out the original instruction
+// picks up from here
+#define SKIFF_FUSE_NEXT()                                                      \
+  do {                                                                         \
+    pc++;                                                                      \
+    if (remaining == 0) {                                                      \
+      goto slice_expired;                                                      \
+    }                                                                          \
+    remaining--;                                                               \
+    SKIFF_COUNT_INSTRUCTION();                                                 \
+  } while (0)
+
+// Run the native code for a hot target. Anything executed natively is taken
+// out of the current slice of the budget
+#define SKIFF_TIER_UP(target)                                                  \
+  do {                                                                         \
+    const uint64_t skiff_hot = (target);                                       \
+    if (jit && skiff_hot < num_instructions) {                                 \
+      jit_entry_t skiff_entry = jit->get_entry(skiff_hot);                     \
+      if (!skiff_entry &&                                                      \
+          ++hot_counts[skiff_hot] == config::jit_hot_threshold) {              \
+        skiff_entry = jit->compile(skiff_hot);                                 \
+      }                                                                        \
+      if (skiff_entry) {                                                       \
+        SKIFF_COUNT_NATIVE(remaining);                                         \
+        const uint64_t skiff_next = skiff_entry(                               \
+            r, &remaining, _pending_interrupts.get_pending_word());            \
+        SKIFF_COUNT_NATIVE_END(remaining);                                     \
+        SKIFF_JUMP(skiff_next);                                                \
+      }                                                                        \
+    }                                                                          \
+  } while (0)
+
+// Backwards jumps are the only way to loop
+#define SKIFF_JUMP_COUNTED(target)                                             \
+  do {                                                                         \
+    const uint64_t skiff_destination = (target);                               \
+    if (jit && skiff_destination <= static_cast<uint64_t>(pc - program)) {     \
+      SKIFF_TIER_UP(skiff_destination);                                        \
+    }                                                                          \
+    SKIFF_JUMP(skiff_destination);                                             \
+  } while (0)
+
+#define SKIFF_ARITH(op)                                                        \
+  r[pc->a] = r[pc->b] op r[pc->c];                                             \
+  SKIFF_NEXT()
+
+#define SKIFF_ARITH_I(op)                                                      \
+  r[pc->a] = r[pc->b] op pc->value;                                            \
+  SKIFF_NEXT()
+
+#define SKIFF_ARITH_F(op)                                                      \
+  r[pc->a] = libskiff::bytecode::floating_point::to_uint64_t(                  \
+      libskiff::bytecode::floating_point::from_uint64_t(r[pc->b])              \
+          op libskiff::bytecode::floating_point::from_uint64_t(r[pc->c]));     \
+  SKIFF_NEXT()
+
+#define SKIFF_BRANCH(op)                                                       \
+  if (r[pc->a] op r[pc->b]) {                                                  \
+    SKIFF_JUMP_COUNTED(pc->value);                                             \
+  }                                                                            \
+  SKIFF_NEXT()
+
+#define SKIFF_BRANCH_I(op)                                                     \
+  if (r[pc->a] op get_immediate(*pc)) {                                        \
+    SKIFF_JUMP_COUNTED(pc->value);                                             \
+  }                                                                            \
+  SKIFF_NEXT()
+
+#define SKIFF_BRANCH_F(op)                                                     \
+  if (libskiff::bytecode::floating_point::from_uint64_t(r[pc->a])              \
+          op libskiff::bytecode::floating_point::from_uint64_t(r[pc->b])) {    \
+    SKIFF_JUMP_COUNTED(pc->value);                                             \
+  }                                                                            \
+  SKIFF_NEXT()
+
+#define SKIFF_DO_PUSH(method)                                                  \
+  if (!_stack.method(r[pc->a])) {                                              \
+    SKIFF_SYNC_IP();                                                           \
+    kill_with_error(skiff::types::runtime_error_e::STACK_PUSH_ERROR,           \
+                    "Unable to push data to stack. Out of memory?");           \
+    pc++;                                                                      \
+    goto leave;                                                                \
+  }
+
+#define SKIFF_PUSH(method)                                                     \
+  SKIFF_DO_PUSH(method)                                                        \
+  SKIFF_NEXT()
+
+#define SKIFF_DO_POP(method)                                                   \
+  {                                                                            \
+    auto [okay, value] = _stack.method();                                      \
+    r[pc->a] = value;                                                          \
+    if (!okay) {                                                               \
+      SKIFF_SYNC_IP();                                                         \
+      kill_with_error(skiff::types::runtime_error_e::STACK_POP_ERROR,          \
+                      "Unable to pop data from stack. Stack empty?");          \
+      pc++;                                                                    \
+      goto leave;                                                              \
+    }                                                                          \
+  }
+
+#define SKIFF_POP(method)                                                      \
+  SKIFF_DO_POP(method)                                                         \
+  SKIFF_NEXT()
+
+#define SKIFF_STORE(type)                                                      \
+  {                                                                            \
+    auto slot = _memman.get_slot(r[pc->a]);                                    \
+    _op_register =                                                             \
+        (slot && slot->store(r[pc->b], static_cast<type>(r[pc->c]))) ? 1 : 0;  \
+  }                                                                            \
+  SKIFF_NEXT()
+
+// Stack accesses are relative to a register, the offset is in the value
+#define SKIFF_STACK_STORE(method, type)                                        \
+  {                                                                            \
+    const bool skiff_okay =                                                    \
+        _stack.method(r[pc->b] + pc->value, static_cast<type>(r[pc->a]));      \
+    _op_register = skiff_okay ? 1 : 0;                                         \
+  }                                                                            \
+  SKIFF_NEXT()
+
+#define SKIFF_STACK_LOAD(method)                                               \
+  {                                                                            \
+    auto [okay, value] = _stack.method(r[pc->b] + pc->value);                  \
+    _op_register = okay ? 1 : 0;                                               \
+    if (okay) {                                                                \
+      r[pc->a] = value;                                                        \
+    }                                                                          \
+  }                                                                            \
+  SKIFF_NEXT()
+
+// Runs of the same instruction, `value` long
+#define SKIFF_REPEAT(action)                                                   \
+  for (uint64_t skiff_left = pc->value;;) {                                    \
+    action;                                                                    \
+    if (--skiff_left == 0) {                                                   \
+      break;                                                                   \
+    }                                                                          \
+    SKIFF_FUSE_NEXT();                                                         \
+  }                                                                            \
+  SKIFF_NEXT()
+
+#define SKIFF_LOAD(type)                                                       \
+  {                                                                            \
+    auto slot = _memman.get_slot(r[pc->a]);                                    \
+    type skiff_value;                                                          \
+    _op_register = 0;                                                          \
+    if (slot && slot->load(r[pc->b], skiff_value)) {                           \
+      _op_register = 1;                                                        \
+      r[pc->c] = skiff_value;                                                  \
+    }                                                                          \
+  }                                                                            \
+  SKIFF_NEXT()
+
+namespace skiff {
+namespace machine {
+
+bool vm_c::execute_threaded(const execution_limit_t &limit)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+
+  if (!_program) {
+    kill_with_error(skiff::types::runtime_error_e::INSTRUCTION_PTR_OUT_OF_RANGE,
+                    "No program loaded");
+    return false;
+  }
+  if (_program->is_verified()) {
+    return run_threaded<true>(limit);
+  }
+  return run_threaded<false>(limit);
+}
+
+template <bool Verified>
+bool vm_c::run_threaded(const execution_limit_t &limit)
+{
+#ifdef SKIFF_COMPUTED_GOTO
+  // Must match the order of threaded_opcode_e
+  static const std::array<const void *,
+                          static_cast<size_t>(threaded_opcode_e::NUM_OPCODES)>
+      handlers = {
+          &&handler_NOP,     &&handler_EXIT,     &&handler_BLT,
+          &&handler_BGT,     &&handler_BEQ,      &&handler_JMP,
+          &&handler_CALL,    &&handler_RET,      &&handler_MOV,
+          &&handler_ADD,     &&handler_SUB,      &&handler_DIV,
+          &&handler_MUL,     &&handler_ADDF,     &&handler_SUBF,
+          &&handler_DIVF,    &&handler_MULF,     &&handler_LSH,
+          &&handler_RSH,     &&handler_AND,      &&handler_OR,
+          &&handler_XOR,     &&handler_NOT,      &&handler_BLTF,
+          &&handler_BGTF,    &&handler_BEQF,     &&handler_ASEQ,
+          &&handler_ASNE,    &&handler_PUSH_W,   &&handler_PUSH_HW,
+          &&handler_PUSH_DW, &&handler_PUSH_QW,  &&handler_POP_W,
+          &&handler_POP_HW,  &&handler_POP_DW,   &&handler_POP_QW,
+          &&handler_ALLOC,   &&handler_FREE,     &&handler_STORE_W,
+          &&handler_STORE_HW, &&handler_STORE_DW, &&handler_STORE_QW,
+          &&handler_LOAD_W,  &&handler_LOAD_HW,  &&handler_LOAD_DW,
+          &&handler_LOAD_QW, &&handler_SYSCALL,  &&handler_DEBUG,
+          &&handler_EIRQ,    &&handler_DIRQ,     &&handler_REGION_BEGIN,
+          &&handler_REGION_FREE, &&handler_MEMORY_COPY,
+          &&handler_MEMORY_FILL, &&handler_MEMORY_COMPARE, &&handler_VECTOR,
+          &&handler_VECTOR_REDUCE, &&handler_VECTOR_DOT, &&handler_REALLOC,
+          &&handler_STACK_STORE_W, &&handler_STACK_STORE_DW,
+          &&handler_STACK_STORE_QW, &&handler_STACK_LOAD_W,
+          &&handler_STACK_LOAD_DW, &&handler_STACK_LOAD_QW,
+          &&handler_PUSH_MULTIPLE, &&handler_POP_MULTIPLE,
+          &&handler_ADDI,    &&handler_SUBI,     &&handler_MULI,
+          &&handler_LSHI,    &&handler_RSHI,     &&handler_ANDI,
+          &&handler_ORI,     &&handler_BLTI,     &&handler_BGTI,
+          &&handler_BEQI,
+          &&handler_MOV_ADD,
+          &&handler_ADD_BLT, &&handler_ADD_BGT,  &&handler_ADD_BEQ,
+          &&handler_ADD_SW,  &&handler_ADD_SQW,  &&handler_MOV_ADD_SW,
+          &&handler_MOV_ADD_SQW, &&handler_PUSH_QW_N, &&handler_POP_QW_N,
+          &&handler_END};
+
+  const threaded_instruction_t *const program =
+      _program->link(handlers.data());
+#else
+  const threaded_instruction_t *const program =
+      _program->get_fused_instructions().data();
+#endif
+
+  const uint64_t num_instructions = _program->get_num_instructions();
+  types::vm_register *const r = _registers.data();
+  const threaded_instruction_t *pc = program;
+  jit_c *const jit = _jit;
+  uint32_t *const hot_counts = _hot_counts.data();
+
+  // Without a deadline the whole budget is a single slice
+  uint64_t budget = limit.max_instructions;
+  uint64_t slice = limit.deadline ? std::min(budget, deadline_check_interval)
+                                  : budget;
+  uint64_t remaining = slice;
+
+  if (!_is_alive) {
+    return false;
+  }
+  SKIFF_JUMP(_ip);
+
+#ifndef SKIFF_COMPUTED_GOTO
+dispatch:
+  switch (pc->opcode) {
+  case threaded_opcode_e::NUM_OPCODES:
+    goto out_of_range;
+#endif
+
+  SKIFF_HANDLER(NOP)
+  {
+    if (_debug_level != libskiff::types::exec_debug_level_e::NONE) {
+      issue_forced_debug("NOP Instruction @ IP = " +
+                         std::to_string(pc - program));
+    }
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(EXIT)
+  {
+    if (_debug_level != libskiff::types::exec_debug_level_e::NONE) {
+      issue_forced_debug("EXIT Instruction @ IP = " +
+                         std::to_string(pc - program));
+    }
+    _is_alive = false;
+    pc++;
+    goto leave;
+  }
+
+  SKIFF_HANDLER(BLT) { SKIFF_BRANCH(<); }
+  SKIFF_HANDLER(BGT) { SKIFF_BRANCH(>); }
+  SKIFF_HANDLER(BEQ) { SKIFF_BRANCH(==); }
+  SKIFF_HANDLER(JMP) { SKIFF_JUMP_COUNTED(pc->value); }
+
+  SKIFF_HANDLER(CALL)
+  {
+    if (!_call_stack.push(static_cast<uint64_t>(pc - program) + 1)) {
+      SKIFF_SYNC_IP();
+      kill_with_error(skiff::types::runtime_error_e::CALL_STACK_OVERFLOW,
+                      "`call` instruction hit with full callstack");
+      goto leave;
+    }
+    SKIFF_TIER_UP(pc->value);
+    SKIFF_JUMP(pc->value);
+  }
+
+  SKIFF_HANDLER(RET)
+  {
+    if (_call_stack.empty()) {
+      SKIFF_SYNC_IP();
+      kill_with_error(
+          skiff::types::runtime_error_e::RETURN_WITH_EMPTY_CALLSTACK,
+          "`ret` instruction hit with empty callstack");
+      goto leave;
+    }
+    const uint64_t destination = std::get<1>(_call_stack.pop());
+    SKIFF_JUMP(destination);
+  }
+
+  SKIFF_HANDLER(MOV)
+  {
+    r[pc->a] = pc->value;
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(ADD) { SKIFF_ARITH(+); }
+  SKIFF_HANDLER(SUB) { SKIFF_ARITH(-); }
+
+  SKIFF_HANDLER(DIV)
+  {
+    if (r[pc->c] == 0) {
+      SKIFF_SYNC_IP();
+      kill_with_error(skiff::types::runtime_error_e::DIVIDE_BY_ZERO,
+                      "`div` instruction asked to divide by 0");
+      goto leave;
+    }
+    SKIFF_ARITH(/);
+  }
+
+  SKIFF_HANDLER(MUL) { SKIFF_ARITH(*); }
+  SKIFF_HANDLER(ADDF) { SKIFF_ARITH_F(+); }
+  SKIFF_HANDLER(SUBF) { SKIFF_ARITH_F(-); }
+
+  SKIFF_HANDLER(DIVF)
+  {
+    if (libskiff::bytecode::floating_point::are_equal(r[pc->c], 0.0)) {
+      SKIFF_SYNC_IP();
+      kill_with_error(skiff::types::runtime_error_e::DIVIDE_BY_ZERO,
+                      "`divf` instruction asked to divide by 0");
+      goto leave;
+    }
+    SKIFF_ARITH_F(/);
+  }
+
+  SKIFF_HANDLER(MULF) { SKIFF_ARITH_F(*); }
+  SKIFF_HANDLER(LSH) { SKIFF_ARITH(<<); }
+  SKIFF_HANDLER(RSH) { SKIFF_ARITH(>>); }
+  SKIFF_HANDLER(AND) { SKIFF_ARITH(&); }
+  SKIFF_HANDLER(OR) { SKIFF_ARITH(|); }
+  SKIFF_HANDLER(XOR) { SKIFF_ARITH(^); }
+
+  SKIFF_HANDLER(NOT)
+  {
+    r[pc->a] = !r[pc->b];
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(BLTF) { SKIFF_BRANCH_F(<); }
+  SKIFF_HANDLER(BGTF) { SKIFF_BRANCH_F(>); }
+  SKIFF_HANDLER(BEQF) { SKIFF_BRANCH_F(==); }
+
+  SKIFF_HANDLER(ASEQ)
+  {
+    if (r[pc->a] != r[pc->b]) {
+      LOG(DEBUG) << TAG("vm") << TERM_COLOR_RED
+                 << "Assertion `ASEQ` failed! Expected [" << r[pc->a]
+                 << "] Actual [" << r[pc->b] << "]" << TERM_COLOR_END << "\n";
+      _integer_registers[0] = 1;
+      _is_alive = false;
+      pc++;
+      goto leave;
+    }
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(ASNE)
+  {
+    if (r[pc->a] == r[pc->b]) {
+      LOG(DEBUG) << TAG("vm") << TERM_COLOR_RED
+                 << "Assertion `ASNE` failed! Expected [" << r[pc->a]
+                 << "] Actual [" << r[pc->b] << "]" << TERM_COLOR_END << "\n";
+      _integer_registers[0] = 1;
+      _is_alive = false;
+      pc++;
+      goto leave;
+    }
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(PUSH_W) { SKIFF_PUSH(push_word); }
+  SKIFF_HANDLER(PUSH_HW) { SKIFF_PUSH(push_hword); }
+  SKIFF_HANDLER(PUSH_DW) { SKIFF_PUSH(push_dword); }
+  SKIFF_HANDLER(PUSH_QW) { SKIFF_PUSH(push_qword); }
+  SKIFF_HANDLER(POP_W) { SKIFF_POP(pop_word); }
+  SKIFF_HANDLER(POP_HW) { SKIFF_POP(pop_hword); }
+  SKIFF_HANDLER(POP_DW) { SKIFF_POP(pop_dword); }
+  SKIFF_HANDLER(POP_QW) { SKIFF_POP(pop_qword); }
+
+  SKIFF_HANDLER(PUSH_MULTIPLE)
+  {
+    if (!push_registers(pc->value)) {
+      SKIFF_SYNC_IP();
+      kill_with_error(skiff::types::runtime_error_e::STACK_PUSH_ERROR,
+                      "Unable to push data to stack. Out of memory?");
+      pc++;
+      goto leave;
+    }
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(POP_MULTIPLE)
+  {
+    if (!pop_registers(pc->value)) {
+      SKIFF_SYNC_IP();
+      kill_with_error(skiff::types::runtime_error_e::STACK_POP_ERROR,
+                      "Unable to pop data from stack. Stack empty?");
+      pc++;
+      goto leave;
+    }
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(ADDI) { SKIFF_ARITH_I(+); }
+  SKIFF_HANDLER(SUBI) { SKIFF_ARITH_I(-); }
+  SKIFF_HANDLER(MULI) { SKIFF_ARITH_I(*); }
+  SKIFF_HANDLER(LSHI) { SKIFF_ARITH_I(<<); }
+  SKIFF_HANDLER(RSHI) { SKIFF_ARITH_I(>>); }
+  SKIFF_HANDLER(ANDI) { SKIFF_ARITH_I(&); }
+  SKIFF_HANDLER(ORI) { SKIFF_ARITH_I(|); }
+  SKIFF_HANDLER(BLTI) { SKIFF_BRANCH_I(<); }
+  SKIFF_HANDLER(BGTI) { SKIFF_BRANCH_I(>); }
+  SKIFF_HANDLER(BEQI) { SKIFF_BRANCH_I(==); }
+
+  SKIFF_HANDLER(ALLOC)
+  {
+    auto [okay, value] = _memman.alloc(r[pc->b]);
+    if (okay) {
+      r[pc->a] = value;
+    }
+    _op_register = okay ? 1 : 0;
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(FREE)
+  {
+    _op_register = _memman.free(r[pc->a]) ? 1 : 0;
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(REALLOC)
+  {
+    _op_register = _memman.realloc(r[pc->a], r[pc->b]) ? 1 : 0;
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(STACK_STORE_W) { SKIFF_STACK_STORE(store_word, uint16_t); }
+  SKIFF_HANDLER(STACK_STORE_DW) { SKIFF_STACK_STORE(store_dword, uint32_t); }
+  SKIFF_HANDLER(STACK_STORE_QW) { SKIFF_STACK_STORE(store_qword, uint64_t); }
+  SKIFF_HANDLER(STACK_LOAD_W) { SKIFF_STACK_LOAD(load_word); }
+  SKIFF_HANDLER(STACK_LOAD_DW) { SKIFF_STACK_LOAD(load_dword); }
+  SKIFF_HANDLER(STACK_LOAD_QW) { SKIFF_STACK_LOAD(load_qword); }
+
+  SKIFF_HANDLER(STORE_W) { SKIFF_STORE(uint16_t); }
+  SKIFF_HANDLER(STORE_HW) { SKIFF_STORE(uint8_t); }
+  SKIFF_HANDLER(STORE_DW) { SKIFF_STORE(uint32_t); }
+  SKIFF_HANDLER(STORE_QW) { SKIFF_STORE(uint64_t); }
+  SKIFF_HANDLER(LOAD_W) { SKIFF_LOAD(uint16_t); }
+  SKIFF_HANDLER(LOAD_HW) { SKIFF_LOAD(uint8_t); }
+  SKIFF_HANDLER(LOAD_DW) { SKIFF_LOAD(uint32_t); }
+  SKIFF_HANDLER(LOAD_QW) { SKIFF_LOAD(uint64_t); }
+
+  SKIFF_HANDLER(SYSCALL)
+  {
+    if (pc->value >= _system_callables.size()) {
+      _op_register = 0;
+      SKIFF_NEXT();
+    }
+
+    // Callables may observe the instruction pointer through the vm
+    pc++;
+    SKIFF_SYNC_IP();
+    types::view_t view = {.integer_registers = _integer_registers,
+                          .float_registers = _floating_point_registers,
+                          .memory_manager = _memman,
+                          .op_register = _op_register};
+    _system_callables[(pc - 1)->value]->execute(view);
+
+    // A callable may have raised an interrupt
+    SKIFF_JUMP(_ip);
+  }
+
+  SKIFF_HANDLER(DEBUG)
+  {
+    pc++;
+    SKIFF_SYNC_IP();
+    display_debug((pc - 1)->value);
+    SKIFF_DISPATCH();
+  }
+
+  SKIFF_HANDLER(EIRQ)
+  {
+    _interrupts_enabled.store(true, std::memory_order_release);
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(DIRQ)
+  {
+    _interrupts_enabled.store(false, std::memory_order_release);
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(REGION_BEGIN)
+  {
+    auto [okay, value] = _memman.begin_region();
+    if (okay) {
+      r[pc->a] = value;
+    }
+    _op_register = okay ? 1 : 0;
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(REGION_FREE)
+  {
+    _op_register = _memman.free_region(r[pc->a]) ? 1 : 0;
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(MEMORY_COPY)
+  {
+    _op_register = memory_copy(r[pc->a], r[pc->b], r[pc->c],
+                               r[get_packed_register(*pc, 0)],
+                               r[get_packed_register(*pc, 1)])
+                       ? 1
+                       : 0;
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(MEMORY_FILL)
+  {
+    _op_register =
+        memory_fill(r[pc->a], r[pc->b], r[pc->c],
+                    static_cast<uint8_t>(r[get_packed_register(*pc, 0)]))
+            ? 1
+            : 0;
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(MEMORY_COMPARE)
+  {
+    auto [okay, value] = memory_compare(
+        r[pc->b], r[pc->c], r[get_packed_register(*pc, 0)],
+        r[get_packed_register(*pc, 1)], r[get_packed_register(*pc, 2)]);
+    if (okay) {
+      r[pc->a] = value;
+    }
+    _op_register = okay ? 1 : 0;
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(VECTOR)
+  {
+    _op_register =
+        vector_apply(get_vector_kind(*pc), r[pc->a], r[pc->b], r[pc->c],
+                     r[get_packed_register(*pc, 0)],
+                     r[get_packed_register(*pc, 1)],
+                     r[get_packed_register(*pc, 2)],
+                     r[get_packed_register(*pc, 3)])
+            ? 1
+            : 0;
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(VECTOR_REDUCE)
+  {
+    auto [okay, value] =
+        vector_reduce(get_vector_kind(*pc), r[pc->b], r[pc->c],
+                      r[get_packed_register(*pc, 0)]);
+    if (okay) {
+      r[pc->a] = value;
+    }
+    _op_register = okay ? 1 : 0;
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(VECTOR_DOT)
+  {
+    auto [okay, value] =
+        vector_dot(get_vector_kind(*pc), r[pc->b], r[pc->c],
+                   r[get_packed_register(*pc, 0)],
+                   r[get_packed_register(*pc, 1)],
+                   r[get_packed_register(*pc, 2)]);
+    if (okay) {
+      r[pc->a] = value;
+    }
+    _op_register = okay ? 1 : 0;
+    SKIFF_NEXT();
+  }
+
+  SKIFF_HANDLER(MOV_ADD)
+  {
+    SKIFF_COUNT_SUPERINSTRUCTION();
+    r[pc->a] = pc->value;
+    SKIFF_FUSE_NEXT();
+    SKIFF_ARITH(+);
+  }
+
+  SKIFF_HANDLER(ADD_BLT)
+  {
+    SKIFF_COUNT_SUPERINSTRUCTION();
+    r[pc->a] = r[pc->b] + r[pc->c];
+    SKIFF_FUSE_NEXT();
+    SKIFF_BRANCH(<);
+  }
+
+  SKIFF_HANDLER(ADD_BGT)
+  {
+    SKIFF_COUNT_SUPERINSTRUCTION();
+    r[pc->a] = r[pc->b] + r[pc->c];
+    SKIFF_FUSE_NEXT();
+    SKIFF_BRANCH(>);
+  }
+
+  SKIFF_HANDLER(ADD_BEQ)
+  {
+    SKIFF_COUNT_SUPERINSTRUCTION();
+    r[pc->a] = r[pc->b] + r[pc->c];
+    SKIFF_FUSE_NEXT();
+    SKIFF_BRANCH(==);
+  }
+
+  SKIFF_HANDLER(ADD_SW)
+  {
+    SKIFF_COUNT_SUPERINSTRUCTION();
+    r[pc->a] = r[pc->b] + r[pc->c];
+    SKIFF_FUSE_NEXT();
+    SKIFF_STORE(uint16_t);
+  }
+
+  SKIFF_HANDLER(ADD_SQW)
+  {
+    SKIFF_COUNT_SUPERINSTRUCTION();
+    r[pc->a] = r[pc->b] + r[pc->c];
+    SKIFF_FUSE_NEXT();
+    SKIFF_STORE(uint64_t);
+  }
+
+  SKIFF_HANDLER(MOV_ADD_SW)
+  {
+    SKIFF_COUNT_SUPERINSTRUCTION();
+    r[pc->a] = pc->value;
+    SKIFF_FUSE_NEXT();
+    r[pc->a] = r[pc->b] + r[pc->c];
+    SKIFF_FUSE_NEXT();
+    SKIFF_STORE(uint16_t);
+  }
+
+  SKIFF_HANDLER(MOV_ADD_SQW)
+  {
+    SKIFF_COUNT_SUPERINSTRUCTION();
+    r[pc->a] = pc->value;
+    SKIFF_FUSE_NEXT();
+    r[pc->a] = r[pc->b] + r[pc->c];
+    SKIFF_FUSE_NEXT();
+    SKIFF_STORE(uint64_t);
+  }
+
+  SKIFF_HANDLER(PUSH_QW_N)
+  {
+    SKIFF_COUNT_SUPERINSTRUCTION();
+    SKIFF_REPEAT(SKIFF_DO_PUSH(push_qword));
+  }
+
+  SKIFF_HANDLER(POP_QW_N)
+  {
+    SKIFF_COUNT_SUPERINSTRUCTION();
+    SKIFF_REPEAT(SKIFF_DO_POP(pop_qword));
+  }
+
+  SKIFF_HANDLER(END)
+  {
+    // Ran off of the end of the program
+    SKIFF_SYNC_IP();
+    goto out_of_range;
+  }
+
+#ifndef SKIFF_COMPUTED_GOTO
+  }
+#endif
+
+slice_expired:
+  budget -= slice;
+  if (budget == 0 ||
+      (limit.deadline && std::chrono::steady_clock::now() >= *limit.deadline)) {
+    SKIFF_SYNC_IP();
+    return true;
+  }
+  slice = limit.deadline ? std::min(budget, deadline_check_interval) : budget;
+  remaining = slice;
+  SKIFF_DISPATCH();
+
+out_of_range:
+  kill_with_error(skiff::types::runtime_error_e::INSTRUCTION_PTR_OUT_OF_RANGE,
+                  "Instruction pointer out of range : " + std::to_string(_ip));
+  return false;
+
+leave:
+  SKIFF_SYNC_IP();
+  return false;
+
+interrupt_failed:
+  // The instruction pointer was left where the interrupt was taken
+  return false;
+}
+
+} // namespace machine
+} // namespace skiff
@@ -1,17 +1,20 @@
 #ifndef SKIFF_APP_OPTIONS_HPP
 #define SKIFF_APP_OPTIONS_HPP
 
+#include <cstdint>
 #include <optional>
 #include <sstream>
 #include <string>
 #include <vector>
 
 #include "logging/aixlog.hpp"
+#include "machine/vm.hpp"
 
 namespace skiff_opt {
 struct assemble_t {
   std::string file_in;
   std::optional<std::string> file_out;
+  bool write_symbols;
 };
 
 struct options_t {
@@ -19,6 +22,16 @@ struct options_t {
   AixLog::Severity log_level;
   std::vector<std::string> suspected_bin;
   bool display_stats;
+  skiff::machine::vm_c::engine_e engine;
+  std::optional<std::size_t> num_jobs;
+  std::optional<uint64_t> timeslice;
+  std::optional<std::string> profile_file;
+  bool aot;
+  skiff::machine::memory::byte_order_e byte_order;
+  skiff::machine::memory::slab_allocator_c::settings_t allocator;
+  uint64_t memory_limit;
+  std::optional<uint64_t> stack_size;
+  std::optional<uint64_t> call_depth;
 };
 
 static void show_usage()
@@ -26,8 +39,31 @@ static void show_usage()
   std::cout
       << "[-a | --assemble ] <file>\t\tAssemble a file\n"
          "[-o | --out      ] <file>\t\tOutput file for assemble command\n"
+         "[-g | --symbols  ] \t\t\tWrite labels to <out>.sym for -p\n"
          "[-s | --stats    ] \t\t\tDisplay statistics\n"
+         "[-p | --profile  ] <file>\t\tProfile, writing folded stacks\n"
+         "                   \t\t\tto file and a report to stdout\n"
          "[-c | --config   ] <file>\t\tRuntime configuration file\n"
+         "[-e | --engine   ] \n\t[threaded|visitor|tiered]\tExecution engine\n"
+         "[--aot           ] \t\t\tCompile binaries to native code ahead\n"
+         "                   \t\t\tof time, caching the result\n"
+         "[--byte-order    ] \n\t[big|native]\t\t\tByte order of allocated memory\n"
+         "[--memory-limit  ] <N>\t\t\tFail allocations past N bytes\n"
+         "                   \t\t\theld by a binary's slots\n"
+         "[--stack-size    ] <N>\t\t\tLet the stack grow to N bytes\n"
+         "                   \t\t\t(default 1048576)\n"
+         "[--call-depth    ] <N>\t\t\tLet calls nest N deep\n"
+         "                   \t\t\t(default 1048576)\n"
+         "[--map-threshold ] <N>\t\t\tMap slots of N bytes or more on\n"
+         "                   \t\t\ttheir own (default 4097)\n"
+         "[--huge-pages    ] \t\t\tBack slots of 2MiB or more with\n"
+         "                   \t\t\thuge pages where available\n"
+         "[--retain-mapped ] <N>\t\t\tKeep up to N bytes of freed\n"
+         "                   \t\t\tmappings for reuse\n"
+         "[-j | --jobs     ] <N>\t\t\tRun binaries on N worker threads\n"
+         "                   \t\t\t(0 = one per hardware thread)\n"
+         "[-t | --timeslice] <N>\t\t\tWith -j, switch between binaries\n"
+         "                   \t\t\tevery N instructions\n"
          "[-l | --loglevel ] \n\t[trace|debug|info|warn|error]\tLog Level\n";
 }
 
@@ -50,7 +86,8 @@ static std::optional<options_t> build_options(std::vector<std::string> opts)
         return std::nullopt;
       }
       options.assemble_file = {.file_in = opts[i + 1],
-                               .file_out = std::nullopt};
+                               .file_out = std::nullopt,
+                               .write_symbols = false};
       i++; // Skip over the file name read in
       continue;
     }
@@ -72,6 +109,30 @@ static std::optional<options_t> build_options(std::vector<std::string> opts)
       continue;
     }
 
+    // Write labels beside the assembled binary
+    if (opts[i] == "-g" || opts[i] == "--symbols") {
+      if (options.assemble_file == std::nullopt) {
+        std::cout << "Expected '-a' or -'-assemble' prior to '-g' or "
+                     "'--symbols' for symbols command"
+                  << std::endl;
+        return std::nullopt;
+      }
+      options.assemble_file->write_symbols = true;
+      continue;
+    }
+
+    // Profile execution
+    if (opts[i] == "-p" || opts[i] == "--profile") {
+      if (i + 1 >= opts.size()) {
+        std::cout << "Expected file name for 'profile' instruction"
+                  << std::endl;
+        return std::nullopt;
+      }
+      options.profile_file = {opts[i + 1]};
+      i++;
+      continue;
+    }
+
     // Log level
     if (opts[i] == "-l" || opts[i] == "--log") {
       if (i + 1 > opts.size()) {
@@ -104,6 +165,215 @@ static std::optional<options_t> build_options(std::vector<std::string> opts)
       continue;
     }
 
+    // Execution engine
+    if (opts[i] == "-e" || opts[i] == "--engine") {
+      if (i + 1 >= opts.size()) {
+        std::cout << "Expected engine for 'engine' instruction" << std::endl;
+        return std::nullopt;
+      }
+
+      if (opts[i + 1] == "threaded") {
+        options.engine = skiff::machine::vm_c::engine_e::THREADED;
+      }
+      else if (opts[i + 1] == "visitor") {
+        options.engine = skiff::machine::vm_c::engine_e::VISITOR;
+      }
+      else if (opts[i + 1] == "tiered") {
+        options.engine = skiff::machine::vm_c::engine_e::TIERED;
+      }
+      else {
+        std::cout << "Invalid engine '" << opts[i + 1] << "' given to '"
+                  << opts[i] << "' instruction" << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+
+      i++;
+      continue;
+    }
+
+    // Compile binaries ahead of time
+    if (opts[i] == "--aot") {
+      options.aot = true;
+      continue;
+    }
+
+    // Byte order of memory allocated by binaries
+    if (opts[i] == "--byte-order") {
+      if (i + 1 >= opts.size()) {
+        std::cout << "Expected order for 'byte-order' instruction"
+                  << std::endl;
+        return std::nullopt;
+      }
+
+      if (opts[i + 1] == "big") {
+        options.byte_order = skiff::machine::memory::byte_order_e::BIG;
+      }
+      else if (opts[i + 1] == "native") {
+        options.byte_order = skiff::machine::memory::byte_order_e::NATIVE;
+      }
+      else {
+        std::cout << "Invalid order '" << opts[i + 1] << "' given to '"
+                  << opts[i] << "' instruction" << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+
+      i++;
+      continue;
+    }
+
+    // Most bytes a binary's slots may hold
+    if (opts[i] == "--memory-limit") {
+      if (i + 1 >= opts.size()) {
+        std::cout << "Expected byte count for 'memory-limit' instruction"
+                  << std::endl;
+        return std::nullopt;
+      }
+
+      uint64_t limit{0};
+      std::istringstream iss(opts[i + 1]);
+      if (!(iss >> limit) || !iss.eof() || limit == 0) {
+        std::cout << "Invalid byte count '" << opts[i + 1] << "' given to '"
+                  << opts[i] << "' instruction" << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      options.memory_limit = limit;
+
+      i++;
+      continue;
+    }
+
+    // Most bytes the stack can grow to
+    if (opts[i] == "--stack-size") {
+      if (i + 1 >= opts.size()) {
+        std::cout << "Expected byte count for 'stack-size' instruction"
+                  << std::endl;
+        return std::nullopt;
+      }
+
+      uint64_t stack_size{0};
+      std::istringstream iss(opts[i + 1]);
+      if (!(iss >> stack_size) || !iss.eof() || stack_size == 0) {
+        std::cout << "Invalid byte count '" << opts[i + 1] << "' given to '"
+                  << opts[i] << "' instruction" << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      options.stack_size = {stack_size};
+
+      i++;
+      continue;
+    }
+
+    // Deepest calls can nest
+    if (opts[i] == "--call-depth") {
+      if (i + 1 >= opts.size()) {
+        std::cout << "Expected depth for 'call-depth' instruction"
+                  << std::endl;
+        return std::nullopt;
+      }
+
+      uint64_t call_depth{0};
+      std::istringstream iss(opts[i + 1]);
+      if (!(iss >> call_depth) || !iss.eof() || call_depth == 0) {
+        std::cout << "Invalid depth '" << opts[i + 1] << "' given to '"
+                  << opts[i] << "' instruction" << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      options.call_depth = {call_depth};
+
+      i++;
+      continue;
+    }
+
+    // Smallest slot that is mapped on its own
+    if (opts[i] == "--map-threshold") {
+      if (i + 1 >= opts.size()) {
+        std::cout << "Expected byte count for 'map-threshold' instruction"
+                  << std::endl;
+        return std::nullopt;
+      }
+
+      std::size_t threshold{0};
+      std::istringstream iss(opts[i + 1]);
+      if (!(iss >> threshold) || !iss.eof()) {
+        std::cout << "Invalid byte count '" << opts[i + 1] << "' given to '"
+                  << opts[i] << "' instruction" << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      options.allocator.map_threshold = threshold;
+
+      i++;
+      continue;
+    }
+
+    // Huge pages for large mapped slots
+    if (opts[i] == "--huge-pages") {
+      options.allocator.huge_pages = true;
+      continue;
+    }
+
+    // Freed mappings kept for reuse
+    if (opts[i] == "--retain-mapped") {
+      if (i + 1 >= opts.size()) {
+        std::cout << "Expected byte count for 'retain-mapped' instruction"
+                  << std::endl;
+        return std::nullopt;
+      }
+
+      std::size_t retained{0};
+      std::istringstream iss(opts[i + 1]);
+      if (!(iss >> retained) || !iss.eof()) {
+        std::cout << "Invalid byte count '" << opts[i + 1] << "' given to '"
+                  << opts[i] << "' instruction" << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      options.allocator.retained_bytes = retained;
+
+      i++;
+      continue;
+    }
+
+    // Run binaries on a pool of workers
+    if (opts[i] == "-j" || opts[i] == "--jobs") {
+      if (i + 1 >= opts.size()) {
+        std::cout << "Expected worker count for 'jobs' instruction"
+                  << std::endl;
+        return std::nullopt;
+      }
+
+      std::size_t num_jobs{0};
+      std::istringstream iss(opts[i + 1]);
+      if (!(iss >> num_jobs) || !iss.eof()) {
+        std::cout << "Invalid worker count '" << opts[i + 1] << "' given to '"
+                  << opts[i] << "' instruction" << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      options.num_jobs = {num_jobs};
+
+      i++;
+      continue;
+    }
+
+    // Instructions each binary runs before yielding to the others
+    if (opts[i] == "-t" || opts[i] == "--timeslice") {
+      if (i + 1 >= opts.size()) {
+        std::cout << "Expected instruction count for 'timeslice' instruction"
+                  << std::endl;
+        return std::nullopt;
+      }
+
+      uint64_t timeslice{0};
+      std::istringstream iss(opts[i + 1]);
+      if (!(iss >> timeslice) || !iss.eof() || timeslice == 0) {
+        std::cout << "Invalid instruction count '" << opts[i + 1]
+                  << "' given to '" << opts[i] << "' instruction" << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      options.timeslice = {timeslice};
+
+      i++;
+      continue;
+    }
+
     // Toggle stats display
     if (opts[i] == "-s" || opts[i] == "--stats") {
       options.display_stats = true;
@@ -0,0 +1,163 @@
+#include "runner/pool.hpp"
+#include "logging/aixlog.hpp"
+
+#include <algorithm>
+
+namespace skiff {
+namespace runner {
+
+namespace {
+// Set on worker threads so that jobs submitted by a job stay local
+thread_local const pool_c *current_pool{nullptr};
+thread_local std::size_t current_worker{0};
+} // namespace
+
+pool_c::pool_c(std::size_t num_workers)
+{
+  LOG(TRACE) << TAG("func") << __func__ << "\n";
+
+  if (num_workers == 0) {
+    num_workers = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+#ifdef SKIFF_USE_THREADS
+  for (std::size_t i = 0; i < num_workers; i++) {
+    _queues.emplace_back(std::make_unique<worker_queue_t>());
+  }
+  for (std::size_t i = 0; i < num_workers; i++) {
+    _threads.emplace_back(&pool_c::worker, this, i);
+  }
+#else
+  // Without threads every job is run by the caller of `wait`
+  LOG(DEBUG) << TAG("pool")
+             << "Compiled without `SKIFF_USE_THREADS`, jobs run in `wait`\n";
+  _queues.emplace_back(std::make_unique<worker_queue_t>());
+#endif
+}
+
+pool_c::~pool_c()
+{
+  wait();
+  {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _work_available.notify_all();
+  for (auto &t : _threads) {
+    t.join();
+  }
+}
+
+std::size_t pool_c::get_num_workers() const
+{
+  return _threads.empty() ? 1 : _threads.size();
+}
+
+void pool_c::submit(job_t job)
+{
+  std::size_t target = 0;
+  if (current_pool == this) {
+    target = current_worker;
+  }
+  else {
+    target = _next_queue.fetch_add(1, std::memory_order_relaxed) %
+             _queues.size();
+  }
+
+  {
+    const std::lock_guard<std::mutex> lock(_queues[target]->mutex);
+    _queues[target]->jobs.push_back(std::move(job));
+  }
+
+  // The job is visible in a queue before it is counted, so a worker that
+  // claims a count is guaranteed to find a job somewhere
+  {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _queued++;
+    _outstanding++;
+  }
+  _work_available.notify_one();
+}
+
+void pool_c::wait()
+{
+#ifndef SKIFF_USE_THREADS
+  job_t job;
+  while (take(0, job)) {
+    {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      _queued--;
+    }
+    job(0);
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _outstanding--;
+  }
+#endif
+  std::unique_lock<std::mutex> lock(_mutex);
+  _all_done.wait(lock, [this]() { return _outstanding == 0; });
+}
+
+bool pool_c::take(const std::size_t id, job_t &job)
+{
+  // Oldest job from our own queue first
+  {
+    auto &own = *_queues[id];
+    const std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.jobs.empty()) {
+      job = std::move(own.jobs.front());
+      own.jobs.pop_front();
+      return true;
+    }
+  }
+
+  // Then steal the newest job from someone else
+  for (std::size_t i = 1; i < _queues.size(); i++) {
+    auto &victim = *_queues[(id + i) % _queues.size()];
+    const std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.jobs.empty()) {
+      job = std::move(victim.jobs.back());
+      victim.jobs.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+void pool_c::worker(const std::size_t id)
+{
+  current_pool = this;
+  current_worker = id;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _work_available.wait(lock,
+                           [this]() { return _stopping || _queued > 0; });
+      if (_queued == 0) {
+        return;
+      }
+      // Claim one of the queued jobs
+      _queued--;
+    }
+
+    job_t job;
+    while (!take(id, job)) {
+      // Another worker is part way through taking a job it claimed
+      std::this_thread::yield();
+    }
+
+    job(id);
+
+    bool done{false};
+    {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      done = (--_outstanding == 0);
+    }
+    if (done) {
+      _all_done.notify_all();
+    }
+  }
+}
+
+} // namespace runner
+} // namespace skiff
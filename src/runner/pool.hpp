@@ -0,0 +1,72 @@
+#ifndef SKIFF_RUNNER_POOL_HPP
+#define SKIFF_RUNNER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace skiff {
+namespace runner {
+
+//! \brief Work-stealing pool of worker threads
+//! \note  Every worker owns a queue of jobs. Workers take jobs from the
+//!        front of their own queue and, once it is empty, steal from the back
+//!        of the other workers' queues.
+class pool_c {
+public:
+  //! \brief A unit of work
+  //!        The argument is the index of the worker running the job
+  using job_t = std::function<void(const std::size_t)>;
+
+  //! \brief Construct the pool and start its workers
+  //! \param num_workers The number of worker threads. 0 selects the
+  //!        number of hardware threads
+  pool_c(std::size_t num_workers);
+
+  //! \brief Destruct the pool
+  //! \note  Waits for all submitted jobs to complete
+  ~pool_c();
+
+  //! \brief Submit a job
+  //! \param job The job to run
+  //! \note  Jobs submitted from a worker are queued on that worker,
+  //!        everything else is spread across the workers
+  void submit(job_t job);
+
+  //! \brief Block until every submitted job has completed
+  void wait();
+
+  //! \brief Retrieve the number of workers
+  [[nodiscard]] std::size_t get_num_workers() const;
+
+private:
+  struct worker_queue_t {
+    std::mutex mutex;
+    std::deque<job_t> jobs;
+  };
+
+  std::vector<std::unique_ptr<worker_queue_t>> _queues;
+  std::vector<std::thread> _threads;
+  std::atomic<std::size_t> _next_queue{0};
+
+  std::mutex _mutex;
+  std::condition_variable _work_available;
+  std::condition_variable _all_done;
+  std::size_t _queued{0};      // Guarded by _mutex
+  std::size_t _outstanding{0}; // Guarded by _mutex
+  bool _stopping{false};       // Guarded by _mutex
+
+  void worker(const std::size_t id);
+  bool take(const std::size_t id, job_t &job);
+};
+
+} // namespace runner
+} // namespace skiff
+
+#endif
@@ -1,13 +1,19 @@
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <unordered_map>
 #include <vector>
 
 #include "assembler/assemble.hpp"
 #include "defines.hpp"
 #include "logging/aixlog.hpp"
+#include "machine/aot.hpp"
+#include "machine/profiler.hpp"
+#include "machine/program.hpp"
 #include "machine/vm.hpp"
 #include "options.hpp"
+#include "runner/pool.hpp"
 #include "types.hpp"
 #include <libskiff/bytecode/executable.hpp>
 #include <libskiff/types.hpp>
@@ -34,6 +40,9 @@ void runtime_callback(skiff::types::runtime_error_e error)
   case skiff::types::runtime_error_e::DIVIDE_BY_ZERO:
     e = "Divide by 0 detected";
     break;
+  case skiff::types::runtime_error_e::CALL_STACK_OVERFLOW:
+    e = "Call stack overflow";
+    break;
   }
   LOG(FATAL) << TAG("runtime error") << e << "\n";
 }
@@ -49,7 +58,8 @@ void setup_logger(AixLog::Severity level)
 }
 
 void handle_assebmled_t(skiff::assembler::assembled_t assembled,
-                        std::optional<std::string> output, bool display_stats)
+                        std::optional<std::string> output, bool display_stats,
+                        bool write_symbols)
 {
   LOG(TRACE) << TAG("func") << __func__ << "\n";
 
@@ -103,28 +113,168 @@ void handle_assebmled_t(skiff::assembler::assembled_t assembled,
              assembled.bin.value().size());
 
   LOG(DEBUG) << TAG("app") << "Binary written to file : " << out_name << "\n";
+
+  if (write_symbols) {
+    std::ofstream sym_out(out_name + ".sym");
+    for (auto &[address, label] : assembled.labels) {
+      sym_out << address << " " << label << "\n";
+    }
+    LOG(DEBUG) << TAG("app") << "Symbols written to file : " << out_name
+               << ".sym\n";
+  }
+}
+
+//  Labels written beside a binary by `-g`, if there are any
+skiff::machine::profiler_c::symbols_t load_symbols(const std::string &bin)
+{
+  skiff::machine::profiler_c::symbols_t symbols;
+  std::ifstream sym_in(bin + ".sym");
+  uint64_t address{0};
+  std::string label;
+  while (sym_in >> address >> label) {
+    symbols[address] = label;
+  }
+  return symbols;
+}
+
+//  Write out everything gathered while profiling a binary
+void write_profile(const skiff::machine::profiler_c &profiler,
+                   const std::string &bin, const std::string &profile_file)
+{
+  auto symbols = load_symbols(bin);
+  if (symbols.empty()) {
+    LOG(INFO) << TAG("app") << "No symbols for " << bin
+              << ", assemble with -g to label the profile\n";
+  }
+
+  std::ofstream folded_out(profile_file);
+  if (!folded_out) {
+    LOG(FATAL) << TAG("app") << "Unable to open profile output file : "
+               << profile_file << "\n";
+  }
+  profiler.write_folded_stacks(folded_out, symbols);
+
+  std::cout << TERM_COLOR_CYAN << "---- Profile : " << bin << " ----"
+            << TERM_COLOR_END << std::endl;
+  profiler.write_report(std::cout, symbols, 20);
+  std::cout << "Folded stacks written to " << profile_file << std::endl;
 }
 
-int run(const std::string &bin, bool show_statistics)
+//  Binaries are decoded once and shared by every vm that runs them
+std::shared_ptr<const skiff::machine::program_c>
+get_program(const std::string &bin)
 {
+  static std::unordered_map<std::string,
+                            std::shared_ptr<const skiff::machine::program_c>>
+      programs;
+
+  if (auto it = programs.find(bin); it != programs.end()) {
+    return it->second;
+  }
+
   std::optional<std::unique_ptr<libskiff::bytecode::executable_c>>
       loaded_binary = libskiff::bytecode::load_binary(bin);
 
   if (loaded_binary == std::nullopt) {
     LOG(FATAL) << TAG("app") << "Failed to load suspected binary file : " << bin
                << "\n";
+    return nullptr;
+  }
+
+  auto [okay, program] =
+      skiff::machine::program_c::decode(*loaded_binary.value());
+  if (!okay) {
+    LOG(FATAL) << TAG("app") << "Failed to decode binary file : " << bin
+               << "\n";
+    return nullptr;
+  }
+
+  programs[bin] = program;
+  return program;
+}
+
+//  Settings given to every vm before it loads a binary
+struct vm_settings_t {
+  skiff::machine::vm_c::engine_e engine;
+  skiff::machine::memory::byte_order_e byte_order;
+  skiff::machine::memory::slab_allocator_c::settings_t allocator;
+  uint64_t memory_limit;
+  std::optional<uint64_t> stack_size;
+  std::optional<uint64_t> call_depth;
+};
+
+void apply_settings(skiff::machine::vm_c &vm, const vm_settings_t &settings)
+{
+  vm.set_engine(settings.engine);
+  vm.set_byte_order(settings.byte_order);
+  if (!vm.set_allocator_settings(settings.allocator)) {
+    LOG(WARNING) << TAG("app") << "Allocator settings not applied\n";
+  }
+  vm.set_memory_limit(settings.memory_limit);
+  if (settings.stack_size && !vm.set_stack_size(*settings.stack_size)) {
+    LOG(WARNING) << TAG("app") << "Stack size not applied\n";
+  }
+  if (settings.call_depth && !vm.set_call_depth(*settings.call_depth)) {
+    LOG(WARNING) << TAG("app") << "Call depth not applied\n";
+  }
+}
+
+//  Native modules are built once per program and kept in the cache across
+//  runs. A binary that can't be compiled is run by the threaded engine
+std::shared_ptr<const skiff::machine::aot_module_c>
+get_native_module(const skiff::machine::program_c &program)
+{
+  static std::unordered_map<uint64_t,
+                            std::shared_ptr<const skiff::machine::aot_module_c>>
+      modules;
+
+  // Hashes can collide, so a module is only reused for its own program
+  if (auto it = modules.find(program.get_hash());
+      it != modules.end() && (!it->second || it->second->matches(program))) {
+    return it->second;
+  }
+
+  auto [okay, module] = skiff::machine::aot_module_c::build(
+      program, skiff::machine::aot_module_c::get_default_cache_directory());
+  if (!okay) {
+    LOG(FATAL) << TAG("app") << "Failed to compile binary to native code\n";
+  }
+
+  modules[program.get_hash()] = module;
+  return module;
+}
+
+int run(const std::string &bin, bool show_statistics,
+        const vm_settings_t &settings,
+        const std::optional<std::string> &profile_file)
+{
+  auto program = get_program(bin);
+  if (!program) {
     return 1;
   }
 
   skiff::machine::vm_c vm;
   vm.set_runtime_callback(runtime_callback);
+  apply_settings(vm, settings);
+  if (settings.engine == skiff::machine::vm_c::engine_e::NATIVE) {
+    vm.set_native_module(get_native_module(*program));
+  }
 
-  if (!vm.load(std::move(loaded_binary.value()))) {
+  if (!vm.load(program)) {
     LOG(FATAL) << TAG("app") << "Failed to load VM\n";
     return 1;
   }
 
+  std::shared_ptr<skiff::machine::profiler_c> profiler;
+  if (profile_file) {
+    profiler = std::make_shared<skiff::machine::profiler_c>();
+    vm.set_profiler(profiler);
+  }
+
   auto [value, code] = vm.execute();
+  if (profiler) {
+    write_profile(*profiler, bin, *profile_file);
+  }
   if (value != skiff::machine::vm_c::execution_result_e::OKAY) {
     LOG(FATAL) << TAG("app") << "VM Died with an error\n";
     return code;
@@ -139,6 +289,145 @@ int run(const std::string &bin, bool show_statistics)
   return code;
 }
 
+//  Result of running a single binary on the job pool
+struct job_result_t {
+  std::string bin;
+  bool loaded{false};
+  skiff::machine::vm_c::execution_result_e result{
+      skiff::machine::vm_c::execution_result_e::ERROR};
+  int code{1};
+  std::size_t worker{0};
+  std::size_t slices{0};
+  skiff::machine::vm_c::runtime_data_t stats;
+};
+
+void display_job_statistics(const std::vector<job_result_t> &results,
+                            const std::size_t num_workers)
+{
+  std::size_t failed{0};
+  std::cout << TERM_COLOR_CYAN << "------- Job Statistics -------"
+            << TERM_COLOR_END << std::endl;
+  for (std::size_t i = 0; i < results.size(); i++) {
+    auto &r = results[i];
+    std::cout << TERM_COLOR_YELLOW << "[" << i << "] " << TERM_COLOR_END
+              << r.bin << " : worker " << r.worker << ", ";
+    if (!r.loaded) {
+      std::cout << "failed to load" << std::endl;
+      failed++;
+      continue;
+    }
+    if (r.result != skiff::machine::vm_c::execution_result_e::OKAY ||
+        r.code != 0) {
+      failed++;
+    }
+    std::cout << "exit code " << r.code << ", "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     r.stats.end - r.stats.start)
+                     .count()
+              << "ms, " << r.slices << " slices";
+#ifdef SKIFF_GENERATE_STATS
+    std::cout << ", " << r.stats.instructions_executed << " instructions";
+#endif
+    std::cout << std::endl;
+  }
+  std::cout << TERM_COLOR_YELLOW << "Workers               : " << TERM_COLOR_END
+            << num_workers << std::endl;
+  std::cout << TERM_COLOR_YELLOW << "Jobs run              : " << TERM_COLOR_END
+            << results.size() << std::endl;
+  std::cout << TERM_COLOR_YELLOW << "Jobs failed           : " << TERM_COLOR_END
+            << failed << std::endl;
+  std::cout << TERM_COLOR_CYAN << "------------------------------"
+            << TERM_COLOR_END << std::endl;
+}
+
+//  Run one slice of a vm. A vm that yields is queued behind the other jobs on
+//  the pool so that long running binaries can't starve the rest
+void run_slice(skiff::runner::pool_c &pool,
+               std::shared_ptr<skiff::machine::vm_c> vm, job_result_t &result,
+               const skiff::machine::vm_c::execution_limit_t limit)
+{
+  pool.submit([&pool, vm, &result, limit](const std::size_t worker) {
+    result.worker = worker;
+    result.slices++;
+
+    auto [value, code] = vm->execute(limit);
+    if (value == skiff::machine::vm_c::execution_result_e::YIELDED) {
+      run_slice(pool, vm, result, limit);
+      return;
+    }
+    result.result = value;
+    result.code = code;
+    result.stats = vm->get_runtime_data();
+  });
+}
+
+//  Run every binary on a pool of workers. Each vm is only ever run by one
+//  worker at a time, the decoded programs are shared between all of them.
+//  With a timeslice, vms yield back to the pool every `timeslice`
+//  instructions so that many binaries can share a few workers
+int run_jobs(const std::vector<std::string> &bins, const std::size_t num_jobs,
+             const std::optional<uint64_t> timeslice, bool show_statistics,
+             const vm_settings_t &settings)
+{
+  // Decode and compile up front so workers only ever see finished programs
+  std::vector<std::shared_ptr<const skiff::machine::program_c>> programs;
+  std::vector<std::shared_ptr<const skiff::machine::aot_module_c>> modules;
+  for (auto &bin : bins) {
+    programs.push_back(get_program(bin));
+    modules.push_back(
+        programs.back() &&
+                settings.engine == skiff::machine::vm_c::engine_e::NATIVE
+            ? get_native_module(*programs.back())
+            : nullptr);
+  }
+
+  skiff::machine::vm_c::execution_limit_t limit;
+  if (timeslice) {
+    limit.max_instructions = *timeslice;
+  }
+
+  std::vector<job_result_t> results(bins.size());
+  std::size_t num_workers{0};
+  {
+    skiff::runner::pool_c pool(num_jobs);
+    num_workers = pool.get_num_workers();
+
+    for (std::size_t i = 0; i < bins.size(); i++) {
+      auto &result = results[i];
+      result.bin = bins[i];
+      if (!programs[i]) {
+        continue;
+      }
+
+      auto vm = std::make_shared<skiff::machine::vm_c>();
+      vm->set_runtime_callback(runtime_callback);
+      apply_settings(*vm, settings);
+      vm->set_native_module(modules[i]);
+      if (!vm->load(programs[i])) {
+        LOG(FATAL) << TAG("app") << "Failed to load VM for " << bins[i]
+                   << "\n";
+        continue;
+      }
+      result.loaded = true;
+
+      run_slice(pool, vm, result, limit);
+    }
+    pool.wait();
+  }
+
+  if (show_statistics) {
+    display_job_statistics(results, num_workers);
+  }
+
+  // Report the first failure in the order the binaries were given
+  for (auto &result : results) {
+    if (result.code != 0) {
+      return result.code;
+    }
+  }
+  return 0;
+}
+
 int main(int argc, char **argv)
 {
   auto opts =
@@ -171,14 +460,35 @@ int main(int argc, char **argv)
 
     // Handle resulting object
     handle_assebmled_t(result, opts->assemble_file->file_out,
-                       opts->display_stats);
+                       opts->display_stats, opts->assemble_file->write_symbols);
     return 0;
   }
 
+  if (opts->aot) {
+    opts->engine = skiff::machine::vm_c::engine_e::NATIVE;
+  }
+
   //  Check for bins
+  if (opts->profile_file &&
+      (opts->suspected_bin.size() > 1 || opts->num_jobs != std::nullopt)) {
+    std::cout << "Only one binary can be profiled at a time, without '-j'"
+              << std::endl;
+    return 1;
+  }
+
+  const vm_settings_t settings{opts->engine, opts->byte_order,
+                               opts->allocator, opts->memory_limit,
+                               opts->stack_size, opts->call_depth};
+
+  if (!opts->suspected_bin.empty() && opts->num_jobs != std::nullopt) {
+    return run_jobs(opts->suspected_bin, *opts->num_jobs, opts->timeslice,
+                    opts->display_stats, settings);
+  }
+
   if (!opts->suspected_bin.empty()) {
     for (auto &item : opts->suspected_bin) {
-      if (auto i = run(item, opts->display_stats); i != 0) {
+      if (auto i = run(item, opts->display_stats, settings, opts->profile_file);
+          i != 0) {
         return i;
       }
     }
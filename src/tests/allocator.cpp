@@ -0,0 +1,202 @@
+#include "machine/memory/allocator.hpp"
+#include "machine/memory/memman.hpp"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+
+TEST_GROUP(allocator_tests){};
+
+TEST(allocator_tests, size_classes)
+{
+  using allocator_c = skiff::machine::memory::slab_allocator_c;
+
+  CHECK_EQUAL(0, allocator_c::get_size_class(0));
+  CHECK_EQUAL(0, allocator_c::get_size_class(16));
+  CHECK_EQUAL(1, allocator_c::get_size_class(17));
+  CHECK_EQUAL(1, allocator_c::get_size_class(32));
+  CHECK_EQUAL(2, allocator_c::get_size_class(33));
+  CHECK_EQUAL(allocator_c::num_size_classes - 1,
+              allocator_c::get_size_class(allocator_c::max_block_bytes));
+  CHECK_EQUAL(allocator_c::num_size_classes,
+              allocator_c::get_size_class(allocator_c::max_block_bytes + 1));
+}
+
+TEST(allocator_tests, recycle)
+{
+  skiff::machine::memory::slab_allocator_c allocator;
+
+  // Freed blocks are handed out again before a slab is carved further
+  auto first = allocator.allocate(24);
+  auto second = allocator.allocate(24);
+  CHECK_TRUE(first != second);
+  std::memset(first, 0xAA, 24);
+  std::memset(second, 0xBB, 24);
+  allocator.release(first, 24);
+  CHECK_TRUE(first == allocator.allocate(30));
+
+  auto &stats = allocator.get_stats();
+  CHECK_EQUAL(3, stats.allocations);
+  CHECK_EQUAL(1, stats.frees);
+  CHECK_EQUAL(1, stats.slabs);
+  CHECK_EQUAL(64, stats.bytes_in_use);
+  CHECK_EQUAL(3, stats.class_allocations[1]);
+
+  // Large blocks are mapped on their own and returned on release
+  auto large = allocator.allocate(100'000);
+  std::memset(large, 0xCC, 100'000);
+  CHECK_EQUAL(1, stats.large_in_use);
+  CHECK_TRUE(stats.large_bytes >= 100'000);
+  CHECK_EQUAL(64 + stats.large_bytes, stats.bytes_in_use);
+  allocator.release(large, 100'000);
+  CHECK_EQUAL(0, stats.large_in_use);
+  CHECK_EQUAL(64, stats.bytes_in_use);
+  CHECK_TRUE(stats.peak_bytes_in_use >= 100'064);
+
+  // Filling past a slab maps another
+  std::vector<void *> blocks;
+  const auto per_slab = allocator.slab_bytes / allocator.max_block_bytes;
+  for (std::size_t i = 0; i <= per_slab; i++) {
+    blocks.push_back(allocator.allocate(allocator.max_block_bytes));
+  }
+  CHECK_EQUAL(3, stats.slabs);
+  for (auto block : blocks) {
+    allocator.release(block, allocator.max_block_bytes);
+  }
+  CHECK_EQUAL(3, stats.slabs);
+}
+
+TEST(allocator_tests, reallocate)
+{
+  skiff::machine::memory::slab_allocator_c allocator;
+  auto &stats = allocator.get_stats();
+
+  // Blocks stay put while they fit their class, and move when they don't
+  auto block = allocator.allocate(20);
+  std::memset(block, 0xAA, 20);
+  CHECK_TRUE(block == allocator.reallocate(block, 20, 32));
+  auto moved = static_cast<uint8_t *>(allocator.reallocate(block, 32, 100));
+  CHECK_TRUE(moved != block);
+  CHECK_EQUAL(0xAA, moved[19]);
+  CHECK_EQUAL(128, stats.bytes_in_use);
+
+  // Large blocks keep their bytes as they grow and shrink
+  auto large = static_cast<uint8_t *>(allocator.reallocate(moved, 100, 8192));
+  CHECK_EQUAL(0xAA, large[0]);
+  large[8191] = 0xBB;
+  large = static_cast<uint8_t *>(allocator.reallocate(large, 8192, 1 << 20));
+  CHECK_EQUAL(0xAA, large[19]);
+  CHECK_EQUAL(0xBB, large[8191]);
+  CHECK_EQUAL(1, stats.large_in_use);
+  CHECK_EQUAL(1 << 20, stats.large_bytes);
+  large = static_cast<uint8_t *>(allocator.reallocate(large, 1 << 20, 5000));
+  CHECK_EQUAL(0xAA, large[19]);
+  CHECK_EQUAL(1, stats.large_in_use);
+  CHECK_TRUE(stats.large_bytes >= 5000 && stats.large_bytes < 1 << 20);
+#ifdef __linux__
+  CHECK_EQUAL(2, stats.remaps);
+#endif
+
+  // And come back to a slab when they shrink far enough
+  auto small = static_cast<uint8_t *>(allocator.reallocate(large, 5000, 16));
+  CHECK_EQUAL(0xAA, small[15]);
+  CHECK_EQUAL(0, stats.large_in_use);
+  CHECK_EQUAL(0, stats.large_bytes);
+  CHECK_EQUAL(16, stats.bytes_in_use);
+  CHECK_EQUAL(6, stats.reallocations);
+  allocator.release(small, 16);
+  CHECK_EQUAL(0, stats.bytes_in_use);
+}
+
+TEST(allocator_tests, memman_slots)
+{
+  skiff::machine::memory::memman_c memman;
+
+  // Short lived slots of the same size are served from the same blocks
+  for (auto i = 0; i < 1000; i++) {
+    auto [okay, id] = memman.alloc(40);
+    CHECK_TRUE(okay);
+    auto slot = memman.get_slot(id);
+    CHECK_TRUE(slot != nullptr);
+    CHECK_TRUE(slot->put_qword(8, i));
+    CHECK_TRUE(memman.free(id));
+  }
+
+  auto [okay, big] = memman.alloc(1 << 20);
+  CHECK_TRUE(okay);
+  CHECK_TRUE(memman.get_slot(big)->put_qword((1 << 20) - 16, 42));
+
+  auto stats = memman.get_allocator_stats();
+  CHECK_EQUAL(2002, stats.allocations);
+  CHECK_EQUAL(2000, stats.frees);
+  CHECK_EQUAL(1, stats.large_in_use);
+  CHECK_TRUE(stats.slabs <= 2);
+}
+
+TEST(allocator_tests, large_settings)
+{
+  using allocator_c = skiff::machine::memory::slab_allocator_c;
+  allocator_c allocator;
+  auto &stats = allocator.get_stats();
+
+  // Blocks under the threshold come from the heap and keep their size
+  allocator_c::settings_t settings;
+  settings.map_threshold = 1 << 16;
+  settings.retained_bytes = 1 << 20;
+  CHECK_TRUE(allocator.set_settings(settings));
+  auto heap = static_cast<uint8_t *>(allocator.allocate(5000));
+  CHECK_EQUAL(1, stats.heap_in_use);
+  CHECK_EQUAL(0, stats.large_in_use);
+  CHECK_EQUAL(5000, stats.bytes_in_use);
+  heap[4999] = 0xAA;
+
+  // They can't change under blocks that are in use
+  CHECK_FALSE(allocator.set_settings({}));
+  CHECK_EQUAL(1 << 16, allocator.get_settings().map_threshold);
+
+  // Growing past the threshold moves them into a mapping
+  auto mapped =
+      static_cast<uint8_t *>(allocator.reallocate(heap, 5000, 1 << 17));
+  CHECK_EQUAL(0xAA, mapped[4999]);
+  CHECK_EQUAL(0, stats.heap_in_use);
+  CHECK_EQUAL(1, stats.large_in_use);
+
+  // Released mappings are kept and come back zeroed
+  std::memset(mapped, 0xBB, 1 << 17);
+  allocator.release(mapped, 1 << 17);
+  CHECK_EQUAL(0, stats.large_in_use);
+  auto reused = static_cast<uint8_t *>(allocator.allocate(1 << 17));
+#ifdef __linux__
+  CHECK_EQUAL(1, stats.reused_mappings);
+  CHECK_TRUE(reused == mapped);
+#endif
+  CHECK_EQUAL(0, reused[0]);
+  CHECK_EQUAL(0, reused[(1 << 17) - 1]);
+  allocator.release(reused, 1 << 17);
+
+  // Nothing past the retention limit is kept
+  auto first = allocator.allocate(1 << 19);
+  auto second = allocator.allocate(1 << 19);
+  auto third = allocator.allocate(1 << 19);
+  allocator.release(first, 1 << 19);
+  allocator.release(second, 1 << 19);
+  allocator.release(third, 1 << 19);
+  CHECK_TRUE(stats.retained_bytes <= 1 << 20);
+  CHECK_EQUAL(0, stats.bytes_in_use);
+
+  // Huge page mappings start on a huge page boundary
+  settings.huge_pages = true;
+  CHECK_TRUE(allocator.set_settings(settings));
+  CHECK_EQUAL(0, stats.retained_bytes);
+  const std::size_t huge = 3 * allocator_c::huge_page_bytes;
+  auto block = static_cast<uint8_t *>(allocator.allocate(huge));
+  block[huge - 1] = 0xCC;
+#ifdef __linux__
+  CHECK_EQUAL(0, reinterpret_cast<std::uintptr_t>(block) %
+                     allocator_c::huge_page_bytes);
+  CHECK_EQUAL(1, stats.huge_mappings);
+#endif
+  allocator.release(block, huge);
+  CHECK_EQUAL(0, stats.large_in_use);
+}
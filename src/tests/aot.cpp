@@ -0,0 +1,424 @@
+#include "logging/aixlog.hpp"
+#include "machine/aot.hpp"
+#include "machine/program.hpp"
+#include "machine/vm.hpp"
+#include "tests/test_programs.hpp"
+#include <libskiff/bytecode/executable.hpp>
+
+#include <CppUTest/TestHarness.h>
+#include <filesystem>
+#include <vector>
+
+namespace {
+
+using skiff::tests::build_program;
+
+struct tc_aot_t {
+  std::string data;
+  skiff::machine::vm_c::execution_result_e result;
+  int exit_code;
+};
+
+const std::filesystem::path cache_directory = "tmp.aot.test.cache";
+
+} // namespace
+
+TEST_GROUP(aot_tests){void setup(){} void teardown(){}};
+
+TEST(aot_tests, native_matches_threaded)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  using result_e = skiff::machine::vm_c::execution_result_e;
+  using engine_e = skiff::machine::vm_c::engine_e;
+
+  std::vector<tc_aot_t> tcs;
+
+  // Integer arithmetic, calls and returns
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "step:\n"
+                 "  add i0 i0 x1\n"
+                 "  mul i3 i0 i2\n"
+                 "  div i4 i3 i2\n"
+                 "  lsh i5 i4 i2\n"
+                 "  rsh i5 i5 x1\n"
+                 "  xor i7 i7 i5\n"
+                 "  ret\n"
+                 "main:\n"
+                 "  mov i1 @5000\n"
+                 "  mov i2 @3\n"
+                 "loop:\n"
+                 "  call step\n"
+                 "  blt i0 i1 loop\n"
+                 "  not i8 i1\n"
+                 "  aseq x0 i8\n"
+                 "  mov i0 @9\n"
+                 "  exit\n",
+                 result_e::OKAY, 9});
+
+  // The data stack and memory through the vm
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @16\n"
+                 "  alloc i2 i1\n"
+                 "  mov i3 @1234\n"
+                 "  push_qw i3\n"
+                 "  pop_qw i4\n"
+                 "  sqw i2 x0 i4\n"
+                 "  lqw i2 x0 i5\n"
+                 "  aseq i3 i5\n"
+                 "  free i2\n"
+                 "  mov i0 @4\n"
+                 "  exit\n",
+                 result_e::OKAY, 4});
+
+  // Regions through the vm
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @16\n"
+                 "  region_begin i7\n"
+                 "  alloc i2 i1\n"
+                 "  sqw i2 x0 i1\n"
+                 "  region_free i7\n"
+                 "  aseq x1 op\n"
+                 "  lqw i2 x0 i3\n"
+                 "  aseq x0 op\n"
+                 "  mov i0 @6\n"
+                 "  exit\n",
+                 result_e::OKAY, 6});
+
+  // Bulk memory through the vm
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @32\n"
+                 "  alloc i2 i1\n"
+                 "  alloc i3 i1\n"
+                 "  mov i4 @7\n"
+                 "  mset i2 x0 i1 i4\n"
+                 "  mcpy i3 x0 i2 x0 i1\n"
+                 "  mcmp i5 i3 x0 i2 x0 i1\n"
+                 "  aseq x0 i5\n"
+                 "  lqw i3 x0 i6\n"
+                 "  mov i7 @506381209866536711\n"
+                 "  aseq i6 i7\n"
+                 "  mov i0 @2\n"
+                 "  exit\n",
+                 result_e::OKAY, 2});
+
+  // Vector instructions through the vm
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @16\n"
+                 "  alloc i2 i1\n"
+                 "  mov i4 @2\n"
+                 "  mset i2 x0 i1 i4\n"
+                 "  vmul_u8 i2 x0 i2 x0 i2 x0 i1\n"
+                 "  aseq x1 op\n"
+                 "  vsum_u8 i5 i2 x0 i1\n"
+                 "  vdot_u64 i6 i2 x0 i2 x0 i4\n"
+                 "  aseq x1 op\n"
+                 "  vhmin_u8 i7 i2 x0 x0\n"
+                 "  aseq x0 op\n"
+                 "  mov i0 @64\n"
+                 "  aseq i0 i5\n"
+                 "  exit\n",
+                 result_e::OKAY, 64});
+
+  // Resizing slots through the vm
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @8\n"
+                 "  alloc i2 i1\n"
+                 "  mov i3 @5\n"
+                 "  shw i2 x0 i3\n"
+                 "  mov i4 @9000\n"
+                 "  realloc i2 i4\n"
+                 "  aseq x1 op\n"
+                 "  lhw i2 x0 i0\n"
+                 "  exit\n",
+                 result_e::OKAY, 5});
+
+  // Locals kept on the stack
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @3\n"
+                 "  push_qw i1\n"
+                 "  push_qw i1\n"
+                 "  mov i2 @0\n"
+                 "loop:\n"
+                 "  lsqw sp @-8 i3\n"
+                 "  add i3 i3 i1\n"
+                 "  ssqw sp @-8 i3\n"
+                 "  add i2 i2 x1\n"
+                 "  blt i2 i1 loop\n"
+                 "  lsqw sp @-16 i4\n"
+                 "  pop_qw i0\n"
+                 "  add i0 i0 i4\n"
+                 "  exit\n",
+                 result_e::OKAY, 15});
+
+  // Runaway recursion
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "descend:\n"
+                 "  call descend\n"
+                 "main:\n"
+                 "  call descend\n"
+                 "  exit\n",
+                 result_e::ERROR, 1});
+
+  // Registers saved and restored around a call
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "clobber:\n"
+                 "  pushm i1 i3 f0\n"
+                 "  mov i1 @0\n"
+                 "  mov i3 @0\n"
+                 "  mov f0 @0\n"
+                 "  popm i1 i3 f0\n"
+                 "  ret\n"
+                 "main:\n"
+                 "  mov i1 @5\n"
+                 "  mov i3 @6\n"
+                 "  mov f0 @9\n"
+                 "  call clobber\n"
+                 "  add i0 i1 i3\n"
+                 "  mov i2 @9\n"
+                 "  aseq i2 f0\n"
+                 "  exit\n",
+                 result_e::OKAY, 11});
+
+  // Arithmetic and branches taking immediates
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  addi i0 i0 @5\n"
+                 "  lshi i1 i0 @2\n"
+                 "  rshi i1 i1 @1\n"
+                 "  muli i2 i1 @3\n"
+                 "  subi i2 i2 @1\n"
+                 "  andi i2 i2 @255\n"
+                 "  ori i2 i2 @256\n"
+                 "  blti i0 @100 main\n"
+                 "  beqi i0 @100 equal\n"
+                 "  exit\n"
+                 "equal:\n"
+                 "  bgti i0 @-1 bad\n"
+                 "  subi i0 i2 @256\n"
+                 "  exit\n"
+                 "bad:\n"
+                 "  mov i0 @1\n"
+                 "  exit\n",
+                 result_e::OKAY, 87});
+
+  // Floating point
+  tcs.push_back({".init main\n"
+                 ".float one 1.0\n"
+                 ".float limit 300.0\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i9 @0\n"
+                 "  mov i8 &one\n"
+                 "  lqw i9 i8 f1\n"
+                 "  mov i8 &limit\n"
+                 "  lqw i9 i8 f2\n"
+                 "loop:\n"
+                 "  addf f0 f0 f1\n"
+                 "  divf f3 f0 f1\n"
+                 "  bltf f3 f2 loop\n"
+                 "  beqf f0 f2 done\n"
+                 "  exit\n"
+                 "done:\n"
+                 "  mov i0 @3\n"
+                 "  exit\n",
+                 result_e::OKAY, 3});
+
+  // Errors are reported by the interpreter
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @3\n"
+                 "loop:\n"
+                 "  sub i1 i1 x1\n"
+                 "  div i2 i2 i1\n"
+                 "  jmp loop\n",
+                 result_e::ERROR, 1});
+
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  ret\n",
+                 result_e::ERROR, 1});
+
+  for (auto &tc : tcs) {
+    auto program = build_program(tc.data);
+    CHECK_TRUE(program != nullptr);
+
+    auto [built, module] =
+        skiff::machine::aot_module_c::build(*program, cache_directory);
+    CHECK_TRUE(built);
+    CHECK_EQUAL(program->get_hash(), module->get_hash());
+
+    for (auto engine : {engine_e::THREADED, engine_e::NATIVE}) {
+      skiff::machine::vm_c vm;
+      vm.set_engine(engine);
+      vm.set_native_module(module);
+      CHECK_TRUE(vm.load(program));
+      CHECK_TRUE(engine == vm.get_engine());
+
+      auto [result, code] = vm.execute();
+      CHECK_EQUAL(static_cast<int>(tc.result), static_cast<int>(result));
+      CHECK_EQUAL(tc.exit_code, code & 0xFF);
+    }
+  }
+  std::filesystem::remove_all(cache_directory);
+}
+
+TEST(aot_tests, native_budget_and_cache)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  using result_e = skiff::machine::vm_c::execution_result_e;
+
+  // 1 + 2 * 20000 + 1 instructions
+  auto program = build_program(".init main\n"
+                               ".code\n"
+                               "main:\n"
+                               "  mov i1 @20000\n"
+                               "loop:\n"
+                               "  add i0 i0 x1\n"
+                               "  blt i0 i1 loop\n"
+                               "  exit\n");
+  CHECK_TRUE(program != nullptr);
+
+  auto [built, module] =
+      skiff::machine::aot_module_c::build(*program, cache_directory);
+  CHECK_TRUE(built);
+  CHECK_FALSE(module->is_from_cache());
+
+  auto [cached, again] =
+      skiff::machine::aot_module_c::build(*program, cache_directory);
+  CHECK_TRUE(cached);
+  CHECK_TRUE(again->is_from_cache());
+
+  skiff::machine::vm_c vm;
+  vm.set_engine(skiff::machine::vm_c::engine_e::NATIVE);
+  vm.set_native_module(again);
+  CHECK_TRUE(vm.load(program));
+
+  std::size_t yields{0};
+  while (true) {
+    auto [result, code] = vm.execute({.max_instructions = 7});
+    if (result != result_e::YIELDED) {
+      CHECK_EQUAL(static_cast<int>(result_e::OKAY), static_cast<int>(result));
+      CHECK_EQUAL(20000, code);
+      break;
+    }
+    yields++;
+  }
+  CHECK_EQUAL(40002 / 7, yields);
+
+  // A module built for another program is not used
+  auto other = build_program(".init main\n"
+                             ".code\n"
+                             "main:\n"
+                             "  exit\n");
+  CHECK_TRUE(other != nullptr);
+  skiff::machine::vm_c mismatched;
+  mismatched.set_engine(skiff::machine::vm_c::engine_e::NATIVE);
+  mismatched.set_native_module(again);
+  CHECK_TRUE(mismatched.load(other));
+  CHECK_TRUE(skiff::machine::vm_c::engine_e::THREADED ==
+             mismatched.get_engine());
+  std::filesystem::remove_all(cache_directory);
+}
+
+TEST(aot_tests, cache_trust)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  auto program = build_program(".init main\n"
+                               ".code\n"
+                               "main:\n"
+                               "  mov i0 @3\n"
+                               "  exit\n");
+  auto other = build_program(".init main\n"
+                             ".code\n"
+                             "main:\n"
+                             "  mov i0 @4\n"
+                             "  exit\n");
+  CHECK_TRUE(program != nullptr);
+  CHECK_TRUE(other != nullptr);
+
+  // The cache is created private to its owner
+  auto [built, module] =
+      skiff::machine::aot_module_c::build(*program, cache_directory);
+  CHECK_TRUE(built);
+  CHECK_TRUE(module->matches(*program));
+  CHECK_FALSE(module->matches(*other));
+  CHECK_TRUE(std::filesystem::status(cache_directory).permissions() ==
+             std::filesystem::perms::owner_all);
+
+  std::filesystem::path module_path;
+  for (auto &entry : std::filesystem::directory_iterator(cache_directory)) {
+    if (entry.path().extension() == ".so") {
+      module_path = entry.path();
+    }
+  }
+  CHECK_FALSE(module_path.empty());
+
+  // A module is only opened for the program it was built from
+  CHECK_TRUE(std::get<0>(
+      skiff::machine::aot_module_c::open(module_path, *program)));
+  CHECK_FALSE(std::get<0>(
+      skiff::machine::aot_module_c::open(module_path, *other)));
+
+  // A module others could have written to is never opened, and is rebuilt
+  std::filesystem::permissions(module_path, std::filesystem::perms::all);
+  CHECK_FALSE(std::get<0>(
+      skiff::machine::aot_module_c::open(module_path, *program)));
+  auto [rebuilt, replacement] =
+      skiff::machine::aot_module_c::build(*program, cache_directory);
+  CHECK_TRUE(rebuilt);
+  CHECK_FALSE(replacement->is_from_cache());
+
+  // Neither is a cache others can write to
+  std::filesystem::permissions(cache_directory, std::filesystem::perms::all);
+  CHECK_FALSE(std::get<0>(
+      skiff::machine::aot_module_c::build(*program, cache_directory)));
+  std::filesystem::remove_all(cache_directory);
+}
+
+TEST(aot_tests, cache_path_passed_verbatim)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  auto program = build_program(".init main\n"
+                               ".code\n"
+                               "main:\n"
+                               "  mov i0 @5\n"
+                               "  exit\n");
+  CHECK_TRUE(program != nullptr);
+
+  // The compiler isn't run through a shell, so quotes and spaces in the
+  // cache path are just part of it
+  const std::filesystem::path odd_directory = "tmp.aot.test 'quoted; cache";
+  auto [built, module] =
+      skiff::machine::aot_module_c::build(*program, odd_directory);
+  CHECK_TRUE(built);
+
+  skiff::machine::vm_c vm;
+  vm.set_engine(skiff::machine::vm_c::engine_e::NATIVE);
+  vm.set_native_module(module);
+  CHECK_TRUE(vm.load(program));
+  CHECK_TRUE(skiff::machine::vm_c::engine_e::NATIVE == vm.get_engine());
+  CHECK_EQUAL(5, std::get<1>(vm.execute()));
+  std::filesystem::remove_all(odd_directory);
+}
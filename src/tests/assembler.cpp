@@ -109,3 +109,38 @@ TEST(assembler_tests, all)
         static_cast<int>(loaded_binary.value().get()->get_debug_level()));
   }
 }
+
+TEST(assembler_tests, immediates)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  struct tc_immediate_t {
+    std::string instruction;
+    bool valid;
+  };
+
+  std::vector<tc_immediate_t> tcs = {
+      {"addi i0 i0 @18446744073709551615", true},
+      {"subi i0 i0 @-1", true},
+      {"lshi i0 i0 @63", true},
+      {"lshi i0 i0 @64", false},
+      {"rshi i0 i0 @64", false},
+      {"andi i0 i0", false},
+      {"blti i0 @2147483647 main", true},
+      {"bgti i0 @-2147483648 main", true},
+      {"beqi i0 @2147483648 main", false},
+      {"blti i0 @-2147483649 main", false},
+      {"blti i0 @1 nowhere", false},
+      {"bgti @1 i0 main", false},
+  };
+
+  for (auto &tc : tcs) {
+    {
+      std::ofstream ofs("tmp.test.asm");
+      ofs << ".init main\n.code\nmain:\n  " << tc.instruction
+          << "\n  exit\n";
+    }
+    auto result = skiff::assembler::assemble("tmp.test.asm");
+    CHECK_EQUAL(tc.valid, result.errors == std::nullopt);
+  }
+}
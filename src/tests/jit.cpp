@@ -0,0 +1,220 @@
+#include "logging/aixlog.hpp"
+#include "machine/program.hpp"
+#include "machine/vm.hpp"
+#include "tests/test_programs.hpp"
+#include <libskiff/bytecode/executable.hpp>
+
+#include <CppUTest/TestHarness.h>
+#include <vector>
+
+namespace {
+
+using skiff::tests::build_program;
+
+struct tc_jit_t {
+  std::string data;
+  skiff::machine::vm_c::execution_result_e result;
+  int exit_code;
+};
+
+} // namespace
+
+TEST_GROUP(jit_tests){void setup(){} void teardown(){}};
+
+TEST(jit_tests, tiered_matches_threaded)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  using result_e = skiff::machine::vm_c::execution_result_e;
+
+  std::vector<tc_jit_t> tcs;
+
+  // Every integer template inside a hot loop
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @5000\n"
+                 "  mov i2 @3\n"
+                 "  mov i8 @18446744073709551615\n"
+                 "loop:\n"
+                 "  add i0 i0 x1\n"
+                 "  mul i3 i0 i2\n"
+                 "  sub i3 i3 i0\n"
+                 "  div i4 i3 i2\n"
+                 "  lsh i5 i4 i2\n"
+                 "  rsh i5 i5 x1\n"
+                 "  and i6 i5 i8\n"
+                 "  or i6 i6 x1\n"
+                 "  xor i7 i7 i6\n"
+                 "  not i9 i7\n"
+                 "  add x0 x0 x1\n"
+                 "  nop\n"
+                 "  blt i0 i1 loop\n"
+                 "  mov i2 @13340\n"
+                 "  aseq i2 i7\n"
+                 "  aseq x0 i9\n"
+                 "  mov i0 @0\n"
+                 "  exit\n",
+                 result_e::OKAY, 0});
+
+  // Every immediate template inside a hot loop, with a forward branch out
+  // of it and a comparison against a sign extended value
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "loop:\n"
+                 "  addi i0 i0 @1\n"
+                 "  muli i3 i0 @3\n"
+                 "  subi i3 i3 @1\n"
+                 "  lshi i5 i3 @3\n"
+                 "  rshi i5 i5 @1\n"
+                 "  andi i6 i5 @4095\n"
+                 "  ori i6 i6 @1\n"
+                 "  xor i7 i7 i6\n"
+                 "  beqi i0 @2500 mark\n"
+                 "back:\n"
+                 "  blti i0 @5000 loop\n"
+                 "  jmp done\n"
+                 "mark:\n"
+                 "  addi i9 i9 @7\n"
+                 "  jmp back\n"
+                 "done:\n"
+                 "  bgti i0 @-1 bad\n"
+                 "  mov i1 @608\n"
+                 "  aseq i1 i7\n"
+                 "  mov i1 @7\n"
+                 "  aseq i1 i9\n"
+                 "  mov i0 @5\n"
+                 "  exit\n"
+                 "bad:\n"
+                 "  mov i0 @9\n"
+                 "  exit\n",
+                 result_e::OKAY, 5});
+
+  // Nested loops with forward branches and a jmp back-edge
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @200\n"
+                 "outer:\n"
+                 "  mov i2 @0\n"
+                 "inner:\n"
+                 "  add i2 i2 x1\n"
+                 "  add i3 i3 x1\n"
+                 "  beq i2 i1 next\n"
+                 "  jmp inner\n"
+                 "next:\n"
+                 "  add i0 i0 x1\n"
+                 "  bgt i1 i0 outer\n"
+                 "  mov i4 @40000\n"
+                 "  aseq i3 i4\n"
+                 "  mov i0 @7\n"
+                 "  exit\n",
+                 result_e::OKAY, 7});
+
+  // Floating point through the helpers
+  tcs.push_back({".init main\n"
+                 ".float one 1.0\n"
+                 ".float two 2.0\n"
+                 ".float limit 2000.0\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i9 @0\n"
+                 "  mov i8 &one\n"
+                 "  lqw i9 i8 f1\n"
+                 "  mov i8 &two\n"
+                 "  lqw i9 i8 f3\n"
+                 "  mov i8 &limit\n"
+                 "  lqw i9 i8 f2\n"
+                 "loop:\n"
+                 "  addf f0 f0 f1\n"
+                 "  mulf f4 f0 f3\n"
+                 "  divf f5 f4 f3\n"
+                 "  subf f6 f5 f0\n"
+                 "  bltf f0 f2 loop\n"
+                 "  beqf f0 f2 done\n"
+                 "  exit\n"
+                 "done:\n"
+                 "  mov i0 @3\n"
+                 "  exit\n",
+                 result_e::OKAY, 3});
+
+  // Leaves native code before dividing by zero
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @3000\n"
+                 "  mov i2 @2000\n"
+                 "loop:\n"
+                 "  add i0 i0 x1\n"
+                 "  sub i2 i2 x1\n"
+                 "  div i3 i0 i2\n"
+                 "  blt i0 i1 loop\n"
+                 "  exit\n",
+                 result_e::ERROR, 1});
+
+  // Hot call target
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "count:\n"
+                 "  add i0 i0 x1\n"
+                 "  ret\n"
+                 "main:\n"
+                 "  mov i1 @5000\n"
+                 "loop:\n"
+                 "  call count\n"
+                 "  blt i0 i1 loop\n"
+                 "  exit\n",
+                 result_e::OKAY, 5000 & 0xFF});
+
+  for (auto &tc : tcs) {
+    auto program = build_program(tc.data);
+    CHECK_TRUE(program != nullptr);
+
+    for (auto engine : {skiff::machine::vm_c::engine_e::THREADED,
+                        skiff::machine::vm_c::engine_e::TIERED}) {
+      skiff::machine::vm_c vm;
+      vm.set_engine(engine);
+      CHECK_TRUE(vm.load(program));
+
+      auto [result, code] = vm.execute();
+      CHECK_EQUAL(static_cast<int>(tc.result), static_cast<int>(result));
+      CHECK_EQUAL(tc.exit_code, code & 0xFF);
+    }
+  }
+}
+
+TEST(jit_tests, tiered_budget_is_exact)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  using result_e = skiff::machine::vm_c::execution_result_e;
+
+  // 1 + 2 * 20000 + 1 instructions
+  auto program = build_program(".init main\n"
+                               ".code\n"
+                               "main:\n"
+                               "  mov i1 @20000\n"
+                               "loop:\n"
+                               "  add i0 i0 x1\n"
+                               "  blt i0 i1 loop\n"
+                               "  exit\n");
+  CHECK_TRUE(program != nullptr);
+
+  skiff::machine::vm_c vm;
+  vm.set_engine(skiff::machine::vm_c::engine_e::TIERED);
+  CHECK_TRUE(vm.load(program));
+
+  std::size_t yields{0};
+  while (true) {
+    auto [result, code] = vm.execute({.max_instructions = 7});
+    if (result != result_e::YIELDED) {
+      CHECK_EQUAL(static_cast<int>(result_e::OKAY), static_cast<int>(result));
+      CHECK_EQUAL(20000, code);
+      break;
+    }
+    yields++;
+  }
+  CHECK_EQUAL(40002 / 7, yields);
+  CHECK_TRUE(program->get_jit().get_num_regions() > 0);
+}
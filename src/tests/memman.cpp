@@ -1,4 +1,6 @@
 #include "machine/memory/memman.hpp"
+#include <atomic>
+#include <thread>
 #include <vector>
 
 #include <CppUTest/TestHarness.h>
@@ -27,9 +29,16 @@ TEST(memman_tests, all)
     auto [okay, id] = memman.alloc(1024);
     CHECK_TRUE_TEXT(okay, "Unable to re-alloc 1024 bytes");
 
-    // Ensure new one has id of 2
-    CHECK_EQUAL_TEXT(
-        2, id, "Unexpected ID generated - ID queue implementation change?");
+    // Ensure new one reuses slot 2, but under a new id
+    CHECK_EQUAL_TEXT(2, id & 0xFFFFFFFF,
+                     "Unexpected slot reused - ID queue implementation change?");
+    CHECK_TRUE_TEXT(2 != id, "Recycled slot kept its old ID");
+    CHECK_TRUE_TEXT(memman.get_slot(id) != nullptr, "Unable to get new slot");
+
+    // The old id must no longer reach the slot
+    CHECK_TRUE_TEXT(memman.get_slot(2) == nullptr, "Stale ID retrieved slot");
+    CHECK_FALSE_TEXT(memman.free(2), "Able to free with stale ID");
+    CHECK_TRUE_TEXT(memman.get_slot(id) != nullptr, "Stale free hit new slot");
   }
 
   {
@@ -41,3 +50,319 @@ TEST(memman_tests, all)
   // Attempt to delete item 6 (failure expected)
   CHECK_FALSE_TEXT(memman.free(6), "Able to free non-existent item");
 }
+
+TEST(memman_tests, concurrent_get_slot)
+{
+  skiff::machine::memory::memman_c memman;
+
+  auto [okay, stable] = memman.alloc(16);
+  CHECK_TRUE(okay);
+  CHECK_TRUE(memman.get_slot(stable)->put_qword(0, 0xABCD));
+
+  // Readers look up slots while the table grows past a chunk and recycles
+  // ids underneath them
+  std::atomic<bool> done{false};
+  std::atomic<uint64_t> bad_reads{0};
+  std::vector<std::thread> readers;
+  for (auto i = 0; i < 4; i++) {
+    readers.emplace_back([&]() {
+      while (!done.load()) {
+        auto slot = memman.get_slot(stable);
+        if (!slot) {
+          bad_reads++;
+          continue;
+        }
+        auto [read, value] = slot->get_qword(0);
+        if (!read || value != 0xABCD) {
+          bad_reads++;
+        }
+      }
+    });
+  }
+
+  std::vector<uint64_t> ids;
+  for (uint64_t i = 0;
+       i < skiff::machine::memory::memman_c::slots_per_chunk * 2; i++) {
+    auto [allocated, id] = memman.alloc(8);
+    CHECK_TRUE(allocated);
+    ids.push_back(id);
+  }
+  for (auto round = 0; round < 8; round++) {
+    for (auto &id : ids) {
+      CHECK_TRUE(memman.free(id));
+      CHECK_TRUE(memman.get_slot(id) == nullptr);
+      auto [allocated, fresh] = memman.alloc(8);
+      CHECK_TRUE(allocated);
+      CHECK_TRUE(fresh != id);
+      id = fresh;
+    }
+  }
+
+  done.store(true);
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  CHECK_EQUAL(0, bad_reads.load());
+}
+
+TEST(memman_tests, regions)
+{
+  skiff::machine::memory::memman_c memman;
+
+  auto [outside_okay, outside] = memman.alloc(32);
+  CHECK_TRUE(outside_okay);
+
+  auto [outer_okay, outer] = memman.begin_region();
+  CHECK_TRUE(outer_okay);
+
+  std::vector<uint64_t> ids;
+  for (auto i = 0; i < 100; i++) {
+    auto [okay, id] = memman.alloc(i * 10);
+    CHECK_TRUE(okay);
+    CHECK_TRUE(memman.get_slot(id)->put_n_bytes(
+        std::vector<uint8_t>(i * 10, static_cast<uint8_t>(i)), 0));
+    ids.push_back(id);
+  }
+
+  // Slots can still be freed one at a time, and their ids reused
+  CHECK_TRUE(memman.free(ids[5]));
+  auto [reused_okay, reused] = memman.alloc(16);
+  CHECK_TRUE(reused_okay);
+  CHECK_EQUAL(ids[5] & 0xFFFFFFFF, reused & 0xFFFFFFFF);
+
+  auto [inner_okay, inner] = memman.begin_region();
+  CHECK_TRUE(inner_okay);
+  CHECK_TRUE(inner != outer);
+  auto [nested_okay, nested] = memman.alloc(8000);
+  CHECK_TRUE(nested_okay);
+
+  // Earlier slots are untouched by later ones
+  for (auto i = 6; i < 100; i++) {
+    auto bytes = memman.get_slot(ids[i])->get_n_bytes(0, i * 10);
+    CHECK_TRUE(bytes == std::vector<uint8_t>(i * 10, static_cast<uint8_t>(i)));
+  }
+
+  // Freeing the outer region takes the inner one with it
+  CHECK_TRUE(memman.free_region(outer));
+  for (auto id : ids) {
+    CHECK_TRUE(memman.get_slot(id) == nullptr);
+  }
+  CHECK_TRUE(memman.get_slot(reused) == nullptr);
+  CHECK_TRUE(memman.get_slot(nested) == nullptr);
+  CHECK_TRUE(memman.get_slot(outside) != nullptr);
+  CHECK_FALSE(memman.free_region(outer));
+  CHECK_FALSE(memman.free_region(inner));
+  CHECK_FALSE(memman.free(reused));
+
+  // Everything the regions held went back to the allocator, and is no
+  // longer charged for
+  auto stats = memman.get_allocator_stats();
+  CHECK_EQUAL(stats.allocations - 2, stats.frees);
+  auto usage = memman.get_usage();
+  CHECK_EQUAL(32, usage.live_bytes);
+  CHECK_EQUAL(102, usage.frees);
+
+  // With no region open, slots are allocated as normal, reusing the ids the
+  // regions gave back starting with the innermost
+  auto [after_okay, after] = memman.alloc(32);
+  CHECK_TRUE(after_okay);
+  CHECK_EQUAL(nested & 0xFFFFFFFF, after & 0xFFFFFFFF);
+  CHECK_TRUE(memman.free(after));
+  CHECK_TRUE(memman.free(outside));
+}
+
+TEST(memman_tests, realloc)
+{
+  skiff::machine::memory::memman_c memman;
+
+  auto [okay, id] = memman.alloc(16);
+  CHECK_TRUE(okay);
+  auto slot = memman.get_slot(id);
+  CHECK_TRUE(slot->put_qword(0, 1234));
+
+  // Growing keeps the id, the memory and its contents
+  CHECK_TRUE(memman.realloc(id, 1 << 16));
+  CHECK_TRUE(slot == memman.get_slot(id));
+  CHECK_EQUAL(1 << 16, slot->size());
+  CHECK_EQUAL(1234, std::get<1>(slot->get_qword(0)));
+  CHECK_TRUE(slot->put_qword((1 << 16) - 16, 5678));
+
+  CHECK_TRUE(memman.realloc(id, 1 << 20));
+  CHECK_EQUAL(5678, std::get<1>(slot->get_qword((1 << 16) - 16)));
+
+  // Shrinking drops whatever no longer fits
+  CHECK_TRUE(memman.realloc(id, 8));
+  CHECK_EQUAL(8, slot->size());
+  CHECK_FALSE(std::get<0>(slot->get_qword(8)));
+  CHECK_EQUAL(0x04, std::get<1>(slot->get_hword(6)));
+
+  // Slots in a region stay in it
+  auto [region_okay, region] = memman.begin_region();
+  CHECK_TRUE(region_okay);
+  auto [inner_okay, inner] = memman.alloc(32);
+  CHECK_TRUE(inner_okay);
+  CHECK_TRUE(memman.get_slot(inner)->fill(0, 32, 0x11));
+  CHECK_TRUE(memman.realloc(inner, 10'000));
+  CHECK_EQUAL(10'000, memman.get_slot(inner)->size());
+  CHECK_EQUAL(0x11, std::get<1>(memman.get_slot(inner)->get_hword(31)));
+  CHECK_TRUE(memman.free_region(region));
+  CHECK_TRUE(memman.get_slot(inner) == nullptr);
+
+  // Freed and unknown slots can't be resized
+  CHECK_TRUE(memman.free(id));
+  CHECK_FALSE(memman.realloc(id, 16));
+  CHECK_FALSE(memman.realloc(inner, 16));
+  CHECK_FALSE(memman.realloc(12345, 16));
+}
+
+TEST(memman_tests, realloc_in_region)
+{
+  skiff::machine::memory::memman_c memman;
+  memman.set_limit(1 << 20);
+
+  auto [region_okay, region] = memman.begin_region();
+  CHECK_TRUE(region_okay);
+  auto [okay, id] = memman.alloc(16);
+  CHECK_TRUE(okay);
+  CHECK_TRUE(memman.get_slot(id)->put_qword(0, 1234));
+
+  // Once carved, a slot moves within its bytes without carving again
+  for (auto i = 0; i < 100; i++) {
+    CHECK_TRUE(memman.realloc(id, 1 << 18));
+    CHECK_TRUE(memman.realloc(id, 16));
+  }
+  CHECK_EQUAL(16 + (1 << 18), memman.get_usage().live_bytes);
+  CHECK_EQUAL(1234, std::get<1>(memman.get_slot(id)->get_qword(0)));
+
+  // Growing past them carves again, and what is left behind is still
+  // charged, so repeated growth runs into the limit
+  bool refused{false};
+  for (uint64_t size = 1 << 18; !refused && size < 1 << 20;) {
+    size += 1 << 16;
+    refused = !memman.realloc(id, size);
+  }
+  CHECK_TRUE(refused);
+  CHECK_TRUE(memman.get_usage().live_bytes <= 1 << 20);
+  CHECK_EQUAL(1234, std::get<1>(memman.get_slot(id)->get_qword(0)));
+
+  // Freeing the slot leaves its bytes with the region, still charged
+  const auto held = memman.get_usage().live_bytes;
+  CHECK_TRUE(memman.free(id));
+  CHECK_EQUAL(held, memman.get_usage().live_bytes);
+
+  CHECK_TRUE(memman.free_region(region));
+  CHECK_EQUAL(0, memman.get_usage().live_bytes);
+}
+
+TEST(memman_tests, usage)
+{
+  skiff::machine::memory::memman_c memman;
+  memman.set_limit(1000);
+  CHECK_EQUAL(1000, memman.get_limit());
+
+  auto [first_okay, first] = memman.alloc(600);
+  CHECK_TRUE(first_okay);
+  auto [second_okay, second] = memman.alloc(300);
+  CHECK_TRUE(second_okay);
+
+  // Nothing may go past the limit, and refusing changes nothing held
+  CHECK_FALSE(std::get<0>(memman.alloc(101)));
+  CHECK_FALSE(memman.realloc(first, 701));
+  CHECK_EQUAL(600, memman.get_slot(first)->size());
+  CHECK_TRUE(std::get<0>(memman.alloc(100)));
+  CHECK_FALSE(std::get<0>(memman.alloc(1)));
+
+  // Shrinking and freeing hand bytes back
+  CHECK_TRUE(memman.realloc(first, 100));
+  CHECK_TRUE(memman.free(second));
+  CHECK_TRUE(memman.realloc(first, 800));
+
+  // Slots freed with their region are accounted for too
+  auto [region_okay, region] = memman.begin_region();
+  CHECK_TRUE(region_okay);
+  CHECK_TRUE(std::get<0>(memman.alloc(50)));
+  CHECK_TRUE(std::get<0>(memman.alloc(50)));
+  CHECK_FALSE(std::get<0>(memman.alloc(1)));
+  CHECK_TRUE(memman.free_region(region));
+
+  auto usage = memman.get_usage();
+  CHECK_EQUAL(900, usage.live_bytes);
+  CHECK_EQUAL(1000, usage.peak_bytes);
+  CHECK_EQUAL(5, usage.allocations);
+  CHECK_EQUAL(3, usage.frees);
+  CHECK_EQUAL(2, usage.reallocations);
+  CHECK_EQUAL(4, usage.refused);
+  CHECK_EQUAL(2, usage.size_histogram[6]);  // 50
+  CHECK_EQUAL(1, usage.size_histogram[7]);  // 100
+  CHECK_EQUAL(1, usage.size_histogram[9]);  // 300
+  CHECK_EQUAL(1, usage.size_histogram[10]); // 600
+
+  // Without a limit anything goes
+  memman.set_limit(0);
+  CHECK_TRUE(std::get<0>(memman.alloc(1 << 20)));
+  CHECK_EQUAL(900 + (1 << 20), memman.get_usage().live_bytes);
+}
+
+TEST(memman_tests, usage_odd_sizes)
+{
+  skiff::machine::memory::memman_c memman;
+  memman.set_limit(8);
+
+  // Odd sizes are charged for the byte of padding they carry, and freeing
+  // them hands back exactly what was charged
+  auto [okay, id] = memman.alloc(3);
+  CHECK_TRUE(okay);
+  CHECK_EQUAL(4, memman.get_usage().live_bytes);
+  CHECK_TRUE(memman.free(id));
+  CHECK_EQUAL(0, memman.get_usage().live_bytes);
+
+  auto [again_okay, again] = memman.alloc(3);
+  CHECK_TRUE(again_okay);
+  CHECK_EQUAL(4, memman.get_usage().live_bytes);
+
+  // Resizing to odd sizes is charged the same way
+  CHECK_TRUE(memman.realloc(again, 7));
+  CHECK_EQUAL(8, memman.get_usage().live_bytes);
+  CHECK_TRUE(memman.realloc(again, 1));
+  CHECK_EQUAL(2, memman.get_usage().live_bytes);
+  CHECK_TRUE(memman.free(again));
+  CHECK_EQUAL(0, memman.get_usage().live_bytes);
+
+  // Nothing was lost along the way, so the whole limit is still there
+  auto [full_okay, full] = memman.alloc(8);
+  CHECK_TRUE(full_okay);
+  CHECK_FALSE(std::get<0>(memman.alloc(1)));
+  CHECK_TRUE(memman.free(full));
+  CHECK_EQUAL(0, memman.get_usage().live_bytes);
+}
+
+TEST(memman_tests, host_out_of_memory)
+{
+  skiff::machine::memory::memman_c memman;
+  constexpr uint64_t too_big = 1ull << 60;
+
+  auto [okay, id] = memman.alloc(16);
+  CHECK_TRUE(okay);
+
+  // More than the host can map fails like going past the limit does,
+  // leaving nothing charged for it
+  CHECK_FALSE(std::get<0>(memman.alloc(too_big)));
+  CHECK_FALSE(memman.realloc(id, too_big));
+  CHECK_EQUAL(16, memman.get_slot(id)->size());
+
+  auto [region_okay, region] = memman.begin_region();
+  CHECK_TRUE(region_okay);
+  auto [inner_okay, inner] = memman.alloc(16);
+  CHECK_TRUE(inner_okay);
+  CHECK_FALSE(std::get<0>(memman.alloc(too_big)));
+  CHECK_FALSE(memman.realloc(inner, too_big));
+  CHECK_EQUAL(16, memman.get_slot(inner)->size());
+  CHECK_TRUE(memman.free_region(region));
+
+  auto usage = memman.get_usage();
+  CHECK_EQUAL(16, usage.live_bytes);
+  CHECK_EQUAL(32, usage.peak_bytes);
+  CHECK_EQUAL(2, usage.allocations);
+  CHECK_EQUAL(0, usage.reallocations);
+  CHECK_TRUE(memman.free(id));
+}
@@ -197,4 +197,152 @@ TEST(memory_c, chonker)
       break;
     }
   }
-}
\ No newline at end of file
+}
+TEST(memory_c, byte_order)
+{
+  using order_e = skiff::machine::memory::byte_order_e;
+
+  skiff::machine::memory::memory_c big(16);
+  skiff::machine::memory::memory_c native(16, order_e::NATIVE);
+  CHECK_TRUE(order_e::BIG == big.get_byte_order());
+  CHECK_TRUE(order_e::NATIVE == native.get_byte_order());
+
+  CHECK_TRUE(big.put_dword(0, 0x11223344));
+  CHECK_TRUE(native.put_dword(0, 0x11223344));
+
+  // Big endian memory always starts with the most significant byte
+  auto [big_okay, big_first] = big.get_hword(0);
+  CHECK_TRUE(big_okay);
+  CHECK_EQUAL(0x11, big_first);
+
+  const uint8_t expected =
+      std::endian::native == std::endian::little ? 0x44 : 0x11;
+  auto [native_okay, native_first] = native.get_hword(0);
+  CHECK_TRUE(native_okay);
+  CHECK_EQUAL(expected, native_first);
+
+  // Either way a value reads back as it was written
+  for (auto memory : {&big, &native}) {
+    CHECK_TRUE(memory->store<uint64_t>(4, 0x0102030405060708));
+    uint64_t value{0};
+    CHECK_TRUE(memory->load(4, value));
+    CHECK_EQUAL(0x0102030405060708, value);
+  }
+}
+
+TEST(memory_c, accessor_bounds)
+{
+  skiff::machine::memory::memory_c memory(16);
+
+  // Stores wider than a byte need room left after them, loads don't
+  CHECK_TRUE(memory.store<uint64_t>(7, 1));
+  CHECK_FALSE(memory.store<uint64_t>(8, 1));
+  CHECK_TRUE(memory.store<uint8_t>(15, 1));
+  CHECK_FALSE(memory.store<uint8_t>(16, 1));
+
+  uint64_t qword{0};
+  CHECK_TRUE(memory.load(8, qword));
+  CHECK_FALSE(memory.load(9, qword));
+  uint8_t byte{0};
+  CHECK_TRUE(memory.load(15, byte));
+  CHECK_EQUAL(1, byte);
+  CHECK_FALSE(memory.load(16, byte));
+
+  // Indices that would wrap around when offset are rejected
+  const auto huge = std::numeric_limits<uint64_t>::max() - 2;
+  CHECK_FALSE(memory.store<uint32_t>(huge, 1));
+  CHECK_FALSE(memory.load(huge, qword));
+  CHECK_FALSE(std::get<0>(memory.get_qword(huge)));
+}
+
+TEST(memory_c, bulk)
+{
+  skiff::machine::memory::memory_c first(32);
+  skiff::machine::memory::memory_c second(32);
+
+  CHECK_TRUE(first.fill(0, 32, 0xAB));
+  CHECK_TRUE(second.fill(0, 32, 0x00));
+  CHECK_TRUE(second.copy(4, first, 8, 16));
+
+  auto [okay, order] = second.compare(4, first, 0, 16);
+  CHECK_TRUE(okay);
+  CHECK_EQUAL(0, order);
+  CHECK_TRUE(std::get<1>(second.compare(0, first, 0, 16)) < 0);
+  CHECK_TRUE(std::get<1>(first.compare(0, second, 0, 16)) > 0);
+
+  // Copies within a memory may overlap
+  CHECK_TRUE(second.copy(0, second, 4, 16));
+  CHECK_EQUAL(0xAB, std::get<1>(second.get_hword(0)));
+  CHECK_EQUAL(0xAB, std::get<1>(second.get_hword(15)));
+
+  // Ranges may end at, but not run past, the end of the memory
+  CHECK_TRUE(first.fill(32, 0, 0x00));
+  CHECK_TRUE(first.fill(16, 16, 0x01));
+  CHECK_FALSE(first.fill(16, 17, 0x00));
+  CHECK_FALSE(first.copy(0, second, 1, 32));
+  CHECK_FALSE(first.copy(1, second, 0, 32));
+  CHECK_FALSE(std::get<0>(first.compare(0, second, 0, 33)));
+  CHECK_FALSE(first.fill(1, std::numeric_limits<uint64_t>::max(), 0x00));
+  CHECK_EQUAL(0x01, std::get<1>(first.get_hword(31)));
+}
+
+TEST(memory_c, spans)
+{
+  skiff::machine::memory::memory_c memory(16);
+  CHECK_TRUE(memory.fill(0, 16, 0x00));
+
+  // Views see and change the memory itself
+  auto [okay, view] = memory.get_span(4, 8);
+  CHECK_TRUE(okay);
+  CHECK_EQUAL(8, view.size());
+  view[0] = 0x42;
+  CHECK_EQUAL(0x42, std::get<1>(memory.get_hword(4)));
+  CHECK_TRUE(memory.put_hword(11, 0x24));
+  CHECK_EQUAL(0x24, view[7]);
+
+  const auto &constant = memory;
+  auto [const_okay, const_view] = constant.get_span(16, 0);
+  CHECK_TRUE(const_okay);
+  CHECK_TRUE(const_view.empty());
+
+  CHECK_FALSE(std::get<0>(memory.get_span(9, 8)));
+  CHECK_FALSE(
+      std::get<0>(memory.get_span(1, std::numeric_limits<uint64_t>::max())));
+
+  // Bytes are put from any contiguous range
+  const uint8_t bytes[] = {1, 2, 3};
+  CHECK_TRUE(memory.put_n_bytes(bytes, 13));
+  CHECK_FALSE(memory.put_n_bytes(bytes, 14));
+  CHECK_TRUE(memory.get_n_bytes(13, 3) == std::vector<uint8_t>({1, 2, 3}));
+  CHECK_TRUE(memory.get_n_bytes(std::numeric_limits<uint64_t>::max(), 2)
+                 .empty());
+}
+
+TEST(memory_c, many_values)
+{
+  using order_e = skiff::machine::memory::byte_order_e;
+
+  skiff::machine::memory::memory_c big(32);
+  skiff::machine::memory::memory_c native(32, order_e::NATIVE);
+  const std::vector<uint64_t> values{0x0102030405060708, 2, 3};
+
+  // Runs of values are laid out as storing each in turn would
+  for (auto memory : {&big, &native}) {
+    CHECK_TRUE(memory->store_n<uint64_t>(4, values));
+    uint64_t value{0};
+    CHECK_TRUE(memory->load(4, value));
+    CHECK_EQUAL(0x0102030405060708, value);
+    CHECK_TRUE(memory->load(20, value));
+    CHECK_EQUAL(3, value);
+
+    std::vector<uint64_t> loaded(3);
+    CHECK_TRUE(memory->load_n<uint64_t>(4, loaded));
+    CHECK_TRUE(loaded == values);
+
+    // The same bounds as single stores and loads, checked all at once
+    CHECK_FALSE(memory->store_n<uint64_t>(8, values));
+    CHECK_TRUE(memory->load_n<uint64_t>(8, loaded));
+    CHECK_FALSE(memory->load_n<uint64_t>(9, loaded));
+  }
+  CHECK_EQUAL(0x01, std::get<1>(big.get_hword(4)));
+}
@@ -0,0 +1,35 @@
+#include "runner/pool.hpp"
+#include <atomic>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+
+TEST_GROUP(pool_tests){};
+
+TEST(pool_tests, all)
+{
+  skiff::runner::pool_c pool(4);
+  CHECK_TRUE(pool.get_num_workers() > 0);
+
+  // Every job runs exactly once
+  std::vector<std::atomic<int>> hits(1000);
+  for (std::size_t i = 0; i < hits.size(); i++) {
+    pool.submit([&hits, i](const std::size_t) { hits[i]++; });
+  }
+  pool.wait();
+  for (auto &hit : hits) {
+    CHECK_EQUAL_TEXT(1, hit.load(), "Job not run exactly once");
+  }
+
+  // Jobs may submit more jobs, wait covers those as well
+  std::atomic<int> nested{0};
+  for (auto i = 0; i < 10; i++) {
+    pool.submit([&](const std::size_t) {
+      for (auto j = 0; j < 10; j++) {
+        pool.submit([&](const std::size_t) { nested++; });
+      }
+    });
+  }
+  pool.wait();
+  CHECK_EQUAL_TEXT(100, nested.load(), "Nested jobs lost");
+}
@@ -0,0 +1,77 @@
+#include "logging/aixlog.hpp"
+#include "machine/profiler.hpp"
+#include "machine/vm.hpp"
+#include "tests/test_programs.hpp"
+#include <libskiff/bytecode/executable.hpp>
+
+#include <CppUTest/TestHarness.h>
+#include <sstream>
+
+TEST_GROUP(profiler_tests){void setup(){} void teardown(){}};
+
+TEST(profiler_tests, annotate_address)
+{
+  skiff::machine::profiler_c::symbols_t symbols{{2, "loop"}, {10, "main"}};
+
+  STRCMP_EQUAL("0x1", skiff::machine::annotate_address(1, symbols).c_str());
+  STRCMP_EQUAL("loop", skiff::machine::annotate_address(2, symbols).c_str());
+  STRCMP_EQUAL("loop+3", skiff::machine::annotate_address(5, symbols).c_str());
+  STRCMP_EQUAL("main+1",
+               skiff::machine::annotate_address(11, symbols).c_str());
+}
+
+TEST(profiler_tests, profile_program)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  auto [executable, symbols] =
+      skiff::tests::build_labelled_executable(".init main\n"
+                                              ".code\n"
+                                              "count:\n"
+                                              "  add i0 i0 x1\n"
+                                              "  blt i0 i1 count\n"
+                                              "  ret\n"
+                                              "main:\n"
+                                              "  mov i1 @10\n"
+                                              "  call count\n"
+                                              "  call count\n"
+                                              "  exit\n");
+  CHECK_TRUE(executable != nullptr);
+  CHECK_EQUAL(2, symbols.size());
+
+  auto profiler = std::make_shared<skiff::machine::profiler_c>();
+  skiff::machine::vm_c vm;
+  vm.set_profiler(profiler);
+  CHECK_TRUE(vm.load(std::move(executable)));
+
+  auto [result, code] = vm.execute();
+  CHECK_EQUAL(
+      static_cast<int>(skiff::machine::vm_c::execution_result_e::OKAY),
+      static_cast<int>(result));
+  CHECK_EQUAL(11, code);
+
+  // First call loops 10 times, the second falls straight through
+  auto &opcodes = profiler->get_opcode_profile();
+  auto count = [&](skiff::machine::threaded_opcode_e op) {
+    return opcodes[static_cast<std::size_t>(op)].count;
+  };
+  CHECK_EQUAL(11, count(skiff::machine::threaded_opcode_e::ADD));
+  CHECK_EQUAL(11, count(skiff::machine::threaded_opcode_e::BLT));
+  CHECK_EQUAL(2, count(skiff::machine::threaded_opcode_e::RET));
+  CHECK_EQUAL(2, count(skiff::machine::threaded_opcode_e::CALL));
+  CHECK_EQUAL(1, count(skiff::machine::threaded_opcode_e::EXIT));
+
+  auto &hits = profiler->get_address_hits();
+  CHECK_EQUAL(11, hits[0]);
+  CHECK_EQUAL(2, hits[2]);
+  CHECK_EQUAL(1, hits[6]);
+
+  // Both calls share a frame
+  std::stringstream folded;
+  profiler->write_folded_stacks(folded, symbols);
+  STRCMP_EQUAL("main 4\nmain;count 24\n", folded.str().c_str());
+
+  std::stringstream report;
+  profiler->write_report(report, symbols, 3);
+  CHECK_TRUE(report.str().find("count+1") != std::string::npos);
+}
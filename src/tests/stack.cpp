@@ -1,4 +1,5 @@
 
+#include "machine/memory/call_stack.hpp"
 #include "machine/memory/stack.hpp"
 #include "config.hpp"
 #include "types.hpp"
@@ -325,4 +326,116 @@ TEST(memory_stack, chonker)
       break;
     }
   }
-}
\ No newline at end of file
+}
+TEST(memory_stack, lazy_commit)
+{
+  // Nothing is committed until the stack is used, and only as far as it
+  // is reached after that
+  skiff::machine::memory::stack_c skiff_stack;
+  CHECK_EQUAL(0, skiff_stack.get_committed_bytes());
+  CHECK_EQUAL(skiff::config::stack_size_bytes, skiff_stack.get_max_bytes());
+  CHECK_TRUE(skiff_stack.push_qword(1));
+  const auto committed = skiff_stack.get_committed_bytes();
+  CHECK_TRUE(committed >= 8 && committed < skiff::config::stack_size_bytes);
+
+  // Stores commit what they reach
+  CHECK_TRUE(skiff_stack.store_qword(500'000, 42));
+  const auto stored = skiff_stack.get_committed_bytes();
+  CHECK_TRUE(stored > 500'000);
+  CHECK_EQUAL(42, std::get<1>(skiff_stack.load_qword(500'000)));
+
+  // Loads past that read as zero without committing anything
+  auto [far_okay, far] = skiff_stack.load_qword(900'000);
+  CHECK_TRUE(far_okay);
+  CHECK_EQUAL(0, far);
+  CHECK_EQUAL(0, std::get<1>(skiff_stack.load_word(stored)));
+  CHECK_EQUAL(stored, skiff_stack.get_committed_bytes());
+  CHECK_EQUAL(1, std::get<1>(skiff_stack.pop_qword()));
+
+  // The size can only change before the stack is used
+  CHECK_FALSE(skiff_stack.set_max_bytes(64));
+}
+
+TEST(memory_stack, max_bytes)
+{
+  skiff::machine::memory::stack_c skiff_stack(64);
+  CHECK_TRUE(skiff_stack.set_max_bytes(32));
+  CHECK_EQUAL(32, skiff_stack.get_max_bytes());
+
+  // Pushes always leave the last bytes free
+  for (auto i = 0; i < 3; i++) {
+    CHECK_TRUE(skiff_stack.push_qword(i));
+  }
+  CHECK_FALSE(skiff_stack.push_qword(3));
+  CHECK_TRUE(skiff_stack.push_dword(3));
+  CHECK_FALSE(skiff_stack.push_dword(4));
+
+  CHECK_FALSE(skiff_stack.store_qword(32, 1));
+  CHECK_FALSE(std::get<0>(skiff_stack.load_qword(28)));
+  CHECK_FALSE(
+      std::get<0>(skiff_stack.load_qword(std::numeric_limits<uint64_t>::max())));
+  CHECK_EQUAL(3, std::get<1>(skiff_stack.pop_dword()));
+  CHECK_EQUAL(2, std::get<1>(skiff_stack.pop_qword()));
+
+  // The largest stack a binary could ask for only commits what it uses
+  skiff::machine::memory::stack_c huge_stack(uint64_t{1} << 40);
+  CHECK_TRUE(huge_stack.push_qword(7));
+  CHECK_TRUE(huge_stack.get_committed_bytes() < 1 << 20);
+  CHECK_EQUAL(7, std::get<1>(huge_stack.pop_qword()));
+}
+
+TEST(memory_stack, many_qwords)
+{
+  skiff::machine::memory::stack_c skiff_stack(64);
+
+  // Several quad words lie where pushing each in turn would leave them
+  const std::vector<uint64_t> values{1, 2, 3};
+  CHECK_TRUE(skiff_stack.push_qwords(values));
+  CHECK_EQUAL(3, std::get<1>(skiff_stack.pop_qword()));
+  CHECK_TRUE(skiff_stack.push_qword(4));
+
+  std::vector<uint64_t> popped(3);
+  CHECK_TRUE(skiff_stack.pop_qwords(popped));
+  CHECK_EQUAL(1, popped[0]);
+  CHECK_EQUAL(2, popped[1]);
+  CHECK_EQUAL(4, popped[2]);
+
+  // All or nothing, whether there is too little room or too few values
+  const std::vector<uint64_t> too_many(8, 5);
+  CHECK_FALSE(skiff_stack.push_qwords(too_many));
+  CHECK_TRUE(skiff_stack.push_qword(6));
+  CHECK_FALSE(skiff_stack.pop_qwords(popped));
+  CHECK_EQUAL(6, std::get<1>(skiff_stack.pop_qword()));
+  CHECK_FALSE(std::get<0>(skiff_stack.pop_qword()));
+}
+
+TEST_GROUP(call_stack){};
+
+TEST(call_stack, depth)
+{
+  skiff::machine::memory::call_stack_c call_stack(4);
+  CHECK_TRUE(call_stack.empty());
+  CHECK_FALSE(std::get<0>(call_stack.pop()));
+  CHECK_TRUE(call_stack.set_max_depth(3));
+  CHECK_EQUAL(3, call_stack.get_max_depth());
+
+  // Holds as many return addresses as it is allowed, and no more
+  for (uint64_t address = 10; address < 13; address++) {
+    CHECK_TRUE(call_stack.push(address));
+  }
+  CHECK_FALSE(call_stack.push(13));
+  CHECK_EQUAL(3, call_stack.get_depth());
+  CHECK_FALSE(call_stack.set_max_depth(8));
+
+  CHECK_EQUAL(12, std::get<1>(call_stack.pop()));
+  CHECK_TRUE(call_stack.push(20));
+  CHECK_EQUAL(20, std::get<1>(call_stack.pop()));
+  CHECK_EQUAL(11, std::get<1>(call_stack.pop()));
+  CHECK_EQUAL(10, std::get<1>(call_stack.pop()));
+  CHECK_TRUE(call_stack.empty());
+  CHECK_EQUAL(3, call_stack.get_peak_depth());
+
+  // A stack that can't hold anything refuses every call
+  skiff::machine::memory::call_stack_c none(0);
+  CHECK_FALSE(none.push(1));
+}
@@ -0,0 +1,53 @@
+#include "tests/test_programs.hpp"
+#include "assembler/assemble.hpp"
+
+#include <fstream>
+
+namespace skiff {
+namespace tests {
+
+std::tuple<std::unique_ptr<libskiff::bytecode::executable_c>, labels_t>
+build_labelled_executable(const std::string &source)
+{
+  {
+    std::ofstream ofs("tmp.test.asm");
+    ofs << source;
+  }
+
+  auto result = skiff::assembler::assemble("tmp.test.asm");
+  if (result.errors != std::nullopt || result.bin == std::nullopt) {
+    return {nullptr, labels_t{}};
+  }
+
+  {
+    std::ofstream fout("tmp.test.bin", std::ios::out | std::ios::binary);
+    fout.write(reinterpret_cast<const char *>(&result.bin.value()[0]),
+               result.bin.value().size());
+  }
+
+  auto loaded_binary = libskiff::bytecode::load_binary("tmp.test.bin");
+  if (loaded_binary == std::nullopt) {
+    return {nullptr, labels_t{}};
+  }
+  return {std::move(loaded_binary.value()), result.labels};
+}
+
+std::unique_ptr<libskiff::bytecode::executable_c>
+build_executable(const std::string &source)
+{
+  return std::move(std::get<0>(build_labelled_executable(source)));
+}
+
+std::shared_ptr<const skiff::machine::program_c>
+build_program(const std::string &source)
+{
+  auto executable = build_executable(source);
+  if (!executable) {
+    return nullptr;
+  }
+  auto [okay, program] = skiff::machine::program_c::decode(*executable);
+  return okay ? program : nullptr;
+}
+
+} // namespace tests
+} // namespace skiff
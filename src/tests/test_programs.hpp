@@ -0,0 +1,39 @@
+#ifndef SKIFF_TESTS_TEST_PROGRAMS_HPP
+#define SKIFF_TESTS_TEST_PROGRAMS_HPP
+
+#include "machine/program.hpp"
+#include <libskiff/bytecode/executable.hpp>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+
+namespace skiff {
+namespace tests {
+
+//! \brief Labels of an assembled program, keyed by instruction
+using labels_t = std::map<uint64_t, std::string>;
+
+//! \brief Assemble source and load the binary it produces
+//! \param source The assembly to build
+//! \returns Tuple with the loaded binary, nullptr if the source didn't
+//!          assemble or the binary didn't load, and the source's labels
+std::tuple<std::unique_ptr<libskiff::bytecode::executable_c>, labels_t>
+build_labelled_executable(const std::string &source);
+
+//! \brief Assemble source and load the binary it produces
+//! \returns The loaded binary, nullptr if it couldn't be built
+std::unique_ptr<libskiff::bytecode::executable_c>
+build_executable(const std::string &source);
+
+//! \brief Assemble source and decode the binary it produces
+//! \returns The decoded program, nullptr if it couldn't be built
+std::shared_ptr<const skiff::machine::program_c>
+build_program(const std::string &source);
+
+} // namespace tests
+} // namespace skiff
+
+#endif
@@ -0,0 +1,254 @@
+#include "machine/vector/vector.hpp"
+#include <libutil/random/generator.hpp>
+
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+
+namespace {
+
+namespace vector = skiff::machine::vector;
+using skiff::machine::memory::byte_order_e;
+using skiff::machine::memory::memory_c;
+
+// Not a multiple of any vector width, so every kernel runs its tail
+static constexpr uint64_t num_lanes = 517;
+
+// Stores need room left after them, so memories get a spare lane
+template <typename T> uint64_t get_size()
+{
+  return (num_lanes + 1) * sizeof(T);
+}
+
+std::vector<const vector::kernels_t *> get_available_kernels()
+{
+  std::vector<const vector::kernels_t *> available;
+  for (auto isa :
+       {vector::isa_e::SCALAR, vector::isa_e::SIMD128, vector::isa_e::AVX2}) {
+    if (auto kernels = vector::get_kernels(isa)) {
+      available.push_back(kernels);
+    }
+  }
+  return available;
+}
+
+// Floating point lanes hold quarters so that sums and products are exact
+// in any order
+template <typename T> T generate_lane()
+{
+  if constexpr (std::is_same_v<T, double>) {
+    return libutil::random::generate_random_c<int64_t>().get_range(-1000,
+                                                                    1000) /
+           4.0;
+  }
+  else {
+    return libutil::random::generate_random_c<T>().get_range(
+        std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
+  }
+}
+
+template <typename T> void put_lane(memory_c &memory, uint64_t i, T value)
+{
+  if constexpr (std::is_same_v<T, double>) {
+    CHECK_TRUE(memory.store(i * sizeof(T), std::bit_cast<uint64_t>(value)));
+  }
+  else {
+    CHECK_TRUE(memory.store(i * sizeof(T), value));
+  }
+}
+
+template <typename T> T get_lane(const memory_c &memory, uint64_t i)
+{
+  if constexpr (std::is_same_v<T, double>) {
+    uint64_t value{0};
+    CHECK_TRUE(memory.load(i * sizeof(T), value));
+    return std::bit_cast<double>(value);
+  }
+  else {
+    T value{0};
+    CHECK_TRUE(memory.load(i * sizeof(T), value));
+    return value;
+  }
+}
+
+template <typename T> T expected_lane(vector::op_e op, T lhs, T rhs)
+{
+  switch (op) {
+  case vector::op_e::ADD:
+    return static_cast<T>(lhs + rhs);
+  case vector::op_e::SUB:
+    return static_cast<T>(lhs - rhs);
+  case vector::op_e::MUL:
+    return static_cast<T>(lhs * rhs);
+  case vector::op_e::MIN:
+    return rhs < lhs ? rhs : lhs;
+  case vector::op_e::MAX:
+    return lhs < rhs ? rhs : lhs;
+  }
+  return 0;
+}
+
+template <typename T> uint64_t to_result(T value)
+{
+  if constexpr (std::is_same_v<T, double>) {
+    return std::bit_cast<uint64_t>(value);
+  }
+  else {
+    return static_cast<uint64_t>(value);
+  }
+}
+
+template <typename T>
+void check_lane_type(vector::lane_e lane, byte_order_e lhs_order,
+                     byte_order_e rhs_order)
+{
+  memory_c lhs(get_size<T>(), lhs_order);
+  memory_c rhs(get_size<T>(), rhs_order);
+  for (uint64_t i = 0; i < num_lanes; i++) {
+    put_lane(lhs, i, generate_lane<T>());
+    put_lane(rhs, i, generate_lane<T>());
+  }
+
+  for (auto kernels : get_available_kernels()) {
+    for (auto op : {vector::op_e::ADD, vector::op_e::SUB, vector::op_e::MUL,
+                    vector::op_e::MIN, vector::op_e::MAX}) {
+      memory_c dest(get_size<T>(), lhs_order);
+      CHECK_TRUE(vector::apply(op, lane, dest, 0, lhs, 0, rhs, 0, num_lanes,
+                               *kernels));
+      for (uint64_t i = 0; i < num_lanes; i++) {
+        CHECK_TRUE(expected_lane(op, get_lane<T>(lhs, i),
+                                 get_lane<T>(rhs, i)) == get_lane<T>(dest, i));
+      }
+    }
+
+    T sum{0};
+    uint64_t wide_sum{0};
+    uint64_t wide_dot{0};
+    double dot{0};
+    T smallest = get_lane<T>(lhs, 0);
+    T largest = smallest;
+    for (uint64_t i = 0; i < num_lanes; i++) {
+      const T first = get_lane<T>(lhs, i);
+      const T second = get_lane<T>(rhs, i);
+      sum += first;
+      wide_sum += static_cast<uint64_t>(first);
+      dot += static_cast<double>(first) * static_cast<double>(second);
+      wide_dot += static_cast<uint64_t>(first) * static_cast<uint64_t>(second);
+      smallest = first < smallest ? first : smallest;
+      largest = largest < first ? first : largest;
+    }
+
+    const bool floating = std::is_same_v<T, double>;
+    auto [summed, sum_result] = vector::reduce(
+        vector::reduction_e::SUM, lane, lhs, 0, num_lanes, *kernels);
+    CHECK_TRUE(summed);
+    CHECK_EQUAL(floating ? to_result(sum) : wide_sum, sum_result);
+
+    auto [found_min, min_result] = vector::reduce(
+        vector::reduction_e::MIN, lane, lhs, 0, num_lanes, *kernels);
+    CHECK_TRUE(found_min);
+    CHECK_EQUAL(to_result(smallest), min_result);
+
+    auto [found_max, max_result] = vector::reduce(
+        vector::reduction_e::MAX, lane, lhs, 0, num_lanes, *kernels);
+    CHECK_TRUE(found_max);
+    CHECK_EQUAL(to_result(largest), max_result);
+
+    auto [dotted, dot_result] =
+        vector::dot(lane, lhs, 0, rhs, 0, num_lanes, *kernels);
+    CHECK_TRUE(dotted);
+    CHECK_EQUAL(floating ? std::bit_cast<uint64_t>(dot) : wide_dot,
+                dot_result);
+  }
+}
+
+} // namespace
+
+TEST_GROUP(vector_tests){};
+
+TEST(vector_tests, kernels_agree)
+{
+  CHECK_TRUE(vector::get_kernels(vector::isa_e::SCALAR) != nullptr);
+  CHECK_TRUE(vector::get_kernels().name != nullptr);
+
+  for (auto lhs_order : {byte_order_e::BIG, byte_order_e::NATIVE}) {
+    for (auto rhs_order : {byte_order_e::BIG, byte_order_e::NATIVE}) {
+      check_lane_type<uint8_t>(vector::lane_e::U8, lhs_order, rhs_order);
+      check_lane_type<uint32_t>(vector::lane_e::U32, lhs_order, rhs_order);
+      check_lane_type<uint64_t>(vector::lane_e::U64, lhs_order, rhs_order);
+      check_lane_type<double>(vector::lane_e::F64, lhs_order, rhs_order);
+    }
+  }
+}
+
+TEST(vector_tests, wide_sums)
+{
+  // Long enough to overflow any narrower accumulator the kernels use
+  const uint64_t count = 70000;
+  memory_c bytes(count);
+  memory_c words(count * 4);
+  CHECK_TRUE(bytes.fill(0, count, 0xFF));
+  CHECK_TRUE(words.fill(0, count * 4, 0xFF));
+
+  for (auto kernels : get_available_kernels()) {
+    CHECK_EQUAL(count * 0xFF,
+                std::get<1>(vector::reduce(vector::reduction_e::SUM,
+                                           vector::lane_e::U8, bytes, 0,
+                                           count, *kernels)));
+    CHECK_EQUAL(count * 0xFE01, std::get<1>(vector::dot(vector::lane_e::U8,
+                                                        bytes, 0, bytes, 0,
+                                                        count, *kernels)));
+    CHECK_EQUAL(count * 0xFFFFFFFF,
+                std::get<1>(vector::reduce(vector::reduction_e::SUM,
+                                           vector::lane_e::U32, words, 0,
+                                           count, *kernels)));
+  }
+}
+
+TEST(vector_tests, ranges)
+{
+  // Eight lanes and a spare
+  memory_c memory(72);
+  for (uint64_t i = 0; i < 8; i++) {
+    CHECK_TRUE(memory.store<uint64_t>(i * 8, i + 1));
+  }
+
+  // Ranges must lie within their memory, and a count of lanes must not
+  // overflow when turned into bytes
+  CHECK_TRUE(vector::apply(vector::op_e::ADD, vector::lane_e::U64, memory, 0,
+                           memory, 0, memory, 0, 8));
+  CHECK_FALSE(vector::apply(vector::op_e::ADD, vector::lane_e::U64, memory, 16,
+                            memory, 0, memory, 0, 8));
+  CHECK_FALSE(vector::apply(vector::op_e::ADD, vector::lane_e::U32, memory, 0,
+                            memory, 0, memory, 0,
+                            std::numeric_limits<uint64_t>::max() / 2));
+  CHECK_FALSE(std::get<0>(vector::reduce(
+      vector::reduction_e::SUM, vector::lane_e::U64, memory, 9, 8)));
+  CHECK_FALSE(std::get<0>(
+      vector::dot(vector::lane_e::U64, memory, 0, memory, 40, 5)));
+
+  // Nothing sums to zero, but has no smallest or largest lane
+  CHECK_TRUE(std::get<0>(vector::reduce(
+      vector::reduction_e::SUM, vector::lane_e::U64, memory, 72, 0)));
+  CHECK_FALSE(std::get<0>(vector::reduce(
+      vector::reduction_e::MIN, vector::lane_e::U64, memory, 0, 0)));
+
+  uint64_t value{0};
+  CHECK_TRUE(memory.load(56, value));
+  CHECK_EQUAL(16, value);
+
+  // Overlapping ranges read every lane before writing any result
+  for (uint64_t i = 0; i < 8; i++) {
+    CHECK_TRUE(memory.store<uint64_t>(i * 8, i));
+  }
+  CHECK_TRUE(vector::apply(vector::op_e::ADD, vector::lane_e::U64, memory, 8,
+                           memory, 0, memory, 0, 7));
+  for (uint64_t i = 1; i < 8; i++) {
+    CHECK_TRUE(memory.load(i * 8, value));
+    CHECK_EQUAL((i - 1) * 2, value);
+  }
+}
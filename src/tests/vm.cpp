@@ -0,0 +1,867 @@
+#include "logging/aixlog.hpp"
+#include "machine/vm.hpp"
+#include "tests/test_programs.hpp"
+#include <libskiff/bytecode/executable.hpp>
+#include <libskiff/types.hpp>
+
+#include <CppUTest/TestHarness.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+using skiff::tests::build_executable;
+
+struct tc_vm_t {
+  std::string data;
+  skiff::machine::vm_c::execution_result_e result;
+  int exit_code;
+};
+
+} // namespace
+
+TEST_GROUP(vm_tests){void setup(){} void teardown(){}};
+
+TEST(vm_tests, engines_agree)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  using result_e = skiff::machine::vm_c::execution_result_e;
+
+  std::vector<tc_vm_t> tcs;
+
+  // Loop with a back-edge and a call
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "count:\n"
+                 "  add i0 i0 x1\n"
+                 "  blt i0 i1 count\n"
+                 "  ret\n"
+                 "main:\n"
+                 "  mov i1 @1000\n"
+                 "  call count\n"
+                 "  aseq i0 i1\n"
+                 "  mov i0 @0\n"
+                 "  exit\n",
+                 result_e::OKAY, 0});
+
+  // Writes to constant registers are discarded
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov x0 @5\n"
+                 "  add x1 x1 x1\n"
+                 "  mov i1 @1\n"
+                 "  aseq x0 i0\n"
+                 "  aseq x1 i1\n"
+                 "  exit\n",
+                 result_e::OKAY, 0});
+
+  // Stack and memory round trip
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @16\n"
+                 "  alloc i2 i1\n"
+                 "  mov i3 @42\n"
+                 "  sqw i2 x0 i3\n"
+                 "  lqw i2 x0 i4\n"
+                 "  push_qw i4\n"
+                 "  pop_qw i5\n"
+                 "  aseq i3 i5\n"
+                 "  free i2\n"
+                 "  mov i0 @7\n"
+                 "  exit\n",
+                 result_e::OKAY, 7});
+
+  // Slots allocated in a region are freed with it
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @16\n"
+                 "  region_begin i7\n"
+                 "  alloc i2 i1\n"
+                 "  alloc i3 i1\n"
+                 "  sqw i3 x0 i1\n"
+                 "  region_free i7\n"
+                 "  aseq x1 op\n"
+                 "  sqw i3 x0 i1\n"
+                 "  aseq x0 op\n"
+                 "  free i2\n"
+                 "  aseq x0 op\n"
+                 "  mov i0 @5\n"
+                 "  exit\n",
+                 result_e::OKAY, 5});
+
+  // Bulk copy, fill and compare
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @32\n"
+                 "  alloc i2 i1\n"
+                 "  alloc i3 i1\n"
+                 "  mov i4 @7\n"
+                 "  mset i2 x0 i1 i4\n"
+                 "  aseq x1 op\n"
+                 "  mov i5 @16\n"
+                 "  mcpy i3 i5 i2 x0 i5\n"
+                 "  aseq x1 op\n"
+                 "  mcmp i6 i3 i5 i2 x0 i5\n"
+                 "  aseq x0 i6\n"
+                 "  mcmp i6 i3 x0 i2 x0 i5\n"
+                 "  mcpy i3 i5 i2 x0 i1\n"
+                 "  aseq x0 op\n"
+                 "  lhw i3 i5 i0\n"
+                 "  add i0 i0 i6\n"
+                 "  exit\n",
+                 result_e::OKAY, 8});
+
+  // Vector lanes, reductions and dot products
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @32\n"
+                 "  alloc i2 i1\n"
+                 "  alloc i3 i1\n"
+                 "  mov i4 @3\n"
+                 "  mset i2 x0 i1 i4\n"
+                 "  vadd_u8 i3 x0 i2 x0 i2 x0 i1\n"
+                 "  aseq x1 op\n"
+                 "  vsum_u8 i5 i3 x0 i1\n"
+                 "  vdot_u8 i6 i2 x0 i3 x0 i1\n"
+                 "  mov i7 @576\n"
+                 "  aseq i6 i7\n"
+                 "  mov i8 @8\n"
+                 "  vmin_u32 i3 i8 i2 x0 i3 x0 i4\n"
+                 "  vhmax_u32 i7 i3 x0 i8\n"
+                 "  mov i9 @101058054\n"
+                 "  aseq i7 i9\n"
+                 "  vsum_u64 i7 i3 x0 i1\n"
+                 "  aseq x0 op\n"
+                 "  add i0 i5 i4\n"
+                 "  exit\n",
+                 result_e::OKAY, 195});
+
+  // Growing and shrinking a slot in place
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @16\n"
+                 "  alloc i2 i1\n"
+                 "  mov i3 @77\n"
+                 "  sqw i2 x0 i3\n"
+                 "  mov i4 @100000\n"
+                 "  realloc i2 i4\n"
+                 "  aseq x1 op\n"
+                 "  mov i5 @99990\n"
+                 "  shw i2 i5 i3\n"
+                 "  aseq x1 op\n"
+                 "  realloc i2 i1\n"
+                 "  shw i2 i5 i3\n"
+                 "  aseq x0 op\n"
+                 "  lqw i2 x0 i0\n"
+                 "  free i2\n"
+                 "  realloc i2 i1\n"
+                 "  aseq x0 op\n"
+                 "  exit\n",
+                 result_e::OKAY, 77});
+
+  // Stack accesses relative to the stack pointer and a frame register
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @10\n"
+                 "  mov i2 @20\n"
+                 "  mov i3 @30\n"
+                 "  push_qw i1\n"
+                 "  push_qw i2\n"
+                 "  push_qw i3\n"
+                 "  add i9 sp x0\n"
+                 "  lsqw sp @-16 i4\n"
+                 "  aseq x1 op\n"
+                 "  mov i5 @2\n"
+                 "  ssqw i9 @-8 i5\n"
+                 "  lsqw i9 @-24 i6\n"
+                 "  ssqw sp @1048576 i5\n"
+                 "  aseq x0 op\n"
+                 "  lsdw x0 @-1 i7\n"
+                 "  aseq x0 op\n"
+                 "  pop_qw i7\n"
+                 "  add i0 i4 i6\n"
+                 "  add i0 i0 i7\n"
+                 "  ssw x0 @100 i2\n"
+                 "  lsw x0 @100 i8\n"
+                 "  add i0 i0 i8\n"
+                 "  ssdw i9 @0 i3\n"
+                 "  lsdw i9 @0 i8\n"
+                 "  add i0 i0 i8\n"
+                 "  exit\n",
+                 result_e::OKAY, 82});
+
+  // Several registers pushed and popped at once, laid out as single pushes
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  mov i1 @1\n"
+                 "  mov i2 @2\n"
+                 "  mov i4 @4\n"
+                 "  mov f3 @7\n"
+                 "  pushm i1 i2 i4 f3\n"
+                 "  pop_qw i8\n"
+                 "  push_qw i8\n"
+                 "  mov i1 @0\n"
+                 "  mov i2 @0\n"
+                 "  mov i4 @0\n"
+                 "  mov f3 @0\n"
+                 "  popm f3 i4 i2 i1\n"
+                 "  aseq i8 f3\n"
+                 "  add i0 i1 i2\n"
+                 "  add i0 i0 i4\n"
+                 "  pushm i0 i1 i2 i3 i4\n"
+                 "  lsqw sp @-40 i9\n"
+                 "  popm i0 i1 i2 i3 i4\n"
+                 "  add i0 i0 i9\n"
+                 "  aseq x0 sp\n"
+                 "  exit\n",
+                 result_e::OKAY, 14});
+
+  // Constants given straight to arithmetic and branches, the negative ones
+  // compared as the unsigned values they extend to
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  addi i0 i0 @3\n"
+                 "  addi i1 i1 @1\n"
+                 "  blti i1 @10 main\n"
+                 "  subi i0 i0 @2\n"
+                 "  muli i0 i0 @3\n"
+                 "  lshi i2 i0 @4\n"
+                 "  rshi i2 i2 @2\n"
+                 "  andi i2 i2 @255\n"
+                 "  ori i2 i2 @1\n"
+                 "  bgti i2 @80 over\n"
+                 "  exit\n"
+                 "over:\n"
+                 "  subi i3 x0 @1\n"
+                 "  beqi i3 @-1 negative\n"
+                 "  exit\n"
+                 "negative:\n"
+                 "  bgti i3 @-2 large\n"
+                 "  exit\n"
+                 "large:\n"
+                 "  blti x0 @-1 done\n"
+                 "  exit\n"
+                 "done:\n"
+                 "  add i0 i0 i2\n"
+                 "  exit\n",
+                 result_e::OKAY, 165});
+
+  // Runtime errors
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  div i0 i1 i2\n"
+                 "  exit\n",
+                 result_e::ERROR, 1});
+
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  ret\n",
+                 result_e::ERROR, 1});
+
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  push_qw i1\n"
+                 "  popm i1 i2\n"
+                 "  exit\n",
+                 result_e::ERROR, 1});
+
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "descend:\n"
+                 "  call descend\n"
+                 "main:\n"
+                 "  call descend\n"
+                 "  exit\n",
+                 result_e::ERROR, 1});
+
+  // Running off of the end of the program
+  tcs.push_back({".init main\n"
+                 ".code\n"
+                 "main:\n"
+                 "  nop\n",
+                 result_e::ERROR, 1});
+
+  for (auto &tc : tcs) {
+    for (auto engine : {skiff::machine::vm_c::engine_e::THREADED,
+                        skiff::machine::vm_c::engine_e::VISITOR}) {
+      auto executable = build_executable(tc.data);
+      CHECK_TRUE(executable != nullptr);
+
+      skiff::machine::vm_c vm;
+      vm.set_engine(engine);
+      CHECK_TRUE(vm.load(std::move(executable)));
+      CHECK_EQUAL(static_cast<int>(engine),
+                  static_cast<int>(vm.get_engine()));
+
+      auto [result, code] = vm.execute();
+      CHECK_EQUAL(static_cast<int>(tc.result), static_cast<int>(result));
+      CHECK_EQUAL(tc.exit_code, code);
+    }
+  }
+}
+
+TEST(vm_tests, interrupts_delivered)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  // Each interrupt is taken before the first instruction of main and
+  // returns back to it
+  std::string data = ".init main\n"
+                     ".code\n"
+                     "interrupt_3:\n"
+                     "  add i2 i2 x1\n"
+                     "  ret\n"
+                     "main:\n"
+                     "  mov i1 @2\n"
+                     "  aseq i2 i1\n"
+                     "  mov i0 @0\n"
+                     "  exit\n";
+
+  for (auto engine : {skiff::machine::vm_c::engine_e::THREADED,
+                      skiff::machine::vm_c::engine_e::VISITOR}) {
+    auto executable = build_executable(data);
+    CHECK_TRUE(executable != nullptr);
+
+    skiff::machine::vm_c vm;
+    vm.set_engine(engine);
+    CHECK_TRUE(vm.load(std::move(executable)));
+    CHECK_EQUAL(static_cast<int>(engine), static_cast<int>(vm.get_engine()));
+
+    CHECK_TRUE(vm.interrupt(3));
+    CHECK_TRUE(vm.interrupt(3));
+
+    auto [result, code] = vm.execute();
+    CHECK_EQUAL(
+        static_cast<int>(skiff::machine::vm_c::execution_result_e::OKAY),
+        static_cast<int>(result));
+    CHECK_EQUAL(0, code);
+  }
+}
+
+TEST(vm_tests, shared_program)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  auto executable = build_executable(".init main\n"
+                                     ".u64 limit 500\n"
+                                     ".code\n"
+                                     "main:\n"
+                                     "  mov i1 @0\n"
+                                     "  mov i2 &limit\n"
+                                     "  lqw i1 i2 i2\n"
+                                     "loop:\n"
+                                     "  add i0 i0 x1\n"
+                                     "  blt i0 i2 loop\n"
+                                     "  exit\n");
+  CHECK_TRUE(executable != nullptr);
+
+  auto [okay, program] = skiff::machine::program_c::decode(*executable);
+  CHECK_TRUE(okay);
+  CHECK_TRUE(program->is_threadable());
+
+  // Every vm binds the same decoded program to its own registers and memory
+  for (auto engine : {skiff::machine::vm_c::engine_e::THREADED,
+                      skiff::machine::vm_c::engine_e::VISITOR,
+                      skiff::machine::vm_c::engine_e::THREADED}) {
+    skiff::machine::vm_c vm;
+    vm.set_engine(engine);
+    CHECK_TRUE(vm.load(program));
+
+    auto [result, code] = vm.execute();
+    CHECK_EQUAL(
+        static_cast<int>(skiff::machine::vm_c::execution_result_e::OKAY),
+        static_cast<int>(result));
+    CHECK_EQUAL(500, code);
+  }
+}
+
+TEST(vm_tests, execution_limits)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  using result_e = skiff::machine::vm_c::execution_result_e;
+
+  // 1 + 2 * 100 + 1 instructions
+  auto executable = build_executable(".init main\n"
+                                     ".code\n"
+                                     "main:\n"
+                                     "  mov i1 @100\n"
+                                     "loop:\n"
+                                     "  add i0 i0 x1\n"
+                                     "  blt i0 i1 loop\n"
+                                     "  exit\n");
+  CHECK_TRUE(executable != nullptr);
+
+  auto [okay, program] = skiff::machine::program_c::decode(*executable);
+  CHECK_TRUE(okay);
+
+  for (auto engine : {skiff::machine::vm_c::engine_e::THREADED,
+                      skiff::machine::vm_c::engine_e::VISITOR}) {
+    skiff::machine::vm_c vm;
+    vm.set_engine(engine);
+    CHECK_TRUE(vm.load(program));
+
+    // An empty budget yields without making progress
+    {
+      auto [result, code] = vm.execute({.max_instructions = 0});
+      CHECK_EQUAL(static_cast<int>(result_e::YIELDED),
+                  static_cast<int>(result));
+    }
+
+    // Exactly 10 instructions run per call
+    std::size_t yields{0};
+    while (true) {
+      auto [result, code] = vm.execute({.max_instructions = 10});
+      if (result != result_e::YIELDED) {
+        CHECK_EQUAL(static_cast<int>(result_e::OKAY),
+                    static_cast<int>(result));
+        CHECK_EQUAL(100, code);
+        break;
+      }
+      yields++;
+    }
+    CHECK_EQUAL(20, yields);
+
+    // A finished vm keeps reporting its result
+    auto [result, code] = vm.execute({.max_instructions = 10});
+    CHECK_EQUAL(static_cast<int>(result_e::OKAY), static_cast<int>(result));
+    CHECK_EQUAL(100, code);
+  }
+
+  // A passed deadline yields once the first check interval has run
+  auto long_running = build_executable(".init main\n"
+                                       ".code\n"
+                                       "main:\n"
+                                       "  mov i1 @100000\n"
+                                       "loop:\n"
+                                       "  add i0 i0 x1\n"
+                                       "  blt i0 i1 loop\n"
+                                       "  exit\n");
+  CHECK_TRUE(long_running != nullptr);
+
+  auto [long_okay, long_program] =
+      skiff::machine::program_c::decode(*long_running);
+  CHECK_TRUE(long_okay);
+
+  for (auto engine : {skiff::machine::vm_c::engine_e::THREADED,
+                      skiff::machine::vm_c::engine_e::VISITOR}) {
+    skiff::machine::vm_c vm;
+    vm.set_engine(engine);
+    CHECK_TRUE(vm.load(long_program));
+
+    auto [yielded, unused] =
+        vm.execute({.deadline = std::chrono::steady_clock::now()});
+    CHECK_EQUAL(static_cast<int>(result_e::YIELDED),
+                static_cast<int>(yielded));
+
+    auto [result, code] = vm.execute();
+    CHECK_EQUAL(static_cast<int>(result_e::OKAY), static_cast<int>(result));
+    CHECK_EQUAL(100000, code);
+  }
+}
+
+TEST(vm_tests, verified_programs)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  using result_e = skiff::machine::vm_c::execution_result_e;
+
+  struct tc_verify_t {
+    tc_vm_t run;
+    bool verified;
+  };
+
+  std::vector<tc_verify_t> tcs;
+
+  // Every transfer of control stays in range
+  tcs.push_back({{".init main\n"
+                  ".code\n"
+                  "handler:\n"
+                  "  ret\n"
+                  "main:\n"
+                  "  mov i1 @10\n"
+                  "loop:\n"
+                  "  add i0 i0 x1\n"
+                  "  call handler\n"
+                  "  blt i0 i1 loop\n"
+                  "  exit\n",
+                  result_e::OKAY, 10},
+                 true});
+
+  tcs.push_back({{".init main\n"
+                  ".code\n"
+                  "main:\n"
+                  "  mov i0 @3\n"
+                  "  beq i0 i0 done\n"
+                  "  jmp main\n"
+                  "done:\n"
+                  "  exit\n"
+                  "  jmp done\n",
+                  result_e::OKAY, 3},
+                 true});
+
+  // Falls off of the end of the program
+  tcs.push_back({{".init main\n"
+                  ".code\n"
+                  "main:\n"
+                  "  mov i0 @3\n",
+                  result_e::ERROR, 1},
+                 false});
+
+  // Returns past the end of the program
+  tcs.push_back({{".init main\n"
+                  ".code\n"
+                  "routine:\n"
+                  "  ret\n"
+                  "main:\n"
+                  "  call routine\n",
+                  result_e::ERROR, 1},
+                 false});
+
+  for (auto &tc : tcs) {
+    auto executable = build_executable(tc.run.data);
+    CHECK_TRUE(executable != nullptr);
+
+    auto [okay, program] = skiff::machine::program_c::decode(*executable);
+    CHECK_TRUE(okay);
+    CHECK_EQUAL(tc.verified, program->is_verified());
+
+    for (auto engine : {skiff::machine::vm_c::engine_e::THREADED,
+                        skiff::machine::vm_c::engine_e::VISITOR}) {
+      skiff::machine::vm_c vm;
+      vm.set_engine(engine);
+      CHECK_TRUE(vm.load(program));
+
+      auto [result, code] = vm.execute();
+      CHECK_EQUAL(static_cast<int>(tc.run.result), static_cast<int>(result));
+      CHECK_EQUAL(tc.run.exit_code, code);
+    }
+  }
+}
+
+TEST(vm_tests, superinstructions)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  using op = skiff::machine::threaded_opcode_e;
+  using result_e = skiff::machine::vm_c::execution_result_e;
+
+  auto executable = build_executable(".init main\n"
+                                     ".code\n"
+                                     "save:\n"
+                                     "  push_qw i0\n"
+                                     "  push_qw i1\n"
+                                     "  push_qw i2\n"
+                                     "  ret\n"
+                                     "restore:\n"
+                                     "  pop_qw i2\n"
+                                     "  pop_qw i1\n"
+                                     "  pop_qw i0\n"
+                                     "  ret\n"
+                                     "main:\n"
+                                     "  mov i1 @64\n"
+                                     "  alloc i8 i1\n"
+                                     "  mov i1 @10\n"
+                                     "loop:\n"
+                                     "  mov i3 @8\n"
+                                     "  add i4 i4 i3\n"
+                                     "  sqw i8 x0 i4\n"
+                                     "  call save\n"
+                                     "  mov i2 @16\n"
+                                     "  add i5 i5 i2\n"
+                                     "  sw i8 i2 i5\n"
+                                     "  call restore\n"
+                                     "  add i0 i0 x1\n"
+                                     "  blt i0 i1 loop\n"
+                                     "  lqw i8 x0 i6\n"
+                                     "  mov i7 @80\n"
+                                     "  aseq i6 i7\n"
+                                     "  mov i2 @16\n"
+                                     "  lw i8 i2 i6\n"
+                                     "  mov i7 @160\n"
+                                     "  aseq i6 i7\n"
+                                     "  exit\n");
+  CHECK_TRUE(executable != nullptr);
+
+  auto [okay, program] = skiff::machine::program_c::decode(*executable);
+  CHECK_TRUE(okay);
+
+  // Runs are fused from every address in them
+  auto &counts = program->get_superinstruction_counts();
+  CHECK_EQUAL(2, counts.at(op::PUSH_QW_N));
+  CHECK_EQUAL(2, counts.at(op::POP_QW_N));
+  CHECK_EQUAL(1, counts.at(op::MOV_ADD_SQW));
+  CHECK_EQUAL(1, counts.at(op::MOV_ADD_SW));
+  CHECK_EQUAL(1, counts.at(op::ADD_SQW));
+  CHECK_EQUAL(1, counts.at(op::ADD_SW));
+  CHECK_EQUAL(1, counts.at(op::ADD_BLT));
+
+  // The original instructions are untouched
+  for (auto &ins : program->get_instructions()) {
+    CHECK_FALSE(skiff::machine::is_superinstruction(ins.opcode));
+  }
+
+  // Budgets that stop part way through a superinstruction resume correctly
+  for (uint64_t budget : {std::numeric_limits<uint64_t>::max(), 1ul, 2ul,
+                          3ul}) {
+    skiff::machine::vm_c vm;
+    vm.set_engine(skiff::machine::vm_c::engine_e::THREADED);
+    CHECK_TRUE(vm.load(program));
+
+    while (true) {
+      auto [result, code] = vm.execute({.max_instructions = budget});
+      if (result != result_e::YIELDED) {
+        CHECK_EQUAL(static_cast<int>(result_e::OKAY),
+                    static_cast<int>(result));
+        CHECK_EQUAL(10, code);
+        break;
+      }
+    }
+  }
+}
+
+TEST(vm_tests, byte_order)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  using result_e = skiff::machine::vm_c::execution_result_e;
+  using order_e = skiff::machine::memory::byte_order_e;
+
+  // Constants are read correctly whatever order allocated memory uses,
+  // the program exits with the first byte of a stored dword
+  const std::string data = ".init main\n"
+                           ".u64 value 4660\n"
+                           ".code\n"
+                           "main:\n"
+                           "  mov i8 &value\n"
+                           "  lqw x0 i8 i1\n"
+                           "  mov i2 @4660\n"
+                           "  aseq i1 i2\n"
+                           "  mov i3 @16\n"
+                           "  alloc i4 i3\n"
+                           "  mov i5 @287454020\n"
+                           "  sdw i4 x0 i5\n"
+                           "  lhw i4 x0 i0\n"
+                           "  exit\n";
+
+  const int native_first =
+      std::endian::native == std::endian::little ? 0x44 : 0x11;
+
+  for (auto [order, expected] : {std::pair{order_e::BIG, 0x11},
+                                 std::pair{order_e::NATIVE, native_first}}) {
+    for (auto engine : {skiff::machine::vm_c::engine_e::THREADED,
+                        skiff::machine::vm_c::engine_e::VISITOR}) {
+      auto executable = build_executable(data);
+      CHECK_TRUE(executable != nullptr);
+
+      skiff::machine::vm_c vm;
+      vm.set_engine(engine);
+      vm.set_byte_order(order);
+      CHECK_TRUE(vm.load(std::move(executable)));
+
+      auto [result, code] = vm.execute();
+      CHECK_EQUAL(static_cast<int>(result_e::OKAY), static_cast<int>(result));
+      CHECK_EQUAL(expected, code);
+    }
+  }
+}
+
+TEST(vm_tests, memory_limit)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  using result_e = skiff::machine::vm_c::execution_result_e;
+
+  // Allocations past the limit fail through op and leave the program
+  // running, it exits with the number of slots it got
+  const std::string data = ".init main\n"
+                           ".code\n"
+                           "main:\n"
+                           "  mov i1 @400\n"
+                           "  mov i0 @0\n"
+                           "loop:\n"
+                           "  alloc i2 i1\n"
+                           "  beq op x0 done\n"
+                           "  add i0 i0 x1\n"
+                           "  blt i0 i1 loop\n"
+                           "done:\n"
+                           "  exit\n";
+
+  for (auto [limit, expected] :
+       {std::pair{uint64_t{1000}, 2}, std::pair{uint64_t{4000}, 10}}) {
+    for (auto engine : {skiff::machine::vm_c::engine_e::THREADED,
+                        skiff::machine::vm_c::engine_e::VISITOR,
+                        skiff::machine::vm_c::engine_e::NATIVE}) {
+      auto executable = build_executable(data);
+      CHECK_TRUE(executable != nullptr);
+
+      skiff::machine::vm_c vm;
+      vm.set_engine(engine);
+      vm.set_memory_limit(limit);
+      CHECK_TRUE(vm.load(std::move(executable)));
+
+      auto [result, code] = vm.execute();
+      CHECK_EQUAL(static_cast<int>(result_e::OKAY), static_cast<int>(result));
+      CHECK_EQUAL(expected, code);
+    }
+  }
+
+  // Bytes a region carved count until the region is freed, even once the
+  // slot has moved off them or been freed. Grows a slot in a region by 1KiB
+  // until refused, counting the resizes in i0, then allocates 2KiB with
+  // the slot freed and again with the region freed, adding op each time
+  const std::string region_data = ".init main\n"
+                                  ".code\n"
+                                  "main:\n"
+                                  "  region_begin i5\n"
+                                  "  mov i3 @16\n"
+                                  "  alloc i2 i3\n"
+                                  "  mov i4 @1024\n"
+                                  "  mov i0 @0\n"
+                                  "loop:\n"
+                                  "  add i3 i3 i4\n"
+                                  "  realloc i2 i3\n"
+                                  "  beq op x0 done\n"
+                                  "  add i0 i0 x1\n"
+                                  "  jmp loop\n"
+                                  "done:\n"
+                                  "  free i2\n"
+                                  "  mov i3 @2048\n"
+                                  "  alloc i6 i3\n"
+                                  "  add i0 i0 op\n"
+                                  "  region_free i5\n"
+                                  "  alloc i6 i3\n"
+                                  "  add i0 i0 op\n"
+                                  "  exit\n";
+
+  for (auto engine : {skiff::machine::vm_c::engine_e::THREADED,
+                      skiff::machine::vm_c::engine_e::VISITOR,
+                      skiff::machine::vm_c::engine_e::NATIVE}) {
+    auto executable = build_executable(region_data);
+    CHECK_TRUE(executable != nullptr);
+
+    skiff::machine::vm_c vm;
+    vm.set_engine(engine);
+    vm.set_memory_limit(4096);
+    CHECK_TRUE(vm.load(std::move(executable)));
+
+    auto [result, code] = vm.execute();
+    CHECK_EQUAL(static_cast<int>(result_e::OKAY), static_cast<int>(result));
+    CHECK_EQUAL(3, code);
+  }
+}
+
+TEST(vm_tests, call_depth)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  using result_e = skiff::machine::vm_c::execution_result_e;
+  using error_e = skiff::types::runtime_error_e;
+
+  // Recurses i1 calls deep before returning all the way back up
+  auto build = [](const int depth) {
+    return build_executable(".init main\n"
+                            ".code\n"
+                            "descend:\n"
+                            "  add i0 i0 x1\n"
+                            "  blt i0 i1 deeper\n"
+                            "  ret\n"
+                            "deeper:\n"
+                            "  call descend\n"
+                            "  ret\n"
+                            "main:\n"
+                            "  mov i1 @" +
+                            std::to_string(depth) +
+                            "\n"
+                            "  call descend\n"
+                            "  exit\n");
+  };
+
+  for (auto engine : {skiff::machine::vm_c::engine_e::THREADED,
+                      skiff::machine::vm_c::engine_e::VISITOR,
+                      skiff::machine::vm_c::engine_e::NATIVE}) {
+    // Calls may nest as deep as the limit
+    skiff::machine::vm_c fits;
+    fits.set_engine(engine);
+    CHECK_TRUE(fits.set_call_depth(100));
+    CHECK_TRUE(fits.load(build(100)));
+    auto [fits_result, fits_code] = fits.execute();
+    CHECK_EQUAL(static_cast<int>(result_e::OKAY),
+                static_cast<int>(fits_result));
+    CHECK_EQUAL(100, fits_code);
+    CHECK_FALSE(fits.set_call_depth(1000));
+
+    // One more stops the binary with an overflow
+    std::optional<error_e> error;
+    skiff::machine::vm_c overflows;
+    overflows.set_engine(engine);
+    overflows.set_runtime_callback([&](error_e e) { error = e; });
+    CHECK_TRUE(overflows.set_call_depth(100));
+    CHECK_TRUE(overflows.load(build(101)));
+    auto [overflow_result, overflow_code] = overflows.execute();
+    CHECK_EQUAL(static_cast<int>(result_e::ERROR),
+                static_cast<int>(overflow_result));
+    CHECK_EQUAL(1, overflow_code);
+    CHECK_TRUE(error == error_e::CALL_STACK_OVERFLOW);
+  }
+}
+
+TEST(vm_tests, interrupt_at_call_depth)
+{
+  AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::fatal);
+
+  using result_e = skiff::machine::vm_c::execution_result_e;
+  using error_e = skiff::types::runtime_error_e;
+
+  // Spins two calls deep, counting in i0 for as long as it runs
+  std::string data = ".init main\n"
+                     ".code\n"
+                     "interrupt_3:\n"
+                     "  ret\n"
+                     "spin:\n"
+                     "  add i0 i0 x1\n"
+                     "  jmp spin\n"
+                     "outer:\n"
+                     "  call spin\n"
+                     "  ret\n"
+                     "main:\n"
+                     "  call outer\n"
+                     "  exit\n";
+
+  for (auto engine : {skiff::machine::vm_c::engine_e::THREADED,
+                      skiff::machine::vm_c::engine_e::VISITOR,
+                      skiff::machine::vm_c::engine_e::NATIVE}) {
+    std::optional<error_e> error;
+    skiff::machine::vm_c vm;
+    vm.set_engine(engine);
+    vm.set_runtime_callback([&](error_e e) { error = e; });
+    CHECK_TRUE(vm.set_call_depth(2));
+    CHECK_TRUE(vm.load(build_executable(data)));
+
+    auto [spinning, spinning_code] = vm.execute({.max_instructions = 100});
+    CHECK_EQUAL(static_cast<int>(result_e::YIELDED),
+                static_cast<int>(spinning));
+
+    // With the call stack full the interrupt can't be taken, and nothing
+    // runs once it has stopped the binary
+    CHECK_TRUE(vm.interrupt(3));
+    auto [result, code] = vm.execute({.max_instructions = 100});
+    CHECK_EQUAL(static_cast<int>(result_e::ERROR), static_cast<int>(result));
+    CHECK_EQUAL(1, code);
+    CHECK_TRUE(error == error_e::CALL_STACK_OVERFLOW);
+  }
+}
@@ -6,6 +6,7 @@
 #include <array>
 #include <cstdint>
 #include <functional>
+#include <span>
 #include <string>
 
 namespace skiff {
@@ -18,7 +19,8 @@ enum class runtime_error_e {
   ILLEGAL_INSTRUCTION,
   INSTRUCTION_PTR_OUT_OF_RANGE,
   STACK_PUSH_ERROR,
-  STACK_POP_ERROR
+  STACK_POP_ERROR,
+  CALL_STACK_OVERFLOW
 };
 
 //! \brief Callback that will receive runtime errors
@@ -31,12 +33,28 @@ using interrupt_cb = std::function<bool(const uint64_t)>;
 //! \brief Register for vm
 using vm_register = uint64_t;
 
+//! \brief Location of each register within a register file
+namespace reg {
+static constexpr uint8_t x0 = 0;
+static constexpr uint8_t x1 = 1;
+static constexpr uint8_t ip = 2;
+static constexpr uint8_t sp = 3;
+static constexpr uint8_t op = 4;
+static constexpr uint8_t sink = 5; // Absorbs writes aimed at x0 / x1
+static constexpr uint8_t i0 = 6;
+static constexpr uint8_t f0 = i0 + config::num_integer_registers;
+static constexpr uint8_t count = f0 + config::num_floating_point_registers;
+} // namespace reg
+
+//! \brief Contiguous storage for every register of a vm
+using register_file_t = std::array<vm_register, reg::count>;
+
 //! \brief Information type passed to system functions
 struct view_t {
-  std::array<types::vm_register, config::num_integer_registers>
-      &integer_registers;
-  std::array<types::vm_register, config::num_floating_point_registers>
-      &float_registers;
+  std::span<types::vm_register, config::num_integer_registers>
+      integer_registers;
+  std::span<types::vm_register, config::num_floating_point_registers>
+      float_registers;
   skiff::machine::memory::memman_c &memory_manager;
   types::vm_register &op_register;
 };
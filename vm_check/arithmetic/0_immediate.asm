@@ -0,0 +1,53 @@
+; This program gives constants straight to arithmetic and branches rather
+; than moving them into a register first.
+
+.init main
+.code
+
+killing_floor:
+  aseq x0 x1                 ; Can never be true (constant 0, constant 1)
+  ret
+
+main:
+  addi i0 x0 @40             ; 40
+  subi i0 i0 @10             ; 30
+  muli i0 i0 @3              ; 90
+  mov i9 @90
+  aseq i9 i0
+
+  lshi i1 i0 @4              ; 1440
+  rshi i1 i1 @3              ; 180
+  mov i9 @180
+  aseq i9 i1
+
+  andi i2 i1 @15             ; 4
+  ori i2 i2 @3               ; 7
+  mov i9 @7
+  aseq i9 i2
+
+  addi i3 x0 @-1             ; Negative values wrap like any other
+  mov i9 @18446744073709551615
+  aseq i9 i3
+
+  blti i2 @7 killing_floor   ; None of these should hit
+  bgti i2 @7 killing_floor
+  beqi i2 @8 killing_floor
+  bgti x0 @-1 killing_floor  ; -1 compares as the largest value there is
+
+  mov i4 @0
+count:                       ; Loops need no register for the bound
+  addi i4 i4 @1
+  blti i4 @100 count
+  mov i9 @100
+  aseq i9 i4
+
+  beqi i3 @-1 spot_one
+  jmp killing_floor          ; Should jump over
+
+spot_one:
+  bgti i3 @2147483647 spot_two
+  jmp killing_floor          ; Should jump over
+
+spot_two:
+  mov i0 @0
+  exit
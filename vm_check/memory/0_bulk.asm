@@ -0,0 +1,58 @@
+; This program fills a slot, copies part of it into a second slot and
+; compares the two. It then checks that ranges reaching past the end of a
+; slot are rejected without touching memory.
+
+.init main
+.code 
+main:
+  mov i7 @64                ; Slot size
+  alloc i1 i7               ; Source slot
+  aseq x1 op
+  alloc i2 i7               ; Destination slot
+  aseq x1 op
+
+  mov i3 @170               ; Fill value
+  mov op @0                 ; Clear op reg
+  mset i1 x0 i7 i3          ; Fill all of the source slot
+  aseq x1 op
+
+  mov i4 @8                 ; Offset
+  mov i5 @32                ; Length
+  mov op @0
+  mcpy i2 i4 i1 x0 i5       ; Copy 32 bytes into the destination at 8
+  aseq x1 op
+
+  lhw i2 i4 i6              ; First copied byte
+  aseq i3 i6
+  lhw i2 x0 i6              ; Byte before the copy is untouched
+  aseq x0 i6
+
+  mov op @0
+  mcmp i8 i2 i4 i1 x0 i5    ; Copied range matches the source
+  aseq x1 op
+  aseq x0 i8
+
+  mcmp i8 i2 x0 i1 x0 i5    ; Zeroed bytes order before the filled ones
+  mov i9 @1
+  aseq i9 i8
+  mcmp i8 i1 x0 i2 x0 i5    ; And the other way around
+  mov i9 @2
+  aseq i9 i8
+
+  mcpy i2 x0 i2 i4 i5       ; Overlapping copy within a slot
+  aseq x1 op
+  lhw i2 x0 i6
+  aseq i3 i6
+
+  mov i5 @57                ; 8 + 57 runs past the end of the slot
+  mset i2 i4 i5 x0
+  aseq x0 op
+  mcpy i2 i4 i1 x0 i5
+  aseq x0 op
+  mcmp i8 i2 i4 i1 x0 i5
+  aseq x0 op
+  lhw i2 i4 i6              ; Nothing was written
+  aseq i3 i6
+
+  mov i0 @0                 ; Return code
+  exit
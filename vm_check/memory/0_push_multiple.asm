@@ -0,0 +1,56 @@
+; This program saves and restores registers with pushm and popm, and checks
+; that the stack is laid out as single pushes would leave it.
+
+.init main
+.code 
+clobber:
+  pushm i1 i2 i5 f3         ; Save what is about to change
+  mov i1 @0
+  mov i2 @0
+  mov i5 @0
+  mov f3 @0
+  popm f3 i5 i2 i1          ; The order they are listed in doesn't matter
+  ret
+
+main:
+  mov i1 @11
+  mov i2 @22
+  mov i5 @55
+  mov f3 @33
+  call clobber
+
+  mov i9 @11
+  aseq i9 i1
+  mov i9 @22
+  aseq i9 i2
+  mov i9 @55
+  aseq i9 i5
+  mov i9 @33
+  aseq i9 f3
+
+  pushm i1 i2 i5            ; Pushed in order of the registers
+  pop_qw i9
+  mov i8 @55
+  aseq i8 i9
+  pop_qw i9
+  mov i8 @22
+  aseq i8 i9
+  pop_qw i9
+  mov i8 @11
+  aseq i8 i9
+
+  push_qw i1                ; And popped back the same way
+  push_qw i2
+  push_qw i5
+  mov i1 @0
+  mov i2 @0
+  mov i5 @0
+  popm i1 i2 i5
+  mov i9 @11
+  aseq i9 i1
+  mov i9 @55
+  aseq i9 i5
+  aseq x0 sp
+
+  mov i0 @0                 ; Return code
+  exit
@@ -0,0 +1,39 @@
+; This program grows a slot well past its original size and shrinks it
+; again, checking that its id and contents survive each resize.
+
+.init main
+.code 
+main:
+  mov i7 @16                ; Original size
+  alloc i1 i7
+  aseq x1 op
+
+  mov i2 @4242
+  sqw i1 x0 i2              ; Something to keep
+
+  mov i3 @1048576           ; Grow to a megabyte
+  mov op @0
+  realloc i1 i3
+  aseq x1 op
+
+  lqw i1 x0 i4              ; Still there
+  aseq i2 i4
+
+  mov i5 @1048560           ; Near the end of the grown slot
+  sqw i1 i5 i2
+  aseq x1 op
+
+  mov op @0
+  realloc i1 i7             ; Back to the original size
+  aseq x1 op
+  lqw i1 x0 i4
+  aseq i2 i4
+  lqw i1 i5 i4              ; The end is gone
+  aseq x0 op
+
+  free i1
+  realloc i1 i7             ; Freed slots can't be resized
+  aseq x0 op
+
+  mov i0 @0                 ; Return code
+  exit
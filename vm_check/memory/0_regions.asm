@@ -0,0 +1,50 @@
+; This program allocates slots inside of a region, nesting a second region
+; inside of the first, then frees the outer region in a single instruction.
+; Every slot allocated in either region must be gone afterwards, while a slot
+; allocated before the region was opened must remain.
+
+.init main
+.code 
+main:
+  mov i7 @64                ; Slot size
+  mov i8 @0                 ; Counter
+  mov i9 @100               ; Upper limit
+
+  alloc i6 i7               ; Slot outside of any region
+  aseq x1 op
+
+  mov op @0                 ; Clear op reg
+  region_begin i5           ; Open the outer region, its id in i5
+  aseq x1 op
+
+allocate_top:
+  mov op @0                 ; Clear op reg
+  alloc i1 i7               ; Allocate a slot in the region
+  aseq x1 op                ; Ensure memory was allocated
+  sqw i1 x0 i8              ; Use it
+  add i8 i8 x1              ; Add one to counter 
+  blt i8 i9 allocate_top    ; branch to allocate_top 
+
+  region_begin i4           ; Open an inner region
+  alloc i2 i7               ; Allocate a slot in the inner region
+  aseq x1 op
+
+  mov op @0                 ; Clear op reg
+  region_free i5            ; Free both regions at once
+  aseq x1 op
+
+  mov op @0
+  sqw i1 x0 i8              ; The last slot of the outer region is gone
+  aseq x0 op
+  sqw i2 x0 i8              ; So is the slot of the inner region
+  aseq x0 op
+  region_free i4            ; And the inner region itself
+  aseq x0 op
+
+  sqw i6 x0 i8              ; The slot outside of the region remains
+  aseq x1 op
+  free i6
+  aseq x1 op
+
+  mov i0 @0                 ; Return code
+  exit
@@ -0,0 +1,41 @@
+; This program keeps locals on the stack and reaches them relative to the
+; stack pointer and to a frame register, rather than pushing and popping.
+
+.init main
+.code 
+main:
+  mov i1 @7
+  mov i2 @8
+  push_qw i1                ; Two locals
+  push_qw i2
+  add i9 sp x0              ; Frame register, one past the last local
+
+  lsqw sp @-16 i3           ; First local
+  aseq x1 op
+  aseq i1 i3
+
+  mov i4 @99
+  ssqw i9 @-8 i4            ; Replace the second local
+  aseq x1 op
+  lsqw sp @-8 i3
+  aseq i4 i3
+
+  ssdw i9 @0 i2             ; Smaller accesses past the locals
+  lsdw i9 @0 i3
+  aseq i2 i3
+  ssw i9 @4 i1
+  lsw i9 @4 i3
+  aseq i1 i3
+
+  lsqw x0 @-8 i3            ; Before the stack
+  aseq x0 op
+  ssqw sp @1048576 i3       ; Past the end of the stack
+  aseq x0 op
+
+  pop_qw i3
+  aseq i4 i3
+  pop_qw i3
+  aseq i1 i3
+
+  mov i0 @0                 ; Return code
+  exit
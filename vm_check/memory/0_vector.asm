@@ -0,0 +1,53 @@
+; This program adds two slots lane by lane, then sums, finds the largest
+; lane of and takes the dot product of the results. It then checks that
+; ranges reaching past the end of a slot are rejected.
+
+.init main
+.code 
+main:
+  mov i7 @64                ; Slot size
+  alloc i1 i7               ; Left hand slot
+  aseq x1 op
+  alloc i2 i7               ; Right hand slot
+  aseq x1 op
+
+  mov i3 @2
+  mset i1 x0 i7 i3          ; Every byte of the left hand slot is 2
+  mov i3 @5
+  mset i2 x0 i7 i3          ; Every byte of the right hand slot is 5
+
+  mov i4 @16                ; Lanes
+  mov op @0
+  vadd_u32 i2 x0 i1 x0 i2 x0 i4 ; Every byte of the right hand slot is 7
+  aseq x1 op
+
+  lhw i2 x0 i5
+  mov i6 @7
+  aseq i6 i5
+
+  mov op @0
+  vsum_u8 i5 i2 x0 i7       ; 64 lanes of 7
+  aseq x1 op
+  mov i6 @448
+  aseq i6 i5
+
+  vhmax_u64 i5 i2 x0 x1     ; The largest of one lane is itself
+  mov i6 @506381209866536711
+  aseq i6 i5
+
+  vdot_u8 i5 i1 x0 i2 x0 i7 ; 64 products of 2 and 7
+  mov i6 @896
+  aseq i6 i5
+
+  mov i4 @9                 ; 9 lanes of 8 bytes run past the end
+  mov op @1
+  vsum_u64 i5 i2 x0 i4
+  aseq x0 op
+  vadd_u64 i2 x0 i1 x0 i2 x0 i4
+  aseq x0 op
+  lhw i2 x0 i5              ; Nothing was written
+  mov i6 @7
+  aseq i6 i5
+
+  mov i0 @0                 ; Return code
+  exit
@@ -67,31 +67,13 @@ fn_print_item:
 ; Save registers used for printing 
 ;
 fn_save_registers:
-  push_qw i0
-  push_qw i1
-  push_qw i2
-  push_qw i3
-  push_qw i4
-  push_qw i5
-  push_qw i6
-  push_qw i7
-  push_qw i8
-  push_qw i9
+  pushm i0 i1 i2 i3 i4 i5 i6 i7 i8 i9
   ret
 
 ; Restore the registers used for printing
 ;
 fn_restore_registers:
-  pop_qw i9
-  pop_qw i8
-  pop_qw i7
-  pop_qw i6
-  pop_qw i5
-  pop_qw i4
-  pop_qw i3
-  pop_qw i2
-  pop_qw i1
-  pop_qw i0
+  popm i0 i1 i2 i3 i4 i5 i6 i7 i8 i9
   ret
 
 ; Declare that we will be using `0` as an interrupt code
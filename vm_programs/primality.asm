@@ -22,10 +22,7 @@
 fn_modulus:
 
   ; Save register states 
-  push_qw i1
-  push_qw i2
-  push_qw i3
-  push_qw i4
+  pushm i1 i2 i3
 
   ; Check for 0 RHS
   mov i0 @0
@@ -33,8 +30,7 @@ fn_modulus:
 
   ; Perform modulous operation
 	div i3 i1 i2
-  mov i4 @0
-	beq i3 i4 l_modulous_is_zero
+	beqi i3 @0 l_modulous_is_zero
 	jmp l_modulus_is_non_zero
 
 l_modulous_is_zero:
@@ -49,10 +45,7 @@ l_modulus_is_non_zero:
 l_modulus_complete:
 
   ; Restore saved registers
-  pop_qw i4
-  pop_qw i3
-  pop_qw i2
-  pop_qw i1
+  popm i1 i2 i3
   ret
 
 ; IS_PRIME
@@ -85,7 +78,6 @@ fn_is_prime:
   beq i0 x0 l_item_is_not_prime
 
   mov i2 @5 ; i 
-  mov i3 @6
 
   ; Check to see if the loop needs to be ran 
   mul i8 i2 i2 
@@ -105,8 +97,7 @@ l_primality_loop_top_0:
   push_qw i2 
 
   ; n % (i+2) == 0 ? 
-  mov i8 @2
-  add i2 i2 i8  ; i+2
+  addi i2 i2 @2  ; i+2
 
   ; debug 1
   call fn_modulus
@@ -117,7 +108,7 @@ l_primality_loop_top_0:
   pop_qw  i2
 
   ; i += 6
-  add i2 i2 i3 
+  addi i2 i2 @6
 
   ; i * i <= 'n'
   mul i8 i2 i2 
@@ -181,31 +172,27 @@ l_end:
 ; MAIN
 fn_main:
   mov i0 @0
-  mov i1 @30
 
 l_main_primality_check_loop_top:
 
   ; Store 'n' in memory
   sw x0 x0 i0
 
-  ; Save loop counter and limit 
+  ; Save loop counter
   push_qw i0
-  push_qw i1
 
   ; i0 (counter) is being checked
   call fn_is_prime
   call fn_print_result
 
-  ; Restore counter and limit 
-  pop_qw i1
+  ; Restore counter
   pop_qw i0
 
   ; Add one to counter
-  mov i2 @1
-  add i0 i0 i2
+  addi i0 i0 @1
 
   ; Check loop condition
-  blt i0 i1 l_main_primality_check_loop_top
+  blti i0 @30 l_main_primality_check_loop_top
 
   #EXIT_SUCCESS
 